@@ -9,6 +9,8 @@ LOCAL_SRC_FILES:=                       \
         DashPlayerDriver.cpp            \
         DashPlayerRenderer.cpp          \
         DashPlayerStats.cpp             \
+        DashPlayerMetrics.cpp           \
+        DashDecodePredictor.cpp         \
         DashPlayerDecoder.cpp           \
         DashPacketSource.cpp            \
         DashFactory.cpp                 \
@@ -53,4 +55,49 @@ LOCAL_MODULE:= libdashplayer
 LOCAL_MODULE_TAGS := eng
 
 include $(BUILD_SHARED_LIBRARY)
+
+# ---------------------------------------------------------------------------------
+#            Make the packet source stress test (dash-packet-source-test)
+# ---------------------------------------------------------------------------------
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:=                       \
+        test/DashPacketSourceTest.cpp
+
+LOCAL_SHARED_LIBRARIES :=       \
+    libdashplayer               \
+    libstagefright              \
+    libstagefright_foundation   \
+    libutils                    \
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)                                                 \
+	$(TOP)/frameworks/av/media/libstagefright/mpeg2ts             \
+
+LOCAL_MODULE:= dash-packet-source-test
+
+LOCAL_MODULE_TAGS := debug
+
+include $(BUILD_EXECUTABLE)
+
+# ---------------------------------------------------------------------------------
+#            Make the decode predictor test (dash-decode-predictor-test)
+# ---------------------------------------------------------------------------------
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:=                       \
+        test/DashDecodePredictorTest.cpp
+
+LOCAL_SHARED_LIBRARIES :=       \
+    libdashplayer               \
+    libutils                    \
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)                                                 \
+
+LOCAL_MODULE:= dash-decode-predictor-test
+
+LOCAL_MODULE_TAGS := debug
+
+include $(BUILD_EXECUTABLE)
 #endif
@@ -43,8 +43,8 @@
 
 //Smmoth streaming settings
 //Max resolution 1080p
-#define MAX_WIDTH 1920;
-#define MAX_HEIGHT 1080;
+#define MAX_WIDTH 1920
+#define MAX_HEIGHT 1080
 
 //Min resolution QVGA
 #define MIN_WIDTH 480;
@@ -378,7 +378,10 @@ DashCodec::DashCodec()
       mEncoderPadding(0),
       mChannelMaskPresent(false),
       mChannelMask(0),
-      mAdaptivePlayback(false){
+      mAdaptivePlayback(false),
+      mLastFrameUs(-1),
+      mSwitchStartUs(-1),
+      mSwitchReconfig(false){
     mUninitializedState = new UninitializedState(this);
     mLoadedState = new LoadedState(this);
     mLoadedToIdleState = new LoadedToIdleState(this);
@@ -959,6 +962,14 @@ status_t DashCodec::configureCodec(
         }
     }
 
+    // Largest resolution the stream may switch to, declared by the client
+    int32_t maxWidth, maxHeight;
+    if (!msg->findInt32("max-width", &maxWidth)
+            || !msg->findInt32("max-height", &maxHeight)) {
+        maxWidth = MAX_WIDTH;
+        maxHeight = MAX_HEIGHT;
+    }
+
     // Always try to enable dynamic output buffers on native surface
     int32_t video = !strncasecmp(mime, "video/", 6);
     sp<RefBase> obj;
@@ -994,8 +1005,6 @@ status_t DashCodec::configureCodec(
                             (GRALLOC_USAGE_SW_READ_MASK |
                              GRALLOC_USAGE_SW_WRITE_MASK)) == 0;
             }
-            int32_t maxWidth = MAX_WIDTH;
-            int32_t maxHeight = MAX_HEIGHT;
             if (mAdaptivePlayback) {
                 ALOGV("[%s] prepareForAdaptivePlayback(%ldx%ld)",
                       mComponentName.c_str(), maxWidth, maxHeight);
@@ -1031,8 +1040,8 @@ status_t DashCodec::configureCodec(
             } else {
                 //override height & width with max for smooth streaming
                 if (mAdaptivePlayback) {
-                    width = MAX_WIDTH;
-                    height = MAX_HEIGHT;
+                    width = width > maxWidth ? width : maxWidth;
+                    height = height > maxHeight ? height : maxHeight;
                 }
                 err = setupVideoDecoder(mime, width, height);
             }
@@ -2815,6 +2824,12 @@ void DashCodec::BaseState::onInputBufferFilled(const sp<AMessage> &msg) {
                     flags |= OMX_BUFFERFLAG_CODECCONFIG;
                 }
 
+                int32_t decodeOnly;
+                if (buffer->meta()->findInt32("decode-only", &decodeOnly)
+                        && decodeOnly != 0) {
+                    flags |= OMX_BUFFERFLAG_DECODEONLY;
+                }
+
                 if (eos) {
                     flags |= OMX_BUFFERFLAG_EOS;
                 }
@@ -2979,7 +2994,10 @@ bool DashCodec::BaseState::onOMXFillBufferDone(
 
         case RESUBMIT_BUFFERS:
         {
-            if (rangeLength == 0 && !(flags & OMX_BUFFERFLAG_EOS)) {
+            // Frames only decoded to get to the seek target go straight
+            // back to the component, like empty ones.
+            if ((rangeLength == 0 || (flags & OMX_BUFFERFLAG_DECODEONLY))
+                    && !(flags & OMX_BUFFERFLAG_EOS)) {
                 ALOGV("[%s] calling fillBuffer %p",
                      mCodec->mComponentName.c_str(), info->mBufferID);
 
@@ -3006,6 +3024,18 @@ bool DashCodec::BaseState::onOMXFillBufferDone(
                 mCodec->sendFormatChange();
             }
 
+            int64_t nowUs = ALooper::GetNowUs();
+            if (rangeLength > 0) {
+                if (mCodec->mSwitchStartUs >= 0) {
+                    ALOGI("[%s] resolution switch (%s) output gap %lld us",
+                          mCodec->mComponentName.c_str(),
+                          mCodec->mSwitchReconfig ? "port reconfig" : "crop only",
+                          nowUs - mCodec->mSwitchStartUs);
+                    mCodec->mSwitchStartUs = -1;
+                }
+                mCodec->mLastFrameUs = nowUs;
+            }
+
             if (mCodec->mNativeWindow == NULL) {
                 info->mData->setRange(rangeOffset, rangeLength);
 
@@ -3020,6 +3050,7 @@ bool DashCodec::BaseState::onOMXFillBufferDone(
                 mCodec->mSkipCutBuffer->submit(info->mData);
             }
             info->mData->meta()->setInt64("timeUs", timeUs);
+            info->mData->meta()->setInt64("fbdTimeUs", nowUs);
 
             sp<AMessage> notify = mCodec->mNotify->dup();
             notify->setInt32("what", CodecBase::kWhatDrainThisBuffer);
@@ -3691,7 +3722,16 @@ bool DashCodec::ExecutingState::onOMXEvent(
         {
             CHECK_EQ(data1, (OMX_U32)kPortIndexOutput);
 
-            if (data2 == 0 || data2 == OMX_IndexParamPortDefinition) {
+            bool reconfig =
+                (data2 == 0 || data2 == OMX_IndexParamPortDefinition);
+            if (mCodec->mSwitchStartUs < 0) {
+                mCodec->mSwitchStartUs = mCodec->mLastFrameUs;
+                mCodec->mSwitchReconfig = reconfig;
+            } else if (reconfig) {
+                mCodec->mSwitchReconfig = true;
+            }
+
+            if (reconfig) {
                 ALOGV("Flush output port before disable");
                 CHECK_EQ(mCodec->mOMX->sendCommand(
                         mCodec->mNode, OMX_CommandFlush, kPortIndexOutput),
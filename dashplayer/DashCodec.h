@@ -286,6 +286,11 @@ private:
 
     status_t requestIDRFrame();
     bool mAdaptivePlayback;
+    // Output gap across resolution switches, logged with the first frame
+    // decoded after OMX_EventPortSettingsChanged
+    int64_t mLastFrameUs;
+    int64_t mSwitchStartUs;
+    bool mSwitchReconfig;
     Vector<OMX_PARAM_PORTDEFINITIONTYPE*> mFormats;
     Vector<OMX_CONFIG_RECTTYPE*> mOutputCrops;
     DISALLOW_EVIL_CONSTRUCTORS(DashCodec);
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "DashDecodePredictor"
+#include <utils/Log.h>
+
+#include "DashDecodePredictor.h"
+
+namespace android {
+
+DashDecodePredictor::DashDecodePredictor() {
+    reset();
+}
+
+void DashDecodePredictor::reset() {
+    for (size_t i = 0; i < kSlots; ++i) {
+        mSlots[i].mTimeUs = -1;
+        mSlots[i].mQueuedUs = 0;
+    }
+    mServiceUs = -1;
+    mLatencyUs = -1;
+    mFrameDurationUs = -1;
+    mLastFbdUs = -1;
+    mLastOutputTimeUs = -1;
+    mCatchup = false;
+}
+
+DashDecodePredictor::Slot &DashDecodePredictor::slotFor(
+        Slot *slots, int64_t timeUs) {
+    return slots[((uint64_t)timeUs * 0x9E3779B97F4A7C15ull >> 59) & (kSlots - 1)];
+}
+
+// Moving average over roughly the last eight samples.
+void DashDecodePredictor::average(int64_t *avg, int64_t sample) {
+    if (sample < 0) {
+        sample = 0;
+    } else if (sample > kMaxSampleUs) {
+        sample = kMaxSampleUs;
+    }
+    *avg = (*avg < 0) ? sample : *avg + (sample - *avg) / 8;
+}
+
+void DashDecodePredictor::onQueued(int64_t timeUs, int64_t nowUs) {
+    Slot &slot = slotFor(mSlots, timeUs);
+    slot.mTimeUs = timeUs;
+    slot.mQueuedUs = nowUs;
+}
+
+int64_t DashDecodePredictor::onDecoded(int64_t timeUs, int64_t fbdUs) {
+    int64_t latencyUs = -1;
+    Slot &slot = slotFor(mSlots, timeUs);
+    if (slot.mTimeUs == timeUs) {
+        // The decoder was idle until the frame was queued, or busy with
+        // the previous one until its FBD.
+        int64_t startUs = slot.mQueuedUs;
+        if (mLastFbdUs > startUs) {
+            startUs = mLastFbdUs;
+        }
+        latencyUs = fbdUs - slot.mQueuedUs;
+        average(&mServiceUs, fbdUs - startUs);
+        average(&mLatencyUs, latencyUs);
+        slot.mTimeUs = -1;
+    }
+    mLastFbdUs = fbdUs;
+
+    // Output is in presentation order.
+    if (mLastOutputTimeUs >= 0 && timeUs > mLastOutputTimeUs
+            && timeUs - mLastOutputTimeUs <= kMaxFrameDurationUs) {
+        average(&mFrameDurationUs, timeUs - mLastOutputTimeUs);
+    }
+    mLastOutputTimeUs = timeUs;
+    return latencyUs;
+}
+
+int64_t DashDecodePredictor::projectedLateUs(int64_t lateByUs) const {
+    // Only once the renderer is behind: a decoder held up by a paused or
+    // full renderer also looks slow.
+    if (lateByUs <= 0 || mServiceUs <= 0 || mFrameDurationUs <= 0
+            || mServiceUs <= mFrameDurationUs) {
+        return lateByUs;
+    }
+    return lateByUs + mLatencyUs * (mServiceUs - mFrameDurationUs) / mServiceUs;
+}
+
+DashDecodePredictor::Action DashDecodePredictor::update(
+        int64_t lateByUs, bool *entered) {
+    int64_t projectedUs = projectedLateUs(lateByUs);
+
+    *entered = false;
+    if (!mCatchup && projectedUs > kCatchupEnterUs) {
+        ALOGV("catch-up on, late by %lld us, projected %lld us "
+              "(service %lld us, frame %lld us, latency %lld us)",
+              lateByUs, projectedUs, mServiceUs, mFrameDurationUs, mLatencyUs);
+        mCatchup = true;
+        *entered = true;
+    } else if (mCatchup && projectedUs < kCatchupExitUs) {
+        ALOGV("catch-up off, late by %lld us", lateByUs);
+        mCatchup = false;
+    }
+
+    if (!mCatchup) {
+        return kDecode;
+    }
+    return (projectedUs > kSkipToSyncUs) ? kSkipToSync : kSkipNonReference;
+}
+
+} // namespace android
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DASH_DECODE_PREDICTOR_H_
+
+#define DASH_DECODE_PREDICTOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android {
+
+// Projects how late video will be by the time the access unit being fed
+// now comes out of the decoder, from the decoder's recent history: its
+// service time per frame (FBD to FBD while busy) against the media frame
+// duration, and its input to output latency. By Little's law the latency
+// holds latency / service frames, and each of them adds service - frame
+// duration to the lateness the renderer last reported.
+//
+// update() turns the projection into an action with hysteresis, so that
+// once the player starts skipping frames it keeps doing so until it is
+// well back on time. Player thread only.
+struct DashDecodePredictor {
+    enum Action {
+        kDecode,
+        kSkipNonReference,      // drop frames no other frame refers to
+        kSkipToSync,            // drop everything up to the next sync frame
+    };
+
+    DashDecodePredictor();
+
+    // On start, seek and decoder flush.
+    void reset();
+
+    // The player keeps one table of queued timestamps, here: onDecoded()
+    // returns the input to output latency of the frame, or -1 if it was
+    // not queued through onQueued() or its entry was overwritten.
+    void onQueued(int64_t timeUs, int64_t nowUs);
+    int64_t onDecoded(int64_t timeUs, int64_t fbdUs);
+
+    int64_t projectedLateUs(int64_t lateByUs) const;
+
+    // Returns the action for the next video access unit; *entered is set
+    // when this call switched catch-up mode on.
+    Action update(int64_t lateByUs, bool *entered);
+
+    bool catchingUp() const { return mCatchup; }
+
+private:
+    enum {
+        kSlots = 32,                        // power of two
+        kCatchupEnterUs = 100000,
+        kCatchupExitUs = 40000,             // the renderer's "too late"
+        kSkipToSyncUs = 1000000,
+        kMaxSampleUs = 500000,
+        kMaxFrameDurationUs = 200000,
+    };
+
+    struct Slot {
+        int64_t mTimeUs;
+        int64_t mQueuedUs;
+    };
+
+    Slot mSlots[kSlots];
+    int64_t mServiceUs;         // averages, -1 until the first sample
+    int64_t mLatencyUs;
+    int64_t mFrameDurationUs;
+    int64_t mLastFbdUs;
+    int64_t mLastOutputTimeUs;
+    bool mCatchup;
+
+    static Slot &slotFor(Slot *slots, int64_t timeUs);
+    static void average(int64_t *avg, int64_t sample);
+};
+
+} // namespace android
+
+#endif // DASH_DECODE_PREDICTOR_H_
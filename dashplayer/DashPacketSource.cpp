@@ -37,7 +37,15 @@ DashPacketSource::DashPacketSource(const sp<MetaData> &meta)
       mEOSResult(OK),
       mStreamPID(0),
       mProgramPID(0),
-      mFirstPTS(0) {
+      mFirstPTS(0),
+      mQueue(new QueueEntry[kInitialQueueSlots]),
+      mQueueSlots(kInitialQueueSlots),
+      mQueueHead(0),
+      mQueueCount(0),
+      mDiscontinuityCount(0),
+      mSegmentStartTimeUs(-1),
+      mLastTimeUs(-1),
+      mBufferedBytes(0) {
     const char *mime;
     CHECK(meta->findCString(kKeyMIMEType, &mime));
 
@@ -58,6 +66,7 @@ void DashPacketSource::updateFormat(const sp<MetaData> &meta) {
 }
 
 DashPacketSource::~DashPacketSource() {
+    delete[] mQueue;
 }
 
 status_t DashPacketSource::start(MetaData *params) {
@@ -90,17 +99,17 @@ status_t DashPacketSource::dequeueAccessUnit(sp<ABuffer> *buffer) {
     buffer->clear();
 
     Mutex::Autolock autoLock(mLock);
-    while (mEOSResult == OK && mBuffers.empty()) {
+    while (mEOSResult == OK && mQueueCount == 0) {
         mCondition.wait(mLock);
     }
 
-    if (!mBuffers.empty()) {
-        *buffer = *mBuffers.begin();
-        mBuffers.erase(mBuffers.begin());
+    if (mQueueCount > 0) {
+        QueueEntry entry;
+        popFront_l(&entry);
+        *buffer = entry.mBuffer;
 
-        int32_t discontinuity;
-        if ((*buffer)->meta()->findInt32("discontinuity", &discontinuity)) {
-            if (wasFormatChange(discontinuity)) {
+        if (entry.mIsDiscontinuity) {
+            if (wasFormatChange(entry.mDiscontinuityType)) {
                 mFormat.clear();
             }
 
@@ -118,28 +127,24 @@ status_t DashPacketSource::read(
     *out = NULL;
 
     Mutex::Autolock autoLock(mLock);
-    while (mEOSResult == OK && mBuffers.empty()) {
+    while (mEOSResult == OK && mQueueCount == 0) {
         mCondition.wait(mLock);
     }
 
-    if (!mBuffers.empty()) {
-        const sp<ABuffer> buffer = *mBuffers.begin();
-        mBuffers.erase(mBuffers.begin());
+    if (mQueueCount > 0) {
+        QueueEntry entry;
+        popFront_l(&entry);
 
-        int32_t discontinuity;
-        if (buffer->meta()->findInt32("discontinuity", &discontinuity)) {
-            if (wasFormatChange(discontinuity)) {
+        if (entry.mIsDiscontinuity) {
+            if (wasFormatChange(entry.mDiscontinuityType)) {
                 mFormat.clear();
             }
 
             return INFO_DISCONTINUITY;
         } else {
-            int64_t timeUs;
-            CHECK(buffer->meta()->findInt64("timeUs", &timeUs));
+            MediaBuffer *mediaBuffer = new MediaBuffer(entry.mBuffer);
 
-            MediaBuffer *mediaBuffer = new MediaBuffer(buffer);
-
-            mediaBuffer->meta_data()->setInt64(kKeyTime, timeUs);
+            mediaBuffer->meta_data()->setInt64(kKeyTime, entry.mTimeUs);
 
             *out = mediaBuffer;
             return OK;
@@ -165,18 +170,25 @@ void DashPacketSource::queueAccessUnit(const sp<ABuffer> &buffer) {
         return;
     }
 
-    int64_t timeUs;
-    CHECK(buffer->meta()->findInt64("timeUs", &timeUs));
-    ALOGV("queueAccessUnit timeUs=%lld us (%.2f secs)", timeUs, timeUs / 1E6);
+    QueueEntry entry;
+    int32_t isSync = 0;
+    CHECK(buffer->meta()->findInt64("timeUs", &entry.mTimeUs));
+    ALOGV("queueAccessUnit timeUs=%lld us (%.2f secs)",
+          entry.mTimeUs, entry.mTimeUs / 1E6);
+    entry.mBuffer = buffer;
+    entry.mDiscontinuityType = 0;
+    entry.mIsDiscontinuity = false;
+    entry.mIsSync = buffer->meta()->findInt32("isSync", &isSync) && isSync == 1;
 
     Mutex::Autolock autoLock(mLock);
-    mBuffers.push_back(buffer);
-    ALOGV("@@@@:: DashPacketSource --> size is %d ",mBuffers.size() );
+    pushBack_l(entry);
+    ALOGV("@@@@:: DashPacketSource --> size is %d ", mQueueCount);
     mCondition.signal();
 }
 
 int DashPacketSource::getQueueSize() {
-    return mBuffers.size();
+    Mutex::Autolock autoLock(mLock);
+    return mQueueCount;
 }
 
 void DashPacketSource::queueDiscontinuity(
@@ -186,34 +198,43 @@ void DashPacketSource::queueDiscontinuity(
 
     if (type == ATSParser::DISCONTINUITY_TIME) {
         ALOGI("Flushing all Access units for seek");
-        mBuffers.clear();
+        clear_l();
         mEOSResult = OK;
         mCondition.signal();
         return;
     }
 
     // Leave only discontinuities in the queue.
-    List<sp<ABuffer> >::iterator it = mBuffers.begin();
-    while (it != mBuffers.end()) {
-        sp<ABuffer> oldBuffer = *it;
-
-        int32_t oldDiscontinuityType;
-        if (!oldBuffer->meta()->findInt32(
-                    "discontinuity", &oldDiscontinuityType)) {
-            it = mBuffers.erase(it);
-            continue;
+    size_t kept = 0;
+    for (size_t i = 0; i < mQueueCount; ++i) {
+        QueueEntry &entry = entryAt_l(i);
+        if (entry.mIsDiscontinuity) {
+            if (kept != i) {
+                entryAt_l(kept) = entry;
+            }
+            ++kept;
         }
-
-        ++it;
     }
+    for (size_t i = kept; i < mQueueCount; ++i) {
+        entryAt_l(i).mBuffer.clear();
+    }
+    mQueueCount = kept;
+    mSegmentStartTimeUs = -1;
+    mLastTimeUs = -1;
+    mBufferedBytes = 0;
 
     mEOSResult = OK;
 
-    sp<ABuffer> buffer = new ABuffer(0);
-    buffer->meta()->setInt32("discontinuity", static_cast<int32_t>(type));
-    buffer->meta()->setMessage("extra", extra);
+    QueueEntry entry;
+    entry.mBuffer = new ABuffer(0);
+    entry.mBuffer->meta()->setInt32("discontinuity", static_cast<int32_t>(type));
+    entry.mBuffer->meta()->setMessage("extra", extra);
+    entry.mTimeUs = -1;
+    entry.mDiscontinuityType = type;
+    entry.mIsDiscontinuity = true;
+    entry.mIsSync = false;
 
-    mBuffers.push_back(buffer);
+    pushBack_l(entry);
     mCondition.signal();
 }
 
@@ -227,7 +248,7 @@ void DashPacketSource::signalEOS(status_t result) {
 
 bool DashPacketSource::hasBufferAvailable(status_t *finalResult) {
     Mutex::Autolock autoLock(mLock);
-    if (!mBuffers.empty()) {
+    if (mQueueCount > 0) {
         return true;
     }
 
@@ -240,33 +261,16 @@ int64_t DashPacketSource::getBufferedDurationUs(status_t *finalResult) {
 
     *finalResult = mEOSResult;
 
-    if (mBuffers.empty()) {
+    if (mLastTimeUs < 0) {
         return 0;
     }
 
-    int64_t time1 = -1;
-    int64_t time2 = -1;
-
-    List<sp<ABuffer> >::iterator it = mBuffers.begin();
-    while (it != mBuffers.end()) {
-        const sp<ABuffer> &buffer = *it;
-
-        int64_t timeUs;
-        if (buffer->meta()->findInt64("timeUs", &timeUs)) {
-            if (time1 < 0) {
-                time1 = timeUs;
-            }
-
-            time2 = timeUs;
-        } else {
-            // This is a discontinuity, reset everything.
-            time1 = time2 = -1;
-        }
-
-        ++it;
-    }
+    return mLastTimeUs - mSegmentStartTimeUs;
+}
 
-    return time2 - time1;
+size_t DashPacketSource::getBufferedBytes() {
+    Mutex::Autolock autoLock(mLock);
+    return mBufferedBytes;
 }
 
 status_t DashPacketSource::nextBufferTime(int64_t *timeUs) {
@@ -274,12 +278,13 @@ status_t DashPacketSource::nextBufferTime(int64_t *timeUs) {
 
     Mutex::Autolock autoLock(mLock);
 
-    if (mBuffers.empty()) {
+    if (mQueueCount == 0) {
         return mEOSResult != OK ? mEOSResult : -EWOULDBLOCK;
     }
 
-    sp<ABuffer> buffer = *mBuffers.begin();
-    CHECK(buffer->meta()->findInt64("timeUs", timeUs));
+    const QueueEntry &entry = entryAt_l(0);
+    CHECK(!entry.mIsDiscontinuity);
+    *timeUs = entry.mTimeUs;
     return OK;
 }
 
@@ -287,18 +292,81 @@ status_t DashPacketSource::nextBufferIsSync(bool* isSyncFrame) {
     Mutex::Autolock autoLock(mLock);
     CHECK(isSyncFrame != NULL);
 
-    if (mBuffers.empty()) {
+    if (mQueueCount == 0) {
         return mEOSResult != OK ? mEOSResult : -EWOULDBLOCK;
     }
 
-    sp<ABuffer> buffer = *mBuffers.begin();
+    *isSyncFrame = entryAt_l(0).mIsSync;
+    return OK;
+}
 
-    *isSyncFrame = false;
-    int32_t value = 0;
-    if (buffer->meta()->findInt32("isSync", &value) && (value == 1)) {
-       *isSyncFrame = true;
+DashPacketSource::QueueEntry &DashPacketSource::entryAt_l(size_t index) const {
+    return mQueue[(mQueueHead + index) & (mQueueSlots - 1)];
+}
+
+void DashPacketSource::pushBack_l(const QueueEntry &entry) {
+    if (mQueueCount == mQueueSlots) {
+        // Double the ring, unwrapping it to start at slot 0.
+        QueueEntry *queue = new QueueEntry[mQueueSlots * 2];
+        for (size_t i = 0; i < mQueueCount; ++i) {
+            queue[i] = entryAt_l(i);
+        }
+        delete[] mQueue;
+        mQueue = queue;
+        mQueueSlots *= 2;
+        mQueueHead = 0;
     }
-    return OK;
+
+    entryAt_l(mQueueCount++) = entry;
+
+    if (entry.mIsDiscontinuity) {
+        ++mDiscontinuityCount;
+        mSegmentStartTimeUs = -1;
+        mLastTimeUs = -1;
+        return;
+    }
+
+    if (mLastTimeUs < 0) {
+        mSegmentStartTimeUs = entry.mTimeUs;
+    }
+    mLastTimeUs = entry.mTimeUs;
+    mBufferedBytes += entry.mBuffer->size();
+}
+
+void DashPacketSource::popFront_l(QueueEntry *entry) {
+    QueueEntry &front = entryAt_l(0);
+    *entry = front;
+    front.mBuffer.clear();
+    mQueueHead = (mQueueHead + 1) & (mQueueSlots - 1);
+    --mQueueCount;
+
+    if (entry->mIsDiscontinuity) {
+        --mDiscontinuityCount;
+        return;
+    }
+
+    mBufferedBytes -= entry->mBuffer->size();
+    if (mDiscontinuityCount == 0) {
+        // The last segment started with this access unit.
+        if (mQueueCount == 0) {
+            mSegmentStartTimeUs = -1;
+            mLastTimeUs = -1;
+        } else {
+            mSegmentStartTimeUs = entryAt_l(0).mTimeUs;
+        }
+    }
+}
+
+void DashPacketSource::clear_l() {
+    for (size_t i = 0; i < mQueueCount; ++i) {
+        entryAt_l(i).mBuffer.clear();
+    }
+    mQueueHead = 0;
+    mQueueCount = 0;
+    mDiscontinuityCount = 0;
+    mSegmentStartTimeUs = -1;
+    mLastTimeUs = -1;
+    mBufferedBytes = 0;
 }
 
 }  // namespace android
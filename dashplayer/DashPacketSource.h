@@ -24,7 +24,6 @@
 #include <media/stagefright/foundation/ABase.h>
 #include <media/stagefright/MediaSource.h>
 #include <utils/threads.h>
-#include <utils/List.h>
 
 #include "ATSParser.h"
 
@@ -48,8 +47,12 @@ struct DashPacketSource : public MediaSource {
 
     // Returns the difference between the last and the first queued
     // presentation timestamps since the last discontinuity (if any).
+    // Both are tracked as access units come and go, so this is O(1).
     int64_t getBufferedDurationUs(status_t *finalResult);
 
+    // Payload bytes of the queued access units.
+    size_t getBufferedBytes();
+
     status_t nextBufferTime(int64_t *timeUs);
 
     void queueAccessUnit(const sp<ABuffer> &buffer);
@@ -73,19 +76,48 @@ protected:
     virtual ~DashPacketSource();
 
 private:
+    enum {
+        kInitialQueueSlots = 256,   // power of two
+    };
+
+    // Queue entry with the metadata looked up once, on enqueue.
+    struct QueueEntry {
+        sp<ABuffer> mBuffer;
+        int64_t mTimeUs;
+        int32_t mDiscontinuityType;
+        bool mIsDiscontinuity;
+        bool mIsSync;
+    };
+
     Mutex mLock;
     Condition mCondition;
 
     bool mIsAudio;
     sp<MetaData> mFormat;
-    List<sp<ABuffer> > mBuffers;
     status_t mEOSResult;
     unsigned mStreamPID;
     unsigned mProgramPID;
     uint64_t mFirstPTS;
 
+    // Ring of mQueueSlots entries, the first at mQueueHead.
+    QueueEntry *mQueue;
+    size_t mQueueSlots;
+    size_t mQueueHead;
+    size_t mQueueCount;
+
+    size_t mDiscontinuityCount;
+    int64_t mSegmentStartTimeUs;    // first access unit after the last
+                                    // queued discontinuity, -1 if none
+    int64_t mLastTimeUs;            // -1 unless an access unit is last
+    size_t mBufferedBytes;
+
     bool wasFormatChange(int32_t discontinuityType) const;
 
+    QueueEntry &entryAt_l(size_t index) const;
+    void pushBack_l(const QueueEntry &entry);
+    void popFront_l(QueueEntry *entry);
+    void clear_l();
+
     DISALLOW_EVIL_CONSTRUCTORS(DashPacketSource);
 };
 
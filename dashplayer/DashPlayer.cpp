@@ -76,9 +76,14 @@ DashPlayer::DashPlayer()
       mSetVideoSize(true),
       mSkipRenderingAudioUntilMediaTimeUs(-1ll),
       mSkipRenderingVideoUntilMediaTimeUs(-1ll),
+      mPrerollSeek(false),
+      mPrerollSyncSeen(false),
+      mPrerollAudioUntilUs(-1ll),
+      mPrerollVideoUntilUs(-1ll),
       mVideoLateByUs(0ll),
       mNumFramesTotal(0ll),
       mNumFramesDropped(0ll),
+      mSkipVideoToSync(false),
       mPauseIndication(false),
       mSourceType(kDefaultSource),
       mRenderer(NULL),
@@ -87,6 +92,11 @@ DashPlayer::DashPlayer()
       mBufferingNotification(false),
       mSRid(0) {
       mTrackName = new char[6];
+
+      char value[PROPERTY_VALUE_MAX];
+      if (property_get("persist.dash.seek.preroll", value, NULL)) {
+          mPrerollSeek = atoi(value) != 0;
+      }
 }
 
 DashPlayer::~DashPlayer() {
@@ -273,9 +283,13 @@ void DashPlayer::onMessageReceived(const sp<AMessage> &msg) {
             mVideoEOS = false;
             mSkipRenderingAudioUntilMediaTimeUs = -1;
             mSkipRenderingVideoUntilMediaTimeUs = -1;
+            mPrerollAudioUntilUs = -1;
+            mPrerollVideoUntilUs = -1;
             mVideoLateByUs = 0;
             mNumFramesTotal = 0;
             mNumFramesDropped = 0;
+            mDecodePredictor.reset();
+            mSkipVideoToSync = false;
             if (mSource != NULL)
             {
               mSource->start();
@@ -465,6 +479,8 @@ void DashPlayer::onMessageReceived(const sp<AMessage> &msg) {
                     mFlushingVideo = FLUSHED;
 
                     mVideoLateByUs = 0;
+                    mDecodePredictor.reset();
+                    mSkipVideoToSync = false;
                 }
 
                 ALOGV("decoder %s flush completed", mTrackName);
@@ -756,6 +772,11 @@ void DashPlayer::onMessageReceived(const sp<AMessage> &msg) {
                   mSource->getMediaPresence(audPresence,vidPresence,textPresence);
                   mRenderer->setMediaPresence(true,audPresence); // audio
                   mRenderer->setMediaPresence(false,vidPresence); // video
+                  if (mPrerollSeek) {
+                      mPrerollSyncSeen = false;
+                      mPrerollAudioUntilUs = seekTimeUs;
+                      mPrerollVideoUntilUs = seekTimeUs;
+                  }
                   if( (mVideoDecoder != NULL) &&
                       (mFlushingVideo == NONE || mFlushingVideo == AWAITING_DISCONTINUITY) ) {
                       flushDecoder( false, true ); // flush video, shutdown
@@ -1342,6 +1363,12 @@ status_t DashPlayer::feedDecoderInputData(int track, const sp<AMessage> &msg) {
         }
 
         dropAccessUnit = false;
+        if (mPrerollSeek && (track == kAudio || track == kVideo)
+                && prerollAccessUnit(track, accessUnit)) {
+            dropAccessUnit = true;
+            continue;
+        }
+
         if (track == kVideo) {
             ++mNumFramesTotal;
 
@@ -1349,10 +1376,7 @@ status_t DashPlayer::feedDecoderInputData(int track, const sp<AMessage> &msg) {
                 mStats->incrementTotalFrames();
             }
 
-            if (mVideoLateByUs > 100000ll
-                    && mVideoIsAVC
-                    && !mIsSecureInputBuffers
-                    && !IsAVCReferenceFrame(accessUnit)) {
+            if (skipVideoAccessUnit(accessUnit)) {
                 dropAccessUnit = true;
                 ++mNumFramesDropped;
                 if(mStats != NULL) {
@@ -1372,6 +1396,14 @@ status_t DashPlayer::feedDecoderInputData(int track, const sp<AMessage> &msg) {
          mediaTimeUs / 1E6);
 #endif
     if (track == kVideo || track == kAudio) {
+        int32_t decodeOnly;
+        int64_t timeUs;
+        if (track == kVideo
+                && !(accessUnit->meta()->findInt32("decode-only", &decodeOnly)
+                        && decodeOnly)
+                && accessUnit->meta()->findInt64("timeUs", &timeUs)) {
+            mDecodePredictor.onQueued(timeUs, ALooper::GetNowUs());
+        }
         reply->setBuffer("buffer", accessUnit);
         reply->post();
     } else if (mSourceType == kHttpDashSource && track == kText) {
@@ -1383,6 +1415,99 @@ status_t DashPlayer::feedDecoderInputData(int track, const sp<AMessage> &msg) {
     return OK;
 }
 
+// Returns true if the access unit is to be dropped: audio before the seek
+// target and video before the first sync sample. Video up to the target is
+// flagged decode-only, and is also skipped here should the decoder output
+// it anyway.
+bool DashPlayer::prerollAccessUnit(int track, const sp<ABuffer> &accessUnit) {
+    int64_t &untilUs =
+        (track == kAudio) ? mPrerollAudioUntilUs : mPrerollVideoUntilUs;
+
+    if (track == kVideo) {
+        // Input buffers may be reused, clear the flag of an earlier unit.
+        accessUnit->meta()->setInt32("decode-only", 0);
+    }
+
+    if (untilUs < 0) {
+        return false;
+    }
+
+    int64_t timeUs;
+    CHECK(accessUnit->meta()->findInt64("timeUs", &timeUs));
+
+    if (track == kAudio) {
+        if (timeUs < untilUs) {
+            return true;
+        }
+        untilUs = -1;
+        return false;
+    }
+
+    if (!mPrerollSyncSeen) {
+        if (!isVideoSyncFrame(accessUnit)) {
+            ALOGV("pre-roll dropping video at %lld us before sync sample",
+                  timeUs);
+            return true;
+        }
+        mPrerollSyncSeen = true;
+    }
+
+    if (timeUs < untilUs) {
+        accessUnit->meta()->setInt32("decode-only", 1);
+        mSkipRenderingVideoUntilMediaTimeUs = untilUs;
+        if (mStats != NULL) {
+            mStats->incrementPrerollFrames();
+        }
+        return false;
+    }
+
+    ALOGV("pre-roll done, first displayable video at %lld us", timeUs);
+    untilUs = -1;
+    return false;
+}
+
+// Returns true if the video access unit is to be dropped before decoding.
+// In catch-up mode that is any non-reference AVC frame, and when far
+// behind everything up to the next sync frame.
+bool DashPlayer::skipVideoAccessUnit(const sp<ABuffer> &accessUnit) {
+    bool entered;
+    DashDecodePredictor::Action action =
+        mDecodePredictor.update(mVideoLateByUs, &entered);
+
+    if (entered && mStats != NULL) {
+        mStats->notifyCatchup();
+    }
+
+    if (action == DashDecodePredictor::kSkipToSync) {
+        mSkipVideoToSync = true;
+    }
+
+    if (mSkipVideoToSync) {
+        if (!isVideoSyncFrame(accessUnit)) {
+            return true;
+        }
+        mSkipVideoToSync = false;
+        // Stale until the renderer has seen frames from here on.
+        mVideoLateByUs = 0;
+        return false;
+    }
+
+    return action == DashDecodePredictor::kSkipNonReference
+        && mVideoIsAVC
+        && !mIsSecureInputBuffers
+        && !IsAVCReferenceFrame(accessUnit);
+}
+
+// Without the source's sync flag, only unencrypted AVC is checked; anything
+// else is taken as a sync frame.
+bool DashPlayer::isVideoSyncFrame(const sp<ABuffer> &accessUnit) {
+    int32_t isSync;
+    if (accessUnit->meta()->findInt32("isSync", &isSync)) {
+        return isSync != 0;
+    }
+    return !mVideoIsAVC || mIsSecureInputBuffers || IsIDR(accessUnit);
+}
+
 void DashPlayer::renderBuffer(bool audio, const sp<AMessage> &msg) {
     // ALOGV("renderBuffer %s", audio ? "audio" : "video");
 
@@ -1406,6 +1531,16 @@ void DashPlayer::renderBuffer(bool audio, const sp<AMessage> &msg) {
     sp<ABuffer> buffer;
     CHECK(msg->findBuffer("buffer", &buffer));
 
+    int64_t mediaTimeUs, fbdTimeUs;
+    if (!audio && buffer->meta()->findInt64("timeUs", &mediaTimeUs)) {
+        if (buffer->meta()->findInt64("fbdTimeUs", &fbdTimeUs)) {
+            int64_t latencyUs = mDecodePredictor.onDecoded(mediaTimeUs, fbdTimeUs);
+            if (latencyUs >= 0 && mStats != NULL) {
+                mStats->recordDecodeLatency(latencyUs);
+            }
+        }
+    }
+
     int64_t &skipUntilMediaTimeUs =
         audio
             ? mSkipRenderingAudioUntilMediaTimeUs
@@ -1563,6 +1698,17 @@ status_t DashPlayer::getParameter(int key, Parcel *reply)
 
     status_t err = OK;
 
+    if (key == KEY_DASH_METRICS)
+    {
+      if (mStats == NULL)
+      {
+        return INVALID_OPERATION;
+      }
+      AString json;
+      mStats->getMetrics(&json);
+      return reply->writeString16(String16(json.c_str(), json.size()));
+    }
+
     if (mSource == NULL)
     {
       ALOGE("Source is NULL in getParameter\n");
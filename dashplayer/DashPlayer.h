@@ -22,10 +22,12 @@
 #include <media/stagefright/foundation/AHandler.h>
 #include <media/stagefright/NativeWindowWrapper.h>
 #include "DashPlayerStats.h"
+#include "DashDecodePredictor.h"
 #include <media/stagefright/foundation/ABuffer.h>
 #define KEY_DASH_ADAPTION_PROPERTIES 8002 // used for Get Adaotionset property
 #define KEY_DASH_MPD_QUERY           8003
 #define KEY_DASH_SET_ADAPTION_PROPERTIES 8004 // used for Set Adaotionset property
+#define KEY_DASH_METRICS             8005 // used for Get playback metrics as JSON
 
 namespace android {
 
@@ -200,9 +202,24 @@ private:
     int64_t mSkipRenderingAudioUntilMediaTimeUs;
     int64_t mSkipRenderingVideoUntilMediaTimeUs;
 
+    // Fast-start seeks (persist.dash.seek.preroll, off by default): until
+    // the seek target, audio is dropped and video is decoded from the
+    // preceding sync sample with OMX_BUFFERFLAG_DECODEONLY, so the first
+    // frame to reach the renderer, and start its clock, is the one at the
+    // target.
+    bool mPrerollSeek;
+    bool mPrerollSyncSeen;
+    int64_t mPrerollAudioUntilUs;
+    int64_t mPrerollVideoUntilUs;
+
     int64_t mVideoLateByUs;
     int64_t mNumFramesTotal, mNumFramesDropped;
 
+    // Video access units are skipped before decoding while the decoder is
+    // projected to fall behind, see DashDecodePredictor.
+    DashDecodePredictor mDecodePredictor;
+    bool mSkipVideoToSync;
+
     bool mPauseIndication;
 
     Mutex mLock;
@@ -229,6 +246,9 @@ private:
     status_t instantiateDecoder(int track, sp<Decoder> *decoder);
 
     status_t feedDecoderInputData(int track, const sp<AMessage> &msg);
+    bool prerollAccessUnit(int track, const sp<ABuffer> &accessUnit);
+    bool skipVideoAccessUnit(const sp<ABuffer> &accessUnit);
+    bool isVideoSyncFrame(const sp<ABuffer> &accessUnit);
     void renderBuffer(bool audio, const sp<AMessage> &msg);
 
     void notifyListener(int msg, int ext1, int ext2, const Parcel *obj=NULL);
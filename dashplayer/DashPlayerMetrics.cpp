@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include <media/stagefright/foundation/AString.h>
+
+#include "DashPlayerMetrics.h"
+
+namespace android {
+
+static const char *kCounterNames[DashPlayerMetrics::kNumCounters] = {
+    "frames_total",
+    "frames_dropped",
+    "frames_rendered",
+    "frames_late",
+    "frames_skipped",
+    "preroll_frames",
+    "sync_losses",
+    "buffering_events",
+    "seeks",
+    "catchups",
+};
+
+static const char *kHistogramNames[DashPlayerMetrics::kNumHistograms] = {
+    "decode_latency_us",
+    "av_sync_late_us",
+    "av_sync_early_us",
+    "dropped_run_frames",
+    "sync_loss_us",
+    "first_frame_latency_us",
+    "seek_latency_us",
+};
+
+DashPlayerMetrics::DashPlayerMetrics() {
+    memset(mShards, 0, sizeof(mShards));
+}
+
+DashPlayerMetrics::Shard *DashPlayerMetrics::shard() {
+    return &mShards[gettid() & (kShards - 1)];
+}
+
+void DashPlayerMetrics::increment(Counter counter, uint64_t n) {
+    __atomic_fetch_add(&shard()->mCounters[counter], n, __ATOMIC_RELAXED);
+}
+
+void DashPlayerMetrics::record(Histogram histogram, int64_t value) {
+    Shard *s = shard();
+    size_t bucket = 0;
+
+    if (value > 0) {
+        bucket = 64 - __builtin_clzll(value);
+        if (bucket >= kBuckets) {
+            bucket = kBuckets - 1;
+        }
+    }
+
+    __atomic_fetch_add(&s->mBuckets[histogram][bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->mCount[histogram], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->mSum[histogram], value, __ATOMIC_RELAXED);
+
+    int64_t max = __atomic_load_n(&s->mMax[histogram], __ATOMIC_RELAXED);
+    while (value > max && !__atomic_compare_exchange_n(
+            &s->mMax[histogram], &max, value, true,
+            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Each field is read atomically, but not all at the same instant, so a
+// snapshot taken during updates can be off by those updates.
+void DashPlayerMetrics::snapshot(Snapshot *snapshot) const {
+    memset(snapshot, 0, sizeof(*snapshot));
+
+    for (size_t i = 0; i < kShards; ++i) {
+        const Shard &s = mShards[i];
+
+        for (size_t c = 0; c < kNumCounters; ++c) {
+            snapshot->mCounters[c] +=
+                __atomic_load_n(&s.mCounters[c], __ATOMIC_RELAXED);
+        }
+
+        for (size_t h = 0; h < kNumHistograms; ++h) {
+            HistogramSnapshot &hs = snapshot->mHistograms[h];
+            int64_t max = __atomic_load_n(&s.mMax[h], __ATOMIC_RELAXED);
+
+            hs.mCount += __atomic_load_n(&s.mCount[h], __ATOMIC_RELAXED);
+            hs.mSum += __atomic_load_n(&s.mSum[h], __ATOMIC_RELAXED);
+            if (max > hs.mMax) {
+                hs.mMax = max;
+            }
+            for (size_t b = 0; b < kBuckets; ++b) {
+                hs.mBuckets[b] +=
+                    __atomic_load_n(&s.mBuckets[h][b], __ATOMIC_RELAXED);
+            }
+        }
+    }
+}
+
+void DashPlayerMetrics::toJson(const Snapshot &snapshot, AString *out) {
+    out->clear();
+    out->append("{\"time_us\":");
+    out->append((long long)snapshot.mTimeUs);
+
+    for (size_t c = 0; c < kNumCounters; ++c) {
+        out->append(",\"");
+        out->append(kCounterNames[c]);
+        out->append("\":");
+        out->append((long long)snapshot.mCounters[c]);
+    }
+
+    // Buckets are listed up to the last non-empty one.
+    for (size_t h = 0; h < kNumHistograms; ++h) {
+        const HistogramSnapshot &hs = snapshot.mHistograms[h];
+        size_t used = kBuckets;
+        while (used > 0 && hs.mBuckets[used - 1] == 0) {
+            --used;
+        }
+
+        out->append(",\"");
+        out->append(kHistogramNames[h]);
+        out->append("\":{\"count\":");
+        out->append((long long)hs.mCount);
+        out->append(",\"sum\":");
+        out->append((long long)hs.mSum);
+        out->append(",\"max\":");
+        out->append((long long)hs.mMax);
+        out->append(",\"log2_buckets\":[");
+        for (size_t b = 0; b < used; ++b) {
+            if (b > 0) {
+                out->append(",");
+            }
+            out->append((long long)hs.mBuckets[b]);
+        }
+        out->append("]}");
+    }
+
+    out->append("}");
+}
+
+const char *DashPlayerMetrics::counterName(Counter counter) {
+    return kCounterNames[counter];
+}
+
+const char *DashPlayerMetrics::histogramName(Histogram histogram) {
+    return kHistogramNames[histogram];
+}
+
+} // namespace android
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DASHPLAYER_METRICS_H_
+
+#define DASHPLAYER_METRICS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace android {
+
+struct AString;
+
+// Counters and log2 histograms updated without locks from any thread.
+// Updates go to one of kShards cache line aligned shards picked by thread
+// id, so the renderer and the player threads do not share lines; readers
+// sum the shards into a Snapshot. Histogram bucket 0 counts values <= 0,
+// bucket b > 0 values in [2^(b-1), 2^b), the last one everything above.
+struct DashPlayerMetrics {
+    enum Counter {
+        kFramesTotal,           // video access units fed to the decoder
+        kFramesDropped,         // dropped before decoding or rendering
+        kFramesRendered,
+        kFramesLate,            // decoded, then dropped by the renderer
+        kFramesSkipped,         // dropped before decoding to catch up
+        kPrerollFrames,
+        kSyncLosses,
+        kBufferingEvents,
+        kSeeks,
+        kCatchups,              // times the player entered catch-up mode
+        kNumCounters
+    };
+
+    enum Histogram {
+        kDecodeLatencyUs,       // access unit fed to decoded frame out
+        kAVSyncLateUs,          // rendered video behind the clock
+        kAVSyncEarlyUs,         // rendered video ahead of the clock
+        kDroppedRunFrames,      // late frames dropped in a row
+        kSyncLossUs,            // from the first late frame to catching up
+        kFirstFrameLatencyUs,
+        kSeekLatencyUs,         // seek to the first frame rendered on time
+        kNumHistograms
+    };
+
+    enum {
+        kBuckets = 24,
+        kShards = 4,            // power of two
+    };
+
+    struct HistogramSnapshot {
+        uint64_t mCount;
+        int64_t mSum;
+        int64_t mMax;
+        uint64_t mBuckets[kBuckets];
+    };
+
+    struct Snapshot {
+        int64_t mTimeUs;
+        uint64_t mCounters[kNumCounters];
+        HistogramSnapshot mHistograms[kNumHistograms];
+    };
+
+    DashPlayerMetrics();
+
+    void increment(Counter counter, uint64_t n = 1);
+    void record(Histogram histogram, int64_t value);
+
+    void snapshot(Snapshot *snapshot) const;
+
+    // One JSON object on a single line, without the newline.
+    static void toJson(const Snapshot &snapshot, AString *out);
+
+    static const char *counterName(Counter counter);
+    static const char *histogramName(Histogram histogram);
+
+private:
+    struct Shard {
+        uint64_t mCounters[kNumCounters];
+        uint64_t mCount[kNumHistograms];
+        int64_t mSum[kNumHistograms];
+        int64_t mMax[kNumHistograms];
+        uint64_t mBuckets[kNumHistograms][kBuckets];
+    } __attribute__((aligned(64)));
+
+    Shard mShards[kShards];
+
+    Shard *shard();
+
+    DashPlayerMetrics(const DashPlayerMetrics &);
+    DashPlayerMetrics &operator=(const DashPlayerMetrics &);
+};
+
+} // namespace android
+
+#endif // DASHPLAYER_METRICS_H_
@@ -27,7 +27,10 @@
  * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <fcntl.h>
 #include <utils/Log.h>
+#include <cutils/properties.h>
+#include <media/stagefright/foundation/AString.h>
 #include "DashPlayerStats.h"
 
 #define NO_MIMETYPE_AVAILABLE "N/A"
@@ -38,36 +41,60 @@ DashPlayerStats::DashPlayerStats() {
       Mutex::Autolock autoLock(mStatsLock);
       mMIME = new char[strlen(NO_MIMETYPE_AVAILABLE)+1];
       strcpy(mMIME,NO_MIMETYPE_AVAILABLE);
-      mNumVideoFramesDecoded = 0;
-      mNumVideoFramesDropped = 0;
       mConsecutiveFramesDropped = 0;
       mCatchupTimeStart = 0;
-      mNumTimesSyncLoss = 0;
-      mMaxEarlyDelta = 0;
-      mMaxLateDelta = 0;
-      mMaxTimeSyncLoss = 0;
-      mTotalFrames = 0;
       mFirstFrameLatencyStartUs = getTimeOfDayUs();
-      mLastFrame = 0;
-      mLastFrameUs = 0;
-      mStatisticsFrames = 0;
-      mFPSSumUs = 0;
-      mVeryFirstFrame = true;
-      mSeekPerformed = false;
-      mTotalTime = 0;
-      mFirstFrameTime = 0;
-      mTotalRenderingFrames = 0;
-      mBufferingEvent = false;
+      mVeryFirstFrame = 1;
+      mSeekPerformed = 0;
+      mBufferingEvent = 0;
+      mFirstRenderUs = 0;
+      mLastRenderUs = 0;
       mFd = -1;
       mFileOut = NULL;
+      mMetricsFd = -1;
+      mFlushIntervalUs = kDefaultFlushIntervalMs * 1000ll;
+      mFlusherStarted = false;
+      mFlusherExit = false;
+      memset(&mLastSnapshot, 0, sizeof(mLastSnapshot));
+      mFPSSumUs = 0;
+      mStatisticsFrames = 0;
+
+      char value[PROPERTY_VALUE_MAX];
+      if (property_get("persist.dash.metrics.interval_ms", value, NULL)
+              && atoi(value) > 0) {
+          mFlushIntervalUs = atoi(value) * 1000ll;
+      }
+      if (property_get("persist.dash.metrics.path", value, NULL)) {
+          mMetricsFd = open(value, O_WRONLY | O_CREAT | O_APPEND, 0644);
+          if (mMetricsFd < 0) {
+              ALOGE("cannot open metrics file %s", value);
+          } else {
+              startFlusher_l();
+          }
+      }
 }
 
 DashPlayerStats::~DashPlayerStats() {
+    bool started;
+    {
+        Mutex::Autolock autoLock(mStatsLock);
+        mFlusherExit = true;
+        mFlusherCondition.signal();
+        started = mFlusherStarted;
+    }
+    if (started) {
+        pthread_join(mFlusherThread, NULL);
+    }
+
     Mutex::Autolock autoLock(mStatsLock);
     if(mFileOut){
       fclose(mFileOut);
       mFileOut = NULL;
     }
+    if (mMetricsFd >= 0) {
+        close(mMetricsFd);
+        mMetricsFd = -1;
+    }
     if(mMIME) {
         delete[] mMIME;
     }
@@ -81,6 +108,9 @@ void DashPlayerStats::setFileDescAndOutputStream(int fd) {
       mFileOut = NULL;
     }
     mFileOut = fdopen(dup(fd), "w");
+    if (mFileOut) {
+        startFlusher_l();
+    }
 }
 
 void DashPlayerStats::setMime(const char* mime) {
@@ -97,52 +127,91 @@ void DashPlayerStats::setMime(const char* mime) {
 }
 
 void DashPlayerStats::setVeryFirstFrame(bool vff) {
-    Mutex::Autolock autoLock(mStatsLock);
-    mVeryFirstFrame = true;
+    __atomic_store_n(&mVeryFirstFrame, 1, __ATOMIC_RELEASE);
 }
 
 void DashPlayerStats::notifySeek() {
-    Mutex::Autolock autoLock(mStatsLock);
-    mFirstFrameLatencyStartUs = getTimeOfDayUs();
-    mSeekPerformed = true;
+    __atomic_store_n(&mFirstFrameLatencyStartUs, getTimeOfDayUs(),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&mSeekPerformed, 1, __ATOMIC_RELEASE);
+    mMetrics.increment(DashPlayerMetrics::kSeeks);
 }
 
 void DashPlayerStats::notifyBufferingEvent() {
-    Mutex::Autolock autoLock(mStatsLock);
-    mBufferingEvent = true;
+    __atomic_store_n(&mBufferingEvent, 1, __ATOMIC_RELAXED);
+    mMetrics.increment(DashPlayerMetrics::kBufferingEvents);
 }
 
 void DashPlayerStats::incrementTotalFrames() {
-    Mutex::Autolock autoLock(mStatsLock);
-    mTotalFrames++;
+    mMetrics.increment(DashPlayerMetrics::kFramesTotal);
 }
 
 void DashPlayerStats::incrementTotalRenderingFrames() {
-    Mutex::Autolock autoLock(mStatsLock);
-    mTotalRenderingFrames++;
+    mMetrics.increment(DashPlayerMetrics::kFramesRendered);
 }
 
 void DashPlayerStats::incrementDroppedFrames() {
-    Mutex::Autolock autoLock(mStatsLock);
-    mNumVideoFramesDropped++;
+    mMetrics.increment(DashPlayerMetrics::kFramesDropped);
+    mMetrics.increment(DashPlayerMetrics::kFramesSkipped);
+}
+
+void DashPlayerStats::notifyCatchup() {
+    mMetrics.increment(DashPlayerMetrics::kCatchups);
+}
+
+void DashPlayerStats::incrementPrerollFrames() {
+    mMetrics.increment(DashPlayerMetrics::kPrerollFrames);
+}
+
+void DashPlayerStats::recordDecodeLatency(int64_t latencyUs) {
+    mMetrics.record(DashPlayerMetrics::kDecodeLatencyUs, latencyUs);
+}
+
+void DashPlayerStats::getMetrics(AString *json) {
+    DashPlayerMetrics::Snapshot snapshot;
+    mMetrics.snapshot(&snapshot);
+    snapshot.mTimeUs = getTimeOfDayUs();
+    DashPlayerMetrics::toJson(snapshot, json);
 }
 
 void DashPlayerStats::logStatistics() {
     if(mFileOut) {
         Mutex::Autolock autoLock(mStatsLock);
+        DashPlayerMetrics::Snapshot s;
+        mMetrics.snapshot(&s);
+        const DashPlayerMetrics::HistogramSnapshot &seek =
+            s.mHistograms[DashPlayerMetrics::kSeekLatencyUs];
+        uint64_t totalFrames = s.mCounters[DashPlayerMetrics::kFramesTotal];
+        uint64_t dropped = s.mCounters[DashPlayerMetrics::kFramesDropped];
+
         fprintf(mFileOut, "=====================================================\n");
         fprintf(mFileOut, "Mime Type: %s\n",mMIME);
-        fprintf(mFileOut, "Number of total frames: %llu\n",mTotalFrames);
-        fprintf(mFileOut, "Number of frames dropped: %lld\n",mNumVideoFramesDropped);
-        fprintf(mFileOut, "Number of frames rendered: %llu\n",mTotalRenderingFrames);
+        fprintf(mFileOut, "Number of total frames: %llu\n",totalFrames);
+        fprintf(mFileOut, "Number of frames dropped: %lld\n",dropped);
+        fprintf(mFileOut, "Number of frames dropped before decode: %llu\n",
+                           s.mCounters[DashPlayerMetrics::kFramesSkipped]);
+        fprintf(mFileOut, "Number of frames dropped after decode: %llu\n",
+                           s.mCounters[DashPlayerMetrics::kFramesLate]);
+        fprintf(mFileOut, "Number of catch-ups: %llu\n",
+                           s.mCounters[DashPlayerMetrics::kCatchups]);
+        fprintf(mFileOut, "Number of frames rendered: %llu\n",
+                           s.mCounters[DashPlayerMetrics::kFramesRendered]);
         fprintf(mFileOut, "Percentage dropped: %.2f\n",
-                           mTotalFrames == 0 ? 0.0 : (double)mNumVideoFramesDropped / mTotalFrames);
+                           totalFrames == 0 ? 0.0 : (double)dropped / totalFrames);
+        fprintf(mFileOut, "Number of seeks: %llu\n",
+                           s.mCounters[DashPlayerMetrics::kSeeks]);
+        fprintf(mFileOut, "Average seek to first frame latency: %lld ms\n",
+                           seek.mCount == 0 ? 0 : seek.mSum / (int64_t)seek.mCount / 1000);
+        fprintf(mFileOut, "Max seek to first frame latency: %lld ms\n", seek.mMax / 1000);
+        fprintf(mFileOut, "Number of pre-roll frames: %llu\n",
+                           s.mCounters[DashPlayerMetrics::kPrerollFrames]);
         fprintf(mFileOut, "=====================================================\n");
     }
 }
 
 void DashPlayerStats::logPause(int64_t positionUs) {
     if(mFileOut) {
+        Mutex::Autolock autoLock(mStatsLock);
         fprintf(mFileOut, "=====================================================\n");
         fprintf(mFileOut, "Pause position: %lld ms\n",positionUs/1000);
         fprintf(mFileOut, "=====================================================\n");
@@ -154,77 +223,84 @@ void DashPlayerStats::logSeek(int64_t seekTimeUs) {
         Mutex::Autolock autoLock(mStatsLock);
         fprintf(mFileOut, "=====================================================\n");
         fprintf(mFileOut, "Seek position: %lld ms\n",seekTimeUs/1000);
-        fprintf(mFileOut, "Seek latency: %lld ms\n",(getTimeOfDayUs() - mFirstFrameLatencyStartUs)/1000);
         fprintf(mFileOut, "=====================================================\n");
     }
 }
 
+// recordLate() and recordOnTime() are called from the renderer thread only.
 void DashPlayerStats::recordLate(int64_t ts, int64_t clock, int64_t delta, int64_t anchorTime) {
-    Mutex::Autolock autoLock(mStatsLock);
-    mNumVideoFramesDropped++;
+    mMetrics.increment(DashPlayerMetrics::kFramesDropped);
+    mMetrics.increment(DashPlayerMetrics::kFramesLate);
+    if (clock > 0 && ts > 0) {
+        mMetrics.record(DashPlayerMetrics::kAVSyncLateUs, delta);
+    }
+
     mConsecutiveFramesDropped++;
     if (mConsecutiveFramesDropped == 1){
-      mCatchupTimeStart = anchorTime;
+      mCatchupTimeStart = clock;
     }
-
-    logLate(ts,clock,delta);
 }
 
+// The seek latency runs from notifySeek() to the first frame rendered on
+// time; it is recorded here only.
 void DashPlayerStats::recordOnTime(int64_t ts, int64_t clock, int64_t delta) {
-    Mutex::Autolock autoLock(mStatsLock);
-    mNumVideoFramesDecoded++;
-    mConsecutiveFramesDropped = 0;
-    logOnTime(ts,clock,delta);
+    if (__atomic_exchange_n(&mSeekPerformed, 0, __ATOMIC_ACQ_REL)) {
+        __atomic_store_n(&mVeryFirstFrame, 0, __ATOMIC_RELAXED);
+        mMetrics.record(DashPlayerMetrics::kSeekLatencyUs, getTimeOfDayUs() -
+            __atomic_load_n(&mFirstFrameLatencyStartUs, __ATOMIC_RELAXED));
+    }
+
+    if (mConsecutiveFramesDropped > 0) {
+        mMetrics.increment(DashPlayerMetrics::kSyncLosses);
+        mMetrics.record(DashPlayerMetrics::kDroppedRunFrames,
+                        mConsecutiveFramesDropped);
+        if (clock > 0 && ts > 0) {
+            mMetrics.record(DashPlayerMetrics::kSyncLossUs,
+                            clock - mCatchupTimeStart);
+        }
+        mConsecutiveFramesDropped = 0;
+    }
+
+    if (clock > 0 && ts > 0) {
+        if (delta <= 0) {
+            mMetrics.record(DashPlayerMetrics::kAVSyncEarlyUs, -delta);
+        } else {
+            mMetrics.record(DashPlayerMetrics::kAVSyncLateUs, delta);
+        }
+    }
 }
 
 void DashPlayerStats::logSyncLoss() {
     if(mFileOut) {
         Mutex::Autolock autoLock(mStatsLock);
+        DashPlayerMetrics::Snapshot s;
+        mMetrics.snapshot(&s);
         fprintf(mFileOut, "=====================================================\n");
-        fprintf(mFileOut, "Number of times AV Sync Losses = %u\n", mNumTimesSyncLoss);
-        fprintf(mFileOut, "Max Video Ahead time delta = %u\n", -mMaxEarlyDelta/1000);
-        fprintf(mFileOut, "Max Video Behind time delta = %u\n", mMaxLateDelta/1000);
-        fprintf(mFileOut, "Max Time sync loss = %u\n",mMaxTimeSyncLoss/1000);
+        fprintf(mFileOut, "Number of times AV Sync Losses = %llu\n",
+                           s.mCounters[DashPlayerMetrics::kSyncLosses]);
+        fprintf(mFileOut, "Max Video Ahead time delta = %lld\n",
+                           s.mHistograms[DashPlayerMetrics::kAVSyncEarlyUs].mMax/1000);
+        fprintf(mFileOut, "Max Video Behind time delta = %lld\n",
+                           s.mHistograms[DashPlayerMetrics::kAVSyncLateUs].mMax/1000);
+        fprintf(mFileOut, "Max Time sync loss = %lld\n",
+                           s.mHistograms[DashPlayerMetrics::kSyncLossUs].mMax/1000);
         fprintf(mFileOut, "=====================================================\n");
     }
 }
 
+// Called by the renderer for every frame it renders; the frame rate is
+// worked out by the flusher.
 void DashPlayerStats::logFps() {
-    if (mFileOut) {
-        Mutex::Autolock autoLock(mStatsLock);
-        int64_t now = getTimeOfDayUs();
+    int64_t now = getTimeOfDayUs();
+    int64_t none = 0;
 
-        if(mTotalRenderingFrames < 2){
-           mLastFrameUs = now;
-           mFirstFrameTime = now;
-        }
+    __atomic_compare_exchange_n(&mFirstRenderUs, &none, now, false,
+                                __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    __atomic_store_n(&mLastRenderUs, now, __ATOMIC_RELAXED);
 
-        mTotalTime = now - mFirstFrameTime;
-        int64_t diff = now - mLastFrameUs;
-        if (diff > 250000 && !mVeryFirstFrame && !mBufferingEvent) {
-             double fps =((mTotalRenderingFrames - mLastFrame) * 1E6)/diff;
-             if (mStatisticsFrames == 0) {
-                 fps =((mTotalRenderingFrames - mLastFrame - 1) * 1E6)/diff;
-             }
-             fprintf(mFileOut, "Frames per second: %.4f, Duration of measurement: %lld\n", fps,diff);
-             mFPSSumUs += fps;
-             ++mStatisticsFrames;
-             mLastFrameUs = now;
-             mLastFrame = mTotalRenderingFrames;
-         }
-
-        if(mSeekPerformed) {
-            mVeryFirstFrame = false;
-            mSeekPerformed = false;
-        } else if(mVeryFirstFrame) {
-            logFirstFrame();
-            fprintf(mFileOut, "setting first frame time\n");
-            mLastFrameUs = now;
-        } else if(mBufferingEvent) {
-            mLastFrameUs = now;
-            mLastFrame = mTotalRenderingFrames;
-        }
-        mBufferingEvent = false;
+    if (__atomic_exchange_n(&mVeryFirstFrame, 0, __ATOMIC_ACQ_REL)) {
+        mMetrics.record(DashPlayerMetrics::kFirstFrameLatencyUs,
+            now - __atomic_load_n(&mFirstFrameLatencyStartUs, __ATOMIC_RELAXED));
     }
 }
 
@@ -234,9 +310,15 @@ void DashPlayerStats::logFpsSummary() {
         logSyncLoss();
         {
             Mutex::Autolock autoLock(mStatsLock);
+            DashPlayerMetrics::Snapshot s;
+            mMetrics.snapshot(&s);
+            int64_t totalTime =
+                __atomic_load_n(&mLastRenderUs, __ATOMIC_RELAXED) -
+                __atomic_load_n(&mFirstRenderUs, __ATOMIC_RELAXED);
             fprintf(mFileOut, "=========================================================\n");
             fprintf(mFileOut, "Average Frames Per Second: %.4f\n", mFPSSumUs/((double)mStatisticsFrames));
-            fprintf(mFileOut, "Total Frames (rendered) / Total Time: %.4f\n", ((double)(mTotalRenderingFrames-1)*1E6)/((double)mTotalTime));
+            fprintf(mFileOut, "Total Frames (rendered) / Total Time: %.4f\n",
+                    ((double)(s.mCounters[DashPlayerMetrics::kFramesRendered]-1)*1E6)/((double)totalTime));
             fprintf(mFileOut, "========================================================\n");
         }
     }
@@ -249,41 +331,98 @@ int64_t DashPlayerStats::getTimeOfDayUs() {
 }
 
 // WARNING: Most private functions are only thread-safe within mStatsLock
-inline void DashPlayerStats::logFirstFrame() {
-    fprintf(mFileOut, "=====================================================\n");
-    fprintf(mFileOut, "First frame latency: %lld ms\n",(getTimeOfDayUs()-mFirstFrameLatencyStartUs)/1000);
-    fprintf(mFileOut, "=====================================================\n");
-    mVeryFirstFrame = false;
+void DashPlayerStats::startFlusher_l() {
+    if (mFlusherStarted) {
+        return;
+    }
+
+    mMetrics.snapshot(&mLastSnapshot);
+    mLastSnapshot.mTimeUs = getTimeOfDayUs();
+    if (pthread_create(&mFlusherThread, NULL, flusherThread, this)) {
+        ALOGE("cannot start the statistics flusher");
+        return;
+    }
+    mFlusherStarted = true;
 }
 
-inline void DashPlayerStats::logCatchUp(int64_t ts, int64_t clock, int64_t delta) {
-    if (mConsecutiveFramesDropped > 0) {
-        mNumTimesSyncLoss++;
-        if (mMaxTimeSyncLoss < (clock - mCatchupTimeStart) && clock > 0 && ts > 0) {
-            mMaxTimeSyncLoss = clock - mCatchupTimeStart;
-        }
+void *DashPlayerStats::flusherThread(void *arg) {
+    static_cast<DashPlayerStats *>(arg)->flusherLoop();
+    return NULL;
+}
+
+void DashPlayerStats::flusherLoop() {
+    Mutex::Autolock autoLock(mStatsLock);
+    while (!mFlusherExit) {
+        mFlusherCondition.waitRelative(mStatsLock, mFlushIntervalUs * 1000ll);
+        flush_l();
     }
 }
 
-inline void DashPlayerStats::logLate(int64_t ts, int64_t clock, int64_t delta) {
-    if (mMaxLateDelta < delta && clock > 0 && ts > 0) {
-        mMaxLateDelta = delta;
+void DashPlayerStats::flush_l() {
+    DashPlayerMetrics::Snapshot snapshot;
+    mMetrics.snapshot(&snapshot);
+    snapshot.mTimeUs = getTimeOfDayUs();
+
+    if (mMetricsFd >= 0) {
+        AString line;
+        DashPlayerMetrics::toJson(snapshot, &line);
+        line.append("\n");
+        if (write(mMetricsFd, line.c_str(), line.size()) < 0) {
+            ALOGE("metrics write failed, stopping JSON output");
+            close(mMetricsFd);
+            mMetricsFd = -1;
+        }
     }
+
+    if (mFileOut) {
+        logFirstFrames_l(snapshot);
+        logFps_l(snapshot);
+        fflush(mFileOut);
+    }
+
+    mLastSnapshot = snapshot;
 }
 
-inline void DashPlayerStats::logOnTime(int64_t ts, int64_t clock, int64_t delta) {
-    bool needLogLate = false;
-    logCatchUp(ts, clock, delta);
-    if (delta <= 0) {
-        if ((-delta) > (-mMaxEarlyDelta) && clock > 0 && ts > 0) {
-            mMaxEarlyDelta = delta;
+// Prints the latencies recorded since the last flush, averaged if several.
+void DashPlayerStats::logFirstFrames_l(const DashPlayerMetrics::Snapshot &snapshot) {
+    static const struct {
+        DashPlayerMetrics::Histogram mHistogram;
+        const char *mLabel;
+    } kLatencies[] = {
+        { DashPlayerMetrics::kFirstFrameLatencyUs, "First frame latency" },
+        { DashPlayerMetrics::kSeekLatencyUs, "Seek to first frame latency" },
+    };
+
+    for (size_t i = 0; i < sizeof(kLatencies) / sizeof(kLatencies[0]); ++i) {
+        const DashPlayerMetrics::HistogramSnapshot &now =
+            snapshot.mHistograms[kLatencies[i].mHistogram];
+        const DashPlayerMetrics::HistogramSnapshot &last =
+            mLastSnapshot.mHistograms[kLatencies[i].mHistogram];
+        if (now.mCount == last.mCount) {
+            continue;
         }
+        fprintf(mFileOut, "=====================================================\n");
+        fprintf(mFileOut, "%s: %lld ms\n", kLatencies[i].mLabel,
+                (now.mSum - last.mSum) / (int64_t)(now.mCount - last.mCount) / 1000);
+        fprintf(mFileOut, "=====================================================\n");
     }
-    else {
-        needLogLate = true;
+}
+
+// Frame rate over the flush interval, skipped if playback buffered.
+void DashPlayerStats::logFps_l(const DashPlayerMetrics::Snapshot &snapshot) {
+    uint64_t frames = snapshot.mCounters[DashPlayerMetrics::kFramesRendered] -
+                      mLastSnapshot.mCounters[DashPlayerMetrics::kFramesRendered];
+    int64_t diff = snapshot.mTimeUs - mLastSnapshot.mTimeUs;
+
+    if (__atomic_exchange_n(&mBufferingEvent, 0, __ATOMIC_RELAXED) ||
+            frames == 0 || diff <= 0) {
+        return;
     }
 
-    if(needLogLate) logLate(ts, clock, delta);
+    double fps = (frames * 1E6) / diff;
+    fprintf(mFileOut, "Frames per second: %.4f, Duration of measurement: %lld\n", fps,diff);
+    mFPSSumUs += fps;
+    ++mStatisticsFrames;
 }
 
 } // namespace android
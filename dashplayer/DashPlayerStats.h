@@ -34,8 +34,18 @@
 #include <utils/RefBase.h>
 #include <utils/threads.h>
 
+#include "DashPlayerMetrics.h"
+
 namespace android {
 
+struct AString;
+
+// The record and increment calls only update DashPlayerMetrics, without
+// locking or I/O, so they are safe on the rendering path. Output is left
+// to a flusher thread, which runs while there is somewhere to write to:
+// JSON lines, one per persist.dash.metrics.interval_ms, to the file named
+// by persist.dash.metrics.path, and the human readable text blocks to the
+// dumpsys stream given to setFileDescAndOutputStream().
 class DashPlayerStats : public RefBase {
   public:
     DashPlayerStats();
@@ -45,7 +55,8 @@ class DashPlayerStats : public RefBase {
     void setVeryFirstFrame(bool vff);
     void notifySeek();
     void incrementTotalFrames();
-    void incrementDroppedFrames();
+    void incrementDroppedFrames();      // skipped before decoding
+    void incrementPrerollFrames();
     void logStatistics();
     void logPause(int64_t positionUs);
     void logSeek(int64_t seekTimeUs);
@@ -57,39 +68,56 @@ class DashPlayerStats : public RefBase {
     static int64_t getTimeOfDayUs();
     void incrementTotalRenderingFrames();
     void notifyBufferingEvent();
+    void notifyCatchup();
     void setFileDescAndOutputStream(int fd);
 
+    // Video access unit fed to the decoder to decoded frame out of it, as
+    // matched up by DashDecodePredictor.
+    void recordDecodeLatency(int64_t latencyUs);
+
+    // Current metrics as one line of JSON.
+    void getMetrics(AString *json);
+
   private:
-    void logFirstFrame();
-    void logCatchUp(int64_t ts, int64_t clock, int64_t delta);
-    void logLate(int64_t ts, int64_t clock, int64_t delta);
-    void logOnTime(int64_t ts, int64_t clock, int64_t delta);
+    enum {
+        kDefaultFlushIntervalMs = 1000,
+    };
 
-    mutable Mutex mStatsLock;
-    bool mStatistics;
-    char* mMIME;
-    int64_t mNumVideoFramesDecoded;
-    int64_t mNumVideoFramesDropped;
+    static void *flusherThread(void *arg);
+    void flusherLoop();
+    void startFlusher_l();
+    void flush_l();
+    void logFirstFrames_l(const DashPlayerMetrics::Snapshot &snapshot);
+    void logFps_l(const DashPlayerMetrics::Snapshot &snapshot);
+
+    DashPlayerMetrics mMetrics;
+
+    // Renderer thread only.
     int64_t mConsecutiveFramesDropped;
-    uint32_t mCatchupTimeStart;
-    uint32_t mNumTimesSyncLoss;
-    uint32_t mMaxEarlyDelta;
-    uint32_t mMaxLateDelta;
-    uint32_t mMaxTimeSyncLoss;
-    uint64_t mTotalFrames;
+    int64_t mCatchupTimeStart;
+
+    // Accessed atomically.
     int64_t mFirstFrameLatencyStartUs;
-    int64_t mLastFrame;
-    int64_t mLastFrameUs;
-    double mFPSSumUs;
-    int64_t mStatisticsFrames;
-    bool mVeryFirstFrame;
-    bool mSeekPerformed;
-    int64_t mTotalTime;
-    int64_t mFirstFrameTime;
-    uint64_t mTotalRenderingFrames;
-    bool mBufferingEvent;
+    int32_t mVeryFirstFrame;
+    int32_t mSeekPerformed;
+    int32_t mBufferingEvent;
+    int64_t mFirstRenderUs;
+    int64_t mLastRenderUs;
+
+    // The rest is under mStatsLock, which the recording path never takes.
+    mutable Mutex mStatsLock;
+    Condition mFlusherCondition;
+    char* mMIME;
     int mFd;
     FILE *mFileOut;
+    int mMetricsFd;
+    int64_t mFlushIntervalUs;
+    bool mFlusherStarted;
+    bool mFlusherExit;
+    pthread_t mFlusherThread;
+    DashPlayerMetrics::Snapshot mLastSnapshot;  // as of the last flush
+    double mFPSSumUs;
+    int64_t mStatisticsFrames;
 };
 
 } // namespace android
@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Test for DashDecodePredictor against a FIFO decoder model.
+ *
+ * dash-decode-predictor-test [frames] [seed]
+ *
+ * Feeds frames to a model decoder that takes them in order, one at a
+ * time, each for a random service time, with the player keeping a random
+ * number of them in flight, and passes the queue and FBD times to the
+ * predictor as DashPlayer does. Frames are now and then not queued
+ * through the predictor (decode-only pre-roll), never come out, or are
+ * flushed with a reset.
+ *
+ * The model keeps its own exact list of the frames in flight, and checks
+ * that onDecoded() returns the latency of every frame it matched. It
+ * mirrors the averages and the catch-up hysteresis, and checks
+ * projectedLateUs() and update() for a random lateness after each
+ * frame. Then checks the steady state projection for a decoder slower
+ * than the frame rate, and that one that keeps up is never projected
+ * late.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <utils/List.h>
+
+#include "DashDecodePredictor.h"
+
+using namespace android;
+
+static const int64_t kFrameUs = 33366;
+static const int kMaxInFlight = 8;
+
+struct ModelFrame {
+    int64_t mTimeUs;
+    int64_t mQueuedUs;          // -1 if not queued through the predictor
+    int64_t mFbdUs;
+    bool mLost;                 // never comes out
+};
+
+struct Model {
+    int64_t mServiceUs;
+    int64_t mLatencyUs;
+    int64_t mFrameDurationUs;
+    int64_t mLastFbdUs;
+    int64_t mLastOutputTimeUs;
+    bool mCatchup;
+};
+
+static uint32_t gRandState;
+
+static uint32_t rnd() {
+    gRandState = gRandState * 1103515245 + 12345;
+    return gRandState >> 8;
+}
+
+static void resetModel(Model *model) {
+    model->mServiceUs = -1;
+    model->mLatencyUs = -1;
+    model->mFrameDurationUs = -1;
+    model->mLastFbdUs = -1;
+    model->mLastOutputTimeUs = -1;
+    model->mCatchup = false;
+}
+
+static void average(int64_t *avg, int64_t sample) {
+    if (sample < 0) {
+        sample = 0;
+    } else if (sample > 500000) {
+        sample = 500000;
+    }
+    *avg = (*avg < 0) ? sample : *avg + (sample - *avg) / 8;
+}
+
+static void modelDecoded(Model *model, const ModelFrame &frame) {
+    if (frame.mQueuedUs >= 0) {
+        int64_t startUs = frame.mQueuedUs;
+        if (model->mLastFbdUs > startUs) {
+            startUs = model->mLastFbdUs;
+        }
+        average(&model->mServiceUs, frame.mFbdUs - startUs);
+        average(&model->mLatencyUs, frame.mFbdUs - frame.mQueuedUs);
+    }
+    model->mLastFbdUs = frame.mFbdUs;
+
+    if (model->mLastOutputTimeUs >= 0 && frame.mTimeUs > model->mLastOutputTimeUs
+            && frame.mTimeUs - model->mLastOutputTimeUs <= 200000) {
+        average(&model->mFrameDurationUs, frame.mTimeUs - model->mLastOutputTimeUs);
+    }
+    model->mLastOutputTimeUs = frame.mTimeUs;
+}
+
+static int64_t modelProjectedUs(const Model &model, int64_t lateByUs) {
+    if (lateByUs <= 0 || model.mServiceUs <= model.mFrameDurationUs
+            || model.mFrameDurationUs <= 0) {
+        return lateByUs;
+    }
+    return lateByUs + model.mLatencyUs * (model.mServiceUs - model.mFrameDurationUs)
+            / model.mServiceUs;
+}
+
+static DashDecodePredictor::Action modelUpdate(Model *model, int64_t lateByUs,
+        bool *entered) {
+    int64_t projectedUs = modelProjectedUs(*model, lateByUs);
+
+    *entered = !model->mCatchup && projectedUs > 100000;
+    if (*entered) {
+        model->mCatchup = true;
+    } else if (model->mCatchup && projectedUs < 40000) {
+        model->mCatchup = false;
+    }
+    if (!model->mCatchup) {
+        return DashDecodePredictor::kDecode;
+    }
+    return (projectedUs > 1000000) ? DashDecodePredictor::kSkipToSync
+                                   : DashDecodePredictor::kSkipNonReference;
+}
+
+static int fifo(uint32_t frames, uint32_t seed) {
+    DashDecodePredictor predictor;
+    Model model;
+    List<ModelFrame> inFlight;
+    int64_t nowUs = 1000000, decoderFreeUs = 0, timeUs = 0;
+    uint32_t matched = 0, missed = 0;
+
+    gRandState = seed;
+    int depth = 1 + rnd() % kMaxInFlight;
+    int64_t serviceUs = kFrameUs / 2 + rnd() % (2 * kFrameUs);
+    resetModel(&model);
+    for (uint32_t i = 0; i < frames; i++) {
+        // Now and then the stream or the decoder speed changes, or the
+        // player seeks and flushes the decoder.
+        if (rnd() % 500 == 0) {
+            depth = 1 + rnd() % kMaxInFlight;
+            serviceUs = kFrameUs / 2 + rnd() % (2 * kFrameUs);
+        }
+        if (rnd() % 1000 == 0) {
+            predictor.reset();
+            resetModel(&model);
+            inFlight.clear();
+            timeUs += (int64_t)(rnd() % 10000000);
+            nowUs = decoderFreeUs = nowUs + 1000;
+        }
+
+        // Feed until the player's queue depth is reached; the decoder
+        // starts each frame when it is queued or done with the last one.
+        while ((int)inFlight.size() < depth) {
+            ModelFrame frame;
+            frame.mTimeUs = timeUs;
+            frame.mQueuedUs = (rnd() % 50 == 0) ? -1 : nowUs;
+            frame.mLost = rnd() % 200 == 0;
+            int64_t startUs = decoderFreeUs > nowUs ? decoderFreeUs : nowUs;
+            decoderFreeUs = frame.mFbdUs =
+                    startUs + serviceUs / 2 + rnd() % serviceUs;
+            if (frame.mQueuedUs >= 0) {
+                predictor.onQueued(frame.mTimeUs, frame.mQueuedUs);
+            }
+            inFlight.push_back(frame);
+            timeUs += kFrameUs;
+            nowUs += 1 + rnd() % 1000;
+        }
+
+        // The oldest frame comes out first.
+        ModelFrame frame = *inFlight.begin();
+        inFlight.erase(inFlight.begin());
+        if (nowUs < frame.mFbdUs) {
+            nowUs = frame.mFbdUs;
+        }
+        if (frame.mLost) {
+            continue;
+        }
+        int64_t latencyUs = predictor.onDecoded(frame.mTimeUs, frame.mFbdUs);
+        if (frame.mQueuedUs < 0) {
+            if (latencyUs != -1) {
+                printf("FAIL: frame %u not queued, latency %lld\n", i,
+                       (long long)latencyUs);
+                printf("fifo failed, seed %u\n", seed);
+                return 1;
+            }
+        } else if (latencyUs == -1) {
+            // overwritten by another frame in the timestamp table
+            frame.mQueuedUs = -1;
+            missed++;
+        } else if (latencyUs != frame.mFbdUs - frame.mQueuedUs) {
+            printf("FAIL: frame %u latency %lld expected %lld\n", i,
+                   (long long)latencyUs,
+                   (long long)(frame.mFbdUs - frame.mQueuedUs));
+            printf("fifo failed, seed %u\n", seed);
+            return 1;
+        } else {
+            matched++;
+        }
+        modelDecoded(&model, frame);
+
+        int64_t lateByUs = (int64_t)(rnd() % 300000) - 100000;
+        bool entered, expectedEntered;
+        DashDecodePredictor::Action action = predictor.update(lateByUs, &entered);
+        DashDecodePredictor::Action expected =
+                modelUpdate(&model, lateByUs, &expectedEntered);
+        if (predictor.projectedLateUs(lateByUs) != modelProjectedUs(model, lateByUs)
+                || action != expected || entered != expectedEntered
+                || predictor.catchingUp() != model.mCatchup) {
+            printf("FAIL: frame %u late by %lld: projected %lld expected %lld, "
+                   "action %d expected %d\n", i, (long long)lateByUs,
+                   (long long)predictor.projectedLateUs(lateByUs),
+                   (long long)modelProjectedUs(model, lateByUs),
+                   action, expected);
+            printf("fifo failed, seed %u\n", seed);
+            return 1;
+        }
+    }
+
+    // With at most kMaxInFlight frames in the 32 entry table, collisions
+    // have to stay rare.
+    if (missed * 100 > matched) {
+        printf("FAIL: %u frames matched, %u missed\n", matched, missed);
+        return 1;
+    }
+    printf("fifo: %u frames passed, %u matched, %u missed, seed %u\n",
+           frames, matched, missed, seed);
+    return 0;
+}
+
+// A decoder with a fixed service time, kept 'depth' frames deep.
+static int64_t steadyProjectedUs(int64_t serviceUs, int depth, int64_t lateByUs) {
+    DashDecodePredictor predictor;
+    int64_t nowUs = 0, fbdUs = 0;
+
+    for (int i = 0; i < depth; i++) {
+        predictor.onQueued(i * kFrameUs, nowUs);
+    }
+    for (int i = 0; i < 100; i++) {
+        fbdUs = (fbdUs > nowUs ? fbdUs : nowUs) + serviceUs;
+        predictor.onDecoded(i * kFrameUs, fbdUs);
+        nowUs = fbdUs;
+        predictor.onQueued((i + depth) * kFrameUs, nowUs);
+    }
+    return predictor.projectedLateUs(lateByUs);
+}
+
+static int steady() {
+    static const int64_t kServiceUs = 50000;
+    static const int kDepth = 4;
+
+    // Each frame waits for the three ahead of it, so the latency is four
+    // service times, and every one of them puts the frame
+    // service - frame duration further behind. The averages settle to
+    // within eight of the samples.
+    int64_t expectedUs = 10000 + kDepth * (kServiceUs - kFrameUs);
+    int64_t projectedUs = steadyProjectedUs(kServiceUs, kDepth, 10000);
+    if (projectedUs < expectedUs - 16 || projectedUs > expectedUs + 16) {
+        printf("FAIL: slow decoder projected %lld expected %lld\n",
+               (long long)projectedUs, (long long)expectedUs);
+        return 1;
+    }
+
+    projectedUs = steadyProjectedUs(kFrameUs / 2, kDepth, 10000);
+    if (projectedUs != 10000) {
+        printf("FAIL: decoder keeping up projected %lld\n", (long long)projectedUs);
+        return 1;
+    }
+
+    // A renderer that is not behind says nothing about the decoder.
+    projectedUs = steadyProjectedUs(kServiceUs, kDepth, 0);
+    if (projectedUs != 0) {
+        printf("FAIL: on time projected %lld\n", (long long)projectedUs);
+        return 1;
+    }
+    printf("steady: passed\n");
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (fifo(argc > 1 ? atoi(argv[1]) : 200000,
+             argc > 2 ? atoi(argv[2]) : 1)) {
+        return 1;
+    }
+    return steady();
+}
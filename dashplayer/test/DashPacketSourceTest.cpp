@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Stress test for DashPacketSource.
+ *
+ * dash-packet-source-test [operations] [seed]
+ *
+ * Runs random sequences of queued access units, discontinuities, seeks
+ * and dequeues against a list model of the queue that walks every entry
+ * as getBufferedDurationUs() used to, and checks the buffered duration,
+ * buffered bytes, next buffer time and sync flag after each step. Then
+ * queues kStressUnits access units, times getBufferedDurationUs() on the
+ * full queue and drains it with a producer and a consumer thread running
+ * while the duration is polled.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MetaData.h>
+#include <media/stagefright/MediaDefs.h>
+#include <utils/List.h>
+
+#include "DashPacketSource.h"
+
+using namespace android;
+
+static const size_t kStressUnits = 10000;
+static const int64_t kFrameUs = 33366;
+
+struct ModelEntry {
+    bool mIsDiscontinuity;
+    int64_t mTimeUs;
+    size_t mSize;
+    bool mIsSync;
+};
+
+static uint32_t gRandState;
+
+static uint32_t rnd() {
+    gRandState = gRandState * 1103515245 + 12345;
+    return gRandState >> 8;
+}
+
+static int64_t nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static sp<ABuffer> makeUnit(int64_t timeUs, size_t size, bool isSync) {
+    sp<ABuffer> buffer = new ABuffer(size);
+    buffer->meta()->setInt64("timeUs", timeUs);
+    if (isSync) {
+        buffer->meta()->setInt32("isSync", 1);
+    }
+    return buffer;
+}
+
+static int64_t modelDurationUs(const List<ModelEntry> &model) {
+    int64_t time1 = -1, time2 = -1;
+    for (List<ModelEntry>::const_iterator it = model.begin();
+            it != model.end(); ++it) {
+        if (!it->mIsDiscontinuity) {
+            if (time1 < 0) {
+                time1 = it->mTimeUs;
+            }
+            time2 = it->mTimeUs;
+        } else {
+            time1 = time2 = -1;
+        }
+    }
+    return time2 - time1;
+}
+
+static size_t modelBytes(const List<ModelEntry> &model) {
+    size_t bytes = 0;
+    for (List<ModelEntry>::const_iterator it = model.begin();
+            it != model.end(); ++it) {
+        bytes += it->mSize;
+    }
+    return bytes;
+}
+
+static bool check(const sp<DashPacketSource> &source,
+        const List<ModelEntry> &model, uint32_t step) {
+    status_t finalResult;
+    int64_t durationUs = source->getBufferedDurationUs(&finalResult);
+    int64_t expectedUs = model.empty() ? 0 : modelDurationUs(model);
+    size_t bytes = source->getBufferedBytes();
+
+    if (durationUs != expectedUs || bytes != modelBytes(model) ||
+            source->getQueueSize() != (int)model.size()) {
+        printf("FAIL: step %u duration %lld expected %lld, bytes %zu "
+               "expected %zu, size %d expected %zu\n", step,
+               (long long)durationUs, (long long)expectedUs, bytes,
+               modelBytes(model), source->getQueueSize(), model.size());
+        return false;
+    }
+
+    if (!model.empty() && !model.begin()->mIsDiscontinuity) {
+        int64_t timeUs;
+        bool isSync;
+        if (source->nextBufferTime(&timeUs) != OK ||
+                timeUs != model.begin()->mTimeUs ||
+                source->nextBufferIsSync(&isSync) != OK ||
+                isSync != model.begin()->mIsSync) {
+            printf("FAIL: step %u next buffer does not match\n", step);
+            return false;
+        }
+    }
+    return true;
+}
+
+static sp<DashPacketSource> makeSource() {
+    sp<MetaData> meta = new MetaData;
+    meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_VIDEO_AVC);
+    return new DashPacketSource(meta);
+}
+
+static int randomOps(uint32_t operations, uint32_t seed) {
+    sp<DashPacketSource> source = makeSource();
+    List<ModelEntry> model;
+    int64_t timeUs = 0;
+
+    gRandState = seed;
+    for (uint32_t i = 0; i < operations; i++) {
+        uint32_t op = rnd() % 100;
+
+        if (op < 55) {
+            ModelEntry entry;
+            entry.mIsDiscontinuity = false;
+            entry.mTimeUs = timeUs;
+            entry.mSize = rnd() % 4096;
+            entry.mIsSync = (rnd() % 8) == 0;
+            timeUs += kFrameUs;
+            source->queueAccessUnit(
+                    makeUnit(entry.mTimeUs, entry.mSize, entry.mIsSync));
+            model.push_back(entry);
+        } else if (op < 95) {
+            if (model.empty()) {
+                continue;
+            }
+            sp<ABuffer> buffer;
+            status_t err = source->dequeueAccessUnit(&buffer);
+            bool wasDiscontinuity = model.begin()->mIsDiscontinuity;
+            model.erase(model.begin());
+            if ((err == INFO_DISCONTINUITY) != wasDiscontinuity ||
+                    (err != OK && err != INFO_DISCONTINUITY)) {
+                printf("FAIL: step %u dequeue returned %d\n", i, err);
+                return 1;
+            }
+        } else if (op < 99) {
+            // keeps only the queued discontinuities
+            ATSParser::DiscontinuityType type = (rnd() & 1) ?
+                    ATSParser::DISCONTINUITY_VIDEO_FORMAT :
+                    ATSParser::DISCONTINUITY_AUDIO_FORMAT;
+            source->queueDiscontinuity(type, new AMessage);
+            List<ModelEntry>::iterator it = model.begin();
+            while (it != model.end()) {
+                if (!it->mIsDiscontinuity) {
+                    it = model.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            ModelEntry entry;
+            entry.mIsDiscontinuity = true;
+            entry.mTimeUs = -1;
+            entry.mSize = 0;
+            entry.mIsSync = false;
+            model.push_back(entry);
+        } else {
+            source->queueDiscontinuity(ATSParser::DISCONTINUITY_TIME, NULL);
+            model.clear();
+        }
+
+        if (!check(source, model, i)) {
+            printf("random operations failed, seed %u\n", seed);
+            return 1;
+        }
+    }
+    printf("random operations: %u passed, seed %u\n", operations, seed);
+    return 0;
+}
+
+struct StressContext {
+    sp<DashPacketSource> mSource;
+    size_t mDequeued;
+};
+
+static void *producer(void *arg) {
+    StressContext *ctx = (StressContext *)arg;
+    for (size_t i = 0; i < kStressUnits; i++) {
+        ctx->mSource->queueAccessUnit(makeUnit(i * kFrameUs, 1024, !(i % 30)));
+    }
+    ctx->mSource->signalEOS(ERROR_END_OF_STREAM);
+    return NULL;
+}
+
+static void *consumer(void *arg) {
+    StressContext *ctx = (StressContext *)arg;
+    sp<ABuffer> buffer;
+    while (ctx->mSource->dequeueAccessUnit(&buffer) == OK) {
+        ctx->mDequeued++;
+    }
+    return NULL;
+}
+
+static int stress() {
+    sp<DashPacketSource> source = makeSource();
+    status_t finalResult;
+    int64_t start, durationUs = 0;
+    size_t i, polls = 0;
+
+    for (i = 0; i < kStressUnits; i++) {
+        source->queueAccessUnit(makeUnit(i * kFrameUs, 1024, !(i % 30)));
+    }
+    start = nowUs();
+    for (i = 0; i < kStressUnits; i++) {
+        durationUs += source->getBufferedDurationUs(&finalResult);
+    }
+    printf("%zu queued units: getBufferedDurationUs %.3f us per call\n",
+           kStressUnits, (double)(nowUs() - start) / kStressUnits);
+    if (durationUs != (int64_t)kStressUnits * (kStressUnits - 1) * kFrameUs) {
+        printf("FAIL: buffered duration %lld\n", (long long)durationUs);
+        return 1;
+    }
+
+    StressContext ctx;
+    ctx.mSource = makeSource();
+    ctx.mDequeued = 0;
+    pthread_t producerThread, consumerThread;
+    start = nowUs();
+    pthread_create(&producerThread, NULL, producer, &ctx);
+    pthread_create(&consumerThread, NULL, consumer, &ctx);
+    while (ctx.mSource->getBufferedDurationUs(&finalResult) >= 0 &&
+            (finalResult == OK || ctx.mSource->getQueueSize() > 0)) {
+        polls++;
+    }
+    pthread_join(producerThread, NULL);
+    pthread_join(consumerThread, NULL);
+    printf("producer/consumer: %zu units in %lld us, %zu polls\n",
+           ctx.mDequeued, (long long)(nowUs() - start), polls);
+    if (ctx.mDequeued != kStressUnits || ctx.mSource->getBufferedBytes()) {
+        printf("FAIL: dequeued %zu units, %zu bytes left\n",
+               ctx.mDequeued, ctx.mSource->getBufferedBytes());
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (randomOps(argc > 1 ? atoi(argv[1]) : 200000,
+                  argc > 2 ? atoi(argv[2]) : 1)) {
+        return 1;
+    }
+    return stress();
+}
@@ -3,7 +3,8 @@ LOCAL_PATH := $(call my-dir)
 include $(CLEAR_VARS)
 
 LOCAL_SRC_FILES := \
-        C2DColorConverter.cpp
+        C2DColorConverter.cpp \
+        SWColorConverter.cpp
 
 LOCAL_C_INCLUDES := \
     $(TOP)/frameworks/av/include/media/stagefright \
@@ -18,3 +19,51 @@ LOCAL_MODULE := libc2dcolorconvert
 LOCAL_ADDITIONAL_DEPENDENCIES := $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr
 
 include $(BUILD_SHARED_LIBRARY)
+
+# ---------------------------------------------------------------------------------
+# 			Make the software converter test (sw-color-convert-test)
+# ---------------------------------------------------------------------------------
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+        SWColorConverter.cpp \
+        test/sw_color_convert_test.cpp
+
+LOCAL_C_INCLUDES := \
+    $(TOP)/frameworks/av/include/media/stagefright \
+    $(TOP)/frameworks/native/include/media/openmax \
+    $(TOP)/hardware/qcom/display/libcopybit
+LOCAL_C_INCLUDES += $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr/include
+LOCAL_SHARED_LIBRARIES := liblog
+
+LOCAL_MODULE_TAGS := debug
+LOCAL_PRELINK_MODULE := false
+
+LOCAL_MODULE := sw-color-convert-test
+LOCAL_ADDITIONAL_DEPENDENCIES := $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr
+
+include $(BUILD_EXECUTABLE)
+
+# ---------------------------------------------------------------------------------
+# 			Make the detiler and crop test (sw-detile-test)
+# ---------------------------------------------------------------------------------
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+        SWColorConverter.cpp \
+        test/sw_detile_test.cpp
+
+LOCAL_C_INCLUDES := \
+    $(TOP)/frameworks/av/include/media/stagefright \
+    $(TOP)/frameworks/native/include/media/openmax \
+    $(TOP)/hardware/qcom/display/libcopybit
+LOCAL_C_INCLUDES += $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr/include
+LOCAL_SHARED_LIBRARIES := liblog
+
+LOCAL_MODULE_TAGS := debug
+LOCAL_PRELINK_MODULE := false
+
+LOCAL_MODULE := sw-detile-test
+LOCAL_ADDITIONAL_DEPENDENCIES := $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr
+
+include $(BUILD_EXECUTABLE)
@@ -31,6 +31,8 @@ Copyright (c) 2012 The Linux Foundation. All rights reserved.
 --------------------------------------------------------------------------*/
 
 #include <C2DColorConverter.h>
+#include <ColorConvertLayout.h>
+#include <SWColorConverter.h>
 #include <arm_neon.h>
 #include <stdlib.h>
 #include <fcntl.h>
@@ -41,13 +43,6 @@ Copyright (c) 2012 The Linux Foundation. All rights reserved.
 
 #undef LOG_TAG
 #define LOG_TAG "C2DColorConvert"
-#define ALIGN( num, to ) (((num) + (to-1)) & (~(to-1)))
-#define ALIGN8K 8192
-#define ALIGN4K 4096
-#define ALIGN2K 2048
-#define ALIGN128 128
-#define ALIGN32 32
-#define ALIGN16 16
 #define PADDING_720P 32
 #define WIDTH_720P 1280
 #define HEIGHT_720P 720
@@ -61,6 +56,7 @@ public:
     C2DColorConverter(size_t srcWidth, size_t srcHeight, size_t dstWidth, size_t dstHeight, ColorConvertFormat srcFormat, ColorConvertFormat dstFormat, int32_t flags, size_t stride);
     int32_t getBuffReq(int32_t port, C2DBuffReq *req);
     int32_t dumpOutput(char * filename, char mode);
+    bool isValid() { return mError == 0; }
 protected:
     virtual ~C2DColorConverter();
     virtual int convertC2D(int srcFd, void * srcData, int dstFd, void * dstData);
@@ -263,18 +259,7 @@ int C2DColorConverter::convertC2D(int srcFd, void * srcData, int dstFd, void * d
 
 bool C2DColorConverter::isYUVSurface(ColorConvertFormat format)
 {
-    switch (format) {
-        case YCbCr420Tile:
-        case YCbCr420SP:
-        case YCbCr420P:
-        case YCrCb420P:
-        case NV12_2K:
-            return true;
-        case RGB565:
-        case RGBA8888:
-        default:
-            return false;
-    }
+    return ccIsYUVFormat(format);
 }
 
 void* C2DColorConverter::getDummySurfaceDef(ColorConvertFormat format, size_t width, size_t height, bool isSource)
@@ -391,94 +376,19 @@ uint32_t C2DColorConverter::getC2DFormat(ColorConvertFormat format)
 
 size_t C2DColorConverter::calcStride(ColorConvertFormat format, size_t width)
 {
-    switch (format) {
-        case RGB565:
-            return ALIGN(width, ALIGN32) * 2; // RGB565 has width as twice
-        case RGBA8888:
-            if (mStride)
-                width = mStride;
-            return ALIGN(width, ALIGN32) * 4;
-
-        case YCbCr420Tile:
-            return ALIGN(width, ALIGN128);
-        case YCbCr420SP:
-            return ALIGN(width, ALIGN16);
-        case NV12_2K:
-            return ALIGN(width, ALIGN16);
-        case YCbCr420P:
-            return width;
-        case YCrCb420P:
-            return ALIGN(width, ALIGN16);
-        default:
-            return 0;
-    }
+    return ccCalcStride(format, width, mStride);
 }
 
 size_t C2DColorConverter::calcYSize(ColorConvertFormat format, size_t width, size_t height)
 {
-    switch (format) {
-        case YCbCr420SP:
-            return (ALIGN(width, ALIGN16) * height);
-        case YCbCr420P:
-            return width * height;
-        case YCrCb420P:
-            return ALIGN(width, ALIGN16) * height;
-        case YCbCr420Tile:
-            return ALIGN(ALIGN(width, ALIGN128) * ALIGN(height, ALIGN32), ALIGN8K);
-        case NV12_2K: {
-            size_t alignedw = ALIGN(width, ALIGN16);
-            size_t lumaSize = ALIGN(alignedw * height, ALIGN2K);
-            return lumaSize;
-        }
-        default:
-            return 0;
-    }
+    return ccCalcYSize(format, width, height);
 }
 
 size_t C2DColorConverter::calcSize(ColorConvertFormat format, size_t width, size_t height)
 {
-    int32_t alignedw = 0;
-    int32_t alignedh = 0;
-    int32_t size = 0;
-
-    switch (format) {
-        case RGB565:
-            size = ALIGN(width, ALIGN32) * ALIGN(height, ALIGN32) * 2;
-            size = ALIGN(size, ALIGN4K);
-            break;
-        case RGBA8888:
-            size = ALIGN(width, ALIGN32) * ALIGN(height, ALIGN32) * 4;
-            size = ALIGN(size, ALIGN4K);
-            break;
-        case YCbCr420SP:
-            alignedw = ALIGN(width, ALIGN16);
-            size = ALIGN((alignedw * height) + (ALIGN(width/2, ALIGN16) * (height/2) * 2), ALIGN4K);
-            break;
-        case YCbCr420P:
-            size = ALIGN((width * height * 3 / 2), ALIGN4K);
-            break;
-        case YCrCb420P:
-            alignedw = ALIGN(width, ALIGN16);
-            size = ALIGN((alignedw * height) + (ALIGN(width/2, ALIGN16) * (height/2) * 2), ALIGN4K);
-            break;
-        case YCbCr420Tile:
-            alignedw = ALIGN(width, ALIGN128);
-            alignedh = ALIGN(height, ALIGN32);
-            size = ALIGN(alignedw * alignedh, ALIGN8K) + ALIGN(alignedw * ALIGN(height/2, ALIGN32), ALIGN8K);
-            break;
-        case NV12_2K: {
-            alignedw = ALIGN(width, ALIGN16);
-            size_t lumaSize = ALIGN(alignedw * height, ALIGN2K);
-            size_t chromaSize = ALIGN((alignedw * height)/2, ALIGN2K);
-            size = ALIGN(lumaSize + chromaSize, ALIGN4K);
-            ALOGV("NV12_2k, width = %d, height = %d, size = %d", width, height, size);
-            }
-            break;
-        default:
-            break;
-    }
-    return size;
+    return ccCalcSize(format, width, height);
 }
+
 /*
  * Tells GPU to map given buffer and returns a physical address of mapped buffer
  */
@@ -664,7 +574,18 @@ int32_t C2DColorConverter::dumpOutput(char * filename, char mode) {
 
 extern "C" C2DColorConverterBase* createC2DColorConverter(size_t srcWidth, size_t srcHeight, size_t dstWidth, size_t dstHeight, ColorConvertFormat srcFormat, ColorConvertFormat dstFormat, int32_t flags, size_t stride)
 {
-    return new C2DColorConverter(srcWidth, srcHeight, dstWidth, dstHeight, srcFormat, dstFormat, flags, stride);
+    C2DColorConverter *c2dcc = new C2DColorConverter(srcWidth, srcHeight, dstWidth, dstHeight, srcFormat, dstFormat, flags, stride);
+    if (c2dcc->isValid())
+        return c2dcc;
+
+    /* no C2D blitter (or headless build): fall back to the CPU converter */
+    delete (C2DColorConverterBase *)c2dcc;
+    if (!SWColorConverter::isSupported(srcWidth, srcHeight, dstWidth, dstHeight, srcFormat, dstFormat)) {
+        ALOGE("No software fallback for conversion %d -> %d", srcFormat, dstFormat);
+        return NULL;
+    }
+    ALOGI("C2D unavailable, using software color converter %d -> %d", srcFormat, dstFormat);
+    return new SWColorConverter(srcWidth, srcHeight, dstWidth, dstHeight, srcFormat, dstFormat, flags, stride);
 }
 
 extern "C" void destroyC2DColorConverter(C2DColorConverterBase* C2DCC)
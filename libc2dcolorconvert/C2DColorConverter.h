@@ -103,6 +103,12 @@ public:
     virtual int convertC2D(int srcFd, void * srcData, int dstFd, void * dstData) = 0;
     virtual int32_t getBuffReq(int32_t port, C2DBuffReq *req) = 0;
     virtual int32_t dumpOutput(char * filename, char mode) = 0;
+    /* convert only this rectangle of the frame; 0 width/height resets to
+       the full frame. Returns -1 if the converter cannot crop. */
+    virtual int32_t setCropRect(size_t x, size_t y, size_t width, size_t height) {
+        (void)x; (void)y; (void)width; (void)height;
+        return -1;
+    }
 };
 
 typedef C2DColorConverterBase* createC2DColorConverter_t(size_t srcWidth, size_t srcHeight, size_t dstWidth, size_t dstHeight, ColorConvertFormat srcFormat, ColorConvertFormat dstFormat, int32_t flags, size_t stride);
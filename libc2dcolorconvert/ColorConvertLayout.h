@@ -0,0 +1,163 @@
+/* copyright (c) 2012, The Linux Foundation. all rights reserved.
+ *
+ * redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * this software is provided "as is" and any express or implied
+ * warranties, including, but not limited to, the implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement
+ * are disclaimed.  in no event shall the copyright owner or contributors
+ * be liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or
+ * business interruption) however caused and on any theory of liability,
+ * whether in contract, strict liability, or tort (including negligence
+ * or otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ *
+ */
+/*--------------------------------------------------------------------------
+Copyright (c) 2012 The Linux Foundation. All rights reserved.
+--------------------------------------------------------------------------*/
+
+#ifndef Color_Convert_Layout_H_
+#define Color_Convert_Layout_H_
+
+/*
+ * Buffer geometry for each ColorConvertFormat. Shared by the C2D and the
+ * software converters so both agree on strides, plane offsets and sizes.
+ */
+
+#include <C2DColorConverter.h>
+
+#define ALIGN( num, to ) (((num) + (to-1)) & (~(to-1)))
+#define ALIGN8K 8192
+#define ALIGN4K 4096
+#define ALIGN2K 2048
+#define ALIGN128 128
+#define ALIGN32 32
+#define ALIGN16 16
+
+namespace android {
+
+static inline bool ccIsYUVFormat(ColorConvertFormat format)
+{
+    switch (format) {
+        case YCbCr420Tile:
+        case YCbCr420SP:
+        case YCbCr420P:
+        case YCrCb420P:
+        case NV12_2K:
+            return true;
+        case RGB565:
+        case RGBA8888:
+        default:
+            return false;
+    }
+}
+
+/* stride of plane 0 in bytes; 'stride' is the RGBA8888 row length override */
+static inline size_t ccCalcStride(ColorConvertFormat format, size_t width, size_t stride)
+{
+    switch (format) {
+        case RGB565:
+            return ALIGN(width, ALIGN32) * 2; // RGB565 has width as twice
+        case RGBA8888:
+            if (stride)
+                width = stride;
+            return ALIGN(width, ALIGN32) * 4;
+
+        case YCbCr420Tile:
+            return ALIGN(width, ALIGN128);
+        case YCbCr420SP:
+            return ALIGN(width, ALIGN16);
+        case NV12_2K:
+            return ALIGN(width, ALIGN16);
+        case YCbCr420P:
+            return width;
+        case YCrCb420P:
+            return ALIGN(width, ALIGN16);
+        default:
+            return 0;
+    }
+}
+
+/* offset of plane 1 (chroma) from the start of the buffer */
+static inline size_t ccCalcYSize(ColorConvertFormat format, size_t width, size_t height)
+{
+    switch (format) {
+        case YCbCr420SP:
+            return (ALIGN(width, ALIGN16) * height);
+        case YCbCr420P:
+            return width * height;
+        case YCrCb420P:
+            return ALIGN(width, ALIGN16) * height;
+        case YCbCr420Tile:
+            return ALIGN(ALIGN(width, ALIGN128) * ALIGN(height, ALIGN32), ALIGN8K);
+        case NV12_2K: {
+            size_t alignedw = ALIGN(width, ALIGN16);
+            size_t lumaSize = ALIGN(alignedw * height, ALIGN2K);
+            return lumaSize;
+        }
+        default:
+            return 0;
+    }
+}
+
+static inline size_t ccCalcSize(ColorConvertFormat format, size_t width, size_t height)
+{
+    int32_t alignedw = 0;
+    int32_t alignedh = 0;
+    int32_t size = 0;
+
+    switch (format) {
+        case RGB565:
+            size = ALIGN(width, ALIGN32) * ALIGN(height, ALIGN32) * 2;
+            size = ALIGN(size, ALIGN4K);
+            break;
+        case RGBA8888:
+            size = ALIGN(width, ALIGN32) * ALIGN(height, ALIGN32) * 4;
+            size = ALIGN(size, ALIGN4K);
+            break;
+        case YCbCr420SP:
+            alignedw = ALIGN(width, ALIGN16);
+            size = ALIGN((alignedw * height) + (ALIGN(width/2, ALIGN16) * (height/2) * 2), ALIGN4K);
+            break;
+        case YCbCr420P:
+            size = ALIGN((width * height * 3 / 2), ALIGN4K);
+            break;
+        case YCrCb420P:
+            alignedw = ALIGN(width, ALIGN16);
+            size = ALIGN((alignedw * height) + (ALIGN(width/2, ALIGN16) * (height/2) * 2), ALIGN4K);
+            break;
+        case YCbCr420Tile:
+            alignedw = ALIGN(width, ALIGN128);
+            alignedh = ALIGN(height, ALIGN32);
+            size = ALIGN(alignedw * alignedh, ALIGN8K) + ALIGN(alignedw * ALIGN(height/2, ALIGN32), ALIGN8K);
+            break;
+        case NV12_2K: {
+            alignedw = ALIGN(width, ALIGN16);
+            size_t lumaSize = ALIGN(alignedw * height, ALIGN2K);
+            size_t chromaSize = ALIGN((alignedw * height)/2, ALIGN2K);
+            size = ALIGN(lumaSize + chromaSize, ALIGN4K);
+            }
+            break;
+        default:
+            break;
+    }
+    return size;
+}
+
+}
+
+#endif  // Color_Convert_Layout_H_
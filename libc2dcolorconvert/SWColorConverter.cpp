@@ -0,0 +1,875 @@
+/* copyright (c) 2012, The Linux Foundation. all rights reserved.
+ *
+ * redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * this software is provided "as is" and any express or implied
+ * warranties, including, but not limited to, the implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement
+ * are disclaimed.  in no event shall the copyright owner or contributors
+ * be liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or
+ * business interruption) however caused and on any theory of liability,
+ * whether in contract, strict liability, or tort (including negligence
+ * or otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ *
+ */
+/*--------------------------------------------------------------------------
+Copyright (c) 2012 The Linux Foundation. All rights reserved.
+--------------------------------------------------------------------------*/
+
+#include <SWColorConverter.h>
+#include <ColorConvertLayout.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utils/Log.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SW_CC_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SW_CC_SSE2
+#endif
+
+#undef LOG_TAG
+#define LOG_TAG "SWColorConvert"
+
+#define TILE_WIDTH 64
+#define TILE_HEIGHT 32
+#define TILE_SIZE (TILE_WIDTH * TILE_HEIGHT)
+
+/* Below this many pixels the thread handoff costs more than it saves */
+#define SW_CC_MT_MIN_PIXELS (320 * 240)
+
+namespace android {
+
+/*
+ * Fixed point BT.601 video range conversion. The coefficients are scaled
+ * so every intermediate fits in a signed 16 bit lane; the SIMD kernels
+ * below evaluate exactly the same expressions and are bit exact with the
+ * scalar code, which also handles the row tails.
+ *
+ *   R = (37 * (Y - 16) + 51 * (V - 128) + 16) >> 5
+ *   G = (37 * (Y - 16) - 13 * (U - 128) - 26 * (V - 128) + 16) >> 5
+ *   B = (37 * (Y - 16) + 65 * (U - 128) + 16) >> 5
+ *
+ *   Y = ((33 * R + 65 * G + 13 * B + 64) >> 7) + 16
+ *   U = ((-38 * R - 74 * G + 112 * B + 128) >> 8) + 128
+ *   V = ((112 * R - 94 * G - 18 * B + 128) >> 8) + 128
+ *
+ * with U/V computed from the rounded average of each 2x2 block.
+ */
+
+static inline uint8_t clampU8(int v)
+{
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+static inline void yuvToRgbPixel(int y, int d, int e, uint8_t *r, uint8_t *g, uint8_t *b)
+{
+    int y1 = (y - 16) * 37;
+    *r = clampU8((y1 + 51 * e + 16) >> 5);
+    *g = clampU8((y1 - 13 * d - 26 * e + 16) >> 5);
+    *b = clampU8((y1 + 65 * d + 16) >> 5);
+}
+
+static inline uint8_t rgbToY(int r, int g, int b)
+{
+    return ((33 * r + 65 * g + 13 * b + 64) >> 7) + 16;
+}
+
+static inline uint16_t packRGB565(uint8_t r, uint8_t g, uint8_t b)
+{
+    return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+}
+
+static void spToRgbaScalar(const uint8_t *y0, const uint8_t *y1, const uint8_t *uv,
+        uint8_t *d0, uint8_t *d1, size_t x, size_t width)
+{
+    for (; x < width; x += 2) {
+        int d = uv[x] - 128, e = uv[x + 1] - 128;
+        for (int i = 0; i < 2; i++) {
+            uint8_t *p0 = d0 + (x + i) * 4, *p1 = d1 + (x + i) * 4;
+            yuvToRgbPixel(y0[x + i], d, e, &p0[0], &p0[1], &p0[2]);
+            p0[3] = 0xff;
+            yuvToRgbPixel(y1[x + i], d, e, &p1[0], &p1[1], &p1[2]);
+            p1[3] = 0xff;
+        }
+    }
+}
+
+static void spToRgb565Scalar(const uint8_t *y0, const uint8_t *y1, const uint8_t *uv,
+        uint16_t *d0, uint16_t *d1, size_t x, size_t width)
+{
+    uint8_t r, g, b;
+    for (; x < width; x += 2) {
+        int d = uv[x] - 128, e = uv[x + 1] - 128;
+        for (int i = 0; i < 2; i++) {
+            yuvToRgbPixel(y0[x + i], d, e, &r, &g, &b);
+            d0[x + i] = packRGB565(r, g, b);
+            yuvToRgbPixel(y1[x + i], d, e, &r, &g, &b);
+            d1[x + i] = packRGB565(r, g, b);
+        }
+    }
+}
+
+static void rgbaToSpScalar(const uint8_t *s0, const uint8_t *s1,
+        uint8_t *y0, uint8_t *y1, uint8_t *uv, size_t x, size_t width)
+{
+    for (; x < width; x += 2) {
+        const uint8_t *a = s0 + x * 4, *c = s1 + x * 4;
+        y0[x] = rgbToY(a[0], a[1], a[2]);
+        y0[x + 1] = rgbToY(a[4], a[5], a[6]);
+        y1[x] = rgbToY(c[0], c[1], c[2]);
+        y1[x + 1] = rgbToY(c[4], c[5], c[6]);
+        int r = (a[0] + a[4] + c[0] + c[4] + 2) >> 2;
+        int g = (a[1] + a[5] + c[1] + c[5] + 2) >> 2;
+        int b = (a[2] + a[6] + c[2] + c[6] + 2) >> 2;
+        uv[x] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+        uv[x + 1] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+    }
+}
+
+static void deinterleaveScalar(const uint8_t *uv, uint8_t *u, uint8_t *v, size_t x, size_t count)
+{
+    for (; x < count; x++) {
+        u[x] = uv[2 * x];
+        v[x] = uv[2 * x + 1];
+    }
+}
+
+#if defined(SW_CC_NEON)
+
+static size_t spToRgbSimd(const uint8_t *y0, const uint8_t *y1, const uint8_t *uv,
+        uint8_t *d0, uint8_t *d1, size_t width, bool rgb565)
+{
+    const int16x8_t k16 = vdupq_n_s16(16);
+    const int16x8_t k128 = vdupq_n_s16(128);
+    const uint8_t *ys[2] = { y0, y1 };
+    uint8_t *ds[2] = { d0, d1 };
+    size_t x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        uint8x8x2_t c = vld2_u8(uv + x);
+        uint8x8x2_t u = vzip_u8(c.val[0], c.val[0]);
+        uint8x8x2_t v = vzip_u8(c.val[1], c.val[1]);
+        for (int h = 0; h < 2; h++) {
+            int16x8_t d = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u.val[h])), k128);
+            int16x8_t e = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v.val[h])), k128);
+            int16x8_t rd = vmlaq_n_s16(k16, e, 51);
+            int16x8_t gd = vmlsq_n_s16(vmlsq_n_s16(k16, d, 13), e, 26);
+            int16x8_t bd = vmlaq_n_s16(k16, d, 65);
+            for (int row = 0; row < 2; row++) {
+                uint8x8_t yv = vld1_u8(ys[row] + x + 8 * h);
+                int16x8_t yl = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(yv)), k16), 37);
+                uint8x8_t r = vqmovun_s16(vshrq_n_s16(vaddq_s16(yl, rd), 5));
+                uint8x8_t g = vqmovun_s16(vshrq_n_s16(vaddq_s16(yl, gd), 5));
+                uint8x8_t b = vqmovun_s16(vshrq_n_s16(vaddq_s16(yl, bd), 5));
+                if (rgb565) {
+                    uint16x8_t p = vshll_n_u8(r, 8);
+                    p = vsriq_n_u16(p, vshll_n_u8(g, 8), 5);
+                    p = vsriq_n_u16(p, vshll_n_u8(b, 8), 11);
+                    vst1q_u16((uint16_t *)ds[row] + x + 8 * h, p);
+                } else {
+                    uint8x8x4_t px;
+                    px.val[0] = r;
+                    px.val[1] = g;
+                    px.val[2] = b;
+                    px.val[3] = vdup_n_u8(0xff);
+                    vst4_u8(ds[row] + (x + 8 * h) * 4, px);
+                }
+            }
+        }
+    }
+    return x;
+}
+
+static inline int16x4_t rgbToChroma(int16x4_t r, int16x4_t g, int16x4_t b,
+        int16_t kr, int16_t kg, int16_t kb)
+{
+    int16x4_t k128 = vdup_n_s16(128);
+    int16x4_t c = vmul_n_s16(r, kr);
+    c = vmla_n_s16(c, g, kg);
+    c = vmla_n_s16(c, b, kb);
+    return vadd_s16(vshr_n_s16(vadd_s16(c, k128), 8), k128);
+}
+
+static size_t rgbaToSpSimd(const uint8_t *s0, const uint8_t *s1,
+        uint8_t *y0, uint8_t *y1, uint8_t *uv, size_t width)
+{
+    const uint8x8_t kr = vdup_n_u8(33), kg = vdup_n_u8(65), kb = vdup_n_u8(13);
+    const uint8x8_t k16 = vdup_n_u8(16);
+    size_t x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        uint8x8x4_t a = vld4_u8(s0 + x * 4);
+        uint8x8x4_t c = vld4_u8(s1 + x * 4);
+
+        uint16x8_t l = vmull_u8(a.val[0], kr);
+        l = vmlal_u8(l, a.val[1], kg);
+        l = vmlal_u8(l, a.val[2], kb);
+        vst1_u8(y0 + x, vadd_u8(vrshrn_n_u16(l, 7), k16));
+        l = vmull_u8(c.val[0], kr);
+        l = vmlal_u8(l, c.val[1], kg);
+        l = vmlal_u8(l, c.val[2], kb);
+        vst1_u8(y1 + x, vadd_u8(vrshrn_n_u16(l, 7), k16));
+
+        int16x4_t r = vreinterpret_s16_u16(vrshr_n_u16(vadd_u16(vpaddl_u8(a.val[0]), vpaddl_u8(c.val[0])), 2));
+        int16x4_t g = vreinterpret_s16_u16(vrshr_n_u16(vadd_u16(vpaddl_u8(a.val[1]), vpaddl_u8(c.val[1])), 2));
+        int16x4_t b = vreinterpret_s16_u16(vrshr_n_u16(vadd_u16(vpaddl_u8(a.val[2]), vpaddl_u8(c.val[2])), 2));
+        int16x4x2_t z = vzip_s16(rgbToChroma(r, g, b, -38, -74, 112),
+                                 rgbToChroma(r, g, b, 112, -94, -18));
+        vst1_u8(uv + x, vqmovun_s16(vcombine_s16(z.val[0], z.val[1])));
+    }
+    return x;
+}
+
+static size_t deinterleaveSimd(const uint8_t *uv, uint8_t *u, uint8_t *v, size_t count)
+{
+    size_t x = 0;
+    for (; x + 16 <= count; x += 16) {
+        uint8x16x2_t c = vld2q_u8(uv + 2 * x);
+        vst1q_u8(u + x, c.val[0]);
+        vst1q_u8(v + x, c.val[1]);
+    }
+    return x;
+}
+
+/* one 64 byte tile row */
+static inline void copyTileRow(uint8_t *dst, const uint8_t *src)
+{
+    uint8x16_t a = vld1q_u8(src);
+    uint8x16_t b = vld1q_u8(src + 16);
+    uint8x16_t c = vld1q_u8(src + 32);
+    uint8x16_t d = vld1q_u8(src + 48);
+    vst1q_u8(dst, a);
+    vst1q_u8(dst + 16, b);
+    vst1q_u8(dst + 32, c);
+    vst1q_u8(dst + 48, d);
+}
+
+#elif defined(SW_CC_SSE2)
+
+static size_t spToRgbSimd(const uint8_t *y0, const uint8_t *y1, const uint8_t *uv,
+        uint8_t *d0, uint8_t *d1, size_t width, bool rgb565)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i k16 = _mm_set1_epi16(16);
+    const __m128i k128 = _mm_set1_epi16(128);
+    const __m128i lo16 = _mm_set1_epi32(0xffff);
+    const __m128i alpha = _mm_set1_epi8((char)0xff);
+    const uint8_t *ys[2] = { y0, y1 };
+    uint8_t *ds[2] = { d0, d1 };
+    size_t x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        /* U0 V0 U1 V1 .. U3 V3 -> U0 U0 U1 U1 .. and V0 V0 V1 V1 .. */
+        __m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(uv + x)), zero);
+        __m128i u = _mm_and_si128(c, lo16);
+        __m128i v = _mm_srli_epi32(c, 16);
+        __m128i d = _mm_sub_epi16(_mm_or_si128(u, _mm_slli_epi32(u, 16)), k128);
+        __m128i e = _mm_sub_epi16(_mm_or_si128(v, _mm_slli_epi32(v, 16)), k128);
+        __m128i rd = _mm_add_epi16(k16, _mm_mullo_epi16(e, _mm_set1_epi16(51)));
+        __m128i gd = _mm_sub_epi16(_mm_sub_epi16(k16, _mm_mullo_epi16(d, _mm_set1_epi16(13))),
+                                   _mm_mullo_epi16(e, _mm_set1_epi16(26)));
+        __m128i bd = _mm_add_epi16(k16, _mm_mullo_epi16(d, _mm_set1_epi16(65)));
+        for (int row = 0; row < 2; row++) {
+            __m128i yv = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(ys[row] + x)), zero);
+            __m128i yl = _mm_mullo_epi16(_mm_sub_epi16(yv, k16), _mm_set1_epi16(37));
+            __m128i r = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(yl, rd), 5), zero);
+            __m128i g = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(yl, gd), 5), zero);
+            __m128i b = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(yl, bd), 5), zero);
+            if (rgb565) {
+                __m128i p = _mm_slli_epi16(_mm_srli_epi16(_mm_unpacklo_epi8(r, zero), 3), 11);
+                p = _mm_or_si128(p, _mm_slli_epi16(_mm_srli_epi16(_mm_unpacklo_epi8(g, zero), 2), 5));
+                p = _mm_or_si128(p, _mm_srli_epi16(_mm_unpacklo_epi8(b, zero), 3));
+                _mm_storeu_si128((__m128i *)((uint16_t *)ds[row] + x), p);
+            } else {
+                __m128i rg = _mm_unpacklo_epi8(r, g);
+                __m128i ba = _mm_unpacklo_epi8(b, alpha);
+                _mm_storeu_si128((__m128i *)(ds[row] + x * 4), _mm_unpacklo_epi16(rg, ba));
+                _mm_storeu_si128((__m128i *)(ds[row] + x * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+            }
+        }
+    }
+    return x;
+}
+
+static inline __m128i rgbToChroma(__m128i r, __m128i g, __m128i b,
+        int16_t kr, int16_t kg, int16_t kb)
+{
+    const __m128i k128 = _mm_set1_epi16(128);
+    __m128i c = _mm_mullo_epi16(r, _mm_set1_epi16(kr));
+    c = _mm_add_epi16(c, _mm_mullo_epi16(g, _mm_set1_epi16(kg)));
+    c = _mm_add_epi16(c, _mm_mullo_epi16(b, _mm_set1_epi16(kb)));
+    return _mm_add_epi16(_mm_srai_epi16(_mm_add_epi16(c, k128), 8), k128);
+}
+
+/* rounded average of horizontal pairs of a row pair sum, 4 results */
+static inline __m128i pairAverage(__m128i sum)
+{
+    const __m128i lo16 = _mm_set1_epi32(0xffff);
+    __m128i s = _mm_add_epi32(_mm_and_si128(sum, lo16), _mm_srli_epi32(sum, 16));
+    s = _mm_srli_epi32(_mm_add_epi32(s, _mm_set1_epi32(2)), 2);
+    return _mm_packs_epi32(s, s);
+}
+
+static size_t rgbaToSpSimd(const uint8_t *s0, const uint8_t *s1,
+        uint8_t *y0, uint8_t *y1, uint8_t *uv, size_t width)
+{
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128i k16 = _mm_set1_epi16(16);
+    const __m128i k64 = _mm_set1_epi16(64);
+    const uint8_t *ss[2] = { s0, s1 };
+    uint8_t *ys[2] = { y0, y1 };
+    __m128i r[2], g[2], b[2];
+    size_t x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        for (int row = 0; row < 2; row++) {
+            __m128i p0 = _mm_loadu_si128((const __m128i *)(ss[row] + x * 4));
+            __m128i p1 = _mm_loadu_si128((const __m128i *)(ss[row] + x * 4 + 16));
+            r[row] = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+            g[row] = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask),
+                                     _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+            b[row] = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask),
+                                     _mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+            __m128i l = _mm_mullo_epi16(r[row], _mm_set1_epi16(33));
+            l = _mm_add_epi16(l, _mm_mullo_epi16(g[row], _mm_set1_epi16(65)));
+            l = _mm_add_epi16(l, _mm_mullo_epi16(b[row], _mm_set1_epi16(13)));
+            l = _mm_add_epi16(_mm_srli_epi16(_mm_add_epi16(l, k64), 7), k16);
+            _mm_storel_epi64((__m128i *)(ys[row] + x), _mm_packus_epi16(l, l));
+        }
+        __m128i ra = pairAverage(_mm_add_epi16(r[0], r[1]));
+        __m128i ga = pairAverage(_mm_add_epi16(g[0], g[1]));
+        __m128i ba = pairAverage(_mm_add_epi16(b[0], b[1]));
+        __m128i c = _mm_unpacklo_epi16(rgbToChroma(ra, ga, ba, -38, -74, 112),
+                                       rgbToChroma(ra, ga, ba, 112, -94, -18));
+        _mm_storel_epi64((__m128i *)(uv + x), _mm_packus_epi16(c, c));
+    }
+    return x;
+}
+
+static size_t deinterleaveSimd(const uint8_t *uv, uint8_t *u, uint8_t *v, size_t count)
+{
+    const __m128i mask = _mm_set1_epi16(0xff);
+    size_t x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(uv + 2 * x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(uv + 2 * x + 16));
+        _mm_storeu_si128((__m128i *)(u + x),
+                _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+        _mm_storeu_si128((__m128i *)(v + x),
+                _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+    }
+    return x;
+}
+
+/*
+ * One 64 byte tile row. Plain stores: non-temporal ones measured 4-8x
+ * slower with sw-detile-test -b, the consumer reads the frame soon after.
+ */
+static inline void copyTileRow(uint8_t *dst, const uint8_t *src)
+{
+    __m128i a = _mm_loadu_si128((const __m128i *)src);
+    __m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+    __m128i c = _mm_loadu_si128((const __m128i *)(src + 32));
+    __m128i d = _mm_loadu_si128((const __m128i *)(src + 48));
+    _mm_storeu_si128((__m128i *)dst, a);
+    _mm_storeu_si128((__m128i *)(dst + 16), b);
+    _mm_storeu_si128((__m128i *)(dst + 32), c);
+    _mm_storeu_si128((__m128i *)(dst + 48), d);
+}
+
+#else
+
+static size_t spToRgbSimd(const uint8_t *, const uint8_t *, const uint8_t *,
+        uint8_t *, uint8_t *, size_t, bool)
+{
+    return 0;
+}
+
+static size_t rgbaToSpSimd(const uint8_t *, const uint8_t *,
+        uint8_t *, uint8_t *, uint8_t *, size_t)
+{
+    return 0;
+}
+
+static size_t deinterleaveSimd(const uint8_t *, uint8_t *, uint8_t *, size_t)
+{
+    return 0;
+}
+
+static inline void copyTileRow(uint8_t *dst, const uint8_t *src)
+{
+    memcpy(dst, src, 64);
+}
+
+#endif
+
+static inline void deinterleave(const uint8_t *uv, uint8_t *u, uint8_t *v, size_t count)
+{
+    deinterleaveScalar(uv, u, v, deinterleaveSimd(uv, u, v, count), count);
+}
+
+/*
+ * Index of tile (x, y) in a 64x32 macro-tiled plane of w x h tiles. Tiles
+ * are stored in pairs of rows following a Z pattern over 2x2 tile groups;
+ * a trailing odd row is stored linearly.
+ */
+static size_t tilePos(size_t x, size_t y, size_t w, size_t h)
+{
+    size_t flim = x + (y & ~1) * w;
+
+    if (y & 1) {
+        flim += (x & ~3) + 2;
+    } else if ((h & 1) == 0 || y != (h - 1)) {
+        flim += (x + 2) & ~3;
+    }
+    return flim;
+}
+
+SWColorConverter::SWColorConverter(size_t srcWidth, size_t srcHeight, size_t dstWidth, size_t dstHeight, ColorConvertFormat srcFormat, ColorConvertFormat dstFormat, int32_t flags, size_t stride)
+{
+    (void)dstWidth;
+    (void)dstHeight;
+    (void)flags;
+
+    mWidth = srcWidth;
+    mHeight = srcHeight;
+    mStride = stride;
+    mSrcFormat = srcFormat;
+    mDstFormat = dstFormat;
+    mSrc = NULL;
+    mDst = NULL;
+    getOp(srcFormat, dstFormat, &mOp);
+    getLayout(srcFormat, &mSrcLayout);
+    getLayout(dstFormat, &mDstLayout);
+    setCropRect(0, 0, srcWidth, srcHeight);
+
+    pthread_mutex_init(&mLock, NULL);
+    pthread_cond_init(&mWorkCond, NULL);
+    pthread_cond_init(&mDoneCond, NULL);
+    mJobSeq = 0;
+    mPending = 0;
+    mStarted = 0;
+    mExit = false;
+    mNumThreads = 0;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > SW_CC_MAX_THREADS)
+        cpus = SW_CC_MAX_THREADS;
+    if (srcWidth * srcHeight < SW_CC_MT_MIN_PIXELS || (size_t)cpus > mUnitEnd)
+        cpus = 1;
+    for (int i = 0; i < cpus - 1; i++) {
+        if (pthread_create(&mThreads[i], NULL, workerThread, this)) {
+            ALOGE("Failed to create color convert thread %d", i);
+            break;
+        }
+        mNumThreads++;
+    }
+    ALOGV("SW color convert %d -> %d, %dx%d, %d threads", srcFormat, dstFormat,
+            srcWidth, srcHeight, mNumThreads + 1);
+}
+
+SWColorConverter::~SWColorConverter()
+{
+    pthread_mutex_lock(&mLock);
+    mExit = true;
+    pthread_cond_broadcast(&mWorkCond);
+    pthread_mutex_unlock(&mLock);
+    for (int i = 0; i < mNumThreads; i++)
+        pthread_join(mThreads[i], NULL);
+
+    pthread_cond_destroy(&mDoneCond);
+    pthread_cond_destroy(&mWorkCond);
+    pthread_mutex_destroy(&mLock);
+}
+
+bool SWColorConverter::getOp(ColorConvertFormat srcFormat, ColorConvertFormat dstFormat, ConvertOp *op)
+{
+    bool dstSP = (dstFormat == YCbCr420SP || dstFormat == NV12_2K);
+    bool dstP = (dstFormat == YCbCr420P || dstFormat == YCrCb420P);
+
+    switch (srcFormat) {
+        case YCbCr420Tile:
+            if (dstSP)
+                *op = OP_DETILE_SP;
+            else if (dstFormat == YCbCr420P)
+                *op = OP_DETILE_P;
+            else
+                return false;
+            return true;
+        case YCbCr420SP:
+        case NV12_2K:
+            if (dstSP)
+                *op = OP_COPY_SP;
+            else if (dstP)
+                *op = OP_SP_TO_P;
+            else if (dstFormat == RGB565)
+                *op = OP_SP_TO_RGB565;
+            else if (dstFormat == RGBA8888)
+                *op = OP_SP_TO_RGBA;
+            else
+                return false;
+            return true;
+        case RGBA8888:
+            if (!dstSP)
+                return false;
+            *op = OP_RGBA_TO_SP;
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool SWColorConverter::isSupported(size_t srcWidth, size_t srcHeight, size_t dstWidth, size_t dstHeight, ColorConvertFormat srcFormat, ColorConvertFormat dstFormat)
+{
+    ConvertOp op;
+
+    if (srcWidth != dstWidth || srcHeight != dstHeight)
+        return false;
+    if (!srcWidth || !srcHeight || (srcWidth & 1) || (srcHeight & 1))
+        return false;
+    return getOp(srcFormat, dstFormat, &op);
+}
+
+void SWColorConverter::getLayout(ColorConvertFormat format, PlaneLayout *layout)
+{
+    size_t ySize = ccCalcYSize(format, mWidth, mHeight);
+
+    layout->yStride = ccCalcStride(format, mWidth, mStride);
+    layout->cStride = layout->yStride;
+    layout->uOffset = ySize;
+    layout->vOffset = 0;
+
+    switch (format) {
+        case YCbCr420P:
+            layout->cStride = layout->yStride / 2;
+            layout->vOffset = ySize + ySize / 4;
+            break;
+        case YCrCb420P:
+            layout->cStride = layout->yStride / 2;
+            layout->vOffset = ySize;
+            layout->uOffset = ySize + ySize / 4;
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * Detiles the part of luma tile row 'tileRow' (and the matching 16 chroma
+ * rows) that falls inside the crop rectangle. Each source tile is 2K of
+ * contiguous memory, so walking tile by tile keeps the reads sequential
+ * while the writes go out as whole 64 byte rows.
+ */
+void SWColorConverter::detileRows(size_t tileRow)
+{
+    size_t tileW = (mWidth - 1) / TILE_WIDTH + 1;
+    size_t tileWAlign = (tileW + 1) & ~1;
+    size_t tileHLuma = (mHeight - 1) / TILE_HEIGHT + 1;
+    size_t tileHChroma = (mHeight / 2 - 1) / TILE_HEIGHT + 1;
+    size_t lumaSize = mSrcLayout.uOffset;
+    size_t yStride = mDstLayout.yStride;
+    size_t cStride = mDstLayout.cStride;
+
+    size_t rowBegin = tileRow * TILE_HEIGHT;
+    size_t rowEnd = rowBegin + TILE_HEIGHT;
+    if (rowBegin < mCropY)
+        rowBegin = mCropY;
+    if (rowEnd > mCropY + mCropH)
+        rowEnd = mCropY + mCropH;
+    size_t tileRow0 = rowBegin - tileRow * TILE_HEIGHT;
+    size_t rows = rowEnd - rowBegin;
+
+    size_t firstTile = mCropX / TILE_WIDTH;
+    size_t lastTile = (mCropX + mCropW - 1) / TILE_WIDTH;
+
+    for (size_t x = firstTile; x <= lastTile; x++) {
+        size_t colBegin = x * TILE_WIDTH;
+        size_t colEnd = colBegin + TILE_WIDTH;
+        if (colBegin < mCropX)
+            colBegin = mCropX;
+        if (colEnd > mCropX + mCropW)
+            colEnd = mCropX + mCropW;
+        size_t tileCol0 = colBegin - x * TILE_WIDTH;
+        size_t cols = colEnd - colBegin;
+
+        const uint8_t *srcY = mSrc + tilePos(x, tileRow, tileWAlign, tileHLuma) * TILE_SIZE +
+            tileRow0 * TILE_WIDTH + tileCol0;
+        const uint8_t *srcC = mSrc + lumaSize +
+            tilePos(x, tileRow / 2, tileWAlign, tileHChroma) * TILE_SIZE +
+            tileRow0 / 2 * TILE_WIDTH + tileCol0;
+        if (tileRow & 1)
+            srcC += TILE_SIZE / 2;
+        if (x < lastTile)
+            __builtin_prefetch(mSrc + tilePos(x + 1, tileRow, tileWAlign, tileHLuma) * TILE_SIZE);
+
+        uint8_t *dstY = mDst + rowBegin * yStride + colBegin;
+        if (cols == TILE_WIDTH) {
+            for (size_t r = 0; r < rows; r++)
+                copyTileRow(dstY + r * yStride, srcY + r * TILE_WIDTH);
+        } else {
+            for (size_t r = 0; r < rows; r++)
+                memcpy(dstY + r * yStride, srcY + r * TILE_WIDTH, cols);
+        }
+
+        size_t chromaRow = rowBegin / 2;
+        if (mOp == OP_DETILE_SP) {
+            uint8_t *dstUV = mDst + mDstLayout.uOffset + chromaRow * cStride + colBegin;
+            for (size_t r = 0; r < rows / 2; r++) {
+                if (cols == TILE_WIDTH)
+                    copyTileRow(dstUV + r * cStride, srcC + r * TILE_WIDTH);
+                else
+                    memcpy(dstUV + r * cStride, srcC + r * TILE_WIDTH, cols);
+            }
+        } else {
+            uint8_t *dstU = mDst + mDstLayout.uOffset + chromaRow * cStride + colBegin / 2;
+            uint8_t *dstV = mDst + mDstLayout.vOffset + chromaRow * cStride + colBegin / 2;
+            for (size_t r = 0; r < rows / 2; r++)
+                deinterleave(srcC + r * TILE_WIDTH, dstU + r * cStride, dstV + r * cStride, cols / 2);
+        }
+    }
+}
+
+/*
+ * Converts tile rows (tiled input) or row pairs [first, last), limited to
+ * the columns of the crop rectangle.
+ */
+void SWColorConverter::convertUnits(size_t first, size_t last)
+{
+    const PlaneLayout &s = mSrcLayout;
+    const PlaneLayout &d = mDstLayout;
+    size_t x0 = mCropX;
+    size_t w = mCropW;
+
+    for (size_t unit = first; unit < last; unit++) {
+        size_t row = unit * 2;
+
+        switch (mOp) {
+            case OP_DETILE_SP:
+            case OP_DETILE_P:
+                detileRows(unit);
+                break;
+            case OP_COPY_SP:
+                memcpy(mDst + row * d.yStride + x0, mSrc + row * s.yStride + x0, w);
+                memcpy(mDst + (row + 1) * d.yStride + x0, mSrc + (row + 1) * s.yStride + x0, w);
+                memcpy(mDst + d.uOffset + unit * d.cStride + x0, mSrc + s.uOffset + unit * s.cStride + x0, w);
+                break;
+            case OP_SP_TO_P:
+                memcpy(mDst + row * d.yStride + x0, mSrc + row * s.yStride + x0, w);
+                memcpy(mDst + (row + 1) * d.yStride + x0, mSrc + (row + 1) * s.yStride + x0, w);
+                deinterleave(mSrc + s.uOffset + unit * s.cStride + x0,
+                        mDst + d.uOffset + unit * d.cStride + x0 / 2,
+                        mDst + d.vOffset + unit * d.cStride + x0 / 2, w / 2);
+                break;
+            case OP_SP_TO_RGB565:
+            case OP_SP_TO_RGBA: {
+                bool rgb565 = (mOp == OP_SP_TO_RGB565);
+                size_t bpp = rgb565 ? 2 : 4;
+                const uint8_t *y0 = mSrc + row * s.yStride + x0;
+                const uint8_t *y1 = y0 + s.yStride;
+                const uint8_t *uv = mSrc + s.uOffset + unit * s.cStride + x0;
+                uint8_t *d0 = mDst + row * d.yStride + x0 * bpp;
+                uint8_t *d1 = d0 + d.yStride;
+                size_t x = spToRgbSimd(y0, y1, uv, d0, d1, w, rgb565);
+                if (rgb565)
+                    spToRgb565Scalar(y0, y1, uv, (uint16_t *)d0, (uint16_t *)d1, x, w);
+                else
+                    spToRgbaScalar(y0, y1, uv, d0, d1, x, w);
+                break;
+            }
+            case OP_RGBA_TO_SP: {
+                const uint8_t *s0 = mSrc + row * s.yStride + x0 * 4;
+                const uint8_t *s1 = s0 + s.yStride;
+                uint8_t *y0 = mDst + row * d.yStride + x0;
+                uint8_t *y1 = y0 + d.yStride;
+                uint8_t *uv = mDst + d.uOffset + unit * d.cStride + x0;
+                size_t x = rgbaToSpSimd(s0, s1, y0, y1, uv, w);
+                rgbaToSpScalar(s0, s1, y0, y1, uv, x, w);
+                break;
+            }
+        }
+    }
+}
+
+/* slice 'index' of 'parts' of the units covered by the crop rectangle */
+void SWColorConverter::convertSlice(int index, int parts)
+{
+    size_t units = mUnitEnd - mUnitBegin;
+    convertUnits(mUnitBegin + units * index / parts, mUnitBegin + units * (index + 1) / parts);
+}
+
+int32_t SWColorConverter::setCropRect(size_t x, size_t y, size_t width, size_t height)
+{
+    if (!width || !height) {
+        x = y = 0;
+        width = mWidth;
+        height = mHeight;
+    }
+    if (x >= mWidth || y >= mHeight || width > mWidth - x || height > mHeight - y) {
+        ALOGE("Invalid crop %dx%d at (%d, %d) for %dx%d", width, height, x, y, mWidth, mHeight);
+        setCropRect(0, 0, 0, 0);
+        return -1;
+    }
+
+    /* 4:2:0 chroma is shared by 2x2 pixels, widen the rectangle to even bounds */
+    mCropX = x & ~1;
+    mCropY = y & ~1;
+    mCropW = ALIGN(x + width, 2) - mCropX;
+    mCropH = ALIGN(y + height, 2) - mCropY;
+
+    if (mSrcFormat == YCbCr420Tile) {
+        mUnitBegin = mCropY / TILE_HEIGHT;
+        mUnitEnd = (mCropY + mCropH - 1) / TILE_HEIGHT + 1;
+    } else {
+        mUnitBegin = mCropY / 2;
+        mUnitEnd = (mCropY + mCropH) / 2;
+    }
+    return 0;
+}
+
+void *SWColorConverter::workerThread(void *arg)
+{
+    SWColorConverter *cc = (SWColorConverter *)arg;
+    int index;
+
+    /* worker index is the order in which the threads start */
+    pthread_mutex_lock(&cc->mLock);
+    index = ++cc->mStarted;
+    pthread_mutex_unlock(&cc->mLock);
+    cc->workerLoop(index);
+    return NULL;
+}
+
+void SWColorConverter::workerLoop(int index)
+{
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&mLock);
+    for (;;) {
+        while (!mExit && mJobSeq == seen)
+            pthread_cond_wait(&mWorkCond, &mLock);
+        if (mExit)
+            break;
+        seen = mJobSeq;
+        pthread_mutex_unlock(&mLock);
+
+        convertSlice(index, mNumThreads + 1);
+
+        pthread_mutex_lock(&mLock);
+        if (--mPending == 0)
+            pthread_cond_signal(&mDoneCond);
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+int SWColorConverter::convertC2D(int srcFd, void * srcData, int dstFd, void * dstData)
+{
+    (void)srcFd;
+    (void)dstFd;
+
+    if ((srcData == NULL) || (dstData == NULL)) {
+        ALOGE("Incorrect input parameters\n");
+        return -1;
+    }
+
+    mSrc = (const uint8_t *)srcData;
+    mDst = (uint8_t *)dstData;
+    if (!mNumThreads) {
+        convertSlice(0, 1);
+        return 0;
+    }
+
+    /* workers take slices 1..N, the caller takes slice 0 */
+    pthread_mutex_lock(&mLock);
+    mPending = mNumThreads;
+    mJobSeq++;
+    pthread_cond_broadcast(&mWorkCond);
+    pthread_mutex_unlock(&mLock);
+
+    convertSlice(0, mNumThreads + 1);
+
+    pthread_mutex_lock(&mLock);
+    while (mPending)
+        pthread_cond_wait(&mDoneCond, &mLock);
+    pthread_mutex_unlock(&mLock);
+    return 0;
+}
+
+int32_t SWColorConverter::getBuffReq(int32_t port, C2DBuffReq *req) {
+    if (!req) return -1;
+
+    if (port != C2D_INPUT && port != C2D_OUTPUT) return -1;
+
+    ColorConvertFormat format = (port == C2D_INPUT) ? mSrcFormat : mDstFormat;
+    memset(req, 0, sizeof(C2DBuffReq));
+    req->width = mWidth;
+    req->height = mHeight;
+    req->stride = ccCalcStride(format, mWidth, mStride);
+    req->sliceHeight = mHeight;
+    req->lumaAlign = (format == NV12_2K) ? ALIGN2K : 1;
+    req->sizeAlign = (format == YCbCr420SP || format == YCbCr420P || format == NV12_2K) ? ALIGN4K : 1;
+    req->size = ccCalcSize(format, mWidth, mHeight);
+    return 0;
+}
+
+int32_t SWColorConverter::dumpOutput(char * filename, char mode) {
+    int fd;
+    if (!filename || !mDst) return -1;
+
+    int flags = O_RDWR | O_CREAT;
+    if (mode == 'a') {
+      flags |= O_APPEND;
+    }
+
+    if ((fd = open(filename, flags, 0644)) < 0) {
+        ALOGE("open dump file failed w/ errno %s", strerror(errno));
+        return -1;
+    }
+
+    int ret = 0;
+    const PlaneLayout &d = mDstLayout;
+    if (ccIsYUVFormat(mDstFormat)) {
+      for (size_t i = 0; i < mHeight && ret >= 0; i++)
+        ret = write(fd, mDst + i * d.yStride, mWidth);
+      if (d.vOffset) {
+        for (size_t i = 0; i < mHeight / 2 && ret >= 0; i++)
+          ret = write(fd, mDst + d.uOffset + i * d.cStride, mWidth / 2);
+        for (size_t i = 0; i < mHeight / 2 && ret >= 0; i++)
+          ret = write(fd, mDst + d.vOffset + i * d.cStride, mWidth / 2);
+      } else {
+        for (size_t i = 0; i < mHeight / 2 && ret >= 0; i++)
+          ret = write(fd, mDst + d.uOffset + i * d.cStride, mWidth);
+      }
+    } else {
+      int bpp = (mDstFormat == RGB565) ? 2 : 4;
+      for (size_t i = 0; i < mHeight && ret >= 0; i++)
+        ret = write(fd, mDst + i * d.yStride, mWidth * bpp);
+    }
+
+    if (ret < 0) {
+      ALOGE("file write failed w/ errno %s", strerror(errno));
+    }
+    close(fd);
+    return ret < 0 ? ret : 0;
+}
+
+}
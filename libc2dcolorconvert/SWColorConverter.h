@@ -0,0 +1,124 @@
+/* copyright (c) 2012, The Linux Foundation. all rights reserved.
+ *
+ * redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * this software is provided "as is" and any express or implied
+ * warranties, including, but not limited to, the implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement
+ * are disclaimed.  in no event shall the copyright owner or contributors
+ * be liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or
+ * business interruption) however caused and on any theory of liability,
+ * whether in contract, strict liability, or tort (including negligence
+ * or otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ *
+ */
+/*--------------------------------------------------------------------------
+Copyright (c) 2012 The Linux Foundation. All rights reserved.
+--------------------------------------------------------------------------*/
+
+#ifndef SW_ColorConverter_H_
+#define SW_ColorConverter_H_
+
+#include <C2DColorConverter.h>
+#include <pthread.h>
+
+namespace android {
+
+#define SW_CC_MAX_THREADS 4
+
+/*
+ * CPU implementation of C2DColorConverterBase, used when the C2D blitter
+ * cannot be loaded. Supports, without scaling:
+ *   YCbCr420Tile               -> YCbCr420SP, NV12_2K, YCbCr420P
+ *   YCbCr420SP, NV12_2K        -> YCbCr420SP, NV12_2K, YCbCr420P, YCrCb420P
+ *   YCbCr420SP, NV12_2K        -> RGB565, RGBA8888
+ *   RGBA8888                   -> YCbCr420SP, NV12_2K
+ * YUV is BT.601 video range. Rows are split across up to
+ * SW_CC_MAX_THREADS threads, the calling thread included. setCropRect
+ * limits conversion to the displayed area; pixels outside it are left
+ * untouched in the destination.
+ */
+class SWColorConverter : public C2DColorConverterBase {
+
+public:
+    SWColorConverter(size_t srcWidth, size_t srcHeight, size_t dstWidth, size_t dstHeight, ColorConvertFormat srcFormat, ColorConvertFormat dstFormat, int32_t flags, size_t stride);
+    static bool isSupported(size_t srcWidth, size_t srcHeight, size_t dstWidth, size_t dstHeight, ColorConvertFormat srcFormat, ColorConvertFormat dstFormat);
+    int32_t getBuffReq(int32_t port, C2DBuffReq *req);
+    int32_t dumpOutput(char * filename, char mode);
+    int32_t setCropRect(size_t x, size_t y, size_t width, size_t height);
+protected:
+    virtual ~SWColorConverter();
+    virtual int convertC2D(int srcFd, void * srcData, int dstFd, void * dstData);
+
+private:
+    enum ConvertOp {
+        OP_DETILE_SP,
+        OP_DETILE_P,
+        OP_COPY_SP,
+        OP_SP_TO_P,
+        OP_SP_TO_RGB565,
+        OP_SP_TO_RGBA,
+        OP_RGBA_TO_SP,
+    };
+
+    struct PlaneLayout {
+        size_t yStride;     // bytes per row of plane 0 (or of the RGB plane)
+        size_t cStride;     // bytes per row of the chroma plane(s)
+        size_t uOffset;     // Cb plane (or interleaved CbCr) offset
+        size_t vOffset;     // Cr plane offset, planar formats only
+    };
+
+    static bool getOp(ColorConvertFormat srcFormat, ColorConvertFormat dstFormat, ConvertOp *op);
+    void getLayout(ColorConvertFormat format, PlaneLayout *layout);
+    void convertUnits(size_t first, size_t last);
+    void convertSlice(int index, int parts);
+    void detileRows(size_t tileRow);
+    static void *workerThread(void *arg);
+    void workerLoop(int index);
+
+    size_t mWidth;
+    size_t mHeight;
+    size_t mStride;
+    ColorConvertFormat mSrcFormat;
+    ColorConvertFormat mDstFormat;
+    ConvertOp mOp;
+    PlaneLayout mSrcLayout;
+    PlaneLayout mDstLayout;
+    size_t mCropX;          // crop rectangle, widened to even bounds
+    size_t mCropY;
+    size_t mCropW;
+    size_t mCropH;
+    size_t mUnitBegin;      // tile rows for tiled input, row pairs otherwise
+    size_t mUnitEnd;
+
+    const uint8_t *mSrc;
+    uint8_t *mDst;
+
+    pthread_mutex_t mLock;
+    pthread_cond_t mWorkCond;
+    pthread_cond_t mDoneCond;
+    pthread_t mThreads[SW_CC_MAX_THREADS];
+    int mNumThreads;        // worker threads, excluding the caller
+    unsigned mJobSeq;
+    int mPending;           // workers still busy with job mJobSeq
+    int mStarted;
+    bool mExit;
+};
+
+}
+
+#endif  // SW_ColorConverter_H_
@@ -0,0 +1,316 @@
+/* copyright (c) 2012, The Linux Foundation. all rights reserved.
+ *
+ * redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * this software is provided "as is" and any express or implied
+ * warranties, including, but not limited to, the implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement
+ * are disclaimed.  in no event shall the copyright owner or contributors
+ * be liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or
+ * business interruption) however caused and on any theory of liability,
+ * whether in contract, strict liability, or tort (including negligence
+ * or otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ *
+ */
+/*
+    Conformance test and benchmark for SWColorConverter.
+
+    sw-color-convert-test [iterations] [seed]
+    sw-color-convert-test -b [width] [height] [loops]
+
+    Every conversion SWColorConverter supports is run on random frames and
+    compared byte for byte with a per-pixel reference that addresses the
+    source and destination only through ColorConvertLayout.h (the geometry
+    the C2D converter uses too) and evaluates the fixed point BT.601
+    formulas documented in SWColorConverter.cpp. Whatever kernel the build
+    picked (NEON, SSE2 or scalar) must match it everywhere, including the
+    row tails the SIMD loops leave to the scalar code and the padding,
+    which must stay untouched. The fixed sizes cover 2x2, widths that are
+    not a multiple of any vector width, tiled frames with an odd number of
+    tile rows and sizes large enough for the thread pool; the iterations
+    after them use random even sizes and random RGBA8888 strides.
+
+    The benchmark reports the time per frame of each conversion.
+*/
+
+#include <SWColorConverter.h>
+#include <ColorConvertLayout.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+using namespace android;
+
+struct conversion {
+    ColorConvertFormat src;
+    ColorConvertFormat dst;
+    const char *name;
+};
+
+static const conversion conversions[] = {
+    { YCbCr420Tile, YCbCr420SP, "Tile -> SP" },
+    { YCbCr420Tile, NV12_2K, "Tile -> NV12_2K" },
+    { YCbCr420Tile, YCbCr420P, "Tile -> P" },
+    { YCbCr420SP, YCbCr420SP, "SP -> SP" },
+    { YCbCr420SP, NV12_2K, "SP -> NV12_2K" },
+    { NV12_2K, YCbCr420SP, "NV12_2K -> SP" },
+    { YCbCr420SP, YCbCr420P, "SP -> P" },
+    { NV12_2K, YCrCb420P, "NV12_2K -> YV12" },
+    { YCbCr420SP, RGB565, "SP -> RGB565" },
+    { NV12_2K, RGB565, "NV12_2K -> RGB565" },
+    { YCbCr420SP, RGBA8888, "SP -> RGBA8888" },
+    { NV12_2K, RGBA8888, "NV12_2K -> RGBA8888" },
+    { RGBA8888, YCbCr420SP, "RGBA8888 -> SP" },
+    { RGBA8888, NV12_2K, "RGBA8888 -> NV12_2K" },
+};
+
+#define NUM_CONVERSIONS (sizeof(conversions) / sizeof(conversions[0]))
+
+static const size_t sizes[][2] = {
+    { 2, 2 }, { 18, 6 }, { 30, 2 }, { 66, 34 }, { 130, 98 }, { 176, 144 },
+    { 322, 242 }, { 640, 480 }, { 1280, 720 }, { 1918, 1082 },
+};
+
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+static uint32_t rnd_state;
+
+static uint32_t rnd()
+{
+    rnd_state = rnd_state * 1103515245 + 12345;
+    return rnd_state >> 8;
+}
+
+static size_t bufSize(ColorConvertFormat format, size_t width, size_t height, size_t stride)
+{
+    size_t size = ccCalcSize(format, width, height);
+    size_t rows = ccCalcStride(format, width, stride) * height;
+    return size > rows ? size : rows;
+}
+
+static int clamp(int v)
+{
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+/* byte offset of luma (x, y) or, for the chroma plane, of chroma (x, y) */
+static size_t tileOffset(size_t x, size_t y, size_t width, size_t height)
+{
+    size_t tilesW = ((width - 1) / 64 + 2) & ~1;
+    size_t tilesH = (height - 1) / 32 + 1;
+    size_t tx = x / 64, ty = y / 32;
+    size_t tile = tx + (ty & ~1) * tilesW;
+
+    if (ty & 1)
+        tile += (tx & ~3) + 2;
+    else if ((tilesH & 1) == 0 || ty != tilesH - 1)
+        tile += (tx + 2) & ~3;
+    return tile * 2048 + (y % 32) * 64 + x % 64;
+}
+
+static void refConvert(const conversion &c, size_t width, size_t height, size_t stride,
+        const uint8_t *src, uint8_t *dst)
+{
+    size_t srcStride = ccCalcStride(c.src, width, stride);
+    size_t dstStride = ccCalcStride(c.dst, width, stride);
+    size_t srcY = ccCalcYSize(c.src, width, height);
+    size_t dstY = ccCalcYSize(c.dst, width, height);
+
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            size_t cx = x & ~1, cy = y / 2;
+            int Y, U, V;
+
+            if (c.src == YCbCr420Tile) {
+                Y = src[tileOffset(x, y, width, height)];
+                U = src[srcY + tileOffset(cx, cy, width, height / 2)];
+                V = src[srcY + tileOffset(cx, cy, width, height / 2) + 1];
+            } else if (c.src == RGBA8888) {
+                const uint8_t *p = src + y * srcStride + x * 4;
+                int r = 0, g = 0, b = 0;
+                Y = ((33 * p[0] + 65 * p[1] + 13 * p[2] + 64) >> 7) + 16;
+                for (size_t j = 0; j < 2; j++) {
+                    for (size_t i = 0; i < 2; i++) {
+                        const uint8_t *q = src + (2 * cy + j) * srcStride + (cx + i) * 4;
+                        r += q[0];
+                        g += q[1];
+                        b += q[2];
+                    }
+                }
+                r = (r + 2) >> 2;
+                g = (g + 2) >> 2;
+                b = (b + 2) >> 2;
+                U = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+                V = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+            } else {
+                Y = src[y * srcStride + x];
+                U = src[srcY + cy * srcStride + cx];
+                V = src[srcY + cy * srcStride + cx + 1];
+            }
+
+            if (c.dst == RGBA8888 || c.dst == RGB565) {
+                int l = 37 * (Y - 16);
+                int R = clamp((l + 51 * (V - 128) + 16) >> 5);
+                int G = clamp((l - 13 * (U - 128) - 26 * (V - 128) + 16) >> 5);
+                int B = clamp((l + 65 * (U - 128) + 16) >> 5);
+                if (c.dst == RGBA8888) {
+                    uint8_t *p = dst + y * dstStride + x * 4;
+                    p[0] = R;
+                    p[1] = G;
+                    p[2] = B;
+                    p[3] = 0xff;
+                } else {
+                    uint16_t p = ((R >> 3) << 11) | ((G >> 2) << 5) | (B >> 3);
+                    memcpy(dst + y * dstStride + x * 2, &p, 2);
+                }
+            } else if (c.dst == YCbCr420P || c.dst == YCrCb420P) {
+                size_t cb = dstY, cr = dstY + dstY / 4;
+                if (c.dst == YCrCb420P) {
+                    cb = cr;
+                    cr = dstY;
+                }
+                dst[y * dstStride + x] = Y;
+                dst[cb + cy * (dstStride / 2) + x / 2] = U;
+                dst[cr + cy * (dstStride / 2) + x / 2] = V;
+            } else {
+                dst[y * dstStride + x] = Y;
+                dst[dstY + cy * dstStride + cx] = U;
+                dst[dstY + cy * dstStride + cx + 1] = V;
+            }
+        }
+    }
+}
+
+static bool check(const conversion &c, size_t width, size_t height, size_t stride)
+{
+    size_t srcSize = bufSize(c.src, width, height, stride);
+    size_t dstSize = bufSize(c.dst, width, height, stride);
+    uint8_t *src = (uint8_t *)malloc(srcSize);
+    uint8_t *out = (uint8_t *)malloc(dstSize);
+    uint8_t *ref = (uint8_t *)malloc(dstSize);
+    bool ok = true;
+
+    for (size_t i = 0; i < srcSize; i++)
+        src[i] = rnd();
+    memset(out, 0xa5, dstSize);
+    memset(ref, 0xa5, dstSize);
+
+    if (!SWColorConverter::isSupported(width, height, width, height, c.src, c.dst)) {
+        printf("FAIL: %s %zux%zu not supported\n", c.name, width, height);
+        ok = false;
+    } else {
+        C2DColorConverterBase *cc = new SWColorConverter(width, height, width, height,
+                c.src, c.dst, 0, stride);
+        C2DBuffReq req;
+        cc->getBuffReq(C2D_OUTPUT, &req);
+        if ((size_t)req.size > dstSize ||
+                (size_t)req.stride != ccCalcStride(c.dst, width, stride)) {
+            printf("FAIL: %s %zux%zu buffer requirements %d/%d\n", c.name, width, height,
+                    req.size, req.stride);
+            ok = false;
+        }
+        if (cc->convertC2D(-1, src, -1, out)) {
+            printf("FAIL: %s %zux%zu convert failed\n", c.name, width, height);
+            ok = false;
+        }
+        delete cc;
+        refConvert(c, width, height, stride, src, ref);
+        for (size_t i = 0; ok && i < dstSize; i++) {
+            if (out[i] != ref[i]) {
+                printf("FAIL: %s %zux%zu stride %zu: byte %zu is %d, expected %d\n",
+                        c.name, width, height, stride, i, out[i], ref[i]);
+                ok = false;
+            }
+        }
+    }
+    free(src);
+    free(out);
+    free(ref);
+    return ok;
+}
+
+static int test(uint32_t iterations, uint32_t seed)
+{
+    rnd_state = seed;
+    for (size_t s = 0; s < NUM_SIZES; s++) {
+        for (size_t i = 0; i < NUM_CONVERSIONS; i++) {
+            if (!check(conversions[i], sizes[s][0], sizes[s][1], 0)) {
+                printf("test failed at fixed size %zux%zu, seed %u\n", sizes[s][0], sizes[s][1], seed);
+                return 1;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < iterations; i++) {
+        const conversion &c = conversions[i % NUM_CONVERSIONS];
+        size_t width = 2 + (rnd() % 400) * 2;
+        size_t height = 2 + (rnd() % 200) * 2;
+        size_t stride = 0;
+        if ((c.src == RGBA8888 || c.dst == RGBA8888) && rnd() % 2)
+            stride = width + rnd() % 70;
+        if (!check(c, width, height, stride)) {
+            printf("test failed at iteration %u, seed %u\n", i, seed);
+            return 1;
+        }
+    }
+    printf("test: %u iterations passed, seed %u\n", iterations, seed);
+    return 0;
+}
+
+static uint64_t now_us()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static int bench(size_t width, size_t height, uint32_t loops)
+{
+    if (!width || !height || (width & 1) || (height & 1)) {
+        printf("width and height must be even\n");
+        return 1;
+    }
+    for (size_t i = 0; i < NUM_CONVERSIONS; i++) {
+        const conversion &c = conversions[i];
+        uint8_t *src = (uint8_t *)malloc(bufSize(c.src, width, height, 0));
+        uint8_t *dst = (uint8_t *)malloc(bufSize(c.dst, width, height, 0));
+        C2DColorConverterBase *cc = new SWColorConverter(width, height, width, height,
+                c.src, c.dst, 0, 0);
+
+        memset(src, 0x80, bufSize(c.src, width, height, 0));
+        cc->convertC2D(-1, src, -1, dst);
+        uint64_t start = now_us();
+        for (uint32_t n = 0; n < loops; n++)
+            cc->convertC2D(-1, src, -1, dst);
+        uint64_t us = now_us() - start;
+        printf("%-22s %zux%zu: %7.2f ms/frame\n", c.name, width, height,
+                (double)us / 1000 / (loops ? loops : 1));
+        delete cc;
+        free(src);
+        free(dst);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && !strcmp(argv[1], "-b"))
+        return bench(argc > 2 ? atoi(argv[2]) : 1920, argc > 3 ? atoi(argv[3]) : 1080,
+                argc > 4 ? atoi(argv[4]) : 50);
+    return test(argc > 1 ? atoi(argv[1]) : 200, argc > 2 ? atoi(argv[2]) : 1);
+}
@@ -0,0 +1,391 @@
+/* copyright (c) 2012, The Linux Foundation. all rights reserved.
+ *
+ * redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * this software is provided "as is" and any express or implied
+ * warranties, including, but not limited to, the implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement
+ * are disclaimed.  in no event shall the copyright owner or contributors
+ * be liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or
+ * business interruption) however caused and on any theory of liability,
+ * whether in contract, strict liability, or tort (including negligence
+ * or otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ *
+ */
+/*
+    Bit exactness test and benchmark for the SWColorConverter 64x32 tile
+    detiler and setCropRect.
+
+    sw-detile-test [iterations] [seed]
+    sw-detile-test -b [loops]
+
+    Each iteration picks a random even frame size, odd ones in tiles
+    included (partial last tile column, odd number of luma or chroma tile
+    rows), a random crop rectangle with odd coordinates allowed, and a
+    destination that is not always 16 byte aligned so both the streaming
+    and the unaligned tile row stores run. The detiled output must match a
+    scalar detiler byte for byte inside the crop rectangle widened to even
+    bounds and leave every other byte untouched. The same crop check runs
+    for the other conversions against their own full frame output. Zero
+    sized and out of range rectangles must reset to the full frame.
+
+    The benchmark compares the scalar detiler with the converter at 720p,
+    1080p and 4K, for the full frame and a centered 3/4 crop.
+*/
+
+#include <SWColorConverter.h>
+#include <ColorConvertLayout.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+using namespace android;
+
+#define FILL 0xa5
+#define DST_SLACK 64
+
+struct rect {
+    size_t x, y, w, h;
+};
+
+static const ColorConvertFormat others[][2] = {
+    { YCbCr420SP, YCbCr420P },
+    { NV12_2K, YCrCb420P },
+    { YCbCr420SP, NV12_2K },
+    { YCbCr420SP, RGB565 },
+    { NV12_2K, RGBA8888 },
+    { RGBA8888, YCbCr420SP },
+};
+
+static uint32_t rnd_state;
+
+static uint32_t rnd()
+{
+    rnd_state = rnd_state * 1103515245 + 12345;
+    return rnd_state >> 8;
+}
+
+/* byte offset of (x, y) in a 64x32 macro-tiled plane of width x height */
+static size_t tileOffset(size_t x, size_t y, size_t width, size_t height)
+{
+    size_t tilesW = ((width - 1) / 64 + 2) & ~1;
+    size_t tilesH = (height - 1) / 32 + 1;
+    size_t tx = x / 64, ty = y / 32;
+    size_t tile = tx + (ty & ~1) * tilesW;
+
+    if (ty & 1)
+        tile += (tx & ~3) + 2;
+    else if ((tilesH & 1) == 0 || ty != tilesH - 1)
+        tile += (tx + 2) & ~3;
+    return tile * 2048 + (y % 32) * 64 + x % 64;
+}
+
+/* one byte at a time detile of 'r' (even bounds) into SP or P */
+static void refDetile(ColorConvertFormat dstFormat, size_t width, size_t height,
+        const uint8_t *src, uint8_t *dst, const rect &r)
+{
+    size_t srcY = ccCalcYSize(YCbCr420Tile, width, height);
+    size_t stride = ccCalcStride(dstFormat, width, 0);
+    size_t dstY = ccCalcYSize(dstFormat, width, height);
+
+    for (size_t y = r.y; y < r.y + r.h; y++)
+        for (size_t x = r.x; x < r.x + r.w; x++)
+            dst[y * stride + x] = src[tileOffset(x, y, width, height)];
+    for (size_t y = r.y / 2; y < (r.y + r.h) / 2; y++) {
+        for (size_t x = r.x; x < r.x + r.w; x += 2) {
+            const uint8_t *uv = src + srcY + tileOffset(x, y, width, height / 2);
+            if (dstFormat == YCbCr420P) {
+                dst[dstY + y * (stride / 2) + x / 2] = uv[0];
+                dst[dstY + dstY / 4 + y * (stride / 2) + x / 2] = uv[1];
+            } else {
+                dst[dstY + y * stride + x] = uv[0];
+                dst[dstY + y * stride + x + 1] = uv[1];
+            }
+        }
+    }
+}
+
+/* copies the even widened rectangle 'r' of every plane from 'full' */
+static void copyRect(ColorConvertFormat format, size_t width, size_t height,
+        const uint8_t *full, uint8_t *dst, const rect &r)
+{
+    size_t stride = ccCalcStride(format, width, 0);
+    size_t ySize = ccCalcYSize(format, width, height);
+    size_t bpp = format == RGBA8888 ? 4 : (format == RGB565 ? 2 : 1);
+
+    for (size_t y = r.y; y < r.y + r.h; y++)
+        memcpy(dst + y * stride + r.x * bpp, full + y * stride + r.x * bpp, r.w * bpp);
+    if (!ccIsYUVFormat(format))
+        return;
+    for (size_t y = r.y / 2; y < (r.y + r.h) / 2; y++) {
+        if (format == YCbCr420P || format == YCrCb420P) {
+            size_t o = ySize + y * (stride / 2) + r.x / 2;
+            memcpy(dst + o, full + o, r.w / 2);
+            memcpy(dst + o + ySize / 4, full + o + ySize / 4, r.w / 2);
+        } else {
+            memcpy(dst + ySize + y * stride + r.x, full + ySize + y * stride + r.x, r.w);
+        }
+    }
+}
+
+static rect widen(size_t x, size_t y, size_t w, size_t h)
+{
+    rect r;
+    r.x = x & ~1;
+    r.y = y & ~1;
+    r.w = ((x + w + 1) & ~1) - r.x;
+    r.h = ((y + h + 1) & ~1) - r.y;
+    return r;
+}
+
+static bool compare(const char *what, const uint8_t *out, const uint8_t *ref, size_t size,
+        ColorConvertFormat src, ColorConvertFormat dst, size_t width, size_t height,
+        const rect &crop)
+{
+    for (size_t i = 0; i < size; i++) {
+        if (out[i] != ref[i]) {
+            printf("FAIL: %s %d -> %d %zux%zu crop %zu,%zu %zux%zu: byte %zu is %d, expected %d\n",
+                    what, src, dst, width, height, crop.x, crop.y, crop.w, crop.h, i, out[i], ref[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool checkDetile(ColorConvertFormat dstFormat, size_t width, size_t height,
+        const rect &crop, size_t align)
+{
+    size_t srcSize = ccCalcSize(YCbCr420Tile, width, height);
+    size_t dstSize = ccCalcSize(dstFormat, width, height);
+    uint8_t *src = (uint8_t *)malloc(srcSize);
+    uint8_t *buf = (uint8_t *)malloc(dstSize + DST_SLACK);
+    uint8_t *ref = (uint8_t *)malloc(dstSize + DST_SLACK);
+    uint8_t *out = (uint8_t *)(((uintptr_t)buf + 15) & ~(uintptr_t)15) + align;
+    C2DColorConverterBase *cc = new SWColorConverter(width, height, width, height,
+            YCbCr420Tile, dstFormat, 0, 0);
+    rect full = { 0, 0, width, height };
+    bool ok = true;
+
+    for (size_t i = 0; i < srcSize; i++)
+        src[i] = rnd();
+    memset(out, FILL, dstSize);
+    memset(ref, FILL, dstSize);
+
+    cc->convertC2D(-1, src, -1, out);
+    refDetile(dstFormat, width, height, src, ref, full);
+    ok = compare("full frame detile", out, ref, dstSize, YCbCr420Tile, dstFormat,
+            width, height, full);
+
+    if (ok && cc->setCropRect(crop.x, crop.y, crop.w, crop.h)) {
+        printf("FAIL: crop %zu,%zu %zux%zu rejected for %zux%zu\n", crop.x, crop.y,
+                crop.w, crop.h, width, height);
+        ok = false;
+    }
+    if (ok) {
+        memset(out, FILL, dstSize);
+        memset(ref, FILL, dstSize);
+        cc->convertC2D(-1, src, -1, out);
+        refDetile(dstFormat, width, height, src, ref, widen(crop.x, crop.y, crop.w, crop.h));
+        ok = compare("cropped detile", out, ref, dstSize, YCbCr420Tile, dstFormat,
+                width, height, crop);
+    }
+
+    delete cc;
+    free(src);
+    free(buf);
+    free(ref);
+    return ok;
+}
+
+static bool checkCrop(ColorConvertFormat srcFormat, ColorConvertFormat dstFormat,
+        size_t width, size_t height, const rect &crop)
+{
+    size_t srcSize = ccCalcSize(srcFormat, width, height);
+    size_t dstSize = ccCalcSize(dstFormat, width, height);
+    uint8_t *src = (uint8_t *)malloc(srcSize);
+    uint8_t *full = (uint8_t *)malloc(dstSize);
+    uint8_t *out = (uint8_t *)malloc(dstSize);
+    uint8_t *ref = (uint8_t *)malloc(dstSize);
+    C2DColorConverterBase *cc = new SWColorConverter(width, height, width, height,
+            srcFormat, dstFormat, 0, 0);
+    bool ok;
+
+    for (size_t i = 0; i < srcSize; i++)
+        src[i] = rnd();
+    memset(full, FILL, dstSize);
+    memset(out, FILL, dstSize);
+    memset(ref, FILL, dstSize);
+
+    cc->convertC2D(-1, src, -1, full);
+    ok = !cc->setCropRect(crop.x, crop.y, crop.w, crop.h);
+    cc->convertC2D(-1, src, -1, out);
+    copyRect(dstFormat, width, height, full, ref, widen(crop.x, crop.y, crop.w, crop.h));
+    ok = ok && compare("cropped", out, ref, dstSize, srcFormat, dstFormat, width, height, crop);
+
+    delete cc;
+    free(src);
+    free(full);
+    free(out);
+    free(ref);
+    return ok;
+}
+
+/* zero sized and invalid rectangles convert the whole frame again */
+static bool checkReset(size_t width, size_t height)
+{
+    static const size_t bad[][4] = {
+        { 0, 0, 0, 0 }, { 2, 2, 0, 4 }, { 0, 0, 1, 1 }, { 1, 0, ~(size_t)0, 2 },
+        { 0, 0, 1, 1 }, { 0, 1, 2, ~(size_t)0 - 1 }, { 0, 0, 1, 1 }, { ~(size_t)0, 0, 2, 2 },
+    };
+    size_t size = ccCalcSize(YCbCr420SP, width, height);
+    uint8_t *src = (uint8_t *)malloc(ccCalcSize(YCbCr420Tile, width, height));
+    uint8_t *out = (uint8_t *)malloc(size);
+    uint8_t *ref = (uint8_t *)malloc(size);
+    C2DColorConverterBase *cc = new SWColorConverter(width, height, width, height,
+            YCbCr420Tile, YCbCr420SP, 0, 0);
+    rect full = { 0, 0, width, height };
+    bool ok = true;
+
+    for (size_t i = 0; i < ccCalcSize(YCbCr420Tile, width, height); i++)
+        src[i] = rnd();
+    memset(ref, FILL, size);
+    refDetile(YCbCr420SP, width, height, src, ref, full);
+
+    for (size_t i = 0; ok && i < sizeof(bad) / sizeof(bad[0]); i++) {
+        /* the 1x1 entries in between set a real crop to be reset */
+        int ret = cc->setCropRect(bad[i][0], bad[i][1], bad[i][2], bad[i][3]);
+        if (bad[i][2] == 1)
+            continue;
+        if (ret != ((bad[i][2] && bad[i][3]) ? -1 : 0)) {
+            printf("FAIL: crop %zu,%zu %zux%zu returned %d\n", bad[i][0], bad[i][1],
+                    bad[i][2], bad[i][3], ret);
+            ok = false;
+        }
+        memset(out, FILL, size);
+        cc->convertC2D(-1, src, -1, out);
+        ok = ok && compare("reset", out, ref, size, YCbCr420Tile, YCbCr420SP, width, height, full);
+    }
+
+    delete cc;
+    free(src);
+    free(out);
+    free(ref);
+    return ok;
+}
+
+static rect randomCrop(size_t width, size_t height)
+{
+    rect r;
+    r.x = rnd() % width;
+    r.y = rnd() % height;
+    r.w = 1 + rnd() % (width - r.x);
+    r.h = 1 + rnd() % (height - r.y);
+    if (rnd() % 4 == 0) {
+        r.x = r.y = 0;
+        r.w = width;
+        r.h = height;
+    }
+    return r;
+}
+
+static int test(uint32_t iterations, uint32_t seed)
+{
+    rnd_state = seed;
+    if (!checkReset(130, 98) || !checkReset(1280, 720)) {
+        printf("test failed in crop reset, seed %u\n", seed);
+        return 1;
+    }
+    for (uint32_t i = 0; i < iterations; i++) {
+        size_t width = 2 + (rnd() % (i % 8 ? 200 : 1000)) * 2;
+        size_t height = 2 + (rnd() % (i % 8 ? 100 : 600)) * 2;
+        rect crop = randomCrop(width, height);
+        ColorConvertFormat dst = (i & 1) ? YCbCr420P : YCbCr420SP;
+        const ColorConvertFormat *other = others[i % (sizeof(others) / sizeof(others[0]))];
+
+        if (!checkDetile(dst, width, height, crop, rnd() % 16) ||
+                !checkCrop(other[0], other[1], width, height, randomCrop(width, height))) {
+            printf("test failed at iteration %u, seed %u\n", i, seed);
+            return 1;
+        }
+    }
+    printf("test: %u iterations passed, seed %u\n", iterations, seed);
+    return 0;
+}
+
+static uint64_t now_us()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void report(const char *name, size_t width, size_t height, uint32_t loops, uint64_t us)
+{
+    double ms = (double)us / 1000 / (loops ? loops : 1);
+    printf("%-20s %4zux%-4zu: %7.2f ms/frame %8.1f MB/s\n", name, width, height, ms,
+            width * height * 1.5 / 1000 / (ms ? ms : 1));
+}
+
+static int bench(uint32_t loops)
+{
+    static const size_t sizes[][2] = { { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 } };
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t width = sizes[s][0], height = sizes[s][1];
+        size_t dstSize = ccCalcSize(YCbCr420SP, width, height);
+        uint8_t *src = (uint8_t *)malloc(ccCalcSize(YCbCr420Tile, width, height));
+        uint8_t *dst = (uint8_t *)malloc(dstSize + DST_SLACK);
+        uint8_t *out = (uint8_t *)(((uintptr_t)dst + 15) & ~(uintptr_t)15);
+        C2DColorConverterBase *cc = new SWColorConverter(width, height, width, height,
+                YCbCr420Tile, YCbCr420SP, 0, 0);
+        rect full = { 0, 0, width, height };
+        uint64_t start;
+
+        memset(src, 0x80, ccCalcSize(YCbCr420Tile, width, height));
+        memset(out, 0, dstSize);
+
+        start = now_us();
+        for (uint32_t i = 0; i < loops; i++)
+            refDetile(YCbCr420SP, width, height, src, out, full);
+        report("scalar detile", width, height, loops, now_us() - start);
+
+        start = now_us();
+        for (uint32_t i = 0; i < loops; i++)
+            cc->convertC2D(-1, src, -1, out);
+        report("SWColorConverter", width, height, loops, now_us() - start);
+
+        cc->setCropRect(width / 8, height / 8, width * 3 / 4, height * 3 / 4);
+        start = now_us();
+        for (uint32_t i = 0; i < loops; i++)
+            cc->convertC2D(-1, src, -1, out);
+        report("3/4 crop", width, height, loops, now_us() - start);
+
+        delete cc;
+        free(src);
+        free(dst);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && !strcmp(argv[1], "-b"))
+        return bench(argc > 2 ? atoi(argv[2]) : 20);
+    return test(argc > 1 ? atoi(argv[1]) : 200, argc > 2 ? atoi(argv[2]) : 1);
+}
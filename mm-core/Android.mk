@@ -51,6 +51,8 @@ LOCAL_COPY_HEADERS      += inc/QOMX_FileFormatExtensions.h
 LOCAL_COPY_HEADERS      += inc/QOMX_IVCommonExtensions.h
 LOCAL_COPY_HEADERS      += inc/QOMX_SourceExtensions.h
 LOCAL_COPY_HEADERS      += inc/QOMX_VideoExtensions.h
+LOCAL_COPY_HEADERS      += inc/QOMX_SessionExtensions.h
+LOCAL_COPY_HEADERS      += inc/QOMX_PoolExtensions.h
 LOCAL_COPY_HEADERS      += inc/OMX_IndexExt.h
 LOCAL_COPY_HEADERS      += inc/QOMX_StreamingExtensions.h
 LOCAL_COPY_HEADERS      += inc/QCMediaDefs.h
@@ -65,11 +67,13 @@ LOCAL_C_INCLUDES        += $(LOCAL_PATH)/inc
 LOCAL_PRELINK_MODULE    := false
 LOCAL_MODULE            := libOmxCore
 LOCAL_MODULE_TAGS       := optional
-LOCAL_SHARED_LIBRARIES  := liblog libdl
+LOCAL_SHARED_LIBRARIES  := liblog libdl libcutils
 LOCAL_CFLAGS            := $(OMXCORE_CFLAGS)
 
 LOCAL_SRC_FILES         := src/common/omx_core_cmp.cpp
 LOCAL_SRC_FILES         += src/common/qc_omx_core.c
+LOCAL_SRC_FILES         += src/common/qc_omx_session.c
+LOCAL_SRC_FILES         += src/common/qc_omx_pool.c
 LOCAL_SRC_FILES         += src/$(MM_CORE_TARGET)/qc_registry_table_android.c
 
 include $(BUILD_SHARED_LIBRARY)
@@ -85,13 +89,59 @@ LOCAL_C_INCLUDES        += $(LOCAL_PATH)/inc
 LOCAL_PRELINK_MODULE    := false
 LOCAL_MODULE            := libmm-omxcore
 LOCAL_MODULE_TAGS       := optional
-LOCAL_SHARED_LIBRARIES  := liblog libdl
+LOCAL_SHARED_LIBRARIES  := liblog libdl libcutils
 LOCAL_CFLAGS            := $(OMXCORE_CFLAGS)
 
 LOCAL_SRC_FILES         := src/common/omx_core_cmp.cpp
 LOCAL_SRC_FILES         += src/common/qc_omx_core.c
+LOCAL_SRC_FILES         += src/common/qc_omx_session.c
+LOCAL_SRC_FILES         += src/common/qc_omx_pool.c
 LOCAL_SRC_FILES         += src/$(MM_CORE_TARGET)/qc_registry_table.c
 
 include $(BUILD_SHARED_LIBRARY)
 
+#===============================================================================
+#             Session manager simulator
+#===============================================================================
+
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES        := $(LOCAL_PATH)/src/common
+LOCAL_C_INCLUDES        += $(LOCAL_PATH)/inc
+LOCAL_PRELINK_MODULE    := false
+LOCAL_MODULE            := mm-omxcore-session-sim
+LOCAL_MODULE_TAGS       := debug
+LOCAL_SHARED_LIBRARIES  := liblog libcutils
+LOCAL_CFLAGS            := $(OMXCORE_CFLAGS)
+
+LOCAL_SRC_FILES         := src/common/qc_omx_session.c
+LOCAL_SRC_FILES         += test/omx_session_sim.c
+
+include $(BUILD_EXECUTABLE)
+
+#===============================================================================
+#             Handle churn benchmark
+#===============================================================================
+
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES        := $(LOCAL_PATH)/src/common
+LOCAL_C_INCLUDES        += $(LOCAL_PATH)/inc
+LOCAL_PRELINK_MODULE    := false
+LOCAL_MODULE            := mm-omxcore-churn-test
+LOCAL_MODULE_TAGS       := debug
+LOCAL_SHARED_LIBRARIES  := liblog libdl libcutils
+LOCAL_CFLAGS            := $(OMXCORE_CFLAGS)
+# the stub components are looked up with dlsym in the executable itself
+LOCAL_LDFLAGS           := -rdynamic
+
+LOCAL_SRC_FILES         := src/common/omx_core_cmp.cpp
+LOCAL_SRC_FILES         += src/common/qc_omx_core.c
+LOCAL_SRC_FILES         += src/common/qc_omx_session.c
+LOCAL_SRC_FILES         += src/common/qc_omx_pool.c
+LOCAL_SRC_FILES         += src/$(MM_CORE_TARGET)/qc_registry_table.c
+LOCAL_SRC_FILES         += test/omx_core_churn_test.cpp
+
+include $(BUILD_EXECUTABLE)
+
 endif #BUILD_TINY_ANDROID
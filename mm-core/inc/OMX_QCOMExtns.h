@@ -416,6 +416,12 @@ enum OMX_QCOM_EXTN_INDEXTYPE
     QOMX_IndexConfigVideoLTRMark = 0x7F00002C,
 
     OMX_GoogleAndroidIndexPrepareForAdaptivePlayback = 0x7F00002D,
+
+    /*"OMX.QCOM.index.config.video.BufferBatch"*/
+    OMX_QcomIndexConfigVideoBufferBatch = 0x7F00002E,
+
+    /*"OMX.QCOM.index.param.video.ExtraDataIndex"*/
+    OMX_QcomIndexParamVideoExtraDataIndex = 0x7F00002F,
 };
 
 /**
@@ -873,7 +879,8 @@ typedef enum OMX_QCOM_EXTRADATATYPE
    OMX_ExtraDataPortDef = 0x7F000008,
    OMX_ExtraDataMP2ExtnData = 0x7F000009,
    OMX_ExtraDataMP2UserData = 0x7F00000a,
-   OMX_ExtraDataVideoLTRInfo = 0x7F00000b
+   OMX_ExtraDataVideoLTRInfo = 0x7F00000b,
+   OMX_ExtraDataIndex = 0x7F00000c
 } OMX_QCOM_EXTRADATATYPE;
 
 typedef struct  OMX_STREAMINTERLACEFORMATTYPE {
@@ -1063,9 +1070,73 @@ typedef struct QOMX_INDEXTIMESTAMPREORDER {
 	OMX_BOOL bEnable;
 } QOMX_INDEXTIMESTAMPREORDER;
 
+#define QOMX_VIDEO_MAX_BUFFER_BATCH 32
+
+/**
+ * Buffer batch, set with OMX_SetConfig on
+ * OMX_QcomIndexConfigVideoBufferBatch to submit several buffers of one
+ * port in a single call. Input port buffers are handled as by
+ * OMX_EmptyThisBuffer and output port buffers as by OMX_FillThisBuffer,
+ * in array order.
+ *
+ *  STRUCT MEMBERS:
+ *  nSize        : Size of the structure in bytes
+ *  nVersion     : OMX specification version information
+ *  nPortIndex   : Port the buffers belong to
+ *  nCount       : Number of entries in ppBufferHdrs, at most
+ *                 QOMX_VIDEO_MAX_BUFFER_BATCH
+ *  nSubmitted   : Set by the component to the number of buffers queued.
+ *                 On error ppBufferHdrs[nSubmitted] is the rejected one.
+ *  ppBufferHdrs : Buffer headers to submit
+ */
+typedef struct QOMX_VIDEO_BUFFER_BATCHTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_U32 nCount;
+    OMX_U32 nSubmitted;
+    OMX_BUFFERHEADERTYPE **ppBufferHdrs;
+} QOMX_VIDEO_BUFFER_BATCHTYPE;
+
+#define QOMX_EXTRADATA_INDEX_MAX 16
+
+typedef struct QOMX_EXTRADATA_INDEX_ENTRY {
+    OMX_U32 eType;
+    OMX_U32 nOffset;
+    OMX_U32 nDataSize;
+} QOMX_EXTRADATA_INDEX_ENTRY;
+
+/**
+ * Extradata index, enabled with QOMX_ENABLETYPE on
+ * OMX_QcomIndexParamVideoExtraDataIndex in the Loaded state. Extradata
+ * records are then left where the driver wrote them instead of being
+ * copied, and the index is written at a fixed place at the end of every
+ * output buffer that has OMX_BUFFERFLAG_EXTRADATA set: an
+ * OMX_OTHER_EXTRADATATYPE of type OMX_ExtraDataIndex starting
+ * QOMX_EXTRADATA_INDEX_OFFSET(nAllocLen) bytes from pBuffer, with this
+ * structure as payload.
+ *
+ *  STRUCT MEMBERS:
+ *  nCount : Number of valid entries
+ *  entry  : One per extradata record exposed to the client, in buffer
+ *           order. nOffset is from pBuffer to the record header and
+ *           nDataSize is the record payload size.
+ */
+typedef struct QOMX_EXTRADATA_INDEXTYPE {
+    OMX_U32 nCount;
+    QOMX_EXTRADATA_INDEX_ENTRY entry[QOMX_EXTRADATA_INDEX_MAX];
+} QOMX_EXTRADATA_INDEXTYPE;
+
+#define QOMX_EXTRADATA_INDEX_SIZE ((sizeof(OMX_OTHER_EXTRADATATYPE) +\
+                                    sizeof(QOMX_EXTRADATA_INDEXTYPE) + 3)&(~3))
+#define QOMX_EXTRADATA_INDEX_OFFSET(nAllocLen) \
+    (((nAllocLen) - QOMX_EXTRADATA_INDEX_SIZE)&(~3))
+
 #define OMX_QCOM_INDEX_PARAM_VIDEO_SYNCFRAMEDECODINGMODE "OMX.QCOM.index.param.video.SyncFrameDecodingMode"
 #define OMX_QCOM_INDEX_PARAM_INDEXEXTRADATA "OMX.QCOM.index.param.IndexExtraData"
 #define OMX_QCOM_INDEX_PARAM_VIDEO_SLICEDELIVERYMODE "OMX.QCOM.index.param.SliceDeliveryMode"
+#define OMX_QCOM_INDEX_CONFIG_VIDEO_BUFFERBATCH "OMX.QCOM.index.config.video.BufferBatch"
+#define OMX_QCOM_INDEX_PARAM_VIDEO_EXTRADATAINDEX "OMX.QCOM.index.param.video.ExtraDataIndex"
 
 typedef enum {
     QOMX_VIDEO_FRAME_PACKING_CHECKERBOARD = 0,
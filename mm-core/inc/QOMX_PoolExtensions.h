@@ -0,0 +1,121 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+
+#ifndef __H_QOMX_POOLEXTENSIONS_H__
+#define __H_QOMX_POOLEXTENSIONS_H__
+
+/*========================================================================
+
+*//** @file QOMX_PoolExtensions.h
+
+@par FILE SERVICES:
+      Qualcomm extensions API for the OpenMax IL core.
+
+      This file contains the warm pool interface of the OpenMax core,
+      through which an IL client can keep initialized instances of a
+      component ready for OMX_GetHandle and compare the start up latency
+      of warm and cold instances.
+
+*//*====================================================================== */
+
+/*========================================================================
+
+                     INCLUDE FILES FOR MODULE
+
+========================================================================== */
+#include <OMX_Core.h>
+
+/*========================================================================
+
+                      DEFINITIONS AND DECLARATIONS
+
+========================================================================== */
+
+#if defined( __cplusplus )
+extern "C"
+{
+#endif /* end of macro __cplusplus */
+
+/**
+ * Warm pool statistics, returned by QOMX_GetWarmPoolStats. Latencies are
+ * measured over OMX_GetHandle, in microseconds. A warm start is served
+ * by a parked instance, a cold start constructs and initializes one.
+ *
+ * STRUCT MEMBERS:
+ *  nSize        : Size of the structure in bytes
+ *  nVersion     : OMX specification version info
+ *  nParked      : Instances parked now
+ *  nLent        : Instances of pooled components in use now
+ *  nWarmStarts  : OMX_GetHandle calls served from the pool
+ *  nColdStarts  : OMX_GetHandle calls that constructed the component
+ *  nWarmAvgUs   : Average latency of warm starts
+ *  nWarmMaxUs   : Largest latency of warm starts
+ *  nColdAvgUs   : Average latency of cold starts
+ *  nColdMaxUs   : Largest latency of cold starts
+ *  nReparked    : Instances freed unused and parked again
+ *  nRetired     : Instances of pooled components destroyed when freed,
+ *                 because the client had used them or enough were parked
+ */
+typedef struct QOMX_WARMPOOLSTATSTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nParked;
+    OMX_U32 nLent;
+    OMX_U32 nWarmStarts;
+    OMX_U32 nColdStarts;
+    OMX_U32 nWarmAvgUs;
+    OMX_U32 nWarmMaxUs;
+    OMX_U32 nColdAvgUs;
+    OMX_U32 nColdMaxUs;
+    OMX_U32 nReparked;
+    OMX_U32 nRetired;
+} QOMX_WARMPOOLSTATSTYPE;
+
+/**
+ * Keeps nInstances initialized instances of a component parked, 0 to
+ * drain them. The component library stays loaded while the component is
+ * pooled. Instances are built in the background by the core. An instance
+ * freed by its client without ever being configured is parked again,
+ * any other is destroyed and replaced. A parked instance holds a driver
+ * instance, so its load at the default port settings counts as active
+ * in QOMX_GetCoreLoad; no instance is parked when that does not fit the
+ * session capacity. The default comes from the omxcore.warmpool
+ * property, a list of "name:count" separated by commas.
+ */
+OMX_API OMX_ERRORTYPE QOMX_SetWarmPool(
+    OMX_IN OMX_STRING cComponentName,
+    OMX_IN OMX_U32 nInstances);
+
+OMX_API OMX_ERRORTYPE QOMX_GetWarmPoolStats(
+    OMX_INOUT QOMX_WARMPOOLSTATSTYPE *pStats);
+
+#if defined( __cplusplus )
+}
+#endif /* end of macro __cplusplus */
+
+#endif /* end of macro __H_QOMX_POOLEXTENSIONS_H__ */
@@ -0,0 +1,175 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+
+#ifndef __H_QOMX_SESSIONEXTENSIONS_H__
+#define __H_QOMX_SESSIONEXTENSIONS_H__
+
+/*========================================================================
+
+*//** @file QOMX_SessionExtensions.h
+
+@par FILE SERVICES:
+      Qualcomm extensions API for the OpenMax IL core.
+
+      This file contains the session manager interface of the OpenMax
+      core, through which an IL client can read the decode/encode load
+      of all component instances and set the admission budget.
+
+*//*====================================================================== */
+
+/*========================================================================
+
+                     INCLUDE FILES FOR MODULE
+
+========================================================================== */
+#include <OMX_Core.h>
+
+/*========================================================================
+
+                      DEFINITIONS AND DECLARATIONS
+
+========================================================================== */
+
+#if defined( __cplusplus )
+extern "C"
+{
+#endif /* end of macro __cplusplus */
+
+/**
+ * Admission policy of the core session manager, applied when starting a
+ * session (Loaded -> Idle) would take the total decode/encode load over
+ * the capacity budget.
+ *
+ *  QOMX_AdmissionReject      : The state change fails with
+ *                              OMX_ErrorInsufficientResources.
+ *  QOMX_AdmissionQueue       : The Idle command is held by the core and
+ *                              forwarded to the component, in arrival
+ *                              order, once enough load is released.
+ *  QOMX_AdmissionLowPriority : The session starts anyway. Its load is
+ *                              reported as nLowPriorityLoad, and counted
+ *                              as active once enough load is released.
+ *                              The component is not told: the video
+ *                              drivers have no priority to lower.
+ *
+ * The default policy is QOMX_AdmissionReject.
+ */
+typedef enum QOMX_ADMISSIONPOLICYTYPE {
+    QOMX_AdmissionReject = 0,
+    QOMX_AdmissionQueue,
+    QOMX_AdmissionLowPriority,
+    QOMX_AdmissionMax = 0x7FFFFFFF
+} QOMX_ADMISSIONPOLICYTYPE;
+
+typedef enum QOMX_SESSIONSTATETYPE {
+    QOMX_SessionLoaded = 0,      /**< No load accounted */
+    QOMX_SessionActive,          /**< Admitted within the budget */
+    QOMX_SessionLowPriority,     /**< Admitted over the budget */
+    QOMX_SessionQueued,          /**< Waiting for load to be released */
+    QOMX_SessionMax = 0x7FFFFFFF
+} QOMX_SESSIONSTATETYPE;
+
+/**
+ * One component instance as seen by the core session manager.
+ *
+ * STRUCT MEMBERS:
+ *  hComponent   : Component handle
+ *  cName        : Component name
+ *  nFrameWidth  : Largest video frame width over the component ports
+ *  nFrameHeight : Largest video frame height over the component ports
+ *  xFramerate   : Frame rate in Q16, 30 fps when the ports leave it unset
+ *  nMBPerSec    : Macroblocks per second the session needs
+ *  eState       : Admission state
+ */
+typedef struct QOMX_SESSIONINFOTYPE {
+    OMX_HANDLETYPE hComponent;
+    OMX_U8 cName[OMX_MAX_STRINGNAME_SIZE];
+    OMX_U32 nFrameWidth;
+    OMX_U32 nFrameHeight;
+    OMX_U32 xFramerate;
+    OMX_U32 nMBPerSec;
+    QOMX_SESSIONSTATETYPE eState;
+} QOMX_SESSIONINFOTYPE;
+
+/**
+ * Live load of the OMX core, returned by QOMX_GetCoreLoad.
+ *
+ * STRUCT MEMBERS:
+ *  nSize             : Size of the structure in bytes
+ *  nVersion          : OMX specification version info
+ *  nCapacity         : Budget in macroblocks per second, 0 if unlimited
+ *  ePolicy           : Policy for sessions over the budget
+ *  nActiveLoad       : MB/s of sessions admitted within the budget
+ *  nLowPriorityLoad  : MB/s of sessions admitted over the budget
+ *  nQueuedLoad       : MB/s of sessions waiting to start
+ *  nSessions         : Component instances known to the core
+ *  nRejected         : Sessions refused since the core was loaded
+ *  nQueued           : Sessions queued since the core was loaded
+ *  nLowPriority      : Sessions started at low priority since the core
+ *                      was loaded
+ */
+typedef struct QOMX_CORELOADTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nCapacity;
+    QOMX_ADMISSIONPOLICYTYPE ePolicy;
+    OMX_U32 nActiveLoad;
+    OMX_U32 nLowPriorityLoad;
+    OMX_U32 nQueuedLoad;
+    OMX_U32 nSessions;
+    OMX_U32 nRejected;
+    OMX_U32 nQueued;
+    OMX_U32 nLowPriority;
+} QOMX_CORELOADTYPE;
+
+/**
+ * Returns the core load and, if pSessions is not NULL, up to
+ * *pNumSessions session entries. *pNumSessions is set to the number of
+ * entries written.
+ */
+OMX_API OMX_ERRORTYPE QOMX_GetCoreLoad(
+    OMX_INOUT QOMX_CORELOADTYPE *pLoad,
+    OMX_OUT QOMX_SESSIONINFOTYPE *pSessions,
+    OMX_INOUT OMX_U32 *pNumSessions);
+
+/**
+ * Sets the capacity budget, in macroblocks per second (0 disables
+ * admission control), and the policy for sessions over it. Applies to
+ * sessions started afterwards. The defaults come from the
+ * omxcore.session.capacity and omxcore.session.policy properties
+ * ("reject", "queue" or "lowpri"). Without a capacity property no
+ * session is refused, e.g. set it to 489600 for two 1080p30 sessions.
+ */
+OMX_API OMX_ERRORTYPE QOMX_SetCoreCapacity(
+    OMX_IN OMX_U32 nCapacity,
+    OMX_IN QOMX_ADMISSIONPOLICYTYPE ePolicy);
+
+#if defined( __cplusplus )
+}
+#endif /* end of macro __cplusplus */
+
+#endif /* end of macro __H_QOMX_SESSIONEXTENSIONS_H__ */
@@ -40,8 +40,78 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "qc_omx_common.h"
 #include "omx_core_cmp.h"
 #include "qc_omx_component.h"
+#include "qc_omx_session.h"
+#include "qc_omx_pool.h"
 #include <string.h>
 
+/* Admission of a session asked to leave the Loaded state. Returns false
+   if the Idle command must not be forwarded now, with *eRet set to the
+   result of the command. */
+static bool session_admit(OMX_HANDLETYPE hComp, qc_omx_component *pThis,
+                          OMX_ERRORTYPE *eRet)
+{
+  OMX_PARAM_PORTDEFINITIONTYPE port;
+  OMX_STATETYPE state = OMX_StateInvalid;
+  OMX_U32 i;
+
+  pThis->get_state(hComp, &state);
+  if (state != OMX_StateLoaded)
+    return true;
+
+  // the client may have left the port settings at their defaults
+  for (i = 0; i < 2; i++)
+  {
+    memset(&port, 0, sizeof(port));
+    port.nSize = sizeof(port);
+    port.nVersion.nVersion = OMX_SPEC_VERSION;
+    port.nPortIndex = i;
+    if (pThis->get_parameter(hComp, OMX_IndexParamPortDefinition, &port) ==
+        OMX_ErrorNone)
+      qc_omx_session_set_port(hComp, &port);
+  }
+
+  switch (qc_omx_session_admit(hComp))
+  {
+    case QC_OMX_SESSION_REJECTED:
+      DEBUG_PRINT_ERROR("OMXCORE: %x rejected, over the session capacity\n",
+                        (unsigned)hComp);
+      *eRet = OMX_ErrorInsufficientResources;
+      return false;
+    case QC_OMX_SESSION_QUEUED:
+      DEBUG_PRINT("OMXCORE: %x queued until load is released\n", (unsigned)hComp);
+      *eRet = OMX_ErrorNone;
+      return false;
+    case QC_OMX_SESSION_LOW_PRIORITY:
+      DEBUG_PRINT("OMXCORE: %x started over the session capacity\n",
+                  (unsigned)hComp);
+      break;
+    default:
+      break;
+  }
+  return true;
+}
+
+/* Acts on the sessions the session manager woke up. Each one is pinned
+   until unpinned here, OMX_FreeHandle waits for that before destroying
+   the component. */
+void qc_omx_component_session_wakeup(qc_omx_session_wakeup *wakeups, int count)
+{
+  int i;
+
+  for (i = 0; i < count; i++)
+  {
+    OMX_HANDLETYPE hComp = wakeups[i].hComp;
+    qc_omx_component *pThis = (qc_omx_component *)(((OMX_COMPONENTTYPE *)hComp)->pComponentPrivate);
+
+    if (wakeups[i].action == QC_OMX_SESSION_RESUME)
+    {
+      DEBUG_PRINT("OMXCORE: %x dequeued, moving to Idle\n", (unsigned)hComp);
+      pThis->send_command(hComp, OMX_CommandStateSet, OMX_StateIdle, NULL);
+    }
+    qc_omx_session_unpin(hComp);
+  }
+}
+
 
 void * qc_omx_create_component_wrapper(OMX_PTR obj_ptr)
 {
@@ -132,7 +202,26 @@ qc_omx_component_send_command(OMX_IN OMX_HANDLETYPE hComp,
 
   if(pThis)
   {
-    eRet = pThis->send_command(hComp,cmd,param1,cmdData);
+    qc_omx_session_wakeup wakeups[QC_OMX_SESSION_MAX];
+    int count = 0, was_queued = 0;
+
+    qc_omx_pool_touch(hComp);
+    if (cmd == OMX_CommandStateSet && param1 == OMX_StateIdle &&
+        !session_admit(hComp, pThis, &eRet))
+    {
+      return eRet;
+    }
+    if (cmd == OMX_CommandStateSet && param1 == OMX_StateLoaded)
+    {
+      count = qc_omx_session_release(hComp, &was_queued, wakeups,
+                                     QC_OMX_SESSION_MAX);
+    }
+    // a queued session never left Loaded, only drop it from the queue
+    if (was_queued)
+      eRet = OMX_ErrorNone;
+    else
+      eRet = pThis->send_command(hComp,cmd,param1,cmdData);
+    qc_omx_component_session_wakeup(wakeups, count);
   }
   return eRet;
 }
@@ -149,6 +238,8 @@ qc_omx_component_get_parameter(OMX_IN OMX_HANDLETYPE     hComp,
   if(pThis)
   {
     eRet = pThis->get_parameter(hComp,paramIndex,paramData);
+    if (eRet == OMX_ErrorNone && paramIndex == OMX_IndexParamPortDefinition)
+      qc_omx_session_set_port(hComp, (OMX_PARAM_PORTDEFINITIONTYPE *)paramData);
   }
   return eRet;
 }
@@ -164,7 +255,10 @@ qc_omx_component_set_parameter(OMX_IN OMX_HANDLETYPE     hComp,
 
   if(pThis)
   {
+    qc_omx_pool_touch(hComp);
     eRet = pThis->set_parameter(hComp,paramIndex,paramData);
+    if (eRet == OMX_ErrorNone && paramIndex == OMX_IndexParamPortDefinition)
+      qc_omx_session_set_port(hComp, (OMX_PARAM_PORTDEFINITIONTYPE *)paramData);
   }
   return eRet;
 }
@@ -198,9 +292,16 @@ qc_omx_component_set_config(OMX_IN OMX_HANDLETYPE      hComp,
 
   if(pThis)
   {
+     qc_omx_pool_touch(hComp);
      eRet = pThis->set_config(hComp,
                               configIndex,
                               configData);
+     if (eRet == OMX_ErrorNone && configIndex == OMX_IndexConfigVideoFramerate)
+     {
+       OMX_CONFIG_FRAMERATETYPE *rate = (OMX_CONFIG_FRAMERATETYPE *)configData;
+       qc_omx_session_set_framerate(hComp, rate->nPortIndex,
+                                    rate->xEncodeFramerate);
+     }
   }
   return eRet;
 }
@@ -259,6 +360,7 @@ qc_omx_component_use_buffer(OMX_IN OMX_HANDLETYPE                hComp,
 
   if(pThis)
   {
+     qc_omx_pool_touch(hComp);
      eRet = pThis->use_buffer(hComp,
                               bufferHdr,
                               port,
@@ -285,6 +387,7 @@ qc_omx_component_allocate_buffer(OMX_IN OMX_HANDLETYPE                hComp,
 
   if(pThis)
   {
+    qc_omx_pool_touch(hComp);
     eRet = pThis->allocate_buffer(hComp,bufferHdr,port,appData,bytes);
   }
   return eRet;
@@ -384,6 +487,7 @@ qc_omx_component_use_EGL_image(OMX_IN OMX_HANDLETYPE                hComp,
   DEBUG_PRINT("OMXCORE: qc_omx_component_use_EGL_image %x, %x , %d\n",(unsigned)hComp,(unsigned)bufferHdr,(unsigned)port);
   if(pThis)
   {
+    qc_omx_pool_touch(hComp);
     eRet = pThis->use_EGL_image(hComp,bufferHdr,port,appData,eglImage);
   }
   return eRet;
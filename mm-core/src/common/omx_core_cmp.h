@@ -39,6 +39,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef OMX_CORE_CMP_H
 #define OMX_CORE_CMP_H
 
+#include "qc_omx_session.h"
 
 
 #ifdef __cplusplus
@@ -48,6 +49,9 @@ extern "C" {
 
 void * qc_omx_create_component_wrapper(OMX_PTR obj_ptr);
 
+// Acts on the sessions the session manager woke up
+void qc_omx_component_session_wakeup(qc_omx_session_wakeup *wakeups, int count);
+
 
 OMX_ERRORTYPE
 qc_omx_component_init(OMX_IN OMX_HANDLETYPE hComp, OMX_IN OMX_STRING componentName);
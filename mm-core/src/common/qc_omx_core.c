@@ -43,15 +43,54 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <unistd.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <pthread.h>
+#include <time.h>
+#ifdef _ANDROID_
+#include <cutils/properties.h>
+#endif
 
 #include "qc_omx_core.h"
 #include "omx_core_cmp.h"
+#include "qc_omx_pool.h"
 
 extern omx_core_cb_type core[];
 extern const unsigned int SIZE_OF_CORE;
 static pthread_mutex_t lock_core = PTHREAD_MUTEX_INITIALIZER;
 
+/* Components playing one role, as indexes into core[] */
+typedef struct
+{
+  const char *role;
+  int *cmps;
+  unsigned cnt;
+} core_role_entry;
+
+/* Where an active component handle is stored in core[] */
+typedef struct
+{
+  OMX_HANDLETYPE inst;
+  int cmp;
+  int slot;
+} core_handle_entry;
+
+static pthread_once_t core_index_once = PTHREAD_ONCE_INIT;
+static pthread_once_t core_pool_once = PTHREAD_ONCE_INIT;
+static int core_index_ready = 0;
+static int *cmp_hash;                   // name -> core[] index, -1 if empty
+static unsigned cmp_hash_mask;
+static core_role_entry *role_hash;
+static unsigned role_hash_mask;
+static int *role_cmps;                  // storage of the role lists
+static core_handle_entry *handle_hash;  // guarded by lock_core
+static unsigned handle_hash_mask;
+static unsigned *inst_count;            // active instances per component
+
+static int core_index_init(void);
+static core_role_entry *role_lookup(const char *role, int insert);
+static int core_find_cmp(const char *cmp_name);
+static void core_pool_configure(void);
+
 /* ======================================================================
 FUNCTION
   omx_core_load_cmp_library
@@ -98,8 +137,9 @@ FUNCTION
 
 DESCRIPTION
   This is the first function called by the application.
-  There is nothing to do here since components shall be loaded
-  whenever the get handle method is called.
+  Builds the registry lookup tables and starts the warm pool, if one is
+  configured; components themselves shall be loaded whenever the get
+  handle method is called.
 
 PARAMETERS
   None
@@ -111,10 +151,242 @@ OMX_API OMX_ERRORTYPE OMX_APIENTRY
 OMX_Init()
 {
   DEBUG_PRINT("OMXCORE API - OMX_Init \n");
-  /* Nothing to do here ; shared objects shall be loaded at the get handle method */
+  /* Shared objects shall be loaded at the get handle method, or by the
+     warm pool, only the registry lookup tables are built here */
+  if (!core_index_init())
+    return OMX_ErrorInsufficientResources;
   return OMX_ErrorNone;
 }
 
+/* ======================================================================
+FUNCTION
+  core_hash_str
+
+DESCRIPTION
+  FNV-1a hash of a component name or role.
+
+PARAMETERS
+  str : string to hash
+
+RETURN VALUE
+  32 bit hash.
+========================================================================== */
+static unsigned core_hash_str(const char *str)
+{
+  unsigned h = 2166136261u;
+  while (*str)
+  {
+    h ^= (unsigned char)*str++;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static unsigned core_hash_ptr(OMX_HANDLETYPE ptr)
+{
+  return (unsigned)(((unsigned long)ptr >> 4) * 2654435761u);
+}
+
+/* Smallest power of two holding n entries at most half full */
+static unsigned core_hash_size(unsigned n)
+{
+  unsigned size = 8;
+  while (size < 2 * n)
+    size <<= 1;
+  return size;
+}
+
+/* ======================================================================
+FUNCTION
+  core_build_index
+
+DESCRIPTION
+  Builds the lookup tables over the registry table: component name to
+  core[] index, role to the components playing it, in registry order,
+  and an empty handle to instance slot map sized for every instance the
+  table allows. core[] does not change at run time, so the name and role
+  tables are only read afterwards and need no locking.
+
+PARAMETERS
+  None
+
+RETURN VALUE
+  None. core_index_ready is set on success.
+========================================================================== */
+static void core_build_index(void)
+{
+  unsigned i, j, k, h, roles = 0, offset = 0;
+
+  for (i = 0; i < SIZE_OF_CORE; i++)
+  {
+    for (j = 0; j < OMX_CORE_MAX_CMP_ROLES && core[i].roles[j]; j++)
+      roles++;
+  }
+
+  cmp_hash_mask = core_hash_size(SIZE_OF_CORE) - 1;
+  role_hash_mask = core_hash_size(roles) - 1;
+  handle_hash_mask = core_hash_size(SIZE_OF_CORE * OMX_COMP_MAX_INST) - 1;
+  cmp_hash = (int *)malloc((cmp_hash_mask + 1) * sizeof(int));
+  role_hash = (core_role_entry *)calloc(role_hash_mask + 1, sizeof(core_role_entry));
+  role_cmps = (int *)malloc((roles ? roles : 1) * sizeof(int));
+  handle_hash = (core_handle_entry *)calloc(handle_hash_mask + 1,
+                                            sizeof(core_handle_entry));
+  inst_count = (unsigned *)calloc(SIZE_OF_CORE ? SIZE_OF_CORE : 1,
+                                  sizeof(unsigned));
+  if (!cmp_hash || !role_hash || !role_cmps || !handle_hash || !inst_count)
+  {
+    DEBUG_PRINT_ERROR("OMXCORE: no memory for the registry index\n");
+    free(cmp_hash);
+    free(role_hash);
+    free(role_cmps);
+    free(handle_hash);
+    free(inst_count);
+    return;
+  }
+
+  for (h = 0; h <= cmp_hash_mask; h++)
+    cmp_hash[h] = -1;
+  for (i = 0; i < SIZE_OF_CORE; i++)
+  {
+    // a duplicated name resolves to its first entry, as the scan did
+    for (h = core_hash_str(core[i].name) & cmp_hash_mask; cmp_hash[h] >= 0;
+         h = (h + 1) & cmp_hash_mask)
+    {
+      if (!strcmp(core[cmp_hash[h]].name, core[i].name))
+        break;
+    }
+    if (cmp_hash[h] < 0)
+      cmp_hash[h] = i;
+  }
+
+  // count the components of each role, then lay the lists out back to back
+  for (i = 0; i < SIZE_OF_CORE; i++)
+  {
+    for (j = 0; j < OMX_CORE_MAX_CMP_ROLES && core[i].roles[j]; j++)
+    {
+      for (k = 0; k < j && strcmp(core[i].roles[k], core[i].roles[j]); k++);
+      if (k < j)
+        continue;
+      core_role_entry *entry = role_lookup(core[i].roles[j], 1);
+      entry->cnt++;
+    }
+  }
+  for (h = 0; h <= role_hash_mask; h++)
+  {
+    if (role_hash[h].role)
+    {
+      role_hash[h].cmps = role_cmps + offset;
+      offset += role_hash[h].cnt;
+      role_hash[h].cnt = 0;
+    }
+  }
+  for (i = 0; i < SIZE_OF_CORE; i++)
+  {
+    for (j = 0; j < OMX_CORE_MAX_CMP_ROLES && core[i].roles[j]; j++)
+    {
+      for (k = 0; k < j && strcmp(core[i].roles[k], core[i].roles[j]); k++);
+      if (k < j)
+        continue;
+      core_role_entry *entry = role_lookup(core[i].roles[j], 0);
+      entry->cmps[entry->cnt++] = i;
+    }
+  }
+  core_index_ready = 1;
+  DEBUG_PRINT("OMXCORE: indexed %u components, %u roles\n", SIZE_OF_CORE, roles);
+}
+
+static int core_index_init(void)
+{
+  pthread_once(&core_index_once, core_build_index);
+  if (core_index_ready)
+    pthread_once(&core_pool_once, core_pool_configure);
+  return core_index_ready;
+}
+
+/* ======================================================================
+FUNCTION
+  role_lookup
+
+DESCRIPTION
+  Finds the entry of a role in the role table.
+
+PARAMETERS
+  role   : role name
+  insert : add the role if it is not in the table yet
+
+RETURN VALUE
+  Role entry, NULL if the role is unknown.
+========================================================================== */
+static core_role_entry *role_lookup(const char *role, int insert)
+{
+  unsigned h;
+
+  for (h = core_hash_str(role) & role_hash_mask; role_hash[h].role;
+       h = (h + 1) & role_hash_mask)
+  {
+    if (!strcmp(role_hash[h].role, role))
+      return &role_hash[h];
+  }
+  if (!insert)
+    return NULL;
+  role_hash[h].role = role;
+  return &role_hash[h];
+}
+
+/* ======================================================================
+FUNCTION
+  handle_lookup
+
+DESCRIPTION
+  Finds the slot of a component handle in the handle map. Caller holds
+  lock_core.
+
+PARAMETERS
+  inst : component handle
+
+RETURN VALUE
+  Map entry, or the empty entry where the handle would be inserted.
+========================================================================== */
+static core_handle_entry *handle_lookup(OMX_HANDLETYPE inst)
+{
+  unsigned h;
+
+  for (h = core_hash_ptr(inst) & handle_hash_mask; handle_hash[h].inst;
+       h = (h + 1) & handle_hash_mask)
+  {
+    if (handle_hash[h].inst == inst)
+      break;
+  }
+  return &handle_hash[h];
+}
+
+/* ======================================================================
+FUNCTION
+  set_cmp_handle
+
+DESCRIPTION
+  Stores a new component handle in its instance slot and the handle map.
+  Caller holds lock_core.
+
+PARAMETERS
+  cmp_index : component index in core[]
+  slot      : free instance slot
+  inst      : component handle
+
+RETURN VALUE
+  None.
+========================================================================== */
+static void set_cmp_handle(int cmp_index, int slot, OMX_HANDLETYPE inst)
+{
+  core_handle_entry *entry = handle_lookup(inst);
+
+  core[cmp_index].inst[slot] = inst;
+  inst_count[cmp_index]++;
+  entry->inst = inst;
+  entry->cmp = cmp_index;
+  entry->slot = slot;
+}
+
 /* ======================================================================
 FUNCTION
   get_cmp_index
@@ -130,21 +402,27 @@ RETURN VALUE
 ========================================================================== */
 static int get_cmp_index(char *cmp_name)
 {
-  int rc = -1,i=0;
-  DEBUG_PRINT("before get_cmp_index **********%d\n", rc);
+  if (!cmp_name || !core_index_init())
+    return -1;
+  return core_find_cmp(cmp_name);
+}
 
-  for(i=0; i< (int)SIZE_OF_CORE; i++)
-  {
-   DEBUG_PRINT("get_cmp_index: cmp_name = %s , core[i].name = %s ,count = %d \n",cmp_name,core[i].name,i);
+/* Name lookup proper, the index must have been built */
+static int core_find_cmp(const char *cmp_name)
+{
+  unsigned h;
 
-    if(!strcmp(cmp_name, core[i].name))
+  for (h = core_hash_str(cmp_name) & cmp_hash_mask; cmp_hash[h] >= 0;
+       h = (h + 1) & cmp_hash_mask)
+  {
+    if (!strcmp(cmp_name, core[cmp_hash[h]].name))
     {
-        rc = i;
-        break;
+      DEBUG_PRINT("returning index %d\n", cmp_hash[h]);
+      return cmp_hash[h];
     }
   }
-  DEBUG_PRINT("returning index %d\n", rc);
-  return rc;
+  DEBUG_PRINT("get_cmp_index: %s not found\n", cmp_name);
+  return -1;
 }
 
 /* ======================================================================
@@ -152,7 +430,8 @@ FUNCTION
   clear_cmp_handle
 
 DESCRIPTION
-  Clears the component handle from the component table.
+  Clears the component handle from the component table. Caller holds
+  lock_core.
 
 PARAMETERS
   None
@@ -162,20 +441,30 @@ RETURN VALUE
 ========================================================================== */
 static void clear_cmp_handle(OMX_HANDLETYPE inst)
 {
-  unsigned i = 0,j=0;
+  core_handle_entry *entry;
+  unsigned h, next, home;
 
-  if(NULL == inst)
+  if(NULL == inst || !core_index_ready)
      return;
 
-  for(i=0; i< SIZE_OF_CORE; i++)
+  entry = handle_lookup(inst);
+  if (!entry->inst)
+    return;
+  core[entry->cmp].inst[entry->slot] = NULL;
+  inst_count[entry->cmp]--;
+
+  // linear probing delete: pull later entries of the run back into the gap
+  h = entry - handle_hash;
+  handle_hash[h].inst = NULL;
+  for (next = (h + 1) & handle_hash_mask; handle_hash[next].inst;
+       next = (next + 1) & handle_hash_mask)
   {
-    for(j=0; j< OMX_COMP_MAX_INST; j++)
+    home = core_hash_ptr(handle_hash[next].inst) & handle_hash_mask;
+    if (((next - home) & handle_hash_mask) >= ((next - h) & handle_hash_mask))
     {
-      if(inst == core[i].inst[j])
-      {
-        core[i].inst[j] = NULL;
-        return;
-      }
+      handle_hash[h] = handle_hash[next];
+      handle_hash[next].inst = NULL;
+      h = next;
     }
   }
   return;
@@ -196,25 +485,16 @@ RETURN VALUE
 ========================================================================== */
 static int is_cmp_handle_exists(OMX_HANDLETYPE inst)
 {
-  unsigned i=0,j=0;
+  core_handle_entry *entry;
   int rc = -1;
 
-  if(NULL == inst)
+  if(NULL == inst || !core_index_ready)
      return rc;
 
   pthread_mutex_lock(&lock_core);
-  for(i=0; i< SIZE_OF_CORE; i++)
-  {
-    for(j=0; j< OMX_COMP_MAX_INST; j++)
-    {
-      if(inst == core[i].inst[j])
-      {
-        rc = i;
-        goto finish;
-      }
-    }
-  }
-finish:
+  entry = handle_lookup(inst);
+  if (entry->inst)
+    rc = entry->cmp;
   pthread_mutex_unlock(&lock_core);
   return rc;
 }
@@ -224,35 +504,29 @@ FUNCTION
   get_comp_handle_index
 
 DESCRIPTION
-  Gets the index to store the next handle for specified component name.
+  Gets the index to store the next handle for specified component.
 
 PARAMETERS
-  cmp_name : Component Name
+  cmp_index : Component index in core array
 
 RETURN VALUE
   Index of next handle to be stored
 ========================================================================== */
-static int get_comp_handle_index(char *cmp_name)
+static int get_comp_handle_index(int cmp_index)
 {
-  unsigned i=0,j=0;
-  int rc = -1;
-  for(i=0; i< SIZE_OF_CORE; i++)
+  unsigned j=0;
+
+  if (inst_count[cmp_index] >= OMX_COMP_MAX_INST)
+    return -1;
+  for(j=0; j< OMX_COMP_MAX_INST; j++)
   {
-    if(!strcmp(cmp_name, core[i].name))
+    if(NULL == core[cmp_index].inst[j])
     {
-      for(j=0; j< OMX_COMP_MAX_INST; j++)
-      {
-        if(NULL == core[i].inst[j])
-        {
-          rc = j;
-          DEBUG_PRINT("free handle slot exists %d\n", rc);
-          return rc;
-        }
-      }
-      break;
+      DEBUG_PRINT("free handle slot exists %d\n", j);
+      return j;
     }
   }
-  return rc;
+  return -1;
 }
 
 /* ======================================================================
@@ -271,19 +545,12 @@ RETURN VALUE
 ========================================================================== */
 static int check_lib_unload(int index)
 {
-  unsigned i=0;
-  int rc = 1;
-
-  for(i=0; i< OMX_COMP_MAX_INST; i++)
+  if (inst_count[index] || qc_omx_pool_pinned(index))
   {
-    if(core[index].inst[i])
-    {
-      rc = 0;
-      DEBUG_PRINT("Library Used \n");
-      break;
-    }
+    DEBUG_PRINT("Library Used \n");
+    return 0;
   }
-  return rc;
+  return 1;
 }
 /* ======================================================================
 FUNCTION
@@ -301,25 +568,14 @@ RETURN VALUE
 ========================================================================== */
 static int is_cmp_already_exists(char *cmp_name)
 {
-  unsigned i    =0,j=0;
-  int rc = -1;
-  for(i=0; i< SIZE_OF_CORE; i++)
+  int i = get_cmp_index(cmp_name);
+
+  if (i >= 0 && inst_count[i])
   {
-    if(!strcmp(cmp_name, core[i].name))
-    {
-      for(j=0; j< OMX_COMP_MAX_INST; j++)
-      {
-        if(core[i].inst[j])
-        {
-          rc = i;
-          DEBUG_PRINT("Component exists %d\n", rc);
-          return rc;
-        }
-      }
-      break;
-    }
+    DEBUG_PRINT("Component exists %d\n", i);
+    return i;
   }
-  return rc;
+  return -1;
 }
 
 /* ======================================================================
@@ -337,20 +593,18 @@ RETURN VALUE
 ========================================================================== */
 void* get_cmp_handle(char *cmp_name)
 {
-  unsigned i    =0,j=0;
+  unsigned j=0;
+  int i = get_cmp_index(cmp_name);
 
   DEBUG_PRINT("get_cmp_handle \n");
-  for(i=0; i< SIZE_OF_CORE; i++)
+  if (i >= 0 && inst_count[i])
   {
-    if(!strcmp(cmp_name, core[i].name))
+    for(j=0; j< OMX_COMP_MAX_INST; j++)
     {
-      for(j=0; j< OMX_COMP_MAX_INST; j++)
+      if(core[i].inst[j])
       {
-        if(core[i].inst[j])
-        {
-          DEBUG_PRINT("get_cmp_handle match\n");
-          return core[i].inst[j];
-        }
+        DEBUG_PRINT("get_cmp_handle match\n");
+        return core[i].inst[j];
       }
     }
   }
@@ -358,6 +612,131 @@ void* get_cmp_handle(char *cmp_name)
   return NULL;
 }
 
+/* Destroys an instance of the warm pool and its session */
+static void core_pool_destroy(OMX_HANDLETYPE hComp)
+{
+  qc_omx_session_wakeup wakeups[QC_OMX_SESSION_MAX];
+  int wakeup_cnt;
+
+  // releases the reservation of the parked instance
+  wakeup_cnt = qc_omx_session_close(hComp, wakeups, QC_OMX_SESSION_MAX);
+  qc_omx_component_session_wakeup(wakeups, wakeup_cnt);
+  qc_omx_component_deinit(hComp);
+}
+
+/* ======================================================================
+FUNCTION
+  core_pool_create
+
+DESCRIPTION
+  Builds an initialized instance of a component for the warm pool. Runs
+  on the pool thread; lock_core is only held to load the library, not
+  while the component initializes. The instance holds a driver instance
+  while parked, so its load at the default port settings is reserved
+  with the session manager; it is not parked if that does not fit.
+
+PARAMETERS
+  cmp_index : component index in core[]
+
+RETURN VALUE
+  Component handle, NULL on failure.
+========================================================================== */
+static OMX_HANDLETYPE core_pool_create(int cmp_index)
+{
+  create_qc_omx_component fn_ptr;
+  OMX_PARAM_PORTDEFINITIONTYPE port;
+  void *pThis, *hComp;
+  OMX_U32 i;
+
+  pthread_mutex_lock(&lock_core);
+  if(!core[cmp_index].so_lib_handle || !core[cmp_index].fn_ptr)
+  {
+    core[cmp_index].fn_ptr =
+      omx_core_load_cmp_library(core[cmp_index].so_lib_name,
+                                &core[cmp_index].so_lib_handle);
+  }
+  fn_ptr = core[cmp_index].fn_ptr;
+  pthread_mutex_unlock(&lock_core);
+
+  if(!fn_ptr || !(pThis = (*fn_ptr)()))
+    return NULL;
+  hComp = qc_omx_create_component_wrapper((OMX_PTR)pThis);
+  // a failed init destroys pThis, and hComp with it
+  if(qc_omx_component_init(hComp, core[cmp_index].name) != OMX_ErrorNone)
+    return NULL;
+
+  qc_omx_session_open(hComp, core[cmp_index].name);
+  for (i = 0; i < 2; i++)
+  {
+    memset(&port, 0, sizeof(port));
+    port.nSize = sizeof(port);
+    port.nVersion.nVersion = OMX_SPEC_VERSION;
+    port.nPortIndex = i;
+    // records the port in the session
+    qc_omx_component_get_parameter(hComp, OMX_IndexParamPortDefinition, &port);
+  }
+  if (!qc_omx_session_reserve(hComp))
+  {
+    DEBUG_PRINT("OMXCORE: no session capacity to park %s\n",
+                core[cmp_index].name);
+    core_pool_destroy(hComp);
+    return NULL;
+  }
+  return (OMX_HANDLETYPE)hComp;
+}
+
+/* ======================================================================
+FUNCTION
+  core_pool_configure
+
+DESCRIPTION
+  Starts the warm pool with the components listed in the
+  omxcore.warmpool property, e.g.
+  "OMX.qcom.video.decoder.avc:2,OMX.qcom.video.decoder.mpeg4:1".
+  Runs once, after the registry index is built.
+
+PARAMETERS
+  None
+
+RETURN VALUE
+  None.
+========================================================================== */
+static void core_pool_configure(void)
+{
+#ifdef _ANDROID_
+  char value[PROPERTY_VALUE_MAX];
+  char *item, *count, *save = NULL;
+  int cmp_index;
+#endif
+
+  qc_omx_pool_init(core_pool_create, core_pool_destroy, qc_omx_session_reserve);
+#ifdef _ANDROID_
+  if (property_get("omxcore.warmpool", value, NULL) <= 0)
+    return;
+  for (item = strtok_r(value, ",", &save); item; item = strtok_r(NULL, ",", &save))
+  {
+    count = strchr(item, ':');
+    if (count)
+      *count++ = '\0';
+    cmp_index = core_find_cmp(item);
+    if (cmp_index < 0)
+    {
+      DEBUG_PRINT_ERROR("OMXCORE: warm pool, unknown component %s\n", item);
+      continue;
+    }
+    qc_omx_pool_set(cmp_index, count ? strtoul(count, NULL, 0) : 1);
+  }
+#endif
+}
+
+static OMX_U32 core_elapsed_us(const struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (OMX_U32)((now.tv_sec - start->tv_sec) * 1000000 +
+                   (now.tv_nsec - start->tv_nsec) / 1000);
+}
 /* ======================================================================
 FUNCTION
   OMX_DeInit
@@ -400,10 +779,15 @@ OMX_GetHandle(OMX_OUT OMX_HANDLETYPE*     handle,
   OMX_ERRORTYPE  eRet = OMX_ErrorNone;
   int cmp_index = -1;
   int hnd_index = -1;
+  int wakeup_cnt;
+  qc_omx_session_wakeup wakeups[QC_OMX_SESSION_MAX];
+  void *hComp = NULL;
+  struct timespec start;
 
   DEBUG_PRINT("OMXCORE API :  Get Handle %x %s %x\n",(unsigned) handle,
                                                      componentName,
                                                      (unsigned) appData);
+  clock_gettime(CLOCK_MONOTONIC, &start);
   pthread_mutex_lock(&lock_core);
   if(handle)
   {
@@ -411,16 +795,48 @@ OMX_GetHandle(OMX_OUT OMX_HANDLETYPE*     handle,
 
     *handle = NULL;
 
+    if(!core_index_init())
+    {
+      pthread_mutex_unlock(&lock_core);
+      return OMX_ErrorInsufficientResources;
+    }
     cmp_index = get_cmp_index(componentName);
 
+    if(cmp_index >= 0 && (hnd_index = get_comp_handle_index(cmp_index)) < 0)
+    {
+      // check before constructing, a component without a slot would leak
+      DEBUG_PRINT("OMX_GetHandle:NO free slot available to store Component Handle\n");
+      pthread_mutex_unlock(&lock_core);
+      return OMX_ErrorInsufficientResources;
+    }
+
+    if(cmp_index >= 0 && (hComp = qc_omx_pool_take(cmp_index)))
+    {
+      // parked instance, already initialized; its session drops the
+      // reservation and is admitted again when the client starts it
+      qc_omx_component_set_callbacks(hComp,callBacks,appData);
+      *handle = (OMX_HANDLETYPE) hComp;
+      set_cmp_handle(cmp_index, hnd_index, *handle);
+      pthread_mutex_unlock(&lock_core);
+      wakeup_cnt = qc_omx_session_release(hComp, NULL, wakeups,
+                                          QC_OMX_SESSION_MAX);
+      qc_omx_component_session_wakeup(wakeups, wakeup_cnt);
+      qc_omx_pool_record(1, core_elapsed_us(&start));
+      DEBUG_PRINT("Component %x taken from the warm pool\n",(unsigned)*handle);
+      return OMX_ErrorNone;
+    }
+
     if(cmp_index >= 0)
     {
        DEBUG_PRINT("getting fn pointer\n");
 
-      // dynamically load the so
-      core[cmp_index].fn_ptr =
-        omx_core_load_cmp_library(core[cmp_index].so_lib_name,
-                                  &core[cmp_index].so_lib_handle);
+      // dynamically load the so, unless an earlier instance already did
+      if(!core[cmp_index].so_lib_handle || !core[cmp_index].fn_ptr)
+      {
+        core[cmp_index].fn_ptr =
+          omx_core_load_cmp_library(core[cmp_index].so_lib_name,
+                                    &core[cmp_index].so_lib_handle);
+      }
 
       if(core[cmp_index].fn_ptr)
       {
@@ -429,7 +845,6 @@ OMX_GetHandle(OMX_OUT OMX_HANDLETYPE*     handle,
         void* pThis = (*(core[cmp_index].fn_ptr))();
         if(pThis)
         {
-          void *hComp = NULL;
           hComp = qc_omx_create_component_wrapper((OMX_PTR)pThis);
           if((eRet = qc_omx_component_init(hComp, core[cmp_index].name)) !=
                            OMX_ErrorNone)
@@ -440,17 +855,10 @@ OMX_GetHandle(OMX_OUT OMX_HANDLETYPE*     handle,
 
           }
           qc_omx_component_set_callbacks(hComp,callBacks,appData);
-          hnd_index = get_comp_handle_index(componentName);
-          if(hnd_index >= 0)
-          {
-            core[cmp_index].inst[hnd_index]= *handle = (OMX_HANDLETYPE) hComp;
-          }
-          else
-          {
-            DEBUG_PRINT("OMX_GetHandle:NO free slot available to store Component Handle\n");
-            pthread_mutex_unlock(&lock_core);
-            return OMX_ErrorInsufficientResources;
-          }
+          *handle = (OMX_HANDLETYPE) hComp;
+          set_cmp_handle(cmp_index, hnd_index, *handle);
+          qc_omx_session_open(hComp, core[cmp_index].name);
+          qc_omx_pool_lend(*handle, cmp_index);
           DEBUG_PRINT("Component %x Successfully created\n",(unsigned)*handle);
         }
         else
@@ -478,6 +886,8 @@ OMX_GetHandle(OMX_OUT OMX_HANDLETYPE*     handle,
     DEBUG_PRINT("\n OMX_GetHandle: NULL handle \n");
   }
   pthread_mutex_unlock(&lock_core);
+  if(eRet == OMX_ErrorNone)
+    qc_omx_pool_record(0, core_elapsed_us(&start));
   return eRet;
 }
 /* ======================================================================
@@ -497,12 +907,33 @@ OMX_API OMX_ERRORTYPE OMX_APIENTRY
 OMX_FreeHandle(OMX_IN OMX_HANDLETYPE hComp)
 {
   OMX_ERRORTYPE eRet = OMX_ErrorNone;
-  int err = 0, i = 0;
+  int err = 0, i = 0, wakeup_cnt = 0;
+  qc_omx_session_wakeup wakeups[QC_OMX_SESSION_MAX];
+  core_handle_entry entry;
   DEBUG_PRINT("OMXCORE API :  Free Handle %x\n",(unsigned) hComp);
 
   // 0. Check that we have an active instance
   if((i=is_cmp_handle_exists(hComp)) >=0)
   {
+    // an instance freed unused goes back to the warm pool, its session
+    // reserved again; it was never started, so no wakeup can be pending.
+    // Its handle is cleared before it is parked, under lock_core like
+    // the take in OMX_GetHandle, so a client taking it again cannot lose
+    // its own handle to the clear.
+    pthread_mutex_lock(&lock_core);
+    entry = *handle_lookup(hComp);
+    clear_cmp_handle(hComp);
+    if (qc_omx_pool_give(hComp))
+    {
+      pthread_mutex_unlock(&lock_core);
+      return OMX_ErrorNone;
+    }
+    // not parked: the handle stays until the instance is destroyed
+    if (entry.inst)
+      set_cmp_handle(entry.cmp, entry.slot, hComp);
+    pthread_mutex_unlock(&lock_core);
+    // no session wakeup may still be using the instance
+    qc_omx_session_detach(hComp);
     // 1. Delete the component
     if ((eRet = qc_omx_component_deinit(hComp)) == OMX_ErrorNone)
     {
@@ -525,6 +956,8 @@ OMX_FreeHandle(OMX_IN OMX_HANDLETYPE hComp)
     }
     clear_cmp_handle(hComp);
     pthread_mutex_unlock(&lock_core);
+    wakeup_cnt = qc_omx_session_close(hComp, wakeups, QC_OMX_SESSION_MAX);
+    qc_omx_component_session_wakeup(wakeups, wakeup_cnt);
     }
     else
     {
@@ -640,9 +1073,15 @@ OMX_GetComponentsOfRole(OMX_IN OMX_STRING      role,
                         OMX_INOUT OMX_U8** compNames)
 {
   OMX_ERRORTYPE eRet = OMX_ErrorNone;
-  unsigned i,j,namecount=0;
+  unsigned i,namecount=0;
+  core_role_entry *entry = NULL;
+
+  DEBUG_PRINT(" Inside OMX_GetComponentsOfRole \n");
 
-  printf(" Inside OMX_GetComponentsOfRole \n");
+  if (role && core_index_init())
+  {
+      entry = role_lookup(role, 0);
+  }
 
   /*If CompNames is NULL then return*/
   if (compNames == NULL)
@@ -653,17 +1092,7 @@ OMX_GetComponentsOfRole(OMX_IN OMX_STRING      role,
       }
       else
   {
-    *numComps          = 0;
-    for (i=0; i<SIZE_OF_CORE;i++)
-    {
-      for(j=0; j<OMX_CORE_MAX_CMP_ROLES && core[i].roles[j] ; j++)
-      {
-        if(!strcmp(role,core[i].roles[j]))
-        {
-                  (*numComps)++;
-              }
-            }
-          }
+    *numComps          = entry ? entry->cnt : 0;
       }
       return eRet;
   }
@@ -679,25 +1108,14 @@ OMX_GetComponentsOfRole(OMX_IN OMX_STRING      role,
 
     *numComps          = 0;
 
-    for (i=0; i<SIZE_OF_CORE;i++)
+    for (i=0; entry && i<entry->cnt && *numComps<namecount; i++)
     {
-      for(j=0; j<OMX_CORE_MAX_CMP_ROLES && core[i].roles[j] ; j++)
-      {
-        if(!strcmp(role,core[i].roles[j]))
-          {
             #ifdef _ANDROID_
-            strlcpy((char *)compNames[*numComps],core[i].name, OMX_MAX_STRINGNAME_SIZE);
+            strlcpy((char *)compNames[*numComps],core[entry->cmps[i]].name, OMX_MAX_STRINGNAME_SIZE);
             #else
-            strncpy((char *)compNames[*numComps],core[i].name, OMX_MAX_STRINGNAME_SIZE);
+            strncpy((char *)compNames[*numComps],core[entry->cmps[i]].name, OMX_MAX_STRINGNAME_SIZE);
             #endif
           (*numComps)++;
-          break;
-        }
-      }
-          if (*numComps == namecount)
-          {
-          break;
-        }
     }
   }
   else
@@ -705,7 +1123,7 @@ OMX_GetComponentsOfRole(OMX_IN OMX_STRING      role,
     eRet = OMX_ErrorBadParameter;
   }
 
-  printf(" Leaving OMX_GetComponentsOfRole \n");
+  DEBUG_PRINT(" Leaving OMX_GetComponentsOfRole \n");
   return eRet;
 }
 /* ======================================================================
@@ -728,7 +1146,8 @@ OMX_GetRolesOfComponent(OMX_IN OMX_STRING compName,
 {
   /* Not supported right now */
   OMX_ERRORTYPE eRet = OMX_ErrorNone;
-  unsigned i,j,numofroles = 0;;
+  unsigned j,numofroles = 0;
+  int i = get_cmp_index(compName);
   DEBUG_PRINT("GetRolesOfComponent %s\n",compName);
 
   if (roles == NULL)
@@ -740,15 +1159,11 @@ OMX_GetRolesOfComponent(OMX_IN OMX_STRING compName,
       else
       {
          *numRoles = 0;
-         for(i=0; i< SIZE_OF_CORE; i++)
+         if(i >= 0)
          {
-           if(!strcmp(compName,core[i].name))
+           for(j=0; (j<OMX_CORE_MAX_CMP_ROLES) && core[i].roles[j];j++)
            {
-             for(j=0; (j<OMX_CORE_MAX_CMP_ROLES) && core[i].roles[j];j++)
-             {
-                (*numRoles)++;
-             }
-             break;
+              (*numRoles)++;
            }
          }
 
@@ -765,10 +1180,8 @@ OMX_GetRolesOfComponent(OMX_IN OMX_STRING compName,
 
     numofroles = *numRoles;
     *numRoles = 0;
-    for(i=0; i< SIZE_OF_CORE; i++)
+    if(i >= 0)
     {
-      if(!strcmp(compName,core[i].name))
-      {
         for(j=0; (j<OMX_CORE_MAX_CMP_ROLES) && core[i].roles[j];j++)
         {
           if(roles && roles[*numRoles])
@@ -785,8 +1198,6 @@ OMX_GetRolesOfComponent(OMX_IN OMX_STRING compName,
               break;
           }
         }
-        break;
-      }
     }
   }
   else
@@ -828,3 +1239,32 @@ OMXConfigParser(
 
     return Status;
 }
+
+/* ======================================================================
+FUNCTION
+  QOMX_SetWarmPool
+
+DESCRIPTION
+  Sets the number of initialized instances of a component kept parked
+  for OMX_GetHandle.
+
+PARAMETERS
+  cComponentName : component name
+  nInstances     : instances to keep, 0 to drain the pool
+
+RETURN VALUE
+  OMX_ErrorComponentNotFound for an unknown component,
+  OMX_ErrorBadParameter if nInstances does not fit in the pool.
+========================================================================== */
+OMX_API OMX_ERRORTYPE QOMX_SetWarmPool(OMX_STRING cComponentName,
+                                       OMX_U32 nInstances)
+{
+  int cmp_index;
+
+  if (!core_index_init())
+    return OMX_ErrorInsufficientResources;
+  cmp_index = get_cmp_index(cComponentName);
+  if (cmp_index < 0)
+    return OMX_ErrorComponentNotFound;
+  return qc_omx_pool_set(cmp_index, nInstances);
+}
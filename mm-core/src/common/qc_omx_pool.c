@@ -0,0 +1,618 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+/*============================================================================
+                            O p e n M A X   w r a p p e r s
+                             O p e n  M A X   C o r e
+
+  This module contains the warm pool of the OpenMAX core. For every
+  pooled component it keeps a number of instances constructed and
+  initialized, with their threads waiting for work, and hands them out on
+  OMX_GetHandle. A background thread builds and destroys the instances so
+  that neither happens on the caller's thread.
+
+  The pool does not reset a used instance: a component carries too much
+  per session state for that to be safe. It tracks instead whether the
+  client did anything besides querying the instance. One freed in that
+  pristine state, as left by capability probing, is parked again, any
+  other is destroyed by the caller as usual and replaced in the
+  background.
+
+  A component whose build failed is not built again on every
+  OMX_GetHandle: the next attempt waits for a delay that doubles with
+  every failure in a row.
+
+*//*========================================================================*/
+
+//////////////////////////////////////////////////////////////////////////////
+//                             Include Files
+//////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "qc_omx_common.h"
+#include "qc_omx_pool.h"
+
+#define QC_OMX_POOL_UNUSED  0
+#define QC_OMX_POOL_PARKED  1
+#define QC_OMX_POOL_LENT    2
+
+/* Delay before building a component again after a failed build, doubled
+   for every failure in a row up to 32 s */
+#define QC_OMX_POOL_RETRY_MS      1000
+#define QC_OMX_POOL_RETRY_SHIFT   5
+
+typedef struct
+{
+  OMX_HANDLETYPE hComp;
+  int cmp;
+  int state;
+  int dirty;            // lent and configured or run by the client
+} qc_omx_pool_entry;
+
+typedef struct
+{
+  int cmp;              // -1 if unused
+  OMX_U32 target;       // instances to keep parked
+  OMX_U32 parked;
+  OMX_U32 building;     // instances the worker is constructing
+  int failed;           // builds failed in a row
+  OMX_U64 retry_ms;     // no build before this time if failed
+} qc_omx_pool_target;
+
+static pthread_mutex_t lock_pool = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond_pool = PTHREAD_COND_INITIALIZER;
+static qc_omx_pool_entry entries[QC_OMX_POOL_MAX];
+static qc_omx_pool_target targets[QC_OMX_POOL_MAX];
+static int num_targets = 0;
+static volatile int pool_active = 0;    // any component pooled, read unlocked
+static int worker_started = 0;
+static qc_omx_pool_create_fn create_fn;
+static qc_omx_pool_destroy_fn destroy_fn;
+static qc_omx_pool_park_fn park_fn;
+
+static OMX_U32 warm_cnt, cold_cnt, warm_max, cold_max, reparked_cnt, retired_cnt;
+static OMX_U64 warm_total, cold_total;
+
+static OMX_U64 pool_now_ms()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (OMX_U64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Caller holds lock_pool */
+static qc_omx_pool_target *pool_target(int cmp)
+{
+  int i;
+
+  for (i = 0; i < num_targets; i++)
+  {
+    if (targets[i].cmp == cmp)
+      return &targets[i];
+  }
+  return NULL;
+}
+
+/* Caller holds lock_pool */
+static qc_omx_pool_entry *pool_entry(OMX_HANDLETYPE hComp)
+{
+  int i;
+
+  for (i = 0; i < QC_OMX_POOL_MAX; i++)
+  {
+    if (entries[i].state != QC_OMX_POOL_UNUSED && entries[i].hComp == hComp)
+      return &entries[i];
+  }
+  return NULL;
+}
+
+/* Caller holds lock_pool */
+static qc_omx_pool_entry *pool_add(OMX_HANDLETYPE hComp, int cmp, int state)
+{
+  int i;
+
+  for (i = 0; i < QC_OMX_POOL_MAX; i++)
+  {
+    if (entries[i].state == QC_OMX_POOL_UNUSED)
+    {
+      entries[i].hComp = hComp;
+      entries[i].cmp = cmp;
+      entries[i].state = state;
+      entries[i].dirty = 0;
+      return &entries[i];
+    }
+  }
+  return NULL;
+}
+
+/* Caller holds lock_pool */
+static int pool_used()
+{
+  int i, used = 0;
+
+  for (i = 0; i < QC_OMX_POOL_MAX; i++)
+  {
+    if (entries[i].state != QC_OMX_POOL_UNUSED)
+      used++;
+  }
+  return used;
+}
+
+/* ======================================================================
+FUNCTION
+  pool_worker
+
+DESCRIPTION
+  Background thread of the pool. Builds instances for components parked
+  below their target and destroys the parked instances above it. It
+  runs when the pool changes, so a component in its retry delay is only
+  built again on a later demand.
+
+PARAMETERS
+  arg : unused
+
+RETURN VALUE
+  None, runs for the life of the process.
+========================================================================== */
+static void *pool_worker(void *arg)
+{
+  int i, building;
+  OMX_U64 now;
+
+  pthread_mutex_lock(&lock_pool);
+  for (;;)
+  {
+    qc_omx_pool_target *t = NULL;
+    OMX_HANDLETYPE victim = NULL;
+
+    building = 0;
+    now = pool_now_ms();
+    for (i = 0; i < num_targets; i++)
+      building += targets[i].building;
+    for (i = 0; i < num_targets && !t && !victim; i++)
+    {
+      qc_omx_pool_target *c = &targets[i];
+      if (c->parked > c->target)
+      {
+        int j;
+        for (j = 0; j < QC_OMX_POOL_MAX; j++)
+        {
+          if (entries[j].state == QC_OMX_POOL_PARKED && entries[j].cmp == c->cmp)
+          {
+            victim = entries[j].hComp;
+            entries[j].state = QC_OMX_POOL_UNUSED;
+            c->parked--;
+            break;
+          }
+        }
+      }
+      else if ((!c->failed || now >= c->retry_ms) &&
+               c->parked + c->building < c->target &&
+               pool_used() + building < QC_OMX_POOL_MAX)
+      {
+        t = c;
+      }
+    }
+
+    if (victim)
+    {
+      pthread_mutex_unlock(&lock_pool);
+      DEBUG_PRINT("OMXCORE: pool destroys parked %x\n", (unsigned)victim);
+      destroy_fn(victim);
+      pthread_mutex_lock(&lock_pool);
+    }
+    else if (t)
+    {
+      int cmp = t->cmp;
+      OMX_HANDLETYPE hComp;
+
+      t->building++;
+      pthread_mutex_unlock(&lock_pool);
+      hComp = create_fn(cmp);
+      pthread_mutex_lock(&lock_pool);
+      // targets are never removed, t is still the entry of cmp
+      t->building--;
+      if (!hComp)
+      {
+        OMX_U64 delay = (OMX_U64)QC_OMX_POOL_RETRY_MS <<
+          (t->failed < QC_OMX_POOL_RETRY_SHIFT ? t->failed : QC_OMX_POOL_RETRY_SHIFT);
+
+        t->failed++;
+        t->retry_ms = pool_now_ms() + delay;
+        DEBUG_PRINT_ERROR("OMXCORE: pool could not build component %d, "
+                          "retry in %llu ms\n", cmp, delay);
+      }
+      else if (t->parked < t->target && pool_add(hComp, cmp, QC_OMX_POOL_PARKED))
+      {
+        DEBUG_PRINT("OMXCORE: pool parked %x\n", (unsigned)hComp);
+        t->parked++;
+        t->failed = 0;
+      }
+      else
+      {
+        t->failed = 0;
+        pthread_mutex_unlock(&lock_pool);
+        destroy_fn(hComp);
+        pthread_mutex_lock(&lock_pool);
+      }
+    }
+    else
+    {
+      pthread_cond_wait(&cond_pool, &lock_pool);
+    }
+  }
+  pthread_mutex_unlock(&lock_pool);
+  return NULL;
+}
+
+/* ======================================================================
+FUNCTION
+  qc_omx_pool_init
+
+DESCRIPTION
+  Registers how the core builds and destroys component instances. Must
+  be called before any other pool function.
+
+PARAMETERS
+  create  : builds an initialized instance of a component
+  destroy : deinitializes and destroys an instance
+  park    : accounts an instance freed unused before parking it again
+
+RETURN VALUE
+  None.
+========================================================================== */
+void qc_omx_pool_init(qc_omx_pool_create_fn create,
+                      qc_omx_pool_destroy_fn destroy,
+                      qc_omx_pool_park_fn park)
+{
+  pthread_mutex_lock(&lock_pool);
+  create_fn = create;
+  destroy_fn = destroy;
+  park_fn = park;
+  pthread_mutex_unlock(&lock_pool);
+}
+
+/* ======================================================================
+FUNCTION
+  qc_omx_pool_set
+
+DESCRIPTION
+  Sets the number of parked instances to keep for a component. The
+  worker thread is started with the first pooled component.
+
+PARAMETERS
+  cmp   : component index in core[]
+  count : instances to keep parked, 0 to drain
+
+RETURN VALUE
+  OMX_ErrorBadParameter if count does not fit in the pool,
+  OMX_ErrorInsufficientResources if the worker could not be started.
+========================================================================== */
+OMX_ERRORTYPE qc_omx_pool_set(int cmp, OMX_U32 count)
+{
+  OMX_ERRORTYPE eRet = OMX_ErrorNone;
+  qc_omx_pool_target *t;
+  pthread_t worker;
+
+  if (count > QC_OMX_POOL_MAX || !create_fn)
+    return OMX_ErrorBadParameter;
+
+  pthread_mutex_lock(&lock_pool);
+  t = pool_target(cmp);
+  if (!t && count)
+  {
+    if (num_targets == QC_OMX_POOL_MAX)
+    {
+      pthread_mutex_unlock(&lock_pool);
+      return OMX_ErrorInsufficientResources;
+    }
+    t = &targets[num_targets++];
+    memset(t, 0, sizeof(*t));
+    t->cmp = cmp;
+  }
+  if (t)
+  {
+    t->target = count;
+    t->failed = 0;
+  }
+  if (count && !worker_started)
+  {
+    if (pthread_create(&worker, NULL, pool_worker, NULL))
+    {
+      DEBUG_PRINT_ERROR("OMXCORE: pool worker could not be started\n");
+      eRet = OMX_ErrorInsufficientResources;
+    }
+    else
+    {
+      pthread_detach(worker);
+      worker_started = 1;
+    }
+  }
+  pool_active = num_targets > 0;
+  pthread_cond_signal(&cond_pool);
+  pthread_mutex_unlock(&lock_pool);
+  DEBUG_PRINT("OMXCORE: pool keeps %lu instances of component %d\n", count, cmp);
+  return eRet;
+}
+
+/* ======================================================================
+FUNCTION
+  qc_omx_pool_pinned
+
+DESCRIPTION
+  Tells whether the library of a component must stay loaded because the
+  pool keeps or may build instances of it.
+
+PARAMETERS
+  cmp : component index in core[]
+
+RETURN VALUE
+  1 if pinned, 0 otherwise.
+========================================================================== */
+int qc_omx_pool_pinned(int cmp)
+{
+  qc_omx_pool_target *t;
+  int pinned;
+
+  if (!pool_active)
+    return 0;
+  pthread_mutex_lock(&lock_pool);
+  t = pool_target(cmp);
+  pinned = t && (t->target || t->parked || t->building);
+  pthread_mutex_unlock(&lock_pool);
+  return pinned;
+}
+
+/* ======================================================================
+FUNCTION
+  qc_omx_pool_take
+
+DESCRIPTION
+  Hands out a parked instance of a component and has the worker build
+  its replacement, unless building it failed. The instance is tracked
+  as lent.
+
+PARAMETERS
+  cmp : component index in core[]
+
+RETURN VALUE
+  The instance, NULL if none is parked.
+========================================================================== */
+OMX_HANDLETYPE qc_omx_pool_take(int cmp)
+{
+  OMX_HANDLETYPE hComp = NULL;
+  qc_omx_pool_target *t;
+  int i;
+
+  if (!pool_active)
+    return NULL;
+  pthread_mutex_lock(&lock_pool);
+  t = pool_target(cmp);
+  if (t && t->parked)
+  {
+    for (i = 0; i < QC_OMX_POOL_MAX; i++)
+    {
+      if (entries[i].state == QC_OMX_POOL_PARKED && entries[i].cmp == cmp)
+      {
+        entries[i].state = QC_OMX_POOL_LENT;
+        entries[i].dirty = 0;
+        hComp = entries[i].hComp;
+        t->parked--;
+        break;
+      }
+    }
+  }
+  if (t)
+    pthread_cond_signal(&cond_pool);
+  pthread_mutex_unlock(&lock_pool);
+  return hComp;
+}
+
+/* ======================================================================
+FUNCTION
+  qc_omx_pool_lend
+
+DESCRIPTION
+  Tracks an instance of a pooled component built on the caller's thread,
+  so that it can be parked when freed unused.
+
+PARAMETERS
+  hComp : new instance
+  cmp   : component index in core[]
+
+RETURN VALUE
+  None. Instances of components that are not pooled are ignored.
+========================================================================== */
+void qc_omx_pool_lend(OMX_HANDLETYPE hComp, int cmp)
+{
+  qc_omx_pool_target *t;
+
+  if (!pool_active)
+    return;
+  pthread_mutex_lock(&lock_pool);
+  t = pool_target(cmp);
+  if (t && t->target)
+    pool_add(hComp, cmp, QC_OMX_POOL_LENT);
+  pthread_mutex_unlock(&lock_pool);
+}
+
+/* ======================================================================
+FUNCTION
+  qc_omx_pool_touch
+
+DESCRIPTION
+  Marks a lent instance as used: the client changed its configuration,
+  its state or its buffers. Called by the core for every such call.
+
+PARAMETERS
+  hComp : component handle
+
+RETURN VALUE
+  None.
+========================================================================== */
+void qc_omx_pool_touch(OMX_HANDLETYPE hComp)
+{
+  qc_omx_pool_entry *e;
+
+  if (!pool_active)
+    return;
+  pthread_mutex_lock(&lock_pool);
+  e = pool_entry(hComp);
+  if (e && e->state == QC_OMX_POOL_LENT)
+    e->dirty = 1;
+  pthread_mutex_unlock(&lock_pool);
+}
+
+/* ======================================================================
+FUNCTION
+  qc_omx_pool_give
+
+DESCRIPTION
+  Returns an instance freed by its client. A lent instance that was
+  never used is parked again if its component is short of parked
+  instances and the park callback accounts it.
+
+PARAMETERS
+  hComp : component handle being freed
+
+RETURN VALUE
+  1 if the instance was parked and must not be destroyed, 0 if the
+  caller destroys it.
+========================================================================== */
+int qc_omx_pool_give(OMX_HANDLETYPE hComp)
+{
+  qc_omx_pool_entry *e;
+  qc_omx_pool_target *t;
+  int parked = 0;
+
+  if (!pool_active)
+    return 0;
+  pthread_mutex_lock(&lock_pool);
+  e = pool_entry(hComp);
+  if (e && e->state == QC_OMX_POOL_LENT)
+  {
+    t = pool_target(e->cmp);
+    if (!e->dirty && t && t->parked < t->target && park_fn(hComp))
+    {
+      e->state = QC_OMX_POOL_PARKED;
+      t->parked++;
+      reparked_cnt++;
+      parked = 1;
+    }
+    else
+    {
+      e->state = QC_OMX_POOL_UNUSED;
+      retired_cnt++;
+      pthread_cond_signal(&cond_pool);
+    }
+  }
+  pthread_mutex_unlock(&lock_pool);
+  return parked;
+}
+
+/* ======================================================================
+FUNCTION
+  qc_omx_pool_record
+
+DESCRIPTION
+  Accounts the latency of an OMX_GetHandle call.
+
+PARAMETERS
+  warm : served from the pool
+  us   : latency in microseconds
+
+RETURN VALUE
+  None.
+========================================================================== */
+void qc_omx_pool_record(int warm, OMX_U32 us)
+{
+  pthread_mutex_lock(&lock_pool);
+  if (warm)
+  {
+    warm_cnt++;
+    warm_total += us;
+    if (us > warm_max)
+      warm_max = us;
+  }
+  else
+  {
+    cold_cnt++;
+    cold_total += us;
+    if (us > cold_max)
+      cold_max = us;
+  }
+  pthread_mutex_unlock(&lock_pool);
+  DEBUG_PRINT("OMXCORE: %s start in %lu us\n", warm ? "warm" : "cold", us);
+}
+
+/* ======================================================================
+FUNCTION
+  QOMX_GetWarmPoolStats
+
+DESCRIPTION
+  Reports the pool occupancy and the start up latencies.
+
+PARAMETERS
+  pStats : filled with the statistics
+
+RETURN VALUE
+  OMX_ErrorBadParameter if pStats is NULL.
+========================================================================== */
+OMX_API OMX_ERRORTYPE QOMX_GetWarmPoolStats(QOMX_WARMPOOLSTATSTYPE *pStats)
+{
+  int i;
+
+  if (!pStats)
+    return OMX_ErrorBadParameter;
+
+  pthread_mutex_lock(&lock_pool);
+  memset(pStats, 0, sizeof(*pStats));
+  pStats->nSize = sizeof(*pStats);
+  pStats->nVersion.nVersion = OMX_SPEC_VERSION;
+  for (i = 0; i < QC_OMX_POOL_MAX; i++)
+  {
+    if (entries[i].state == QC_OMX_POOL_PARKED)
+      pStats->nParked++;
+    else if (entries[i].state == QC_OMX_POOL_LENT)
+      pStats->nLent++;
+  }
+  pStats->nWarmStarts = warm_cnt;
+  pStats->nColdStarts = cold_cnt;
+  pStats->nWarmAvgUs = warm_cnt ? (OMX_U32)(warm_total / warm_cnt) : 0;
+  pStats->nWarmMaxUs = warm_max;
+  pStats->nColdAvgUs = cold_cnt ? (OMX_U32)(cold_total / cold_cnt) : 0;
+  pStats->nColdMaxUs = cold_max;
+  pStats->nReparked = reparked_cnt;
+  pStats->nRetired = retired_cnt;
+  pthread_mutex_unlock(&lock_pool);
+  return OMX_ErrorNone;
+}
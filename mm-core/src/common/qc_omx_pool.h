@@ -0,0 +1,76 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+/*============================================================================
+                            O p e n M A X   w r a p p e r s
+                             O p e n  M A X   C o r e
+
+ Warm pool: keeps constructed and initialized component instances parked
+ so that OMX_GetHandle can hand one out without a cold start.
+
+*//*========================================================================*/
+
+#ifndef QC_OMX_POOL_H
+#define QC_OMX_POOL_H
+
+#include "OMX_Core.h"
+#include "OMX_Component.h"
+#include "QOMX_PoolExtensions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Parked plus lent instances of all pooled components */
+#define QC_OMX_POOL_MAX 16
+
+/* Builds an initialized instance of core[cmp], NULL on failure */
+typedef OMX_HANDLETYPE (*qc_omx_pool_create_fn)(int cmp);
+/* Deinitializes and destroys an instance */
+typedef void (*qc_omx_pool_destroy_fn)(OMX_HANDLETYPE hComp);
+/* Accounts an instance freed unused before it is parked again, 0 if it
+   may not be */
+typedef int (*qc_omx_pool_park_fn)(OMX_HANDLETYPE hComp);
+
+void qc_omx_pool_init(qc_omx_pool_create_fn create,
+                      qc_omx_pool_destroy_fn destroy,
+                      qc_omx_pool_park_fn park);
+OMX_ERRORTYPE qc_omx_pool_set(int cmp, OMX_U32 count);
+int qc_omx_pool_pinned(int cmp);
+
+OMX_HANDLETYPE qc_omx_pool_take(int cmp);
+void qc_omx_pool_lend(OMX_HANDLETYPE hComp, int cmp);
+void qc_omx_pool_touch(OMX_HANDLETYPE hComp);
+int qc_omx_pool_give(OMX_HANDLETYPE hComp);
+
+void qc_omx_pool_record(int warm, OMX_U32 us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,714 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+/*============================================================================
+                            O p e n M A X   w r a p p e r s
+                             O p e n  M A X   C o r e
+
+  This module contains the session manager of the OpenMAX core. It keeps
+  the resolution and frame rate of every component instance, as set on
+  its ports, and admits a session when it leaves the Loaded state only if
+  its macroblock rate fits in the capacity budget.
+
+  A session handed out in a wakeup is pinned until the caller is done
+  with it, and qc_omx_session_detach waits for that, so the component
+  cannot be freed under the wakeup.
+
+*//*========================================================================*/
+
+//////////////////////////////////////////////////////////////////////////////
+//                             Include Files
+//////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#ifdef _ANDROID_
+#include <cutils/properties.h>
+#endif
+
+#include "qc_omx_common.h"
+#include "qc_omx_session.h"
+
+/* Default budget in MB/s; 0 disables admission control until the
+   omxcore.session.capacity property sets a budget */
+#ifndef OMX_CORE_SESSION_CAPACITY
+#define OMX_CORE_SESSION_CAPACITY 0
+#endif
+
+#define QC_OMX_SESSION_PORTS        2
+#define QC_OMX_SESSION_DEFAULT_FPS  (30 << 16)
+
+typedef struct
+{
+  OMX_U32 width;
+  OMX_U32 height;
+  OMX_U32 xFramerate;   // Q16, 0 if not set
+} qc_omx_session_port;
+
+typedef struct
+{
+  OMX_HANDLETYPE hComp;
+  char name[OMX_MAX_STRINGNAME_SIZE];
+  qc_omx_session_port port[QC_OMX_SESSION_PORTS];
+  OMX_U32 mbps;
+  QOMX_SESSIONSTATETYPE state;
+  unsigned seq;         // admission order, for queueing and promotion
+  int pins;             // wakeups handed out and not yet acted on
+  int closing;          // being freed, no more wakeups
+} qc_omx_session;
+
+static pthread_mutex_t lock_session = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond_session = PTHREAD_COND_INITIALIZER;
+static qc_omx_session sessions[QC_OMX_SESSION_MAX];
+static OMX_U32 capacity = OMX_CORE_SESSION_CAPACITY;
+static QOMX_ADMISSIONPOLICYTYPE policy = QOMX_AdmissionReject;
+static int configured = 0;
+static unsigned next_seq = 0;
+static OMX_U32 rejected_cnt = 0, queued_cnt = 0, low_priority_cnt = 0;
+
+/* ======================================================================
+FUNCTION
+  session_configure
+
+DESCRIPTION
+  Reads the capacity and policy properties the first time the session
+  manager is used. Caller holds lock_session.
+
+PARAMETERS
+  None
+
+RETURN VALUE
+  None.
+========================================================================== */
+static void session_configure()
+{
+#ifdef _ANDROID_
+  char value[PROPERTY_VALUE_MAX];
+#endif
+
+  if (configured)
+    return;
+  configured = 1;
+#ifdef _ANDROID_
+  if (property_get("omxcore.session.capacity", value, NULL) > 0)
+    capacity = strtoul(value, NULL, 0);
+  if (property_get("omxcore.session.policy", value, NULL) > 0)
+  {
+    if (!strcmp(value, "reject"))
+      policy = QOMX_AdmissionReject;
+    else if (!strcmp(value, "queue"))
+      policy = QOMX_AdmissionQueue;
+    else if (!strcmp(value, "lowpri"))
+      policy = QOMX_AdmissionLowPriority;
+  }
+#endif
+  DEBUG_PRINT("Session capacity %lu MB/s, policy %d\n", capacity, policy);
+}
+
+/* Caller holds lock_session */
+static qc_omx_session *session_find(OMX_HANDLETYPE hComp)
+{
+  unsigned i;
+
+  for (i = 0; i < QC_OMX_SESSION_MAX; i++)
+  {
+    if (sessions[i].hComp == hComp)
+      return &sessions[i];
+  }
+  return NULL;
+}
+
+/* Macroblock rate of the largest video port at the highest frame rate set
+   on any port */
+static OMX_U32 session_mbps(const qc_omx_session *s)
+{
+  OMX_U32 mbs = 0, fps = 0, port_mbs;
+  unsigned i;
+
+  for (i = 0; i < QC_OMX_SESSION_PORTS; i++)
+  {
+    port_mbs = ((s->port[i].width + 15) >> 4) * ((s->port[i].height + 15) >> 4);
+    if (port_mbs > mbs)
+      mbs = port_mbs;
+    if (s->port[i].xFramerate > fps)
+      fps = s->port[i].xFramerate;
+  }
+  if (!fps)
+    fps = QC_OMX_SESSION_DEFAULT_FPS;
+  return (OMX_U32)(((unsigned long long)mbs * fps) >> 16);
+}
+
+/* Caller holds lock_session */
+static OMX_U32 session_load(QOMX_SESSIONSTATETYPE state)
+{
+  OMX_U32 load = 0;
+  unsigned i;
+
+  for (i = 0; i < QC_OMX_SESSION_MAX; i++)
+  {
+    if (sessions[i].hComp && sessions[i].state == state)
+      load += sessions[i].mbps;
+  }
+  return load;
+}
+
+/* Oldest session in the given state admitted after seq, caller holds
+   lock_session */
+static qc_omx_session *session_next(QOMX_SESSIONSTATETYPE state,
+                                    qc_omx_session *after)
+{
+  qc_omx_session *next = NULL;
+  unsigned i;
+
+  for (i = 0; i < QC_OMX_SESSION_MAX; i++)
+  {
+    qc_omx_session *s = &sessions[i];
+    if (!s->hComp || s->state != state || s->closing)
+      continue;
+    if (after && (int)(s->seq - after->seq) <= 0)
+      continue;
+    if (!next || (int)(s->seq - next->seq) < 0)
+      next = s;
+  }
+  return next;
+}
+
+/* ======================================================================
+FUNCTION
+  session_schedule
+
+DESCRIPTION
+  Hands released load to waiting sessions: low priority sessions that
+  now fit are counted as active again first, then queued sessions are
+  started in arrival order until one does not fit. Every session in
+  wakeups is pinned. Caller holds lock_session.
+
+PARAMETERS
+  wakeups : filled with the sessions the caller must act on
+  max     : size of wakeups
+
+RETURN VALUE
+  Number of wakeups filled.
+========================================================================== */
+static int session_schedule(qc_omx_session_wakeup *wakeups, int max)
+{
+  OMX_U32 active = session_load(QOMX_SessionActive);
+  OMX_U32 low = session_load(QOMX_SessionLowPriority);
+  qc_omx_session *s = NULL;
+  int n = 0;
+
+  while ((s = session_next(QOMX_SessionLowPriority, s)))
+  {
+    if (capacity && active + s->mbps > capacity)
+      continue;
+    s->state = QOMX_SessionActive;
+    active += s->mbps;
+    low -= s->mbps;
+    DEBUG_PRINT("Session %p promoted, %lu MB/s\n", s->hComp, s->mbps);
+  }
+
+  s = NULL;
+  while (n < max && (s = session_next(QOMX_SessionQueued, s)))
+  {
+    if (capacity && active + low + s->mbps > capacity)
+      break;
+    s->state = QOMX_SessionActive;
+    active += s->mbps;
+    s->pins++;
+    wakeups[n].hComp = s->hComp;
+    wakeups[n++].action = QC_OMX_SESSION_RESUME;
+    DEBUG_PRINT("Session %p dequeued, %lu MB/s\n", s->hComp, s->mbps);
+  }
+  return n;
+}
+
+/* ======================================================================
+FUNCTION
+  qc_omx_session_open
+
+DESCRIPTION
+  Starts tracking a component instance, in the Loaded state. Instances
+  beyond QC_OMX_SESSION_MAX are not tracked and always admitted.
+
+PARAMETERS
+  hComp : component handle
+  name  : component name
+
+RETURN VALUE
+  None.
+========================================================================== */
+void qc_omx_session_open(OMX_HANDLETYPE hComp, const char *name)
+{
+  qc_omx_session *s;
+
+  pthread_mutex_lock(&lock_session);
+  session_configure();
+  s = session_find(NULL);
+  if (s)
+  {
+    memset(s, 0, sizeof(*s));
+    s->hComp = hComp;
+    s->state = QOMX_SessionLoaded;
+#ifdef _ANDROID_
+    strlcpy(s->name, name, sizeof(s->name));
+#else
+    strncpy(s->name, name, sizeof(s->name) - 1);
+#endif
+  }
+  else
+  {
+    DEBUG_PRINT_ERROR("Session table full, %s not accounted\n", name);
+  }
+  pthread_mutex_unlock(&lock_session);
+}
+
+/* ======================================================================
+FUNCTION
+  qc_omx_session_detach
+
+DESCRIPTION
+  Called before a component instance is destroyed: no wakeup is handed
+  out for it any more, and the ones already handed out are waited for.
+  Its load stays accounted until qc_omx_session_close.
+
+PARAMETERS
+  hComp : component handle
+
+RETURN VALUE
+  None.
+========================================================================== */
+void qc_omx_session_detach(OMX_HANDLETYPE hComp)
+{
+  qc_omx_session *s;
+
+  if (!hComp)
+    return;
+  pthread_mutex_lock(&lock_session);
+  s = session_find(hComp);
+  if (s)
+  {
+    s->closing = 1;
+    while (s->pins)
+      pthread_cond_wait(&cond_session, &lock_session);
+  }
+  pthread_mutex_unlock(&lock_session);
+}
+
+/* ======================================================================
+FUNCTION
+  qc_omx_session_unpin
+
+DESCRIPTION
+  Tells the session manager the caller is done with a session it got in
+  a wakeup.
+
+PARAMETERS
+  hComp : component handle from the wakeup
+
+RETURN VALUE
+  None.
+========================================================================== */
+void qc_omx_session_unpin(OMX_HANDLETYPE hComp)
+{
+  qc_omx_session *s;
+
+  if (!hComp)
+    return;
+  pthread_mutex_lock(&lock_session);
+  s = session_find(hComp);
+  if (s && s->pins && !--s->pins)
+    pthread_cond_broadcast(&cond_session);
+  pthread_mutex_unlock(&lock_session);
+}
+
+/* ======================================================================
+FUNCTION
+  qc_omx_session_close
+
+DESCRIPTION
+  Stops tracking a component instance and releases its load. Waits for
+  its pending wakeups like qc_omx_session_detach.
+
+PARAMETERS
+  hComp   : component handle
+  wakeups : filled with the sessions the caller must act on
+  max     : size of wakeups
+
+RETURN VALUE
+  Number of wakeups filled.
+========================================================================== */
+int qc_omx_session_close(OMX_HANDLETYPE hComp,
+                         qc_omx_session_wakeup *wakeups, int max)
+{
+  qc_omx_session *s;
+  int n = 0;
+
+  if (!hComp)
+    return 0;
+  pthread_mutex_lock(&lock_session);
+  s = session_find(hComp);
+  if (s)
+  {
+    s->closing = 1;
+    while (s->pins)
+      pthread_cond_wait(&cond_session, &lock_session);
+    s->hComp = NULL;
+    n = session_schedule(wakeups, max);
+  }
+  pthread_mutex_unlock(&lock_session);
+  return n;
+}
+
+/* ======================================================================
+FUNCTION
+  qc_omx_session_set_port
+
+DESCRIPTION
+  Records the frame size and rate of a video port, as set or read by the
+  client. The load of a running session follows the change.
+
+PARAMETERS
+  hComp : component handle
+  port  : port definition
+
+RETURN VALUE
+  None.
+========================================================================== */
+void qc_omx_session_set_port(OMX_HANDLETYPE hComp,
+                             const OMX_PARAM_PORTDEFINITIONTYPE *port)
+{
+  qc_omx_session *s;
+
+  if (!hComp || !port || port->eDomain != OMX_PortDomainVideo ||
+      port->nPortIndex >= QC_OMX_SESSION_PORTS)
+    return;
+  pthread_mutex_lock(&lock_session);
+  s = session_find(hComp);
+  if (s)
+  {
+    s->port[port->nPortIndex].width = port->format.video.nFrameWidth;
+    s->port[port->nPortIndex].height = port->format.video.nFrameHeight;
+    s->port[port->nPortIndex].xFramerate = port->format.video.xFramerate;
+    s->mbps = session_mbps(s);
+  }
+  pthread_mutex_unlock(&lock_session);
+}
+
+/* ======================================================================
+FUNCTION
+  qc_omx_session_set_framerate
+
+DESCRIPTION
+  Records a frame rate set through OMX_IndexConfigVideoFramerate.
+
+PARAMETERS
+  hComp      : component handle
+  port       : port index
+  xFramerate : frame rate in Q16
+
+RETURN VALUE
+  None.
+========================================================================== */
+void qc_omx_session_set_framerate(OMX_HANDLETYPE hComp, OMX_U32 port,
+                                  OMX_U32 xFramerate)
+{
+  qc_omx_session *s;
+
+  if (!hComp || port >= QC_OMX_SESSION_PORTS)
+    return;
+  pthread_mutex_lock(&lock_session);
+  s = session_find(hComp);
+  if (s)
+  {
+    s->port[port].xFramerate = xFramerate;
+    s->mbps = session_mbps(s);
+  }
+  pthread_mutex_unlock(&lock_session);
+}
+
+/* ======================================================================
+FUNCTION
+  qc_omx_session_admit
+
+DESCRIPTION
+  Decides whether a session leaving the Loaded state may start. A
+  session that fits the budget, with no other session queued ahead of it,
+  is admitted, as is one without video load; otherwise the policy
+  applies. Asking again for a session
+  already decided returns the same decision.
+
+PARAMETERS
+  hComp : component handle
+
+RETURN VALUE
+  QC_OMX_SESSION_ADMITTED, _LOW_PRIORITY, _QUEUED or _REJECTED.
+========================================================================== */
+int qc_omx_session_admit(OMX_HANDLETYPE hComp)
+{
+  qc_omx_session *s;
+  int rc = QC_OMX_SESSION_ADMITTED;
+
+  pthread_mutex_lock(&lock_session);
+  session_configure();
+  s = session_find(hComp);
+  if (!s || !hComp)
+    goto finish;
+
+  switch (s->state)
+  {
+    case QOMX_SessionLowPriority:
+      rc = QC_OMX_SESSION_LOW_PRIORITY;
+      goto finish;
+    case QOMX_SessionQueued:
+      rc = QC_OMX_SESSION_QUEUED;
+      goto finish;
+    case QOMX_SessionActive:
+      goto finish;
+    default:
+      break;
+  }
+
+  s->seq = next_seq++;
+  if (!capacity || !s->mbps ||
+      (session_load(QOMX_SessionActive) + session_load(QOMX_SessionLowPriority) +
+       s->mbps <= capacity && !session_next(QOMX_SessionQueued, NULL)))
+  {
+    s->state = QOMX_SessionActive;
+  }
+  else if (policy == QOMX_AdmissionQueue)
+  {
+    s->state = QOMX_SessionQueued;
+    queued_cnt++;
+    rc = QC_OMX_SESSION_QUEUED;
+  }
+  else if (policy == QOMX_AdmissionLowPriority)
+  {
+    s->state = QOMX_SessionLowPriority;
+    low_priority_cnt++;
+    rc = QC_OMX_SESSION_LOW_PRIORITY;
+  }
+  else
+  {
+    rejected_cnt++;
+    rc = QC_OMX_SESSION_REJECTED;
+  }
+  DEBUG_PRINT("Session %s %p: %lu MB/s, decision %d\n", s->name, hComp,
+              s->mbps, rc);
+
+finish:
+  pthread_mutex_unlock(&lock_session);
+  return rc;
+}
+
+/* ======================================================================
+FUNCTION
+  qc_omx_session_reserve
+
+DESCRIPTION
+  Accounts the load of an instance parked in the warm pool, at its
+  default port settings, since it holds a driver instance. Unlike
+  qc_omx_session_admit no policy applies: the reservation is only made
+  if it fits the budget with no session queued. qc_omx_session_release
+  drops it.
+
+PARAMETERS
+  hComp : component handle
+
+RETURN VALUE
+  1 if reserved or not accounted, 0 if the instance must not be parked.
+========================================================================== */
+int qc_omx_session_reserve(OMX_HANDLETYPE hComp)
+{
+  qc_omx_session *s;
+  int rc = 1;
+
+  pthread_mutex_lock(&lock_session);
+  session_configure();
+  s = session_find(hComp);
+  if (s && hComp)
+  {
+    if (s->state != QOMX_SessionLoaded)
+      rc = 0;
+    else if (capacity && s->mbps &&
+             (session_load(QOMX_SessionActive) +
+              session_load(QOMX_SessionLowPriority) + s->mbps > capacity ||
+              session_next(QOMX_SessionQueued, NULL)))
+      rc = 0;
+    else
+    {
+      s->seq = next_seq++;
+      s->state = QOMX_SessionActive;
+    }
+    DEBUG_PRINT("Session %s %p: reserve %lu MB/s, %s\n", s->name, hComp,
+                s->mbps, rc ? "done" : "refused");
+  }
+  pthread_mutex_unlock(&lock_session);
+  return rc;
+}
+
+/* ======================================================================
+FUNCTION
+  qc_omx_session_release
+
+DESCRIPTION
+  Returns a session to the Loaded state, releasing its load or removing
+  it from the queue.
+
+PARAMETERS
+  hComp      : component handle
+  was_queued : set if the session was still queued
+  wakeups    : filled with the sessions the caller must act on
+  max        : size of wakeups
+
+RETURN VALUE
+  Number of wakeups filled.
+========================================================================== */
+int qc_omx_session_release(OMX_HANDLETYPE hComp, int *was_queued,
+                           qc_omx_session_wakeup *wakeups, int max)
+{
+  qc_omx_session *s;
+  int n = 0;
+
+  if (was_queued)
+    *was_queued = 0;
+  if (!hComp)
+    return 0;
+  pthread_mutex_lock(&lock_session);
+  s = session_find(hComp);
+  if (s && s->state != QOMX_SessionLoaded)
+  {
+    if (was_queued)
+      *was_queued = (s->state == QOMX_SessionQueued);
+    s->state = QOMX_SessionLoaded;
+    n = session_schedule(wakeups, max);
+  }
+  pthread_mutex_unlock(&lock_session);
+  return n;
+}
+
+/* ======================================================================
+FUNCTION
+  QOMX_GetCoreLoad
+
+DESCRIPTION
+  Reports the live load of the core and its sessions.
+
+PARAMETERS
+  pLoad        : filled with the load summary
+  pSessions    : optional, filled with up to *pNumSessions entries
+  pNumSessions : in: size of pSessions, out: entries filled
+
+RETURN VALUE
+  OMX_ErrorBadParameter if pLoad is NULL, or pSessions is given without
+  pNumSessions.
+========================================================================== */
+OMX_API OMX_ERRORTYPE QOMX_GetCoreLoad(QOMX_CORELOADTYPE *pLoad,
+                                       QOMX_SESSIONINFOTYPE *pSessions,
+                                       OMX_U32 *pNumSessions)
+{
+  OMX_U32 count = 0;
+  unsigned i, j;
+
+  if (!pLoad || (pSessions && !pNumSessions))
+    return OMX_ErrorBadParameter;
+
+  pthread_mutex_lock(&lock_session);
+  session_configure();
+  memset(pLoad, 0, sizeof(*pLoad));
+  pLoad->nSize = sizeof(*pLoad);
+  pLoad->nVersion.nVersion = OMX_SPEC_VERSION;
+  pLoad->nCapacity = capacity;
+  pLoad->ePolicy = policy;
+  pLoad->nActiveLoad = session_load(QOMX_SessionActive);
+  pLoad->nLowPriorityLoad = session_load(QOMX_SessionLowPriority);
+  pLoad->nQueuedLoad = session_load(QOMX_SessionQueued);
+  pLoad->nRejected = rejected_cnt;
+  pLoad->nQueued = queued_cnt;
+  pLoad->nLowPriority = low_priority_cnt;
+
+  for (i = 0; i < QC_OMX_SESSION_MAX; i++)
+  {
+    qc_omx_session *s = &sessions[i];
+    if (!s->hComp)
+      continue;
+    pLoad->nSessions++;
+    if (!pSessions || count >= *pNumSessions)
+      continue;
+    memset(&pSessions[count], 0, sizeof(pSessions[count]));
+    pSessions[count].hComponent = s->hComp;
+    memcpy(pSessions[count].cName, s->name, sizeof(s->name));
+    for (j = 0; j < QC_OMX_SESSION_PORTS; j++)
+    {
+      if (s->port[j].width > pSessions[count].nFrameWidth)
+        pSessions[count].nFrameWidth = s->port[j].width;
+      if (s->port[j].height > pSessions[count].nFrameHeight)
+        pSessions[count].nFrameHeight = s->port[j].height;
+      if (s->port[j].xFramerate > pSessions[count].xFramerate)
+        pSessions[count].xFramerate = s->port[j].xFramerate;
+    }
+    if (!pSessions[count].xFramerate)
+      pSessions[count].xFramerate = QC_OMX_SESSION_DEFAULT_FPS;
+    pSessions[count].nMBPerSec = s->mbps;
+    pSessions[count].eState = s->state;
+    count++;
+  }
+  pthread_mutex_unlock(&lock_session);
+
+  if (pNumSessions)
+    *pNumSessions = count;
+  return OMX_ErrorNone;
+}
+
+/* ======================================================================
+FUNCTION
+  QOMX_SetCoreCapacity
+
+DESCRIPTION
+  Overrides the capacity budget and admission policy.
+
+PARAMETERS
+  nCapacity : budget in MB/s, 0 for unlimited
+  ePolicy   : policy for sessions over the budget
+
+RETURN VALUE
+  OMX_ErrorBadParameter for an unknown policy.
+========================================================================== */
+OMX_API OMX_ERRORTYPE QOMX_SetCoreCapacity(OMX_U32 nCapacity,
+                                           QOMX_ADMISSIONPOLICYTYPE ePolicy)
+{
+  if (ePolicy != QOMX_AdmissionReject && ePolicy != QOMX_AdmissionQueue &&
+      ePolicy != QOMX_AdmissionLowPriority)
+    return OMX_ErrorBadParameter;
+
+  pthread_mutex_lock(&lock_session);
+  configured = 1;
+  capacity = nCapacity;
+  policy = ePolicy;
+  pthread_mutex_unlock(&lock_session);
+  return OMX_ErrorNone;
+}
@@ -0,0 +1,85 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+/*============================================================================
+                            O p e n M A X   w r a p p e r s
+                             O p e n  M A X   C o r e
+
+ Session manager: accounts the macroblock rate of every component instance
+ against a capacity budget and decides whether a new session may start.
+
+*//*========================================================================*/
+
+#ifndef QC_OMX_SESSION_H
+#define QC_OMX_SESSION_H
+
+#include "OMX_Core.h"
+#include "OMX_Component.h"
+#include "QOMX_SessionExtensions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define QC_OMX_SESSION_MAX 32
+
+/* Admission decisions */
+#define QC_OMX_SESSION_ADMITTED      0
+#define QC_OMX_SESSION_LOW_PRIORITY  1
+#define QC_OMX_SESSION_QUEUED        2
+#define QC_OMX_SESSION_REJECTED      3
+
+/* Actions the caller must take on other sessions once load is released */
+#define QC_OMX_SESSION_RESUME   0  // forward the held Idle command
+
+typedef struct
+{
+  OMX_HANDLETYPE hComp;
+  int action;
+} qc_omx_session_wakeup;
+
+void qc_omx_session_open(OMX_HANDLETYPE hComp, const char *name);
+void qc_omx_session_detach(OMX_HANDLETYPE hComp);
+int qc_omx_session_close(OMX_HANDLETYPE hComp,
+                         qc_omx_session_wakeup *wakeups, int max);
+void qc_omx_session_unpin(OMX_HANDLETYPE hComp);
+
+void qc_omx_session_set_port(OMX_HANDLETYPE hComp,
+                             const OMX_PARAM_PORTDEFINITIONTYPE *port);
+void qc_omx_session_set_framerate(OMX_HANDLETYPE hComp, OMX_U32 port,
+                                  OMX_U32 xFramerate);
+
+int qc_omx_session_admit(OMX_HANDLETYPE hComp);
+int qc_omx_session_reserve(OMX_HANDLETYPE hComp);
+int qc_omx_session_release(OMX_HANDLETYPE hComp, int *was_queued,
+                           qc_omx_session_wakeup *wakeups, int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
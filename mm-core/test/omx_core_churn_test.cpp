@@ -0,0 +1,519 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+/*
+	Churn benchmark for the OMX core handle management.
+
+	mm-omxcore-churn-test [iterations] [init_us]
+
+	Every component of the registry table is served by a stub component
+	built into this executable, so the numbers only cover the core: name
+	lookup, library reuse, handle slot bookkeeping and the component
+	wrapper. The test creates and frees one instance of every component
+	in turn, then fills every instance slot of every component and frees
+	them in reverse, and finally times the role queries. Results of the
+	role queries are checked against a scan of the registry table.
+
+	The warm pool is then compared with cold starts on the first
+	component, its stub taking init_us (default 20000) to initialize as
+	a stand-in for the driver open and thread creation of a decoder:
+	instances freed unused, as by capability probing, and instances
+	configured by their client, which the pool has to replace. The stub
+	ports are QCIF at 30 fps: the load of parked instances must be
+	reserved with the session manager and the pool must not park beyond
+	the budget. A component failing to initialize must not be built
+	again on every start. Two clients starting and freeing instances
+	of one component, with the pool lock kept busy, must have every
+	instance parked again or destroyed, and no handle left behind.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "qc_omx_component.h"
+#include "QOMX_PoolExtensions.h"
+#include "QOMX_SessionExtensions.h"
+
+extern "C" {
+#include "qc_omx_core.h"
+extern omx_core_cb_type core[];
+extern const unsigned int SIZE_OF_CORE;
+}
+
+#define CHURN_DEFAULT_ITERATIONS 2000
+#define CHURN_DEFAULT_INIT_US    20000
+#define CHURN_POOL_STARTS        20
+#define CHURN_QCIF_MBPS          (11 * 9 * 30)
+#define CHURN_HANDOFF_STARTS     50000
+
+static unsigned init_us;        // simulated component_init cost
+static bool init_fails;
+static volatile unsigned init_calls;
+static volatile int live_components;
+
+class churn_component : public qc_omx_component
+{
+public:
+  churn_component() { __sync_fetch_and_add(&live_components, 1); }
+  ~churn_component() { __sync_fetch_and_sub(&live_components, 1); }
+  OMX_ERRORTYPE component_init(OMX_STRING)
+  {
+    __sync_fetch_and_add(&init_calls, 1);
+    unsigned us = __atomic_load_n(&init_us, __ATOMIC_RELAXED);
+    if (us)
+      usleep(us);
+    return init_fails ? OMX_ErrorInsufficientResources : OMX_ErrorNone;
+  }
+  OMX_ERRORTYPE get_component_version(OMX_HANDLETYPE, OMX_STRING,
+      OMX_VERSIONTYPE*, OMX_VERSIONTYPE*, OMX_UUIDTYPE*)
+  { return OMX_ErrorNotImplemented; }
+  OMX_ERRORTYPE send_command(OMX_HANDLETYPE, OMX_COMMANDTYPE, OMX_U32, OMX_PTR)
+  { return OMX_ErrorNone; }
+  OMX_ERRORTYPE get_parameter(OMX_HANDLETYPE, OMX_INDEXTYPE index, OMX_PTR data)
+  {
+    OMX_PARAM_PORTDEFINITIONTYPE *port = (OMX_PARAM_PORTDEFINITIONTYPE *)data;
+    if (index != OMX_IndexParamPortDefinition || port->nPortIndex > 1)
+      return OMX_ErrorUnsupportedIndex;
+    port->eDomain = OMX_PortDomainVideo;
+    port->format.video.nFrameWidth = 176;
+    port->format.video.nFrameHeight = 144;
+    port->format.video.xFramerate = 30 << 16;
+    return OMX_ErrorNone;
+  }
+  OMX_ERRORTYPE set_parameter(OMX_HANDLETYPE, OMX_INDEXTYPE, OMX_PTR)
+  { return OMX_ErrorUnsupportedIndex; }
+  OMX_ERRORTYPE get_config(OMX_HANDLETYPE, OMX_INDEXTYPE, OMX_PTR)
+  { return OMX_ErrorUnsupportedIndex; }
+  OMX_ERRORTYPE set_config(OMX_HANDLETYPE, OMX_INDEXTYPE, OMX_PTR)
+  { return OMX_ErrorUnsupportedIndex; }
+  OMX_ERRORTYPE get_extension_index(OMX_HANDLETYPE, OMX_STRING, OMX_INDEXTYPE*)
+  { return OMX_ErrorNotImplemented; }
+  OMX_ERRORTYPE get_state(OMX_HANDLETYPE, OMX_STATETYPE *state)
+  { *state = OMX_StateLoaded; return OMX_ErrorNone; }
+  OMX_ERRORTYPE component_tunnel_request(OMX_HANDLETYPE, OMX_U32,
+      OMX_HANDLETYPE, OMX_U32, OMX_TUNNELSETUPTYPE*)
+  { return OMX_ErrorNotImplemented; }
+  OMX_ERRORTYPE use_buffer(OMX_HANDLETYPE, OMX_BUFFERHEADERTYPE**, OMX_U32,
+      OMX_PTR, OMX_U32, OMX_U8*)
+  { return OMX_ErrorNotImplemented; }
+  OMX_ERRORTYPE allocate_buffer(OMX_HANDLETYPE, OMX_BUFFERHEADERTYPE**,
+      OMX_U32, OMX_PTR, OMX_U32)
+  { return OMX_ErrorNotImplemented; }
+  OMX_ERRORTYPE free_buffer(OMX_HANDLETYPE, OMX_U32, OMX_BUFFERHEADERTYPE*)
+  { return OMX_ErrorNotImplemented; }
+  OMX_ERRORTYPE empty_this_buffer(OMX_HANDLETYPE, OMX_BUFFERHEADERTYPE*)
+  { return OMX_ErrorNotImplemented; }
+  OMX_ERRORTYPE fill_this_buffer(OMX_HANDLETYPE, OMX_BUFFERHEADERTYPE*)
+  { return OMX_ErrorNotImplemented; }
+  OMX_ERRORTYPE set_callbacks(OMX_HANDLETYPE, OMX_CALLBACKTYPE*, OMX_PTR)
+  { return OMX_ErrorNone; }
+  OMX_ERRORTYPE component_deinit(OMX_HANDLETYPE) { return OMX_ErrorNone; }
+  OMX_ERRORTYPE use_EGL_image(OMX_HANDLETYPE, OMX_BUFFERHEADERTYPE**, OMX_U32,
+      OMX_PTR, void*)
+  { return OMX_ErrorNotImplemented; }
+  OMX_ERRORTYPE component_role_enum(OMX_HANDLETYPE, OMX_U8*, OMX_U32)
+  { return OMX_ErrorNoMore; }
+};
+
+// Looked up by the core in this executable, see main()
+extern "C" void *get_omx_component_factory_fn(void)
+{
+  return new churn_component;
+}
+
+static OMX_CALLBACKTYPE callbacks = { NULL, NULL, NULL };
+static int failures;
+// registry entries reachable by name; a repeated name resolves to its first
+static unsigned *distinct;
+static unsigned num_distinct;
+
+static double now_us(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+static void check(bool cond, const char *what, const char *name)
+{
+  if (!cond) {
+    if (failures++ < 10)
+      printf("FAIL: %s (%s)\n", what, name);
+  }
+}
+
+static void churn_single(unsigned iterations)
+{
+  OMX_HANDLETYPE handle;
+  double start = now_us();
+
+  for (unsigned it = 0; it < iterations; it++) {
+    for (unsigned k = 0; k < num_distinct; k++) {
+      unsigned i = distinct[k];
+      OMX_ERRORTYPE err = OMX_GetHandle(&handle, core[i].name, NULL, &callbacks);
+      check(err == OMX_ErrorNone && handle, "GetHandle", core[i].name);
+      if (err == OMX_ErrorNone)
+        check(OMX_FreeHandle(handle) == OMX_ErrorNone, "FreeHandle", core[i].name);
+    }
+  }
+  printf("Single instance churn: %.3f us per GetHandle/FreeHandle pair\n",
+      (now_us() - start) / ((double)iterations * num_distinct));
+}
+
+static void churn_full(unsigned iterations)
+{
+  unsigned max = num_distinct * OMX_COMP_MAX_INST, count;
+  OMX_HANDLETYPE *handles = new OMX_HANDLETYPE[max];
+  double start = now_us();
+
+  for (unsigned it = 0; it < iterations; it++) {
+    count = 0;
+    for (unsigned j = 0; j < OMX_COMP_MAX_INST; j++) {
+      for (unsigned k = 0; k < num_distinct; k++) {
+        unsigned i = distinct[k];
+        if (OMX_GetHandle(&handles[count], core[i].name, NULL, &callbacks) ==
+            OMX_ErrorNone)
+          count++;
+        else
+          check(false, "GetHandle with free slot", core[i].name);
+      }
+    }
+    // every slot taken: one more instance must be refused
+    OMX_HANDLETYPE extra = NULL;
+    check(OMX_GetHandle(&extra, core[0].name, NULL, &callbacks) ==
+        OMX_ErrorInsufficientResources, "GetHandle beyond the slots", core[0].name);
+    while (count)
+      OMX_FreeHandle(handles[--count]);
+  }
+  printf("All slots churn: %.3f us per GetHandle/FreeHandle pair (%u live)\n",
+      (now_us() - start) / ((double)iterations * max), max);
+  delete [] handles;
+}
+
+static void query_roles(unsigned iterations)
+{
+  OMX_U8 name_buf[64][OMX_MAX_STRINGNAME_SIZE];
+  OMX_U8 *names[64];
+  OMX_U32 num;
+  unsigned i, j, expect, queries = 0;
+  double start;
+
+  for (i = 0; i < 64; i++)
+    names[i] = name_buf[i];
+
+  for (i = 0; i < SIZE_OF_CORE; i++) {
+    if (!core[i].roles[0])
+      continue;
+    expect = 0;
+    for (j = 0; j < SIZE_OF_CORE; j++)
+      if (core[j].roles[0] && !strcmp(core[j].roles[0], core[i].roles[0]))
+        expect++;
+    OMX_GetComponentsOfRole(core[i].roles[0], &num, NULL);
+    check(num == expect, "GetComponentsOfRole count", core[i].roles[0]);
+    num = 64;
+    OMX_GetComponentsOfRole(core[i].roles[0], &num, names);
+    check(num == expect, "GetComponentsOfRole names", core[i].roles[0]);
+    for (j = 0; j < SIZE_OF_CORE && num; j++) {
+      if (core[j].roles[0] && !strcmp(core[j].roles[0], core[i].roles[0])) {
+        check(!strcmp((char *)names[0], core[j].name),
+            "GetComponentsOfRole order", core[i].roles[0]);
+        break;
+      }
+    }
+    OMX_GetRolesOfComponent(core[i].name, &num, NULL);
+    check(num == 1, "GetRolesOfComponent", core[i].name);
+  }
+  OMX_GetComponentsOfRole((char *)"video_decoder.none", &num, NULL);
+  check(num == 0, "GetComponentsOfRole unknown role", "video_decoder.none");
+
+  start = now_us();
+  for (unsigned it = 0; it < iterations; it++) {
+    for (i = 0; i < SIZE_OF_CORE; i++) {
+      num = 64;
+      OMX_GetComponentsOfRole(core[i].roles[0], &num, names);
+      num = 1;
+      OMX_GetRolesOfComponent(core[i].name, &num, names);
+      queries += 2;
+    }
+  }
+  printf("Role queries: %.3f us per query\n", (now_us() - start) / queries);
+}
+
+/* Average OMX_GetHandle latency of one component over CHURN_POOL_STARTS
+   starts. A used instance has a command sent before it is freed. With
+   wait_parked set every start first waits for the pool to refill. */
+static double pool_starts(const char *name, bool used, bool wait_parked)
+{
+  OMX_HANDLETYPE handle;
+  QOMX_WARMPOOLSTATSTYPE stats;
+  double start, total = 0;
+
+  for (unsigned n = 0; n < CHURN_POOL_STARTS; n++) {
+    for (unsigned wait = 0; wait_parked && wait < 1000; wait++) {
+      QOMX_GetWarmPoolStats(&stats);
+      if (stats.nParked)
+        break;
+      usleep(1000);
+    }
+    start = now_us();
+    if (OMX_GetHandle(&handle, (char *)name, NULL, &callbacks) != OMX_ErrorNone) {
+      check(false, "GetHandle", name);
+      continue;
+    }
+    total += now_us() - start;
+    if (used)
+      OMX_SendCommand(handle, OMX_CommandStateSet, OMX_StateIdle, NULL);
+    OMX_FreeHandle(handle);
+  }
+  return total / CHURN_POOL_STARTS;
+}
+
+static bool pool_drained(void)
+{
+  QOMX_WARMPOOLSTATSTYPE stats;
+
+  for (unsigned wait = 0; wait < 1000; wait++) {
+    QOMX_GetWarmPoolStats(&stats);
+    if (!stats.nParked)
+      return true;
+    usleep(1000);
+  }
+  return false;
+}
+
+static OMX_U32 active_load(void)
+{
+  QOMX_CORELOADTYPE load;
+
+  QOMX_GetCoreLoad(&load, NULL, NULL);
+  return load.nActiveLoad;
+}
+
+static bool pool_parked(void)
+{
+  QOMX_WARMPOOLSTATSTYPE stats;
+
+  for (unsigned wait = 0; wait < 1000; wait++) {
+    QOMX_GetWarmPoolStats(&stats);
+    if (stats.nParked)
+      return true;
+    usleep(1000);
+  }
+  return false;
+}
+
+/* Parked instances against the session budget, and failed builds */
+static void pool_accounting(void)
+{
+  const char *name = core[distinct[0]].name;
+  QOMX_WARMPOOLSTATSTYPE stats;
+  QOMX_CORELOADTYPE load;
+  OMX_HANDLETYPE handle;
+  unsigned calls;
+
+  QOMX_GetCoreLoad(&load, NULL, NULL);
+  check(QOMX_SetWarmPool((char *)name, 1) == OMX_ErrorNone, "SetWarmPool", name);
+  check(pool_parked(), "instance parked", name);
+  check(active_load() == CHURN_QCIF_MBPS, "parked instance load reserved", name);
+  if (OMX_GetHandle(&handle, (char *)name, NULL, &callbacks) == OMX_ErrorNone) {
+    check(active_load() == 0, "reservation dropped on take", name);
+    OMX_FreeHandle(handle);
+    check(active_load() == CHURN_QCIF_MBPS, "reparked instance load reserved", name);
+  } else {
+    check(false, "GetHandle", name);
+  }
+  check(QOMX_SetWarmPool((char *)name, 0) == OMX_ErrorNone, "drain", name);
+  check(pool_drained(), "pool drained", name);
+  check(active_load() == 0, "reservation released on drain", name);
+
+  // no room for a parked instance
+  QOMX_SetCoreCapacity(CHURN_QCIF_MBPS - 1, QOMX_AdmissionReject);
+  QOMX_SetWarmPool((char *)name, 1);
+  usleep(100000);
+  QOMX_GetWarmPoolStats(&stats);
+  check(!stats.nParked, "no instance parked over the budget", name);
+  check(active_load() == 0, "no load reserved over the budget", name);
+  QOMX_SetWarmPool((char *)name, 0);
+  QOMX_SetCoreCapacity(load.nCapacity, load.ePolicy);
+
+  // one failed build, then cold starts failing the same way
+  init_fails = true;
+  calls = init_calls;
+  QOMX_SetWarmPool((char *)name, 1);
+  usleep(100000);
+  for (unsigned n = 0; n < CHURN_POOL_STARTS; n++)
+    check(OMX_GetHandle(&handle, (char *)name, NULL, &callbacks) != OMX_ErrorNone,
+        "GetHandle of failing component", name);
+  usleep(100000);
+  printf("Failing component: %u inits for %u starts\n", init_calls - calls,
+      CHURN_POOL_STARTS);
+  check(init_calls - calls == CHURN_POOL_STARTS + 1, "failed build not retried", name);
+  QOMX_SetWarmPool((char *)name, 0);
+  init_fails = false;
+}
+
+static int handoff_done;
+
+static void *handoff_client(void *arg)
+{
+  const char *name = (const char *)arg;
+  OMX_HANDLETYPE handle;
+
+  for (unsigned n = 0; n < CHURN_HANDOFF_STARTS; n++) {
+    if (OMX_GetHandle(&handle, (char *)name, NULL, &callbacks) != OMX_ErrorNone) {
+      check(false, "GetHandle", name);
+      continue;
+    }
+    OMX_FreeHandle(handle);
+  }
+  return NULL;
+}
+
+static void *handoff_stats(void *)
+{
+  QOMX_WARMPOOLSTATSTYPE stats;
+
+  while (!__atomic_load_n(&handoff_done, __ATOMIC_RELAXED))
+    QOMX_GetWarmPoolStats(&stats);
+  return NULL;
+}
+
+/* An instance one client frees unused is parked again while the other
+   client may be taking it from the pool. The stats thread keeps the pool
+   lock busy, so that the freeing client blocks inside the pool. */
+static void pool_handoff(void)
+{
+  const char *name = core[distinct[0]].name;
+  int cmp = distinct[0];
+  pthread_t clients[2], stats;
+  unsigned slots = 0;
+  int live;
+
+  check(pool_drained(), "pool drained", name);
+  live = live_components;
+  QOMX_SetWarmPool((char *)name, 1);
+  check(pool_parked(), "instance parked", name);
+  __atomic_store_n(&handoff_done, 0, __ATOMIC_RELAXED);
+  pthread_create(&stats, NULL, handoff_stats, NULL);
+  for (unsigned k = 0; k < 2; k++)
+    pthread_create(&clients[k], NULL, handoff_client, (void *)name);
+  for (unsigned k = 0; k < 2; k++)
+    pthread_join(clients[k], NULL);
+  __atomic_store_n(&handoff_done, 1, __ATOMIC_RELAXED);
+  pthread_join(stats, NULL);
+
+  QOMX_SetWarmPool((char *)name, 0);
+  check(pool_drained(), "pool drained", name);
+  for (unsigned k = 0; k < OMX_COMP_MAX_INST; k++)
+    slots += core[cmp].inst[k] != NULL;
+  printf("Pool handoff: %d instances and %u handles left\n",
+      live_components - live, slots);
+  check(live_components == live, "every instance parked or destroyed", name);
+  check(!slots, "no handle left", name);
+}
+
+static void warm_pool(void)
+{
+  const char *name = core[distinct[0]].name;
+  QOMX_WARMPOOLSTATSTYPE before, after;
+  double cold, probe, used;
+
+  // the stats are global: drop whatever omxcore.warmpool set up
+  for (unsigned k = 0; k < num_distinct; k++)
+    QOMX_SetWarmPool(core[distinct[k]].name, 0);
+  check(pool_drained(), "pool drained", "all");
+
+  cold = pool_starts(name, false, false);
+  check(QOMX_SetWarmPool((char *)name, 1) == OMX_ErrorNone, "SetWarmPool", name);
+  QOMX_GetWarmPoolStats(&before);
+  probe = pool_starts(name, false, true);
+  used = pool_starts(name, true, true);
+  QOMX_GetWarmPoolStats(&after);
+
+  printf("Cold start: %.1f us, warm start: %.1f us freed unused, "
+      "%.1f us freed after use (%s, init %u us)\n",
+      cold, probe, used, name, init_us);
+  printf("Pool: %lu warm starts, %lu reparked, %lu retired\n",
+      (unsigned long)(after.nWarmStarts - before.nWarmStarts),
+      (unsigned long)(after.nReparked - before.nReparked),
+      (unsigned long)(after.nRetired - before.nRetired));
+  check(after.nWarmStarts - before.nWarmStarts == 2 * CHURN_POOL_STARTS,
+      "every start served warm", name);
+  check(after.nRetired - before.nRetired == CHURN_POOL_STARTS,
+      "used instances retired", name);
+
+  check(QOMX_SetWarmPool((char *)name, 0) == OMX_ErrorNone, "drain", name);
+  check(pool_drained(), "pool drained", name);
+  check(QOMX_SetWarmPool((char *)"OMX.qcom.none", 1) == OMX_ErrorComponentNotFound,
+      "SetWarmPool of unknown component", "OMX.qcom.none");
+}
+
+int main(int argc, char **argv)
+{
+  unsigned iterations = argc > 1 ? atoi(argv[1]) : CHURN_DEFAULT_ITERATIONS;
+  unsigned pool_init_us = argc > 2 ? atoi(argv[2]) : CHURN_DEFAULT_INIT_US;
+  OMX_HANDLETYPE handle;
+
+  // load every component from this executable instead of its library
+  distinct = new unsigned[SIZE_OF_CORE];
+  for (unsigned i = 0; i < SIZE_OF_CORE; i++) {
+    unsigned j;
+    core[i].so_lib_name = NULL;
+    for (j = 0; j < i && strcmp(core[j].name, core[i].name); j++);
+    if (j == i)
+      distinct[num_distinct++] = i;
+  }
+
+  if (OMX_Init() != OMX_ErrorNone) {
+    printf("FAIL: OMX_Init\n");
+    return 1;
+  }
+  printf("%u components, %u iterations\n", num_distinct, iterations);
+
+  check(OMX_GetHandle(&handle, (char *)"OMX.qcom.none", NULL, &callbacks) ==
+      OMX_ErrorNotImplemented, "GetHandle of unknown component", "OMX.qcom.none");
+  check(OMX_FreeHandle((OMX_HANDLETYPE)&callbacks) == OMX_ErrorNone,
+      "FreeHandle of unknown handle", "");
+
+  churn_single(iterations);
+  churn_full(iterations / 4 + 1);
+  query_roles(iterations);
+  __atomic_store_n(&init_us, pool_init_us, __ATOMIC_RELAXED);
+  warm_pool();
+  // the pool thread may still be building for the previous phase
+  __atomic_store_n(&init_us, 1000, __ATOMIC_RELAXED);
+  pool_accounting();
+  pool_handoff();
+
+  OMX_Deinit();
+  delete [] distinct;
+  printf("%s\n", failures ? "FAILED" : "PASSED");
+  return failures ? 1 : 0;
+}
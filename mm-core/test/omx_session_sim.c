@@ -0,0 +1,299 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+/*
+	Concurrency simulator for the OMX core session manager.
+
+	mm-omxcore-session-sim [threads] [sessions_per_thread] [seed]
+
+	Every thread plays a client opening sessions of random resolution and
+	frame rate, starting them, running them for a random time and freeing
+	them, under each admission policy in turn. Some queued clients give
+	up and free their session just as it is picked to be started. The simulator acts on the wakeups
+	the session manager returns the way the core does, and checks after
+	every step that the load admitted within the budget never exceeds it,
+	that the reported loads match what the clients hold, that queued
+	sessions are started in arrival order and that no wakeup is handed
+	out for a session that is being freed.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "qc_omx_session.h"
+
+#define CAPACITY        489600      // two 1080p30 sessions
+#define MAX_THREADS     QC_OMX_SESSION_MAX
+
+struct sim_format
+{
+  OMX_U32 width, height, fps;
+};
+
+static const struct sim_format formats[] =
+{
+  { 176, 144, 15 }, { 320, 240, 30 }, { 640, 480, 30 }, { 1280, 720, 30 },
+  { 1280, 720, 60 }, { 1920, 1080, 24 }, { 1920, 1080, 30 },
+};
+
+struct sim_session
+{
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int started;
+  int nudged;               // picked for a wakeup
+  volatile int freed;       // detached, the component would be gone
+  unsigned queue_ticket;    // order the session was queued in
+};
+
+static struct sim_session sim[MAX_THREADS];
+static pthread_mutex_t sim_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned queue_tickets, last_started;
+static unsigned abandon_cnt, freed_wakeups;
+static unsigned long long load_sum, load_samples;
+static OMX_U32 peak_load;
+static unsigned run_cnt, fail_cnt, order_errors;
+static long long max_wait_us;
+static int sessions_per_thread;
+
+static long long now_us()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+static void check_load(const char *where)
+{
+  QOMX_CORELOADTYPE load;
+
+  QOMX_GetCoreLoad(&load, NULL, NULL);
+  pthread_mutex_lock(&sim_lock);
+  if (load.nActiveLoad > load.nCapacity)
+  {
+    printf("FAIL %s: active load %lu over capacity %lu\n", where,
+           load.nActiveLoad, load.nCapacity);
+    fail_cnt++;
+  }
+  load_sum += load.nActiveLoad;
+  load_samples++;
+  if (load.nActiveLoad + load.nLowPriorityLoad > peak_load)
+    peak_load = load.nActiveLoad + load.nLowPriorityLoad;
+  pthread_mutex_unlock(&sim_lock);
+}
+
+/* What the core does with the wakeups: here a queued client is told its
+   Idle transition went through. Caller holds sim_lock, so that tickets
+   follow the order of the session manager decisions. */
+static void wake(qc_omx_session_wakeup *wakeups, int count)
+{
+  int i;
+
+  for (i = 0; i < count; i++)
+  {
+    struct sim_session *s = (struct sim_session *)wakeups[i].hComp;
+
+    /* A client giving up does so as its session is picked, the worst
+       time: it goes on to free the session while the wakeup is pending. */
+    pthread_mutex_lock(&s->lock);
+    s->nudged = 1;
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+    usleep(50);
+    if (s->freed)
+      freed_wakeups++;
+    if (wakeups[i].action == QC_OMX_SESSION_RESUME)
+    {
+      if ((int)(s->queue_ticket - last_started) < 0)
+        order_errors++;
+      last_started = s->queue_ticket;
+      pthread_mutex_lock(&s->lock);
+      s->started = 1;
+      pthread_cond_signal(&s->cond);
+      pthread_mutex_unlock(&s->lock);
+    }
+    qc_omx_session_unpin(wakeups[i].hComp);
+  }
+}
+
+static void *client(void *arg)
+{
+  struct sim_session *s = (struct sim_session *)arg;
+  qc_omx_session_wakeup wakeups[QC_OMX_SESSION_MAX];
+  unsigned seed = (unsigned)(s - sim) * 7919 + 1;
+  int n, rc, was_queued, abandon;
+
+  for (n = 0; n < sessions_per_thread; n++)
+  {
+    const struct sim_format *f = &formats[rand_r(&seed) % (sizeof(formats) / sizeof(formats[0]))];
+    OMX_PARAM_PORTDEFINITIONTYPE port;
+    long long wait_start;
+
+    s->freed = 0;
+    s->nudged = 0;
+    abandon = !(rand_r(&seed) % 8);
+    qc_omx_session_open((OMX_HANDLETYPE)s, "OMX.sim.video.decoder");
+    memset(&port, 0, sizeof(port));
+    port.nPortIndex = 0;
+    port.eDomain = OMX_PortDomainVideo;
+    port.format.video.nFrameWidth = f->width;
+    port.format.video.nFrameHeight = f->height;
+    port.format.video.xFramerate = f->fps << 16;
+    qc_omx_session_set_port((OMX_HANDLETYPE)s, &port);
+
+    s->started = 0;
+    wait_start = now_us();
+    pthread_mutex_lock(&sim_lock);
+    rc = qc_omx_session_admit((OMX_HANDLETYPE)s);
+    if (rc == QC_OMX_SESSION_QUEUED)
+      s->queue_ticket = queue_tickets++;
+    pthread_mutex_unlock(&sim_lock);
+    if (rc == QC_OMX_SESSION_QUEUED)
+    {
+      pthread_mutex_lock(&s->lock);
+      while (!s->started && !(abandon && s->nudged))
+        pthread_cond_wait(&s->cond, &s->lock);
+      abandon = !s->started;
+      pthread_mutex_unlock(&s->lock);
+      if (!abandon)
+      {
+        pthread_mutex_lock(&sim_lock);
+        if (now_us() - wait_start > max_wait_us)
+          max_wait_us = now_us() - wait_start;
+        pthread_mutex_unlock(&sim_lock);
+      }
+    }
+    else
+      abandon = 0;
+
+    if (rc != QC_OMX_SESSION_REJECTED && !abandon)
+    {
+      check_load("admit");
+      usleep(200 + rand_r(&seed) % 800);
+      pthread_mutex_lock(&sim_lock);
+      run_cnt++;
+      rc = qc_omx_session_release((OMX_HANDLETYPE)s, &was_queued, wakeups,
+                                  QC_OMX_SESSION_MAX);
+      if (was_queued)
+      {
+        printf("FAIL: started session still queued\n");
+        fail_cnt++;
+      }
+      wake(wakeups, rc);
+      pthread_mutex_unlock(&sim_lock);
+    }
+    // OMX_FreeHandle: detach, destroy the component, then close
+    qc_omx_session_detach((OMX_HANDLETYPE)s);
+    s->freed = 1;
+    pthread_mutex_lock(&sim_lock);
+    abandon_cnt += abandon;
+    rc = qc_omx_session_close((OMX_HANDLETYPE)s, wakeups, QC_OMX_SESSION_MAX);
+    wake(wakeups, rc);
+    pthread_mutex_unlock(&sim_lock);
+    check_load("close");
+    usleep(rand_r(&seed) % 300);
+  }
+  return NULL;
+}
+
+static int run(QOMX_ADMISSIONPOLICYTYPE policy, int threads)
+{
+  static const char *names[] = { "reject", "queue", "lowpri" };
+  pthread_t tid[MAX_THREADS];
+  QOMX_CORELOADTYPE before, load;
+  long long start;
+  int i;
+
+  queue_tickets = last_started = 0;
+  abandon_cnt = freed_wakeups = 0;
+  load_sum = load_samples = 0;
+  peak_load = run_cnt = order_errors = 0;
+  max_wait_us = 0;
+  QOMX_SetCoreCapacity(CAPACITY, policy);
+  QOMX_GetCoreLoad(&before, NULL, NULL);
+
+  start = now_us();
+  for (i = 0; i < threads; i++)
+    pthread_create(&tid[i], NULL, client, &sim[i]);
+  for (i = 0; i < threads; i++)
+    pthread_join(tid[i], NULL);
+
+  QOMX_GetCoreLoad(&load, NULL, NULL);
+  if (load.nSessions || load.nActiveLoad || load.nLowPriorityLoad ||
+      load.nQueuedLoad)
+  {
+    printf("FAIL: %lu sessions, load %lu/%lu/%lu left after the run\n",
+           load.nSessions, load.nActiveLoad, load.nLowPriorityLoad,
+           load.nQueuedLoad);
+    fail_cnt++;
+  }
+  if (order_errors)
+  {
+    printf("FAIL: %u queued sessions started out of order\n", order_errors);
+    fail_cnt++;
+  }
+  if (freed_wakeups)
+  {
+    printf("FAIL: %u wakeups for sessions being freed\n", freed_wakeups);
+    fail_cnt++;
+  }
+  printf("%-6s: %u sessions run in %.2f s, rejected %lu, queued %lu "
+         "(%u given up, max wait %lld us), low priority %lu, mean admitted "
+         "load %.0f%%, peak %.0f%% of capacity\n", names[policy], run_cnt,
+         (now_us() - start) / 1e6, load.nRejected - before.nRejected,
+         load.nQueued - before.nQueued, abandon_cnt, max_wait_us,
+         load.nLowPriority - before.nLowPriority, load_samples ? 100.0 * load_sum / load_samples / CAPACITY : 0,
+         100.0 * peak_load / CAPACITY);
+  return fail_cnt;
+}
+
+int main(int argc, char **argv)
+{
+  int threads = argc > 1 ? atoi(argv[1]) : 16;
+  int i;
+
+  sessions_per_thread = argc > 2 ? atoi(argv[2]) : 200;
+  if (threads < 1 || threads > MAX_THREADS)
+  {
+    printf("threads must be between 1 and %d\n", MAX_THREADS);
+    return 1;
+  }
+  for (i = 0; i < threads; i++)
+  {
+    pthread_mutex_init(&sim[i].lock, NULL);
+    pthread_cond_init(&sim[i].cond, NULL);
+  }
+
+  run(QOMX_AdmissionReject, threads);
+  run(QOMX_AdmissionQueue, threads);
+  run(QOMX_AdmissionLowPriority, threads);
+  printf(fail_cnt ? "FAILED\n" : "PASSED\n");
+  return fail_cnt ? 1 : 0;
+}
@@ -34,6 +34,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string.h>
 #include <stdlib.h>
 #include "OMX_QCOMExtns.h"
+#include "h264_bitreader.h"
 #include<linux/msm_vidc_dec.h>
 #include<linux/msm_vidc_enc.h>
 
@@ -95,8 +96,7 @@ private:
   OMX_U32 byte_ptr;
   OMX_U32 pack_sei;
   OMX_U32 sei_payload_type;
-  OMX_U32 d_u(OMX_U32 num_bits);
-  OMX_U32 d_ue();
+  h264_bitreader bits;
   OMX_U32 parse_frame_pack(OMX_U32 payload_size);
   OMX_S32 parse_rbsp(OMX_U8 *buf, OMX_U32 len);
   OMX_S32 parse_sei(OMX_U8 *buffer, OMX_U32 buffer_length);
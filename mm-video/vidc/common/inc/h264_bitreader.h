@@ -0,0 +1,268 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2010-2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+
+#ifndef __H264_BITREADER_H__
+#define __H264_BITREADER_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * MSB-first bit reader over an H.264 NAL payload, shared by the stream,
+ * frame-boundary and extradata parsers.
+ *
+ * init() removes the emulation prevention bytes (00 00 03) in a single
+ * pass into a buffer owned by the reader, or reads an already extracted
+ * RBSP in place. Bits are served from a 64-bit cache that is refilled a
+ * word at a time, and ue()/se() find the Exp-Golomb prefix with a count
+ * of leading zeros instead of reading it bit by bit. Reads past the end
+ * of the payload return zero bits.
+ */
+class h264_bitreader
+{
+public:
+  h264_bitreader():
+    data(NULL), size(0), next(0), cache(0), cache_bits(0),
+    epb_skipped(0), buf(NULL), buf_size(0)
+  {
+  }
+
+  ~h264_bitreader()
+  {
+    free(buf);
+  }
+
+  /* Returns false when the stripped copy could not be allocated, in which
+   * case the reader is left empty. */
+  bool init(const uint8_t *src, uint32_t len, bool strip_epb = true)
+  {
+    data = src;
+    size = src ? len : 0;
+    epb_skipped = 0;
+    if (strip_epb && size) {
+      if (buf_size < size) {
+        uint8_t *tmp = (uint8_t *)realloc(buf, size);
+        if (!tmp) {
+          data = NULL;
+          size = 0;
+          rewind(0);
+          return false;
+        }
+        buf = tmp;
+        buf_size = size;
+      }
+      size = strip(src, size, buf, &epb_skipped);
+      data = buf;
+    }
+    rewind(0);
+    return true;
+  }
+
+  /* Reads of more than 32 bits return zero and consume nothing, as
+   * h264_stream_parser::extract_bits does; the cache only guarantees 56
+   * bits after a refill. */
+  uint32_t u(uint32_t n)
+  {
+    uint32_t value;
+    if (!n || n > 32)
+      return 0;
+    if (cache_bits < n)
+      refill();
+    value = (uint32_t)(cache >> (64 - n));
+    consume(n);
+    return value;
+  }
+
+  uint32_t ue()
+  {
+    uint32_t lead_zeros, len;
+    if (cache_bits < 32)
+      refill();
+    lead_zeros = cache ? (uint32_t)__builtin_clzll(cache) : 64;
+    len = 2 * lead_zeros + 1;
+    if (len <= cache_bits) {
+      uint32_t code = (uint32_t)(cache >> (64 - len)) - 1;
+      consume(len);
+      return code;
+    }
+    if (lead_zeros < 32) {
+      consume(lead_zeros);
+      return u(lead_zeros + 1) - 1;
+    }
+    // no stop bit within 32 bits: not a valid code, give up on the payload
+    rewind(size << 3);
+    return 0;
+  }
+
+  int32_t se()
+  {
+    uint32_t code = ue();
+    if (code & 1)
+      return (int32_t)((code >> 1) + 1);
+    return -(int32_t)(code >> 1);
+  }
+
+  void skip(uint32_t n)
+  {
+    rewind(bit_pos() + n);
+  }
+
+  /* Bit offset into the RBSP, i.e. after emulation prevention removal */
+  uint32_t bit_pos() const
+  {
+    return (next << 3) - cache_bits;
+  }
+
+  void seek(uint32_t pos)
+  {
+    rewind(pos);
+  }
+
+  bool more_bits() const
+  {
+    return bit_pos() < (size << 3);
+  }
+
+  uint32_t bits_left() const
+  {
+    uint32_t pos = bit_pos();
+    return pos < (size << 3) ? (size << 3) - pos : 0;
+  }
+
+  bool byte_aligned() const
+  {
+    return !(cache_bits & 7);
+  }
+
+  uint32_t bits_to_align() const
+  {
+    return cache_bits & 7;
+  }
+
+  uint32_t rbsp_size() const
+  {
+    return size;
+  }
+
+  uint32_t epb_count() const
+  {
+    return epb_skipped;
+  }
+
+  /* Copy src to dst without emulation prevention bytes; dst may not
+   * overlap src. Returns the number of bytes written. */
+  static uint32_t strip(const uint8_t *src, uint32_t len, uint8_t *dst,
+      uint32_t *skipped)
+  {
+    uint32_t i = 0, copied = 0, out = 0, count = 0;
+    while (i + 2 < len) {
+      // none of the three windows ending in src[i+2] can be 00 00 03
+      if (src[i + 2] > 3) {
+        i += 3;
+      } else if (!src[i] && !src[i + 1] && src[i + 2] == 3) {
+        memcpy(dst + out, src + copied, i + 2 - copied);
+        out += i + 2 - copied;
+        copied = i + 3;
+        count++;
+        i += 3;
+      } else {
+        i++;
+      }
+    }
+    memcpy(dst + out, src + copied, len - copied);
+    out += len - copied;
+    if (skipped)
+      *skipped = count;
+    return out;
+  }
+
+private:
+  h264_bitreader(const h264_bitreader &);
+  h264_bitreader &operator=(const h264_bitreader &);
+
+  static uint64_t load_be64(const uint8_t *p)
+  {
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    return w;
+  }
+
+  /* Top up the cache to at least 56 valid bits */
+  void refill()
+  {
+    uint32_t bytes = (63 - cache_bits) >> 3;
+    uint64_t w;
+    if (next + 8 <= size) {
+      w = load_be64(data + next);
+    } else {
+      w = 0;
+      for (uint32_t i = 0; i < 8; i++) {
+        w <<= 8;
+        if (next + i < size)
+          w |= data[next + i];
+      }
+    }
+    cache |= w >> cache_bits;
+    next += bytes;
+    cache_bits += bytes << 3;
+  }
+
+  void consume(uint32_t n)
+  {
+    cache = (n < 64) ? cache << n : 0;
+    cache_bits -= n;
+  }
+
+  void rewind(uint32_t pos)
+  {
+    if (pos > (size << 3))
+      pos = size << 3;
+    next = pos >> 3;
+    cache = 0;
+    cache_bits = 0;
+    if (pos & 7) {
+      refill();
+      consume(pos & 7);
+    }
+  }
+
+  const uint8_t *data;
+  uint32_t size;          // RBSP bytes
+  uint32_t next;          // first byte not yet loaded into the cache
+  uint64_t cache;         // unread bits, MSB first
+  uint32_t cache_bits;
+  uint32_t epb_skipped;
+  uint8_t *buf;           // stripped copy of the last payload
+  uint32_t buf_size;
+};
+
+#endif // __H264_BITREADER_H__
@@ -41,6 +41,8 @@ public:
     bool convert(int src_fd, void *src_viraddr,
                  int dest_fd,void *dest_viraddr);
     bool get_buffer_size(int port,unsigned int &buf_size);
+    bool set_crop(unsigned int left, unsigned int top,
+                  unsigned int width, unsigned int height);
     int get_src_format();
     void close();
 private:
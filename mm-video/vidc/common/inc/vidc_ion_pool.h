@@ -0,0 +1,133 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+
+#ifndef __VIDC_ION_POOL_H__
+#define __VIDC_ION_POOL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <linux/msm_ion.h>
+
+#define VIDC_ION_POOL_MAX_ENTRIES 64
+#define VIDC_ION_POOL_CLASSES     80   // 4 classes per power of two, 4K..4G
+#define VIDC_ION_POOL_MAX_WASTE   4    // a hit is at most 4x the request
+
+struct vidc_ion_pool_stats
+{
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t parked;            // buffers retained by give()
+    uint32_t rejected;          // give() calls that were freed instead
+    uint32_t evicted;
+    uint32_t retained;
+    uint64_t retained_bytes;
+    uint64_t cap_bytes;
+    uint32_t reconfigs;
+    uint32_t reconfig_avg_us;
+    uint32_t reconfig_max_us;
+};
+
+/* Process wide pool of mapped ION buffers, used by omx_vdec and
+ * omx_video. free_ion_memory parks non-secure buffers here instead of
+ * returning them to ION, and alloc_map_ion_memory hands a parked buffer
+ * back when one with the same owner, ion client, heap mask and flags is
+ * at least as large and as aligned as the request (and no more than
+ * VIDC_ION_POOL_MAX_WASTE times larger). A port reconfiguration to a
+ * resolution seen before then costs no ION alloc/map at all.
+ *
+ * A parked buffer still holds what its last user wrote to it, so it is
+ * only handed back to the component instance that parked it, never to
+ * another session. Each instance drains its buffers when it is destroyed,
+ * before the ion client fd they were allocated from can be closed.
+ *
+ * Parked buffers are kept in size classes, best fit first, and the least
+ * recently parked buffer is freed when the pool would exceed its cap
+ * (vidc.ion.pool.size, in MB). The pool is off unless the cap is set.
+ */
+class vidc_ion_pool
+{
+public:
+    static vidc_ion_pool *get();
+
+    /* alloc_data carries len, align, heap_mask and flags of the request.
+     * On a hit, the handle and actual len are written to alloc_data and
+     * the handle and shared fd to fd_data. */
+    bool take(const void *owner, int dev_fd,
+            struct ion_allocation_data *alloc_data,
+            struct ion_fd_data *fd_data);
+    /* Returns false if the buffer was not retained; the caller frees it */
+    bool give(const void *owner, int dev_fd,
+            const struct ion_allocation_data *alloc_data,
+            const struct ion_fd_data *fd_data);
+    /* Frees the buffers parked by owner */
+    void drain(const void *owner);
+
+    void record_reconfig(uint32_t us);
+    void get_stats(struct vidc_ion_pool_stats *stats);
+    void log_stats(const char *tag);
+
+    static uint64_t now_us();
+
+private:
+    struct entry {
+        const void *owner;      // instance that parked the buffer
+        int dev_fd;             // -1 when unused
+        int fd;
+        struct ion_handle *handle;
+        size_t len;
+        size_t align;
+        unsigned int heap_mask;
+        unsigned int flags;
+        uint64_t stamp;
+        int prev;
+        int next;
+    };
+
+    vidc_ion_pool();
+    vidc_ion_pool(const vidc_ion_pool &);
+    vidc_ion_pool &operator=(const vidc_ion_pool &);
+
+    static void create();
+    static int size_class(size_t len);
+    static void release(const struct entry *e);
+
+    void link(int index);
+    void unlink(int index);
+    int evict_lru(struct entry *victim);
+
+    pthread_mutex_t lock;
+    struct entry entries[VIDC_ION_POOL_MAX_ENTRIES];
+    int heads[VIDC_ION_POOL_CLASSES];
+    uint64_t cap;
+    uint64_t stamp;
+    struct vidc_ion_pool_stats stats;
+    uint64_t reconfig_total_us;
+};
+
+#endif // __VIDC_ION_POOL_H__
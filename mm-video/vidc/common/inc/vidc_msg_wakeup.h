@@ -0,0 +1,79 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+#ifndef __VIDC_MSG_WAKEUP_H__
+#define __VIDC_MSG_WAKEUP_H__
+
+#include <stdint.h>
+
+/* Coalesces message thread wakeups. post_event still queues every event
+ * under the component lock, but only the first event of a burst writes to
+ * the message pipe; the rest ride on that wakeup since process_event_cb
+ * drains all queues before returning.
+ *
+ * Producer: queue the event, then write to the pipe only if signal()
+ * returns true. Consumer: call rearm() after reading from the pipe and
+ * before draining the queues, so an event queued after the drain started
+ * always produces a new wakeup.
+ */
+class vidc_msg_wakeup
+{
+public:
+    vidc_msg_wakeup(): pending(0), signalled(0), coalesced(0) {}
+
+    bool signal()
+    {
+        if (__sync_bool_compare_and_swap(&pending, 0, 1)) {
+            __sync_fetch_and_add(&signalled, 1);
+            return true;
+        }
+        __sync_fetch_and_add(&coalesced, 1);
+        return false;
+    }
+
+    void rearm()
+    {
+        __sync_lock_release(&pending);
+        __sync_synchronize();
+    }
+
+    void reset()
+    {
+        rearm();
+        signalled = coalesced = 0;
+    }
+
+    uint32_t get_signalled() { return signalled; }
+    uint32_t get_coalesced() { return coalesced; }
+
+private:
+    volatile int32_t pending;
+    volatile uint32_t signalled;
+    volatile uint32_t coalesced;
+};
+
+#endif // __VIDC_MSG_WAKEUP_H__
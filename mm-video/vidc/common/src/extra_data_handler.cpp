@@ -45,92 +45,45 @@ extra_data_handler::~extra_data_handler()
   }
 }
 
-OMX_U32 extra_data_handler::d_u(OMX_U32 num_bits)
-{
-  OMX_U32 rem_bits = num_bits, bins = 0, shift = 0;
-
-  while(rem_bits >= bit_ptr) {
-    DEBUG_PRINT_LOW("\nIn %s() bit_ptr/byte_ptr :%d/%d/%x", __func__, bit_ptr,
-      byte_ptr, rbsp_buf[byte_ptr]);
-    bins <<= shift;
-    shift = (8-bit_ptr);
-    bins |= ((rbsp_buf[byte_ptr] << shift) & 0xFF) >> shift;
-    rem_bits -= bit_ptr;
-    bit_ptr = 8;
-    byte_ptr ++;
-  }
-  DEBUG_PRINT_LOW("\nIn %s() bit_ptr/byte_ptr :%d/%d/%x", __func__, bit_ptr,
-    byte_ptr, rbsp_buf[byte_ptr]);
-
-  if (rem_bits) {
-    bins <<= rem_bits;
-    bins |= ((rbsp_buf[byte_ptr] << (8-bit_ptr)) & 0xFF) >> (8-rem_bits);
-    bit_ptr -= rem_bits;
-	if (bit_ptr == 0) {
-       bit_ptr = 8;
-	   byte_ptr++;
-	}
-  }
-  DEBUG_PRINT_LOW("\nIn %s() bit_ptr/byte_ptr :%d/%d/%x", __func__, bit_ptr,
-    byte_ptr, rbsp_buf[byte_ptr]);
-
-  DEBUG_PRINT_LOW("\nIn %s() bin/num_bits : %x/%d", __func__, bins, num_bits);
-  return bins;
-}
-
-OMX_U32 extra_data_handler::d_ue()
-{
-    OMX_S32 lead_zeros = -1;
-    OMX_U32 symbol, bit;
-    do{
-        bit = d_u(1);
-        lead_zeros++;
-    }while (!bit);
-
-    symbol = ((1 << lead_zeros) - 1) + d_u(lead_zeros);
-
-    DEBUG_PRINT_LOW("\nIn %s() symbol : %d", __func__,symbol);
-    return symbol;
-}
-
 OMX_U32 extra_data_handler::parse_frame_pack(OMX_U32 payload_size)
 {
-  frame_packing_arrangement.id = d_ue();
-  frame_packing_arrangement.cancel_flag = d_u(1);
+  frame_packing_arrangement.id = bits.ue();
+  frame_packing_arrangement.cancel_flag = bits.u(1);
   if(!frame_packing_arrangement.cancel_flag) {
-     frame_packing_arrangement.type = d_u(7);
-     frame_packing_arrangement.quincunx_sampling_flag = d_u(1);
-     frame_packing_arrangement.content_interpretation_type = d_u(6);
-     frame_packing_arrangement.spatial_flipping_flag = d_u(1);
-     frame_packing_arrangement.frame0_flipped_flag = d_u(1);
-     frame_packing_arrangement.field_views_flag = d_u(1);
-     frame_packing_arrangement.current_frame_is_frame0_flag = d_u(1);
-     frame_packing_arrangement.frame0_self_contained_flag = d_u(1);
-     frame_packing_arrangement.frame1_self_contained_flag = d_u(1);
+     frame_packing_arrangement.type = bits.u(7);
+     frame_packing_arrangement.quincunx_sampling_flag = bits.u(1);
+     frame_packing_arrangement.content_interpretation_type = bits.u(6);
+     frame_packing_arrangement.spatial_flipping_flag = bits.u(1);
+     frame_packing_arrangement.frame0_flipped_flag = bits.u(1);
+     frame_packing_arrangement.field_views_flag = bits.u(1);
+     frame_packing_arrangement.current_frame_is_frame0_flag = bits.u(1);
+     frame_packing_arrangement.frame0_self_contained_flag = bits.u(1);
+     frame_packing_arrangement.frame1_self_contained_flag = bits.u(1);
 
      if(!frame_packing_arrangement.quincunx_sampling_flag &&
         frame_packing_arrangement.type != 5) {
-        frame_packing_arrangement.frame0_grid_position_x = d_u(4);
-        frame_packing_arrangement.frame0_grid_position_y = d_u(4);
-        frame_packing_arrangement.frame1_grid_position_x = d_u(4);
-        frame_packing_arrangement.frame1_grid_position_y = d_u(4);
+        frame_packing_arrangement.frame0_grid_position_x = bits.u(4);
+        frame_packing_arrangement.frame0_grid_position_y = bits.u(4);
+        frame_packing_arrangement.frame1_grid_position_x = bits.u(4);
+        frame_packing_arrangement.frame1_grid_position_y = bits.u(4);
      }
-     frame_packing_arrangement.reserved_byte = d_u(8);
-     frame_packing_arrangement.repetition_period = d_ue();
+     frame_packing_arrangement.reserved_byte = bits.u(8);
+     frame_packing_arrangement.repetition_period = bits.ue();
    }
-   frame_packing_arrangement.extension_flag = d_u(1);
+   frame_packing_arrangement.extension_flag = bits.u(1);
 
    return 1;
 }
 
 OMX_S32 extra_data_handler::parse_rbsp(OMX_U8 *buf, OMX_U32 len)
 {
-   OMX_U32 i = 3, j=0, startcode;
+   OMX_U32 i = 3, startcode;
    OMX_U32 nal_unit_type, nal_ref_idc, forbidden_zero_bit;
 
-   bit_ptr  = 8;
-   byte_ptr = 0;
-
+   if (len < 5) {
+       DEBUG_PRINT_ERROR("\nERROR: In %s() NAL too short", __func__);
+       return -1;
+   }
    startcode =  buf[0] << 16 | buf[1] <<8 | buf[2];
 
    if (!startcode) {
@@ -150,21 +103,16 @@ OMX_S32 extra_data_handler::parse_rbsp(OMX_U8 *buf, OMX_U32 len)
 
    nal_unit_type = (buf[i++] & 0x1F);
 
-   while(i<len) {
-     if(!(buf[i] + buf[i+1]) && (buf[i+2] == H264_EMULATION_BYTE) &&
-		(i+2 < len)) {
-        rbsp_buf[j++] = buf[i++];
-        rbsp_buf[j++] = buf[i++];
-        i++;
-     } else
-        rbsp_buf[j++] = buf[i++];
+   if (!bits.init(buf + i, len - i)) {
+       DEBUG_PRINT_ERROR("\nERROR: In %s() no memory for RBSP", __func__);
+       return -1;
    }
    return nal_unit_type;
 }
 OMX_S32 extra_data_handler::parse_sei(OMX_U8 *buffer, OMX_U32 buffer_length)
 {
   OMX_U32 nal_unit_type, payload_type = 0, payload_size = 0;
-  OMX_U32 marker = 0, pad = 0xFF;
+  OMX_U32 marker = 0, pad = 0xFF, value;
 
   nal_unit_type = parse_rbsp(buffer, buffer_length);
 
@@ -173,15 +121,17 @@ OMX_S32 extra_data_handler::parse_sei(OMX_U8 *buffer, OMX_U32 buffer_length)
      return -1;
   } else {
 
-    while(rbsp_buf[byte_ptr] == 0xFF)
-      payload_type += rbsp_buf[byte_ptr++];
-    payload_type += rbsp_buf[byte_ptr++];
+    do {
+      value = bits.u(8);
+      payload_type += value;
+    } while(value == 0xFF && bits.more_bits());
 
     DEBUG_PRINT_LOW("\nIn %s() payload_type : %u", __func__, payload_type);
 
-    while(rbsp_buf[byte_ptr] == 0xFF)
-      payload_size += rbsp_buf[byte_ptr++];
-    payload_size += rbsp_buf[byte_ptr++];
+    do {
+      value = bits.u(8);
+      payload_size += value;
+    } while(value == 0xFF && bits.more_bits());
 
     DEBUG_PRINT_LOW("\nIn %s() payload_size : %u", __func__, payload_size);
 
@@ -195,11 +145,11 @@ OMX_S32 extra_data_handler::parse_sei(OMX_U8 *buffer, OMX_U32 buffer_length)
       break;
     }
   }
-  if(bit_ptr != 8) {
-    marker = d_u(1);
+  if(!bits.byte_aligned()) {
+    marker = bits.u(1);
     if(marker) {
-      if(bit_ptr != 8) {
-	 pad = d_u(bit_ptr);
+      if(!bits.byte_aligned()) {
+	 pad = bits.u(bits.bits_to_align());
 	 if(pad) {
 	   DEBUG_PRINT_ERROR("\nERROR: In %s() padding Bits Error in SEI",
 	     __func__);
@@ -213,7 +163,7 @@ OMX_S32 extra_data_handler::parse_sei(OMX_U8 *buffer, OMX_U32 buffer_length)
     }
   }
   DEBUG_PRINT_LOW("\nIn %s() payload_size : %u/%u", __func__,
-    payload_size, byte_ptr);
+    payload_size, bits.bit_pos() >> 3);
   return 1;
 }
 /*======================================================================
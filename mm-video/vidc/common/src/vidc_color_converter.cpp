@@ -151,3 +151,10 @@ bool omx_c2d_conv::get_buffer_size(int port,unsigned int &buf_size)
   }
   return ret;
 }
+bool omx_c2d_conv::set_crop(unsigned int left, unsigned int top,
+     unsigned int width, unsigned int height)
+{
+  if(!c2dcc)
+    return false;
+  return (c2dcc->setCropRect(left,top,width,height) < 0)?false:true;
+}
@@ -0,0 +1,295 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <utils/Log.h>
+#ifdef _ANDROID_
+#include <cutils/properties.h>
+#endif
+#include "vidc_ion_pool.h"
+#undef DEBUG_PRINT_LOW
+#undef DEBUG_PRINT_HIGH
+#undef DEBUG_PRINT_ERROR
+
+#define DEBUG_PRINT_LOW ALOGV
+#define DEBUG_PRINT_HIGH ALOGE
+#define DEBUG_PRINT_ERROR ALOGE
+
+/* Cap in MB when vidc.ion.pool.size is not set, 0 turns the pool off */
+#ifndef VIDC_ION_POOL_DEFAULT_MB
+#define VIDC_ION_POOL_DEFAULT_MB "0"
+#endif
+
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+static vidc_ion_pool *pool_instance;
+
+vidc_ion_pool *vidc_ion_pool::get()
+{
+  pthread_once(&pool_once, create);
+  return pool_instance;
+}
+
+void vidc_ion_pool::create()
+{
+  pool_instance = new vidc_ion_pool();
+}
+
+vidc_ion_pool::vidc_ion_pool():
+  cap(0), stamp(0), reconfig_total_us(0)
+{
+  unsigned long mb = strtoul(VIDC_ION_POOL_DEFAULT_MB, NULL, 10);
+#ifdef _ANDROID_
+  char value[PROPERTY_VALUE_MAX] = {0};
+  property_get("vidc.ion.pool.size", value, VIDC_ION_POOL_DEFAULT_MB);
+  mb = strtoul(value, NULL, 10);
+#endif
+  cap = (uint64_t)mb << 20;
+  pthread_mutex_init(&lock, NULL);
+  memset(&stats, 0, sizeof(stats));
+  stats.cap_bytes = cap;
+  for (int i = 0; i < VIDC_ION_POOL_MAX_ENTRIES; i++)
+    entries[i].dev_fd = -1;
+  for (int i = 0; i < VIDC_ION_POOL_CLASSES; i++)
+    heads[i] = -1;
+  DEBUG_PRINT_HIGH("vidc_ion_pool: cap %lu MB", mb);
+}
+
+uint64_t vidc_ion_pool::now_us()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int vidc_ion_pool::size_class(size_t len)
+{
+  uint64_t v = len < 4096 ? 4096 : len;
+  int order = 63 - __builtin_clzll(v);
+  int cls = (order - 12) * 4 + (int)((v >> (order - 2)) & 3);
+  return cls < VIDC_ION_POOL_CLASSES ? cls : VIDC_ION_POOL_CLASSES - 1;
+}
+
+void vidc_ion_pool::release(const struct entry *e)
+{
+  struct ion_handle_data handle_data;
+  if (close(e->fd)) {
+    DEBUG_PRINT_ERROR("vidc_ion_pool: close(%d) failed, errno = %d",
+        e->fd, errno);
+  }
+  handle_data.handle = e->handle;
+  if (ioctl(e->dev_fd, ION_IOC_FREE, &handle_data)) {
+    DEBUG_PRINT_ERROR("vidc_ion_pool: free failed, dev_fd = %d, "
+        "handle = %p, errno = %d", e->dev_fd, e->handle, errno);
+  }
+}
+
+void vidc_ion_pool::link(int index)
+{
+  struct entry *e = &entries[index];
+  int cls = size_class(e->len);
+  e->prev = -1;
+  e->next = heads[cls];
+  if (heads[cls] >= 0)
+    entries[heads[cls]].prev = index;
+  heads[cls] = index;
+  stats.retained++;
+  stats.retained_bytes += e->len;
+}
+
+void vidc_ion_pool::unlink(int index)
+{
+  struct entry *e = &entries[index];
+  if (e->prev >= 0)
+    entries[e->prev].next = e->next;
+  else
+    heads[size_class(e->len)] = e->next;
+  if (e->next >= 0)
+    entries[e->next].prev = e->prev;
+  e->dev_fd = -1;
+  stats.retained--;
+  stats.retained_bytes -= e->len;
+}
+
+/* Removes the least recently parked entry and copies it to victim for
+ * the caller to release outside the lock */
+int vidc_ion_pool::evict_lru(struct entry *victim)
+{
+  int oldest = -1;
+  for (int i = 0; i < VIDC_ION_POOL_MAX_ENTRIES; i++) {
+    if (entries[i].dev_fd >= 0 &&
+        (oldest < 0 || entries[i].stamp < entries[oldest].stamp))
+      oldest = i;
+  }
+  if (oldest >= 0) {
+    *victim = entries[oldest];
+    unlink(oldest);
+    stats.evicted++;
+  }
+  return oldest;
+}
+
+bool vidc_ion_pool::take(const void *owner, int dev_fd,
+    struct ion_allocation_data *alloc_data, struct ion_fd_data *fd_data)
+{
+  size_t want, limit;
+  int best = -1, last;
+  if (!cap || dev_fd <= 0 || !alloc_data || !fd_data || !alloc_data->len)
+    return false;
+  want = alloc_data->len;
+  limit = want <= (size_t)-1 / VIDC_ION_POOL_MAX_WASTE ?
+      want * VIDC_ION_POOL_MAX_WASTE : (size_t)-1;
+  last = size_class(limit);
+
+  pthread_mutex_lock(&lock);
+  for (int cls = size_class(want); cls <= last && best < 0; cls++) {
+    for (int i = heads[cls]; i >= 0; i = entries[i].next) {
+      const struct entry *e = &entries[i];
+      if (e->owner != owner || e->dev_fd != dev_fd ||
+          e->heap_mask != alloc_data->heap_mask ||
+          e->flags != alloc_data->flags || e->align < alloc_data->align ||
+          e->len < want || e->len > limit)
+        continue;
+      if (best < 0 || e->len < entries[best].len)
+        best = i;
+    }
+  }
+  if (best < 0) {
+    stats.misses++;
+    pthread_mutex_unlock(&lock);
+    return false;
+  }
+  alloc_data->len = entries[best].len;
+  alloc_data->align = entries[best].align;
+  alloc_data->handle = entries[best].handle;
+  fd_data->handle = entries[best].handle;
+  fd_data->fd = entries[best].fd;
+  unlink(best);
+  stats.hits++;
+  pthread_mutex_unlock(&lock);
+  DEBUG_PRINT_LOW("vidc_ion_pool: hit, len %u for %u, fd %d",
+      (unsigned)alloc_data->len, (unsigned)want, fd_data->fd);
+  return true;
+}
+
+bool vidc_ion_pool::give(const void *owner, int dev_fd,
+    const struct ion_allocation_data *alloc_data,
+    const struct ion_fd_data *fd_data)
+{
+  struct entry victims[VIDC_ION_POOL_MAX_ENTRIES];
+  int count = 0, slot = -1;
+  if (!cap || dev_fd <= 0 || !alloc_data || !fd_data ||
+      !alloc_data->handle || fd_data->fd < 0 || !alloc_data->len)
+    return false;
+
+  pthread_mutex_lock(&lock);
+  if (alloc_data->len > cap) {
+    stats.rejected++;
+    pthread_mutex_unlock(&lock);
+    return false;
+  }
+  while (stats.retained_bytes + alloc_data->len > cap ||
+      stats.retained == VIDC_ION_POOL_MAX_ENTRIES) {
+    if (evict_lru(&victims[count]) < 0)
+      break;
+    count++;
+  }
+  for (int i = 0; i < VIDC_ION_POOL_MAX_ENTRIES && slot < 0; i++) {
+    if (entries[i].dev_fd < 0)
+      slot = i;
+  }
+  struct entry *e = &entries[slot];
+  e->owner = owner;
+  e->dev_fd = dev_fd;
+  e->fd = fd_data->fd;
+  e->handle = alloc_data->handle;
+  e->len = alloc_data->len;
+  e->align = alloc_data->align;
+  e->heap_mask = alloc_data->heap_mask;
+  e->flags = alloc_data->flags;
+  e->stamp = ++stamp;
+  link(slot);
+  stats.parked++;
+  pthread_mutex_unlock(&lock);
+
+  for (int i = 0; i < count; i++)
+    release(&victims[i]);
+  return true;
+}
+
+void vidc_ion_pool::drain(const void *owner)
+{
+  struct entry victims[VIDC_ION_POOL_MAX_ENTRIES];
+  int count = 0;
+  pthread_mutex_lock(&lock);
+  for (int i = 0; i < VIDC_ION_POOL_MAX_ENTRIES; i++) {
+    if (entries[i].dev_fd >= 0 && entries[i].owner == owner) {
+      victims[count++] = entries[i];
+      unlink(i);
+    }
+  }
+  pthread_mutex_unlock(&lock);
+  for (int i = 0; i < count; i++)
+    release(&victims[i]);
+  if (count)
+    DEBUG_PRINT_HIGH("vidc_ion_pool: drained %d buffers of %p",
+        count, owner);
+}
+
+void vidc_ion_pool::record_reconfig(uint32_t us)
+{
+  pthread_mutex_lock(&lock);
+  stats.reconfigs++;
+  reconfig_total_us += us;
+  stats.reconfig_avg_us = (uint32_t)(reconfig_total_us / stats.reconfigs);
+  if (us > stats.reconfig_max_us)
+    stats.reconfig_max_us = us;
+  pthread_mutex_unlock(&lock);
+}
+
+void vidc_ion_pool::get_stats(struct vidc_ion_pool_stats *out)
+{
+  pthread_mutex_lock(&lock);
+  *out = stats;
+  pthread_mutex_unlock(&lock);
+}
+
+void vidc_ion_pool::log_stats(const char *tag)
+{
+  struct vidc_ion_pool_stats s;
+  get_stats(&s);
+  DEBUG_PRINT_HIGH("%s: ion pool hits %u misses %u, retained %u buffers "
+      "%llu KB of %llu KB, parked %u rejected %u evicted %u, "
+      "reconfigs %u avg %u us max %u us", tag, s.hits, s.misses,
+      s.retained, (unsigned long long)(s.retained_bytes >> 10),
+      (unsigned long long)(s.cap_bytes >> 10), s.parked, s.rejected,
+      s.evicted, s.reconfigs, s.reconfig_avg_us, s.reconfig_max_us);
+}
@@ -90,6 +90,7 @@ LOCAL_SRC_FILES         += src/mp4_utils.cpp
 LOCAL_SRC_FILES         += src/omx_vdec.cpp
 LOCAL_SRC_FILES         += ../common/src/extra_data_handler.cpp
 LOCAL_SRC_FILES         += ../common/src/vidc_color_converter.cpp
+LOCAL_SRC_FILES         += ../common/src/vidc_ion_pool.cpp
 
 LOCAL_ADDITIONAL_DEPENDENCIES  := $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr
 
@@ -103,6 +104,8 @@ include $(CLEAR_VARS)
 mm-vdec-test-inc    := hardware/qcom/media/mm-core/inc
 mm-vdec-test-inc    += $(LOCAL_PATH)/inc
 mm-vdec-test-inc    += $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr/include
+mm-vdec-test-inc    += frameworks/native/include/media/openmax
+mm-vdec-test-inc    += frameworks/native/include/media/hardware
 
 LOCAL_MODULE                    := mm-vdec-omx-test
 LOCAL_MODULE_TAGS               := debug
@@ -141,6 +144,138 @@ LOCAL_ADDITIONAL_DEPENDENCIES  := $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr
 
 include $(BUILD_EXECUTABLE)
 
+# ---------------------------------------------------------------------------------
+# 			Make the bitreader test (mm-vdec-bitreader-test)
+# ---------------------------------------------------------------------------------
+include $(CLEAR_VARS)
+
+LOCAL_MODULE                    := mm-vdec-bitreader-test
+LOCAL_MODULE_TAGS               := debug
+LOCAL_C_INCLUDES                := $(OMX_VIDEO_PATH)/vidc/common/inc
+LOCAL_PRELINK_MODULE            := false
+
+LOCAL_SRC_FILES                 := test/h264_bitreader_test.cpp
+
+include $(BUILD_EXECUTABLE)
+
+# ---------------------------------------------------------------------------------
+# 			Make the frame parser test (mm-vdec-frameparser-test)
+# ---------------------------------------------------------------------------------
+include $(CLEAR_VARS)
+
+mm-vdec-fp-test-inc     := $(LOCAL_PATH)/inc
+mm-vdec-fp-test-inc     += $(OMX_VIDEO_PATH)/vidc/common/inc
+mm-vdec-fp-test-inc     += hardware/qcom/media/mm-core/inc
+mm-vdec-fp-test-inc     += $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr/include
+
+LOCAL_MODULE                    := mm-vdec-frameparser-test
+LOCAL_MODULE_TAGS               := debug
+LOCAL_CFLAGS                    := $(libOmxVdec-def)
+LOCAL_C_INCLUDES                := $(mm-vdec-fp-test-inc)
+LOCAL_PRELINK_MODULE            := false
+LOCAL_SHARED_LIBRARIES          := liblog libcutils
+
+LOCAL_SRC_FILES                 := src/frameparser.cpp
+LOCAL_SRC_FILES                 += src/h264_utils.cpp
+LOCAL_SRC_FILES                 += test/frameparser_test.cpp
+
+LOCAL_ADDITIONAL_DEPENDENCIES  := $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr
+
+include $(BUILD_EXECUTABLE)
+
+# ---------------------------------------------------------------------------------
+# 			Make the NAL length conversion test (mm-vdec-nal-length-test)
+# ---------------------------------------------------------------------------------
+include $(CLEAR_VARS)
+
+LOCAL_MODULE                    := mm-vdec-nal-length-test
+LOCAL_MODULE_TAGS               := debug
+LOCAL_C_INCLUDES                := $(LOCAL_PATH)/inc
+LOCAL_PRELINK_MODULE            := false
+
+LOCAL_SRC_FILES                 := test/nal_length_test.cpp
+
+include $(BUILD_EXECUTABLE)
+
+# ---------------------------------------------------------------------------------
+# 			Make the H.264 utilities test (mm-vdec-h264-utils-test)
+# ---------------------------------------------------------------------------------
+include $(CLEAR_VARS)
+
+mm-vdec-h264-test-inc   := $(LOCAL_PATH)/inc
+mm-vdec-h264-test-inc   += $(OMX_VIDEO_PATH)/vidc/common/inc
+mm-vdec-h264-test-inc   += hardware/qcom/media/mm-core/inc
+mm-vdec-h264-test-inc   += $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr/include
+
+LOCAL_MODULE                    := mm-vdec-h264-utils-test
+LOCAL_MODULE_TAGS               := debug
+LOCAL_CFLAGS                    := $(libOmxVdec-def)
+LOCAL_C_INCLUDES                := $(mm-vdec-h264-test-inc)
+LOCAL_PRELINK_MODULE            := false
+LOCAL_SHARED_LIBRARIES          := liblog libcutils
+
+LOCAL_SRC_FILES                 := src/h264_utils.cpp
+LOCAL_SRC_FILES                 += test/h264_utils_test.cpp
+
+LOCAL_ADDITIONAL_DEPENDENCIES  := $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr
+
+include $(BUILD_EXECUTABLE)
+
+# ---------------------------------------------------------------------------------
+# 			Make the timestamp reorder test (mm-vdec-ts-parser-test)
+# ---------------------------------------------------------------------------------
+include $(CLEAR_VARS)
+
+mm-vdec-ts-test-inc     := $(LOCAL_PATH)/inc
+mm-vdec-ts-test-inc     += hardware/qcom/media/mm-core/inc
+
+LOCAL_MODULE                    := mm-vdec-ts-parser-test
+LOCAL_MODULE_TAGS               := debug
+LOCAL_CFLAGS                    := $(libOmxVdec-def)
+LOCAL_C_INCLUDES                := $(mm-vdec-ts-test-inc)
+LOCAL_PRELINK_MODULE            := false
+LOCAL_SHARED_LIBRARIES          := liblog
+
+LOCAL_SRC_FILES                 := src/ts_parser.cpp
+LOCAL_SRC_FILES                 += test/ts_parser_test.cpp
+
+include $(BUILD_EXECUTABLE)
+
+# ---------------------------------------------------------------------------------
+# 			Make the message wakeup test (mm-vdec-msg-wakeup-test)
+# ---------------------------------------------------------------------------------
+include $(CLEAR_VARS)
+
+LOCAL_MODULE                    := mm-vdec-msg-wakeup-test
+LOCAL_MODULE_TAGS               := debug
+LOCAL_C_INCLUDES                := $(OMX_VIDEO_PATH)/vidc/common/inc
+LOCAL_PRELINK_MODULE            := false
+
+LOCAL_SRC_FILES                 := test/msg_wakeup_test.cpp
+
+include $(BUILD_EXECUTABLE)
+
+# ---------------------------------------------------------------------------------
+# 			Make the mock vidc driver (libmm-vidc-mock-drv)
+# ---------------------------------------------------------------------------------
+include $(CLEAR_VARS)
+
+mm-vdec-mock-drv-inc    := $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr/include
+
+LOCAL_MODULE                    := libmm-vidc-mock-drv
+LOCAL_MODULE_TAGS               := debug
+LOCAL_C_INCLUDES                := $(mm-vdec-mock-drv-inc)
+LOCAL_PRELINK_MODULE            := false
+LOCAL_SHARED_LIBRARIES          := libcutils libdl
+
+LOCAL_SRC_FILES                 := test/mock_drv.c
+LOCAL_SRC_FILES                 += test/mock_vidc_drv.c
+LOCAL_SRC_FILES                 += test/mock_v4l2_drv.c
+
+LOCAL_ADDITIONAL_DEPENDENCIES  := $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr
+
+include $(BUILD_SHARED_LIBRARY)
+
 endif #BUILD_TINY_ANDROID
 
 # ---------------------------------------------------------------------------------
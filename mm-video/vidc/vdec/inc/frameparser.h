@@ -73,6 +73,15 @@ public:
 	int parse_h264_nallength (OMX_BUFFERHEADERTYPE *source,
 		                        OMX_BUFFERHEADERTYPE *dest ,
 							              OMX_U32 *partialframe);
+	bool is_frame_aligned (OMX_BUFFERHEADERTYPE *source);
+	bool at_frame_boundary ();
+	int copy_aligned_frame (OMX_BUFFERHEADERTYPE *source,
+	                        OMX_BUFFERHEADERTYPE *dest);
+	bool is_nal_length_aligned (OMX_BUFFERHEADERTYPE *source);
+	bool at_nal_boundary ();
+	int convert_nal_length_frame (OMX_BUFFERHEADERTYPE *source,
+	                              OMX_BUFFERHEADERTYPE *dest,
+	                              OMX_U32 *nal_types);
 	void flush ();
 	 frame_parse ();
 	~frame_parse ();
@@ -86,6 +95,7 @@ private:
    unsigned char last_byte;
    bool header_found;
    bool skip_frame_boundary;
+   bool scan_prefix;
 
    /*Variables for NAL Length Parsing*/
    enum state_nal_parse state_nal;
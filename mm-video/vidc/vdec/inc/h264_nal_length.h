@@ -0,0 +1,166 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+
+#ifndef __H264_NAL_LENGTH_H__
+#define __H264_NAL_LENGTH_H__
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Conversion of MP4/AVCC length-prefixed H.264 NAL units to Annex-B.
+ *
+ * to_annexb() handles a whole access unit in one pass. With 4-byte length
+ * fields the Annex-B stream has the same size, so the unit is copied once
+ * (or not at all when dst == src) and each length field is overwritten by
+ * a start code while walking from header to header. Shorter length fields
+ * grow the stream, and the output is gathered in a single pass writing a
+ * start code and the payload of every NAL unit. A zero length unit becomes
+ * a bare start code, as the NAL length parser produces.
+ */
+class h264_nal_length
+{
+public:
+  /* Returns the Annex-B size written to dst, or -1 when a length field
+   * runs past src, src ends inside a length field or dst is too small.
+   * dst may be src for 4-byte length fields only, and holds partial
+   * output after an error. nal_types, if given, gets bit n set for every
+   * NAL unit type n seen. */
+  static int to_annexb(uint8_t *dst, uint32_t dst_len, const uint8_t *src,
+      uint32_t src_len, uint32_t nal_length, uint32_t *nal_types)
+  {
+    uint32_t in = 0, out = 0, len, types = 0;
+
+    if (nal_length < 1 || nal_length > 4)
+      return -1;
+    if (nal_length == 4) {
+      if (src_len > dst_len)
+        return -1;
+      if (dst != src)
+        memcpy(dst, src, src_len);
+      while (src_len - in >= 4) {
+        len = get(dst + in, 4);
+        if (len > src_len - in - 4)
+          return -1;
+        put_start_code(dst + in);
+        if (len)
+          types |= 1u << (dst[in + 4] & 0x1F);
+        in += 4 + len;
+      }
+      out = src_len;
+    } else {
+      while (src_len - in >= nal_length) {
+        len = get(src + in, nal_length);
+        in += nal_length;
+        if (len > src_len - in || dst_len - out < 4 || len > dst_len - out - 4)
+          return -1;
+        put_start_code(dst + out);
+        memcpy(dst + out + 4, src + in, len);
+        if (len)
+          types |= 1u << (src[in] & 0x1F);
+        in += len;
+        out += 4 + len;
+      }
+    }
+    if (in != src_len)
+      return -1;
+    if (nal_types)
+      *nal_types = types;
+    return (int)out;
+  }
+
+  /* Rewrites the parameter sets of an avcC record (ISO/IEC 14496-15
+   * AVCDecoderConfigurationRecord) as SPS then PPS units with nal_length
+   * byte prefixes. Returns the size written, or -1 for a truncated record
+   * or a length that does not fit the field. dst NULL only sizes. */
+  static int from_avcc(uint8_t *dst, const uint8_t *avcc, uint32_t avcc_len,
+      uint32_t nal_length)
+  {
+    uint32_t in = 5, out = 0, count, len, set;
+
+    if (avcc_len < 6 || nal_length < 1 || nal_length > 4)
+      return -1;
+    for (set = 0; set < 2; set++) {
+      if (in >= avcc_len)
+        return -1;
+      // SPS count is the low 5 bits, the PPS count a full byte
+      count = set ? avcc[in] : (avcc[in] & 0x1F);
+      in++;
+      while (count--) {
+        if (avcc_len - in < 2)
+          return -1;
+        len = get(avcc + in, 2);
+        in += 2;
+        if (len > avcc_len - in ||
+            (nal_length < 4 && len >> (nal_length << 3)))
+          return -1;
+        if (dst) {
+          put(dst + out, len, nal_length);
+          memcpy(dst + out + nal_length, avcc + in, len);
+        }
+        in += len;
+        out += nal_length + len;
+      }
+    }
+    return (int)out;
+  }
+
+  static uint32_t get(const uint8_t *p, uint32_t nal_length)
+  {
+    uint32_t value = 0;
+    if (nal_length == 4) {
+      memcpy(&value, p, 4);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      value = __builtin_bswap32(value);
+#endif
+      return value;
+    }
+    while (nal_length--)
+      value = (value << 8) | *p++;
+    return value;
+  }
+
+  static void put(uint8_t *p, uint32_t value, uint32_t nal_length)
+  {
+    while (nal_length--) {
+      p[nal_length] = (uint8_t)value;
+      value >>= 8;
+    }
+  }
+
+private:
+  static void put_start_code(uint8_t *p)
+  {
+    p[0] = 0;
+    p[1] = 0;
+    p[2] = 0;
+    p[3] = 1;
+  }
+};
+
+#endif // __H264_NAL_LENGTH_H__
@@ -44,10 +44,12 @@ This module contains H264 video decoder utilities and helper routines.
 
 ========================================================================== */
 #include <stdio.h>
+#include <string.h>
 #include "Map.h"
 #include "qtypes.h"
 #include "OMX_Core.h"
 #include "OMX_QCOMExtns.h"
+#include "h264_bitreader.h"
 
 #define STD_MIN(x,y) (((x) < (y)) ? (x) : (y))
 
@@ -119,8 +121,43 @@ struct H264ParamNalu {
     uint32 crop_top;
     uint32 crop_bot;
 };
-//typedef map<uint32, H264ParamNalu> H264ParamNaluSet;
-typedef Map<uint32, H264ParamNalu *> H264ParamNaluSet;
+
+// Fixed capacity parameter set store indexed directly by the set id. SPS and
+// PPS ids are bounded by the spec, so lookup and replacement are O(1) and no
+// allocation happens after construction.
+template <uint32 MAX_SETS>
+class H264ParamNaluSet
+{
+public:
+    H264ParamNaluSet() { clear(); }
+    H264ParamNalu *find(uint32 id)
+    {
+        return (id < MAX_SETS && valid[id]) ? &sets[id] : NULL;
+    }
+    // Returns the slot for id, replacing any set previously stored there
+    H264ParamNalu *insert(uint32 id)
+    {
+        if (id >= MAX_SETS)
+            return NULL;
+        memset(&sets[id], 0, sizeof(H264ParamNalu));
+        valid[id] = true;
+        return &sets[id];
+    }
+    bool erase(uint32 id)
+    {
+        if (id >= MAX_SETS || !valid[id])
+            return false;
+        valid[id] = false;
+        return true;
+    }
+    void clear() { memset(valid, 0, sizeof(valid)); }
+private:
+    H264ParamNalu sets[MAX_SETS];
+    bool valid[MAX_SETS];
+};
+
+#define H264_MAX_SPS_COUNT 32
+#define H264_MAX_PPS_COUNT 256
 
 typedef enum {
   NALU_TYPE_UNSPECIFIED = 0,
@@ -157,8 +194,9 @@ class extra_data_parser;
 
 class RbspParser
 /******************************************************************************
- ** This class is used to convert an H.264 NALU (network abstraction layer
- ** unit) into RBSP (raw byte sequence payload) and extract bits from it.
+ ** This class is used to extract bits from the RBSP (raw byte sequence
+ ** payload) of an H.264 NALU (network abstraction layer unit). The input
+ ** is read in place; emulation prevention bytes must already be removed.
  *****************************************************************************/
 {
 public:
@@ -166,18 +204,12 @@ public:
 
     virtual ~RbspParser ();
 
-    uint32 next ();
-    void advance ();
     uint32 u (uint32 n);
     uint32 ue ();
     int32 se ();
 
 private:
-    const     uint8 *begin, *end;
-    int32     pos;
-    uint32    bit;
-    uint32    cursor;
-    bool      advanceNeeded;
+    h264_bitreader bits;
 };
 
 class H264_Utils
@@ -200,11 +232,13 @@ private:
                          OMX_OUT  OMX_U8  *rbsp_bistream,
                          OMX_OUT  OMX_U32 *rbsp_length,
                          OMX_OUT  NALU    *nal_unit);
+    void parse_sps(uint8 *rbsp, uint32 rbsp_length);
+    void parse_pps(uint8 *rbsp, uint32 rbsp_length);
 
     unsigned          m_height;
     unsigned          m_width;
-    H264ParamNaluSet  pic;
-    H264ParamNaluSet  seq;
+    H264ParamNaluSet<H264_MAX_PPS_COUNT>  pic;
+    H264ParamNaluSet<H264_MAX_SPS_COUNT>  seq;
     uint8             *m_rbspBytes;
     NALU              m_prv_nalu;
     bool              m_forceToStichNextNAL;
@@ -431,10 +465,8 @@ class h264_stream_parser
     void update_panscan_data(OMX_S64 timestamp);
 #endif
   private:
-    void init_bitstream(OMX_U8* data, OMX_U32 size);
     OMX_U32 extract_bits(OMX_U32 n);
     inline bool more_bits();
-    void read_word();
     OMX_U32 uev();
     OMX_S32 sev();
     OMX_S32 iv(OMX_U32 n_bits);
@@ -456,14 +488,8 @@ class h264_stream_parser
     OMX_S64 calculate_fixed_fps_ts(OMX_S64 timestamp, OMX_U32 DeltaTfiDivisor);
     void parse_frame_pack();
 
-    OMX_U32 curr_32_bit;
-    OMX_U32 bits_read;
-    OMX_U32 zero_cntr;
-    OMX_U32 emulation_code_skip_cntr;
-    OMX_U8* bitstream;
-    OMX_U32 bitstream_bytes;
+    h264_bitreader bits;
     OMX_U32 frame_rate;
-    bool    emulation_sc_enabled;
 
     h264_vui_param vui_param;
     h264_sei_buf_period sei_buf_period;
@@ -102,6 +102,10 @@ extern "C"{
 #include "extra_data_handler.h"
 #include "ts_parser.h"
 #include "vidc_color_converter.h"
+#include "vidc_msg_wakeup.h"
+#ifdef USE_ION
+#include "vidc_ion_pool.h"
+#endif
 extern "C" {
   OMX_API void * get_omx_component_factory_fn(void);
 }
@@ -380,6 +384,8 @@ public:
     struct video_driver_context drv_ctx;
     int  m_pipe_in;
     int  m_pipe_out;
+    // Batches message thread wakeups across queued events
+    vidc_msg_wakeup m_msg_wakeup;
     pthread_t msg_thread_id;
     pthread_t async_thread_id;
     bool is_component_secure();
@@ -482,30 +488,35 @@ private:
         ~omx_cmd_queue();
         bool insert_entry(unsigned p1, unsigned p2, unsigned id);
         bool pop_entry(unsigned *p1,unsigned *p2, unsigned *id);
+        unsigned pop_entries(unsigned *p1, unsigned *p2, unsigned *id,
+                             unsigned max);
         // get msgtype of the first ele from the queue
         unsigned get_q_msg_type();
 
     };
 
 #ifdef _ANDROID_
-    struct ts_entry
+    // bounded by the number of buffers that can be outstanding at once
+    struct ts_arr_list: public omx_ts_list
     {
-        OMX_TICKS timestamp;
-        bool valid;
+        ts_arr_list(): omx_ts_list(MAX_NUM_INPUT_OUTPUT_BUFFERS) {}
     };
+#endif
 
-    struct ts_arr_list
+    /* Timestamps of input queued with OMX_BUFFERFLAG_DECODEONLY. Output
+     * with a matching timestamp is flagged likewise, for the client not
+     * to render it, whether or not the driver carries the flag over. */
+    struct decode_only_list
     {
-        ts_entry m_ts_arr_list[MAX_NUM_INPUT_OUTPUT_BUFFERS];
+        OMX_TICKS m_ts[MAX_NUM_INPUT_OUTPUT_BUFFERS];
+        unsigned m_count;
 
-        ts_arr_list();
-        ~ts_arr_list();
+        decode_only_list(): m_count(0) {}
 
-        bool insert_ts(OMX_TICKS ts);
-        bool pop_min_ts(OMX_TICKS &ts);
-        bool reset_ts_list();
+        void insert_ts(OMX_TICKS ts);
+        bool remove_ts(OMX_TICKS ts);
+        void reset() { m_count = 0; }
     };
-#endif
 
     struct desc_buffer_hdr
     {
@@ -572,11 +583,19 @@ private:
 
     OMX_ERRORTYPE push_input_buffer (OMX_HANDLETYPE hComp);
     OMX_ERRORTYPE push_input_sc_codec (OMX_HANDLETYPE hComp);
+    OMX_ERRORTYPE push_input_aligned_frame (OMX_HANDLETYPE hComp,
+                                            bool *fallback);
     OMX_ERRORTYPE push_input_h264 (OMX_HANDLETYPE hComp);
+    void update_h264_param_sets (OMX_U8 *annexb, OMX_U8 *source,
+                                 OMX_U32 source_len);
     OMX_ERRORTYPE push_input_vc1 (OMX_HANDLETYPE hComp);
 
     OMX_ERRORTYPE fill_this_buffer_proxy(OMX_HANDLETYPE       hComp,
                                        OMX_BUFFERHEADERTYPE *buffer);
+    OMX_ERRORTYPE validate_etb(OMX_BUFFERHEADERTYPE **buffer, unsigned *event);
+    OMX_ERRORTYPE validate_ftb(OMX_BUFFERHEADERTYPE *buffer);
+    OMX_ERRORTYPE submit_buffer_batch(OMX_HANDLETYPE hComp,
+                                      QOMX_VIDEO_BUFFER_BATCHTYPE *batch);
     bool release_done();
 
     bool release_output_done();
@@ -637,6 +656,10 @@ private:
                      unsigned int p2,
                      unsigned int id
                     );
+    bool post_events(unsigned int p1,
+                     const unsigned int *p2,
+                     const unsigned int *id,
+                     unsigned int count);
     inline int clip2(int x)
     {
         x = x -1;
@@ -713,6 +736,7 @@ private:
     // Timestamp list
     ts_arr_list           m_timestamp_list;
 #endif
+    decode_only_list      m_decode_only_ts;
 
     bool input_flush_progress;
     bool output_flush_progress;
@@ -792,6 +816,8 @@ private:
     OMX_U32 m_smoothstreaming_height;
     OMX_U32 m_smoothstreaming_width;
     bool m_use_smoothstreaming;
+    // Whole-frame arbitrary bytes input bypasses the start code parser
+    bool m_aligned_input;
 
     OMX_S64 prev_ts;
     bool rst_prev_ts;
@@ -799,9 +825,16 @@ private:
 
     struct vdec_allocatorproperty op_buf_rcnfg;
     bool in_reconfig;
+    uint64_t m_reconfig_start_us;   // port settings change to output re-enable
     OMX_NATIVE_WINDOWTYPE m_display_id;
     h264_stream_parser *h264_parser;
     OMX_U32 client_extradata;
+    // Leave driver extradata in place and describe it with an index
+    bool m_extradata_index;
+    // Per-frame extradata cost, logged on teardown
+    perf_metrics m_extradata_cost;
+    OMX_U32 m_extradata_frames;
+    OMX_U64 m_extradata_copied;
 #ifdef _ANDROID_
     bool m_debug_timestamp;
     bool perf_flag;
@@ -35,5 +35,7 @@ void free_queue(Queue *q);
 void free_queue_and_qelement(Queue *q);
 int push(Queue *q, void * element);
 void *pop(Queue *q);
+/* Number of heap allocations made for queue nodes so far */
+int queue_alloc_count(Queue *q);
 
 #endif
@@ -45,6 +45,52 @@ extern "C"{
 #define ALOGE(fmt, args...) fprintf(stderr, fmt, ##args)
 #endif /* _ANDROID_ */
 
+/* Binary min-heap of timestamps ordered by (generation, timestamp), so that
+ * every timestamp of an older generation pops before any of a newer one.
+ * Insert and pop are O(log n); storage is a fixed array. */
+class omx_ts_min_heap {
+public:
+	omx_ts_min_heap();
+	bool push(OMX_TICKS ts, unsigned int generation);
+	bool pop(OMX_TICKS *ts, unsigned int *generation);
+	bool top(OMX_TICKS *ts, unsigned int *generation);
+	bool remove(OMX_TICKS ts, unsigned int generation);
+	void clear() { entries = 0; }
+	unsigned int size() { return entries; }
+
+private:
+	#define TS_HEAP_SZ 256
+	typedef struct heap_entry {
+		OMX_TICKS timestamp;
+		unsigned int generation;
+	}heap_entry;
+	heap_entry heap[TS_HEAP_SZ];
+	unsigned int entries;
+	bool less(const heap_entry &a, const heap_entry &b)
+	{
+		int gen_diff = (int)(a.generation - b.generation);
+		return gen_diff < 0 ||
+			(gen_diff == 0 && a.timestamp < b.timestamp);
+	}
+	void sift_up(unsigned int idx);
+	void sift_down(unsigned int idx);
+};
+
+/* Output timestamps of a decoder that returns frames in presentation
+ * order: each decoded frame takes the smallest timestamp still queued.
+ * At most max_entries (and TS_HEAP_SZ) timestamps are held at once. */
+class omx_ts_list {
+public:
+	omx_ts_list(unsigned int max_entries);
+	bool insert_ts(OMX_TICKS ts);
+	bool pop_min_ts(OMX_TICKS &ts);
+	bool reset_ts_list();
+
+private:
+	omx_ts_min_heap ts_heap;
+	unsigned int max_entries;
+};
+
 class omx_time_stamp_reorder {
 public:
 	omx_time_stamp_reorder();
@@ -57,30 +103,18 @@ public:
 	void flush_timestamp();
 
 private:
-	#define TIME_SZ 64
-	typedef struct timestamp {
-		OMX_TICKS timestamps;
-		bool in_use;
-	}timestamp;
-	typedef struct time_stamp_list {
-		timestamp input_timestamps[TIME_SZ];
-		time_stamp_list *next;
-		time_stamp_list *prev;
-		unsigned int entries_filled;
-	}time_stamp_list;
+	/* Timestamps queued before an EOS form one generation and are all
+	 * returned before any timestamp queued after it */
+	omx_ts_min_heap ts_heap;
+	unsigned int insert_gen;
 	bool error;
-	time_stamp_list *phead,*pcurrent;
-	bool get_current_list();
-	bool add_new_list();
-	bool update_head();
-	void delete_list();
 	void handle_error()
 	{
 		ALOGE("Error handler called for TS Parser");
 		if (error)
 			return;
 		error = true;
-		delete_list();
+		ts_heap.clear();
 	}
 	bool reorder_ts;
         bool print_debug;
@@ -41,8 +41,14 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <sys/time.h>
 #include <sys/poll.h>
 #include <stdint.h>
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "frameparser.h"
+#include "h264_nal_length.h"
 
 #ifdef _ANDROID_
     extern "C"{
@@ -73,6 +79,53 @@ static unsigned char VC1_AP_mask_code[4] = {0xFF,0xFF,0xFF,0xFC};
 static unsigned char MPEG2_start_code[4] = {0x00, 0x00, 0x01, 0x00};
 static unsigned char MPEG2_mask_code[4] = {0xFF, 0xFF, 0xFF, 0xFF};
 
+/* Returns the first index i in [pos, len) such that psource[i] == 0x00 and
+ * either psource[i+1] == 0x00 or i is the last byte; len if there is none.
+ * Every start code begins with 00 00, so all bytes skipped here would only
+ * have cycled the A0/A1 states without reaching A2. */
+static OMX_U32 find_start_code_prefix (const OMX_U8 *psource, OMX_U32 pos,
+                                       OMX_U32 len)
+{
+#if defined(__ARM_NEON__)
+    const uint8x16_t zero = vdupq_n_u8(0);
+    while (pos + 17 <= len)
+    {
+        uint8x16_t cur = vld1q_u8(psource + pos);
+        uint8x16_t next = vld1q_u8(psource + pos + 1);
+        uint64x2_t hit = vreinterpretq_u64_u8(vceqq_u8(vorrq_u8(cur, next), zero));
+        if (vgetq_lane_u64(hit, 0) | vgetq_lane_u64(hit, 1))
+            break;
+        pos += 16;
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    while (pos + 17 <= len)
+    {
+        __m128i cur = _mm_loadu_si128((const __m128i *)(psource + pos));
+        __m128i next = _mm_loadu_si128((const __m128i *)(psource + pos + 1));
+        int hit = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_or_si128(cur, next), zero));
+        if (hit)
+            return pos + __builtin_ctz(hit);
+        pos += 16;
+    }
+#endif
+    /*A word without any zero byte cannot start a 00 00 pair*/
+    while (pos + 4 <= len)
+    {
+        uint32_t word;
+        memcpy (&word, psource + pos, sizeof(word));
+        if ((word - 0x01010101U) & ~word & 0x80808080U)
+            break;
+        pos += 4;
+    }
+    for (; pos < len; pos++)
+    {
+        if (psource[pos] == 0x00 && (pos + 1 == len || psource[pos + 1] == 0x00))
+            break;
+    }
+    return pos;
+}
+
 frame_parse::frame_parse():parse_state(A0),
                            last_byte_h263(0),
                            state_nal(NAL_LENGTH_ACC),
@@ -83,7 +136,8 @@ frame_parse::frame_parse():parse_state(A0),
                            start_code(NULL),
                            mask_code(NULL),
                            header_found(false),
-                           skip_frame_boundary(false)
+                           skip_frame_boundary(false),
+                           scan_prefix(false)
 {
 }
 
@@ -126,6 +180,9 @@ int frame_parse::init_start_codes (codec_type codec_type_parse)
                 mask_code = MPEG2_mask_code;
                 break;
         }
+	/*Vectorized skip only valid when the code starts with a full 00 00*/
+	scan_prefix = (start_code[0] == 0x00 && mask_code[0] == 0xFF &&
+	               start_code[1] == 0x00 && mask_code[1] == 0xFF);
 	return 1;
 }
 
@@ -365,6 +422,12 @@ int frame_parse::parse_sc_frame ( OMX_BUFFERHEADERTYPE *source,
       switch (parse_state)
       {
       case A0:
+          if (scan_prefix)
+          {
+              parsed_length = find_start_code_prefix (psource, parsed_length, temp_len);
+              if (parsed_length == temp_len)
+                  break;
+          }
           if ((psource [parsed_length] & mask_code [0])  == start_code[0])
           {
             parse_state = A1;
@@ -613,6 +676,110 @@ int frame_parse::parse_h264_nallength (OMX_BUFFERHEADERTYPE *source,
    return 1;
 }
 
+/* A source buffer can bypass the start code state machine when the parser
+ * holds no partial start code, the client marked it as ending on a frame
+ * boundary and it begins with a start code itself. */
+bool frame_parse::at_frame_boundary ()
+{
+    return (start_code != NULL && parse_state == A0 && !skip_frame_boundary);
+}
+
+bool frame_parse::is_frame_aligned (OMX_BUFFERHEADERTYPE *source)
+{
+    OMX_U8 *psource = NULL;
+
+    if (source == NULL || !at_frame_boundary() ||
+        !(source->nFlags & OMX_BUFFERFLAG_ENDOFFRAME) ||
+        source->nFilledLen < 4)
+    {
+        return false;
+    }
+
+    psource = source->pBuffer + source->nOffset;
+    return ((psource[0] & mask_code[0]) == start_code[0] &&
+            (psource[1] & mask_code[1]) == start_code[1] &&
+            (psource[2] & mask_code[2]) == start_code[2]);
+}
+
+int frame_parse::copy_aligned_frame (OMX_BUFFERHEADERTYPE *source,
+                                     OMX_BUFFERHEADERTYPE *dest)
+{
+    OMX_U32 dest_len = 0;
+
+    if (source == NULL || dest == NULL)
+    {
+        return -1;
+    }
+
+    dest_len = dest->nAllocLen - (dest->nFilledLen + dest->nOffset);
+    if (source->nFilledLen > dest_len)
+    {
+        DEBUG_PRINT_LOW("\n FrameParser: aligned frame %d exceeds dest %d",
+            source->nFilledLen, dest_len);
+        return -1;
+    }
+
+    memcpy (dest->pBuffer + dest->nOffset + dest->nFilledLen,
+            source->pBuffer + source->nOffset, source->nFilledLen);
+    dest->nFilledLen += source->nFilledLen;
+    dest->nTimeStamp = source->nTimeStamp;
+    dest->nFlags = source->nFlags;
+    source->nOffset += source->nFilledLen;
+    source->nFilledLen = 0;
+    return 1;
+}
+
+/* NAL length streams: the parser is between NAL units when it has not
+ * started accumulating a length field. An ENDOFFRAME source then holds
+ * whole access units and is converted in one pass. */
+bool frame_parse::at_nal_boundary ()
+{
+    return (nal_length != 0 && state_nal == NAL_LENGTH_ACC && accum_length == 0);
+}
+
+bool frame_parse::is_nal_length_aligned (OMX_BUFFERHEADERTYPE *source)
+{
+    return (source != NULL && at_nal_boundary() &&
+            (source->nFlags & OMX_BUFFERFLAG_ENDOFFRAME) &&
+            source->nFilledLen >= nal_length);
+}
+
+int frame_parse::convert_nal_length_frame (OMX_BUFFERHEADERTYPE *source,
+                                           OMX_BUFFERHEADERTYPE *dest,
+                                           OMX_U32 *nal_types)
+{
+    int converted = 0;
+    uint32_t types = 0;
+
+    if (source == NULL || dest == NULL)
+    {
+        return -1;
+    }
+
+    converted = h264_nal_length::to_annexb(
+        dest->pBuffer + dest->nOffset + dest->nFilledLen,
+        dest->nAllocLen - (dest->nFilledLen + dest->nOffset),
+        source->pBuffer + source->nOffset, source->nFilledLen,
+        nal_length, &types);
+    if (converted == -1)
+    {
+        DEBUG_PRINT_LOW("\n FrameParser: NAL length frame %d does not convert",
+            source->nFilledLen);
+        return -1;
+    }
+
+    if (nal_types)
+    {
+        *nal_types = types;
+    }
+    dest->nFilledLen += converted;
+    dest->nTimeStamp = source->nTimeStamp;
+    dest->nFlags = source->nFlags;
+    source->nOffset += source->nFilledLen;
+    source->nFilledLen = 0;
+    return 1;
+}
+
 void frame_parse::flush ()
 {
     parse_state = A0;
@@ -76,89 +76,29 @@ and other items needed by this module.
 #define MAX_SUPPORTED_LEVEL 32
 
 RbspParser::RbspParser (const uint8 *_begin, const uint8 *_end)
-: begin (_begin), end(_end), pos (- 1), bit (0),
-cursor (0xFFFFFF), advanceNeeded (true)
 {
+    bits.init(_begin, static_cast<uint32>(_end - _begin), false);
 }
 
 // Destructor
-/*lint -e{1540}  Pointer member neither freed nor zeroed by destructor
- * No problem
- */
 RbspParser::~RbspParser () {}
 
-// Return next RBSP byte as a word
-uint32 RbspParser::next ()
-{
-    if (advanceNeeded) advance ();
-    //return static_cast<uint32> (*pos);
-    return static_cast<uint32> (begin[pos]);
-}
-
-// Advance RBSP decoder to next byte
-void RbspParser::advance ()
-{
-    ++pos;
-    //if (pos >= stop)
-    if (begin + pos == end)
-    {
-        /*lint -e{730}  Boolean argument to function
-         * I don't see a problem here
-         */
-        //throw false;
-        ALOGV("H264Parser-->NEED TO THROW THE EXCEPTION...\n");
-    }
-    cursor <<= 8;
-    //cursor |= static_cast<uint32> (*pos);
-    cursor |= static_cast<uint32> (begin[pos]);
-    if ((cursor & 0xFFFFFF) == 0x000003)
-    {
-        advance ();
-    }
-    advanceNeeded = false;
-}
-
 // Decode unsigned integer
 uint32 RbspParser::u (uint32 n)
 {
-    uint32 i, s, x = 0;
-    for (i = 0; i < n; i += s)
-    {
-        s = static_cast<uint32>STD_MIN(static_cast<int>(8 - bit),
-            static_cast<int>(n - i));
-        x <<= s;
-
-        x |= ((next () >> ((8 - static_cast<uint32>(bit)) - s)) &
-            ((1 << s) - 1));
-
-        bit = (bit + s) % 8;
-        if (!bit)
-        {
-            advanceNeeded = true;
-        }
-    }
-    return x;
+    return bits.u(n);
 }
 
 // Decode unsigned integer Exp-Golomb-coded syntax element
 uint32 RbspParser::ue ()
 {
-    int leadingZeroBits = -1;
-    for (uint32 b = 0; !b; ++leadingZeroBits)
-    {
-        b = u (1);
-    }
-    return ((1 << leadingZeroBits) - 1) +
-        u (static_cast<uint32>(leadingZeroBits));
+    return bits.ue();
 }
 
 // Decode signed integer Exp-Golomb-coded syntax element
 int32 RbspParser::se ()
 {
-    const uint32 x = ue ();
-    if (!x) return 0;
-    else if (x & 1) return static_cast<int32> ((x >> 1) + 1);
-    else return - static_cast<int32> (x >> 1);
+    return bits.se();
 }
 
 void H264_Utils::allocate_rbsp_buffer(uint32 inputBufferSize)
@@ -227,6 +167,149 @@ void H264_Utils::initialize_frame_checking_environment()
   m_prv_nalu.nalu_type = NALU_TYPE_UNSPECIFIED;
 }
 
+/***********************************************************************/
+/*
+FUNCTION:
+  H264_Utils::parse_sps
+
+DESCRIPTION:
+  Store the SPS fields needed for slice header parsing in the
+  sequence parameter set table, replacing any SPS with the same id
+
+INPUT/OUTPUT PARAMETERS:
+  rbsp : RBSP of the SPS NAL without the NAL header byte
+  rbsp_length : the length of the RBSP
+
+RETURN VALUE:
+  None.
+*/
+/***********************************************************************/
+void H264_Utils::parse_sps(uint8 *rbsp, uint32 rbsp_length)
+{
+  H264ParamNalu parsed, *sps = &parsed;
+  uint32 profile_idc, id, value;
+
+  if (rbsp_length < 4)
+    return;
+
+  RbspParser rbsp_parser(rbsp, rbsp + rbsp_length);
+  profile_idc = rbsp_parser.u(8);
+  rbsp_parser.u(16); //constraint flags and level_idc
+  id = rbsp_parser.ue();
+  if (id >= H264_MAX_SPS_COUNT)
+  {
+    ALOGE("ERROR: In %s() - invalid sps id %d", __func__, id);
+    return;
+  }
+  memset(sps, 0, sizeof(*sps));
+  sps->seqSetID = id;
+  if (profile_idc == 100 || profile_idc == 110 || profile_idc == 122 ||
+      profile_idc == 244 || profile_idc ==  44 || profile_idc ==  83 ||
+      profile_idc ==  86 || profile_idc == 118)
+  {
+    uint32 scaling_matrix_limit = 8;
+    if (rbsp_parser.ue() == 3) //chroma_format_idc
+    {
+      rbsp_parser.u(1); //separate_colour_plane_flag
+      scaling_matrix_limit = 12;
+    }
+    rbsp_parser.ue(); //bit_depth_luma_minus8
+    rbsp_parser.ue(); //bit_depth_chroma_minus8
+    rbsp_parser.u(1); //qpprime_y_zero_transform_bypass_flag
+    if (rbsp_parser.u(1)) //seq_scaling_matrix_present_flag
+    {
+      for (uint32 i = 0; i < scaling_matrix_limit; i++)
+      {
+        if (!rbsp_parser.u(1)) //seq_scaling_list_present_flag[i]
+          continue;
+        int32 last_scale = 8, next_scale = 8;
+        for (uint32 j = 0; j < ((i < 6) ? 16 : 64) && next_scale; j++)
+        {
+          next_scale = (last_scale + rbsp_parser.se() + 256) % 256;
+          last_scale = next_scale ? next_scale : last_scale;
+        }
+      }
+    }
+  }
+  sps->log2MaxFrameNumMinus4 = rbsp_parser.ue();
+  sps->picOrderCntType = rbsp_parser.ue();
+  if (sps->picOrderCntType == 0)
+  {
+    sps->log2MaxPicOrderCntLsbMinus4 = rbsp_parser.ue();
+  }
+  else if (sps->picOrderCntType == 1)
+  {
+    sps->deltaPicOrderAlwaysZeroFlag = rbsp_parser.u(1);
+    rbsp_parser.se(); //offset_for_non_ref_pic
+    rbsp_parser.se(); //offset_for_top_to_bottom_field
+    value = rbsp_parser.ue(); //num_ref_frames_in_pic_order_cnt_cycle
+    for (uint32 i = 0; i < value && i < 256; i++)
+      rbsp_parser.se(); //offset_for_ref_frame[i]
+  }
+  rbsp_parser.ue(); //max_num_ref_frames
+  rbsp_parser.u(1); //gaps_in_frame_num_value_allowed_flag
+  sps->picWidthInMbsMinus1 = rbsp_parser.ue();
+  sps->picHeightInMapUnitsMinus1 = rbsp_parser.ue();
+  sps->frameMbsOnlyFlag = rbsp_parser.u(1);
+
+  // Ranges from 7.4.2.1.1; slice headers are read with these widths
+  if (sps->log2MaxFrameNumMinus4 > 12 || sps->picOrderCntType > 2 ||
+      sps->log2MaxPicOrderCntLsbMinus4 > 12)
+  {
+    ALOGE("ERROR: In %s() - corrupt sps %d, log2_max_frame_num_minus4 %d "
+        "pic_order_cnt_type %d", __func__, id, sps->log2MaxFrameNumMinus4,
+        sps->picOrderCntType);
+    seq.erase(id);
+    return;
+  }
+  *seq.insert(id) = parsed;
+  ALOGV("parse_sps: id %d log2_max_frame_num_minus4 %d %dx%d mbs",
+      id, sps->log2MaxFrameNumMinus4, sps->picWidthInMbsMinus1 + 1,
+      sps->picHeightInMapUnitsMinus1 + 1);
+}
+
+/***********************************************************************/
+/*
+FUNCTION:
+  H264_Utils::parse_pps
+
+DESCRIPTION:
+  Store the PPS to SPS association in the picture parameter set table,
+  replacing any PPS with the same id
+
+INPUT/OUTPUT PARAMETERS:
+  rbsp : RBSP of the PPS NAL without the NAL header byte
+  rbsp_length : the length of the RBSP
+
+RETURN VALUE:
+  None.
+*/
+/***********************************************************************/
+void H264_Utils::parse_pps(uint8 *rbsp, uint32 rbsp_length)
+{
+  H264ParamNalu *pps = NULL;
+  uint32 id, seq_id;
+
+  if (!rbsp_length)
+    return;
+
+  RbspParser rbsp_parser(rbsp, rbsp + rbsp_length);
+  id = rbsp_parser.ue();
+  seq_id = rbsp_parser.ue();
+  if (id >= H264_MAX_PPS_COUNT || seq_id >= H264_MAX_SPS_COUNT)
+  {
+    ALOGE("ERROR: In %s() - invalid pps id %d sps id %d", __func__, id, seq_id);
+    if (id < H264_MAX_PPS_COUNT)
+      pic.erase(id);
+    return;
+  }
+  pps = pic.insert(id);
+  pps->picSetID = id;
+  pps->seqSetID = seq_id;
+  rbsp_parser.u(1); //entropy_coding_mode_flag
+  pps->picOrderPresentFlag = rbsp_parser.u(1);
+}
+
 /***********************************************************************/
 /*
 FUNCTION:
@@ -452,6 +535,10 @@ bool H264_Utils::isNewFrame(OMX_BUFFERHEADERTYPE *p_buf_hdr,
         case NALU_TYPE_SEI:
         {
           ALOGV("\n Non-AU boundary with NAL type %d", nal_unit.nalu_type);
+          if (nal_unit.nalu_type == NALU_TYPE_SPS)
+            parse_sps(m_rbspBytes, numBytesInRBSP);
+          else if (nal_unit.nalu_type == NALU_TYPE_PPS)
+            parse_pps(m_rbspBytes, numBytesInRBSP);
           if(m_au_data)
           {
             isNewFrame = OMX_TRUE;
@@ -564,13 +651,7 @@ h264_stream_parser::~h264_stream_parser()
 
 void h264_stream_parser::reset()
 {
-  curr_32_bit = 0;
-  bits_read = 0;
-  zero_cntr = 0;
-  emulation_code_skip_cntr = 0;
-  emulation_sc_enabled = true;
-  bitstream = NULL;
-  bitstream_bytes = 0;
+  bits.init(NULL, 0);
   memset(&vui_param, 0, sizeof(vui_param));
   vui_param.fixed_fps_prev_ts = LLONG_MAX;
   memset(&sei_buf_period, 0, sizeof(sei_buf_period));
@@ -580,16 +661,6 @@ void h264_stream_parser::reset()
   mbaff_flag = 0;
 }
 
-void h264_stream_parser::init_bitstream(OMX_U8* data, OMX_U32 size)
-{
-  bitstream = data;
-  bitstream_bytes = size;
-  curr_32_bit = 0;
-  bits_read = 0;
-  zero_cntr = 0;
-  emulation_code_skip_cntr = 0;
-}
-
 void h264_stream_parser::parse_vui(bool vui_in_extradata)
 {
   OMX_U32 value = 0;
@@ -792,27 +863,30 @@ void h264_stream_parser::hrd_parameters(h264_hrd_param *hrd_param)
 
 void h264_stream_parser::parse_sei()
 {
-  OMX_U32 value = 0, processed_bytes = 0;
-  OMX_U8 *sei_msg_start = bitstream;
-  OMX_U32 sei_unit_size = bitstream_bytes;
-  ALOGV("@@parse_sei: IN sei_unit_size(%u)", sei_unit_size);
-  while ((processed_bytes + 2) < sei_unit_size && more_bits())
+  OMX_U32 value = 0, payload_start = 0;
+  ALOGV("@@parse_sei: IN sei_unit_size(%u)", bits.bits_left() >> 3);
+  // payload offsets are in RBSP bytes, so emulation prevention needs no
+  // accounting here; the last byte holds the rbsp trailing bits
+  while (bits.bits_left() > 16)
   {
-    init_bitstream(sei_msg_start + processed_bytes, sei_unit_size - processed_bytes);
     ALOGV("-->NALU_TYPE_SEI");
     OMX_U32 payload_type = 0, payload_size = 0, aux = 0;
     do {
       value = extract_bits(8);
       payload_type += value;
-      processed_bytes++;
     } while (value == 0xFF);
     ALOGV("-->payload_type   : %u", payload_type);
     do {
       value = extract_bits(8);
       payload_size += value;
-      processed_bytes++;
     } while (value == 0xFF);
     ALOGV("-->payload_size   : %u", payload_size);
+    payload_start = bits.bit_pos();
+    if (payload_size > (bits.bits_left() >> 3))
+    {
+      ALOGV("-->SEI payload size[%u] exceeds the NAL", payload_size);
+      break;
+    }
     if (payload_size > 0)
     {
       switch (payload_type)
@@ -833,8 +907,8 @@ void h264_stream_parser::parse_sei()
           ALOGV("-->SEI payload type [%u] not implemented! size[%u]", payload_type, payload_size);
       }
     }
-    processed_bytes += (payload_size + emulation_code_skip_cntr);
-    ALOGV("-->SEI processed_bytes[%u]", processed_bytes);
+    bits.seek(payload_start + (payload_size << 3));
+    ALOGV("-->SEI processed_bytes[%u]", bits.bit_pos() >> 3);
   }
   ALOGV("@@parse_sei: OUT");
 }
@@ -1147,79 +1221,27 @@ void h264_stream_parser::scaling_list(OMX_U32 size_of_scaling_list)
 
 OMX_U32 h264_stream_parser::extract_bits(OMX_U32 n)
 {
-  OMX_U32 value = 0;
   if (n > 32)
   {
     ALOGE("ERROR: extract_bits limit to 32 bits!");
-    return value;
+    return 0;
   }
-  value = curr_32_bit >> (32 - n);
-  if (bits_read < n)
-  {
-    n -= bits_read;
-    read_word();
-    value |= (curr_32_bit >> (32 - n));
-    if (bits_read < n)
-    {
-      ALOGV("ERROR: extract_bits underflow!");
-      value >>= (n - bits_read);
-      n = bits_read;
-    }
-  }
-  bits_read -= n;
-  curr_32_bit <<= n;
-  return value;
-}
-
-void h264_stream_parser::read_word()
-{
-  curr_32_bit = 0;
-  bits_read = 0;
-  while (bitstream_bytes && bits_read < 32)
-  {
-    if (*bitstream == EMULATION_PREVENTION_THREE_BYTE &&
-        zero_cntr >= 2 && emulation_sc_enabled)
-    {
-      ALOGV("EMULATION_PREVENTION_THREE_BYTE: Skip 0x03 byte aligned!");
-      emulation_code_skip_cntr++;
-    }
-    else
-    {
-      curr_32_bit <<= 8;
-      curr_32_bit |= *bitstream;
-      bits_read += 8;
-    }
-    if (*bitstream == 0)
-      zero_cntr++;
-    else
-      zero_cntr = 0;
-    bitstream++;
-    bitstream_bytes--;
-  }
-  curr_32_bit <<= (32 - bits_read);
+  return bits.u(n);
 }
 
 OMX_U32 h264_stream_parser::uev()
 {
-  OMX_U32 lead_zero_bits = 0, code_num = 0;
-  while(!extract_bits(1) && more_bits())
-    lead_zero_bits++;
-  code_num = lead_zero_bits == 0 ? 0 :
-    (1 << lead_zero_bits) - 1 + extract_bits(lead_zero_bits);
-  return code_num;
+  return bits.ue();
 }
 
 bool h264_stream_parser::more_bits()
 {
-  return (bitstream_bytes > 0 || bits_read > 0);
+  return bits.more_bits();
 }
 
 OMX_S32 h264_stream_parser::sev()
 {
-  OMX_U32 code_num = uev();
-  OMX_S32 ret;
-  ret = (code_num + 1) >> 1;
-  return ((code_num & 1) ? ret : -ret);
+  return bits.se();
 }
 
 OMX_S32 h264_stream_parser::iv(OMX_U32 n_bits)
@@ -1395,15 +1417,18 @@ void h264_stream_parser::get_frame_rate(OMX_U32 *frame_rate)
 
 void h264_stream_parser::parse_nal(OMX_U8* data_ptr, OMX_U32 data_len, OMX_U32 nal_type, bool enable_emu_sc)
 {
-  OMX_U32 nal_unit_type = NALU_TYPE_UNSPECIFIED, cons_bytes = 0;
+  OMX_U32 nal_unit_type = NALU_TYPE_UNSPECIFIED;
   ALOGV("parse_nal(): IN nal_type(%lu)", nal_type);
   if (!data_len)
     return;
-  init_bitstream(data_ptr, data_len);
-  emulation_sc_enabled = enable_emu_sc;
+  if (!bits.init(data_ptr, data_len, enable_emu_sc))
+  {
+    ALOGE("parse_nal(): no memory for %lu byte RBSP", data_len);
+    return;
+  }
   if (nal_type != NALU_TYPE_VUI)
   {
-    cons_bytes = get_nal_unit_type(&nal_unit_type);
+    get_nal_unit_type(&nal_unit_type);
     if (nal_type != nal_unit_type && nal_type != NALU_TYPE_UNSPECIFIED)
     {
       ALOGV("Unexpected nal_type(%x) expected(%x)", nal_unit_type, nal_type);
@@ -1420,7 +1445,6 @@ void h264_stream_parser::parse_nal(OMX_U8* data_ptr, OMX_U32 data_len, OMX_U32 n
 #endif
     break;
     case NALU_TYPE_SEI:
-      init_bitstream(data_ptr + cons_bytes, data_len - cons_bytes);
       parse_sei();
     break;
     case NALU_TYPE_VUI:
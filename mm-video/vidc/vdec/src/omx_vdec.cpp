@@ -46,6 +46,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <unistd.h>
 #include <errno.h>
 #include "omx_vdec.h"
+#include "h264_nal_length.h"
 #include <fcntl.h>
 #include <limits.h>
 #include <QServiceUtils.h>
@@ -227,6 +228,7 @@ void* message_thread(void *input)
 
     if (1 == n)
     {
+        omx->m_msg_wakeup.rearm();
         omx->process_event_cb(omx, id);
     }
     if ((n < 0) && (errno != EINTR))
@@ -235,7 +237,8 @@ void* message_thread(void *input)
       break;
     }
   }
-  DEBUG_PRINT_HIGH("omx_vdec: message thread stop");
+  DEBUG_PRINT_HIGH("omx_vdec: message thread stop, wakeups %u coalesced %u",
+      omx->m_msg_wakeup.get_signalled(), omx->m_msg_wakeup.get_coalesced());
   return 0;
 }
 
@@ -356,113 +359,49 @@ bool omx_vdec::omx_cmd_queue::pop_entry(unsigned *p1, unsigned *p2, unsigned *id
   return ret;
 }
 
-// Retrieve the first mesg type in the queue
-unsigned omx_vdec::omx_cmd_queue::get_q_msg_type()
+// omx cmd queue pop of up to max entries, returns the number popped
+unsigned omx_vdec::omx_cmd_queue::pop_entries(unsigned *p1, unsigned *p2,
+                                              unsigned *id, unsigned max)
 {
-    return m_q[m_read].id;
+  unsigned count = 0;
+  while (count < max && pop_entry(&p1[count], &p2[count], &id[count]))
+  {
+    count++;
+  }
+  return count;
 }
 
-#ifdef _ANDROID_
-omx_vdec::ts_arr_list::ts_arr_list()
-{
-  //initialize timestamps array
-  memset(m_ts_arr_list, 0, ( sizeof(ts_entry) * MAX_NUM_INPUT_OUTPUT_BUFFERS) );
-}
-omx_vdec::ts_arr_list::~ts_arr_list()
+// Retrieve the first mesg type in the queue
+unsigned omx_vdec::omx_cmd_queue::get_q_msg_type()
 {
-  //free m_ts_arr_list?
+    return m_q[m_read].id;
 }
 
-bool omx_vdec::ts_arr_list::insert_ts(OMX_TICKS ts)
+void omx_vdec::decode_only_list::insert_ts(OMX_TICKS ts)
 {
-  bool ret = true;
-  bool duplicate_ts = false;
-  int idx = 0;
-
-  //insert at the first available empty location
-  for ( ; idx < MAX_NUM_INPUT_OUTPUT_BUFFERS; idx++)
-  {
-    if (!m_ts_arr_list[idx].valid)
-    {
-      //found invalid or empty entry, save timestamp
-      m_ts_arr_list[idx].valid = true;
-      m_ts_arr_list[idx].timestamp = ts;
-      DEBUG_PRINT_LOW("Insert_ts(): Inserting TIMESTAMP (%lld) at idx (%d)",
-                       ts, idx);
-      break;
-    }
-  }
-
-  if (idx == MAX_NUM_INPUT_OUTPUT_BUFFERS)
+  //input the driver dropped never comes back out, forget the oldest
+  if (m_count == MAX_NUM_INPUT_OUTPUT_BUFFERS)
   {
-    DEBUG_PRINT_LOW("Timestamp array list is FULL. Unsuccessful insert");
-    ret = false;
+    memmove(m_ts, m_ts + 1, (m_count - 1) * sizeof(m_ts[0]));
+    m_count--;
   }
-  return ret;
+  m_ts[m_count++] = ts;
 }
 
-bool omx_vdec::ts_arr_list::pop_min_ts(OMX_TICKS &ts)
+bool omx_vdec::decode_only_list::remove_ts(OMX_TICKS ts)
 {
-  bool ret = true;
-  int min_idx = -1;
-  OMX_TICKS min_ts = 0;
-  int idx = 0;
-
-  for ( ; idx < MAX_NUM_INPUT_OUTPUT_BUFFERS; idx++)
+  for (unsigned i = 0; i < m_count; i++)
   {
-
-    if (m_ts_arr_list[idx].valid)
+    if (m_ts[i] == ts)
     {
-      //found valid entry, save index
-      if (min_idx < 0)
-      {
-        //first valid entry
-        min_ts = m_ts_arr_list[idx].timestamp;
-        min_idx = idx;
-      }
-      else if (m_ts_arr_list[idx].timestamp < min_ts)
-      {
-        min_ts = m_ts_arr_list[idx].timestamp;
-        min_idx = idx;
-      }
+      memmove(m_ts + i, m_ts + i + 1, (m_count - i - 1) * sizeof(m_ts[0]));
+      m_count--;
+      return true;
     }
-
   }
-
-  if (min_idx < 0)
-  {
-    //no valid entries found
-    DEBUG_PRINT_LOW("Timestamp array list is empty. Unsuccessful pop");
-    ts = 0;
-    ret = false;
-  }
-  else
-  {
-    ts = m_ts_arr_list[min_idx].timestamp;
-    m_ts_arr_list[min_idx].valid = false;
-    DEBUG_PRINT_LOW("Pop_min_ts:Timestamp (%lld), index(%d)",
-                     ts, min_idx);
-  }
-
-  return ret;
-
+  return false;
 }
 
-
-bool omx_vdec::ts_arr_list::reset_ts_list()
-{
-  bool ret = true;
-  int idx = 0;
-
-  DEBUG_PRINT_LOW("reset_ts_list(): Resetting timestamp array list");
-  for ( ; idx < MAX_NUM_INPUT_OUTPUT_BUFFERS; idx++)
-  {
-    m_ts_arr_list[idx].valid = false;
-  }
-  return ret;
-}
-#endif
-
 // factory function executed by the core to create instances
 void *get_omx_component_factory_fn(void)
 {
@@ -547,6 +486,9 @@ omx_vdec::omx_vdec(): m_state(OMX_StateInvalid),
                       ouput_egl_buffers(false),
                       h264_parser(NULL),
                       client_extradata(0),
+                      m_extradata_index(false),
+                      m_extradata_frames(0),
+                      m_extradata_copied(0),
                       h264_last_au_ts(LLONG_MAX),
                       h264_last_au_flags(0),
                       m_inp_err_count(0),
@@ -555,6 +497,7 @@ omx_vdec::omx_vdec(): m_state(OMX_StateInvalid),
                       m_smoothstreaming_height(0),
                       m_smoothstreaming_width(0),
                       m_use_smoothstreaming(false),
+                      m_aligned_input(false),
 #ifdef _ANDROID_
                       m_heap_ptr(NULL),
                       m_heap_count(0),
@@ -562,6 +505,7 @@ omx_vdec::omx_vdec(): m_state(OMX_StateInvalid),
                       m_use_android_native_buffers(OMX_FALSE),
 #endif
                       in_reconfig(false),
+                      m_reconfig_start_us(0),
                       m_use_output_pmem(OMX_FALSE),
                       m_out_mem_region_smi(OMX_FALSE),
                       m_out_pvt_entry_pmem(OMX_FALSE),
@@ -605,6 +549,14 @@ omx_vdec::omx_vdec(): m_state(OMX_StateInvalid),
   m_debug_concealedmb = atoi(property_value);
   DEBUG_PRINT_HIGH("vidc.dec.debug.concealedmb value is %d",m_debug_concealedmb);
 
+  /* Arbitrary bytes buffers flagged OMX_BUFFERFLAG_ENDOFFRAME that begin */
+  /* with a start code are submitted without start code parsing, enable */
+  /* with setprop vidc.dec.aligned.input 1 */
+  property_value[0] = NULL;
+  property_get("vidc.dec.aligned.input", property_value, "0");
+  m_aligned_input = atoi(property_value);
+  DEBUG_PRINT_HIGH("vidc.dec.aligned.input value is %d",m_aligned_input);
+
 #endif
   memset(&m_cmp,0,sizeof(m_cmp));
   memset(&m_cb,0,sizeof(m_cb));
@@ -683,6 +635,12 @@ omx_vdec::~omx_vdec()
   m_pmem_info = NULL;
   DEBUG_PRINT_HIGH("In OMX Vdec Destructor(), Vdec instances = %d",
      m_vdec_num_instances);
+  if (m_extradata_frames)
+    DEBUG_PRINT_HIGH("Extradata cost: %.2f us/frame over %u frames, "
+       "%llu bytes copied (index %s)",
+       (float)m_extradata_cost.processing_time_us() / m_extradata_frames,
+       m_extradata_frames, m_extradata_copied,
+       m_extradata_index ? "on" : "off");
   if(m_pipe_in > 0)
     close(m_pipe_in);
   if(m_pipe_out > 0)
@@ -719,11 +677,17 @@ omx_vdec::~omx_vdec()
     sendBroadCastEvent(String16("qualcomm.intent.action.SECURE_END_DONE"));
 #endif /* _ANDROID_ */
 
+#ifdef USE_ION
+  vidc_ion_pool::get()->drain(this);
+#endif
   m_vdec_num_instances--;
   if (!m_vdec_num_instances)
   {
     DEBUG_PRINT_HIGH("Calling close() on vdec ion devicefd = %d",
        m_vdec_ion_devicefd);
+#ifdef USE_ION
+    vidc_ion_pool::get()->log_stats("omx_vdec");
+#endif
     close(m_vdec_ion_devicefd);
     m_vdec_ion_devicefd = 0;
     pthread_mutex_destroy(&m_vdec_ionlock);
@@ -757,6 +721,11 @@ void omx_vdec::process_event_cb(void *ctxt, unsigned char id)
   unsigned p2; // Parameter - 2
   unsigned ident;
   unsigned qsize=0; // qsize
+  // ETB/FTB events are popped in runs under one lock acquisition
+  unsigned batch_p1[QOMX_VIDEO_MAX_BUFFER_BATCH];
+  unsigned batch_p2[QOMX_VIDEO_MAX_BUFFER_BATCH];
+  unsigned batch_id[QOMX_VIDEO_MAX_BUFFER_BATCH];
+  unsigned batch_cnt = 0, batch_pos = 0;
   omx_vdec *pThis = (omx_vdec *) ctxt;
 
   if(!pThis)
@@ -769,32 +738,54 @@ void omx_vdec::process_event_cb(void *ctxt, unsigned char id)
   // Protect the shared queue data structure
   do
   {
-    /*Read the message id's from the queue*/
-    pthread_mutex_lock(&pThis->m_lock);
-    qsize = pThis->m_cmd_q.m_size;
-    if(qsize)
+    if (batch_pos < batch_cnt)
     {
-      pThis->m_cmd_q.pop_entry(&p1,&p2,&ident);
+      /*Next buffer of the run popped below, no need to take the lock*/
+      p1 = batch_p1[batch_pos];
+      p2 = batch_p2[batch_pos];
+      ident = batch_id[batch_pos];
+      batch_pos++;
+      qsize = 1;
     }
-
-    if (qsize == 0 && pThis->m_state != OMX_StatePause)
+    else
     {
-      qsize = pThis->m_ftb_q.m_size;
-      if (qsize)
+      /*Read the message id's from the queue*/
+      pthread_mutex_lock(&pThis->m_lock);
+      qsize = pThis->m_cmd_q.m_size;
+      if(qsize)
       {
-        pThis->m_ftb_q.pop_entry(&p1,&p2,&ident);
+        pThis->m_cmd_q.pop_entry(&p1,&p2,&ident);
       }
-    }
 
-    if (qsize == 0 && pThis->m_state != OMX_StatePause)
-    {
-      qsize = pThis->m_etb_q.m_size;
-      if (qsize)
+      if (qsize == 0 && pThis->m_state != OMX_StatePause)
       {
-        pThis->m_etb_q.pop_entry(&p1,&p2,&ident);
+        qsize = pThis->m_ftb_q.m_size;
+        if (qsize)
+        {
+          batch_cnt = pThis->m_ftb_q.pop_entries(batch_p1, batch_p2, batch_id,
+                                                 QOMX_VIDEO_MAX_BUFFER_BATCH);
+        }
+      }
+
+      if (qsize == 0 && pThis->m_state != OMX_StatePause)
+      {
+        qsize = pThis->m_etb_q.m_size;
+        if (qsize)
+        {
+          batch_cnt = pThis->m_etb_q.pop_entries(batch_p1, batch_p2, batch_id,
+                                                 QOMX_VIDEO_MAX_BUFFER_BATCH);
+        }
+      }
+      pthread_mutex_unlock(&pThis->m_lock);
+
+      if (batch_cnt)
+      {
+        p1 = batch_p1[0];
+        p2 = batch_p2[0];
+        ident = batch_id[0];
+        batch_pos = 1;
       }
     }
-    pthread_mutex_unlock(&pThis->m_lock);
 
     /*process message if we have one*/
     if(qsize > 0)
@@ -859,6 +850,16 @@ void omx_vdec::process_event_cb(void *ctxt, unsigned char id)
                 break;
               case OMX_CommandPortEnable:
                 DEBUG_PRINT_HIGH("OMX_CommandPortEnable complete for port [%d]", p2);
+#ifdef USE_ION
+                if (p2 == OMX_CORE_OUTPUT_PORT_INDEX && pThis->m_reconfig_start_us)
+                {
+                  vidc_ion_pool *pool = vidc_ion_pool::get();
+                  pool->record_reconfig((uint32_t)(vidc_ion_pool::now_us() -
+                      pThis->m_reconfig_start_us));
+                  pThis->m_reconfig_start_us = 0;
+                  pool->log_stats("omx_vdec reconfig done");
+                }
+#endif
                 pThis->m_cb.EventHandler(&pThis->m_cmp, pThis->m_app_data,\
                                       OMX_EventCmdComplete, p1, p2, NULL );
                 break;
@@ -1288,6 +1289,9 @@ void omx_vdec::process_event_cb(void *ctxt, unsigned char id)
           break;
         }
       }
+    if (batch_pos < batch_cnt)
+      continue;
+    batch_pos = batch_cnt = 0;
     pthread_mutex_lock(&pThis->m_lock);
     qsize = pThis->m_cmd_q.m_size;
     if (pThis->m_state != OMX_StatePause)
@@ -2608,6 +2612,7 @@ bool omx_vdec::execute_input_flush()
     prev_ts = LLONG_MAX;
     rst_prev_ts = true;
   }
+  m_decode_only_ts.reset();
 #ifdef _ANDROID_
   if (m_debug_timestamp)
   {
@@ -2637,34 +2642,67 @@ RETURN VALUE
 bool omx_vdec::post_event(unsigned int p1,
                           unsigned int p2,
                           unsigned int id)
+{
+  return post_events(p1, &p2, &id, 1);
+}
+
+/* ======================================================================
+FUNCTION
+  omx_vdec::post_events
+
+DESCRIPTION
+  Queue several events under one lock acquisition and wake the message
+  thread once for all of them.
+
+PARAMETERS
+  p1 : first parameter shared by all events
+  p2, id : per event second parameter and event identifier
+  count : number of events
+
+RETURN VALUE
+  true/false
+
+========================================================================== */
+bool omx_vdec::post_events(unsigned int p1,
+                           const unsigned int *p2,
+                           const unsigned int *id,
+                           unsigned int count)
 {
   bool bRet      =                      false;
+  unsigned int i;
 
+  if (!count)
+    return true;
 
   pthread_mutex_lock(&m_lock);
 
-  if (id == m_fill_output_msg ||
-      id == OMX_COMPONENT_GENERATE_FBD)
+  for (i = 0; i < count; i++)
   {
-    m_ftb_q.insert_entry(p1,p2,id);
-  }
-  else if (id == OMX_COMPONENT_GENERATE_ETB ||
-           id == OMX_COMPONENT_GENERATE_EBD ||
-           id == OMX_COMPONENT_GENERATE_ETB_ARBITRARY)
-  {
-    m_etb_q.insert_entry(p1,p2,id);
-  }
-  else
-  {
-    m_cmd_q.insert_entry(p1,p2,id);
+    if (id[i] == m_fill_output_msg ||
+        id[i] == OMX_COMPONENT_GENERATE_FBD)
+    {
+      m_ftb_q.insert_entry(p1,p2[i],id[i]);
+    }
+    else if (id[i] == OMX_COMPONENT_GENERATE_ETB ||
+             id[i] == OMX_COMPONENT_GENERATE_EBD ||
+             id[i] == OMX_COMPONENT_GENERATE_ETB_ARBITRARY)
+    {
+      m_etb_q.insert_entry(p1,p2[i],id[i]);
+    }
+    else
+    {
+      m_cmd_q.insert_entry(p1,p2[i],id[i]);
+    }
+    DEBUG_PRINT_LOW("Value of this pointer in post_event 0x%x", p2[i]);
   }
 
   bRet = true;
-  DEBUG_PRINT_LOW("Value of this pointer in post_event 0x%x", p2);
-  post_message(this, id);
 
   pthread_mutex_unlock(&m_lock);
 
+  if (m_msg_wakeup.signal())
+    post_message(this, id[0]);
+
   return bRet;
 }
 #ifdef MAX_RES_720P
@@ -3728,6 +3766,24 @@ OMX_ERRORTYPE  omx_vdec::set_parameter(OMX_IN OMX_HANDLETYPE     hComp,
         }
       }
       break;
+    case OMX_QcomIndexParamVideoExtraDataIndex:
+      {
+        if (m_state != OMX_StateLoaded) {
+          DEBUG_PRINT_ERROR("ERROR: extradata index allowed in Loaded state only");
+          eRet = OMX_ErrorIncorrectStateOperation;
+        } else if (secure_mode || drv_ctx.enable_sec_metadata) {
+          DEBUG_PRINT_ERROR("\n secure mode setting not supported");
+          eRet = OMX_ErrorUnsupportedSetting;
+        } else {
+          m_extradata_index =
+            (((QOMX_ENABLETYPE *)paramData)->bEnable == OMX_TRUE);
+          DEBUG_PRINT_HIGH("set_parameter: extradata index %s",
+             m_extradata_index ? "enabled" : "disabled");
+          // the index takes its own space at the end of the buffer
+          eRet = get_buffer_req(&drv_ctx.op_buf);
+        }
+      }
+      break;
     case OMX_QcomIndexParamH264TimeInfo:
       {
         if(!secure_mode || drv_ctx.enable_sec_metadata)
@@ -4168,61 +4224,45 @@ OMX_ERRORTYPE  omx_vdec::set_config(OMX_IN OMX_HANDLETYPE      hComp,
     if (!strcmp(drv_ctx.kind, "OMX.qcom.video.decoder.avc"))
     {
       DEBUG_PRINT_LOW("Index OMX_IndexVendorVideoExtraData AVC");
-      OMX_U32 extra_size;
-      // Parsing done here for the AVC atom is definitely not generic
-      // Currently this piece of code is working, but certainly
-      // not tested with all .mp4 files.
-      // Incase of failure, we might need to revisit this
-      // for a generic piece of code.
+      int size;
 
+      if (config->nDataSize < 7)
+      {
+        DEBUG_PRINT_ERROR("\n AVC atom of size %d too short", config->nDataSize);
+        return OMX_ErrorBadParameter;
+      }
       // Retrieve size of NAL length field
       // byte #4 contains the size of NAL lenght field
       nal_length = (config->pData[4] & 0x03) + 1;
 
-      extra_size = 0;
-      if (nal_length > 2)
+      // Every SPS and PPS of the avcC atom is rewritten with a NAL length
+      // field of nal_length bytes, sized exactly before copying once
+      size = h264_nal_length::from_avcc(NULL, config->pData,
+                                        config->nDataSize, nal_length);
+      if (size <= 0)
       {
-        /* Presently we assume that only one SPS and one PPS in AvC1 Atom */
-        extra_size = (nal_length - 2) * 2;
+        DEBUG_PRINT_ERROR("\n Malformed AVC atom of size %d", config->nDataSize);
+        return OMX_ErrorBadParameter;
+      }
+      if (m_vendor_config.pData)
+      {
+        free(m_vendor_config.pData);
       }
-
-      // SPS starts from byte #6
-      OMX_U8 *pSrcBuf = (OMX_U8 *) (&config->pData[6]);
-      OMX_U8 *pDestBuf;
       m_vendor_config.nPortIndex = config->nPortIndex;
-
-      // minus 6 --> SPS starts from byte #6
-      // minus 1 --> picture param set byte to be ignored from avcatom
-      m_vendor_config.nDataSize = config->nDataSize - 6 - 1 + extra_size;
+      m_vendor_config.nDataSize = size;
       m_vendor_config.pData = (OMX_U8 *) malloc(m_vendor_config.nDataSize);
-      OMX_U32 len;
-      OMX_U8 index = 0;
-      // case where SPS+PPS is sent as part of set_config
-      pDestBuf = m_vendor_config.pData;
+      if (!m_vendor_config.pData)
+      {
+        m_vendor_config.nDataSize = 0;
+        return OMX_ErrorInsufficientResources;
+      }
+      h264_nal_length::from_avcc(m_vendor_config.pData, config->pData,
+                                 config->nDataSize, nal_length);
 
       DEBUG_PRINT_LOW("Rxd SPS+PPS nPortIndex[%d] len[%d] data[0x%x]",
            m_vendor_config.nPortIndex,
            m_vendor_config.nDataSize,
            m_vendor_config.pData);
-      while (index < 2)
-      {
-        uint8 *psize;
-        len = *pSrcBuf;
-        len = len << 8;
-        len |= *(pSrcBuf + 1);
-        psize = (uint8 *) & len;
-        memcpy(pDestBuf + nal_length, pSrcBuf + 2,len);
-        for (int i = 0; i < nal_length; i++)
-        {
-          pDestBuf[i] = psize[nal_length - 1 - i];
-        }
-        //memcpy(pDestBuf,pSrcBuf,(len+2));
-        pDestBuf += len + nal_length;
-        pSrcBuf += len + 2;
-        index++;
-        pSrcBuf++;   // skip picture param set
-        len = 0;
-      }
     }
     else if (!strcmp(drv_ctx.kind, "OMX.qcom.video.decoder.mpeg4") ||
              !strcmp(drv_ctx.kind, "OMX.qcom.video.decoder.mpeg2"))
@@ -4306,6 +4346,11 @@ OMX_ERRORTYPE  omx_vdec::set_config(OMX_IN OMX_HANDLETYPE      hComp,
       }
     }
     break;
+  case OMX_QcomIndexConfigVideoBufferBatch:
+    {
+      ret = submit_buffer_batch(hComp, (QOMX_VIDEO_BUFFER_BATCHTYPE *)configData);
+    }
+    break;
   default:
     {
       DEBUG_PRINT_ERROR("SetConfig: unknown index %d\n", configIndex);
@@ -4342,6 +4387,12 @@ OMX_ERRORTYPE  omx_vdec::get_extension_index(OMX_IN OMX_HANDLETYPE      hComp,
     else if (!strncmp(paramName, "OMX.QCOM.index.param.video.SyncFrameDecodingMode",sizeof("OMX.QCOM.index.param.video.SyncFrameDecodingMode") - 1)) {
         *indexType = (OMX_INDEXTYPE)OMX_QcomIndexParamVideoSyncFrameDecodingMode;
     }
+    else if (!strncmp(paramName, OMX_QCOM_INDEX_CONFIG_VIDEO_BUFFERBATCH, sizeof(OMX_QCOM_INDEX_CONFIG_VIDEO_BUFFERBATCH) - 1)) {
+        *indexType = (OMX_INDEXTYPE)OMX_QcomIndexConfigVideoBufferBatch;
+    }
+    else if (!strncmp(paramName, OMX_QCOM_INDEX_PARAM_VIDEO_EXTRADATAINDEX, sizeof(OMX_QCOM_INDEX_PARAM_VIDEO_EXTRADATAINDEX) - 1)) {
+        *indexType = (OMX_INDEXTYPE)OMX_QcomIndexParamVideoExtraDataIndex;
+    }
 #ifdef MAX_RES_1080P
     else if (!strncmp(paramName, "OMX.QCOM.index.param.IndexExtraData",sizeof("OMX.QCOM.index.param.IndexExtraData") - 1))
     {
@@ -5886,9 +5937,42 @@ RETURN VALUE
 OMX_ERRORTYPE  omx_vdec::empty_this_buffer(OMX_IN OMX_HANDLETYPE         hComp,
                                            OMX_IN OMX_BUFFERHEADERTYPE* buffer)
 {
-  OMX_ERRORTYPE ret1 = OMX_ErrorNone;
+  unsigned event = OMX_COMPONENT_GENERATE_ETB;
+  OMX_ERRORTYPE ret = validate_etb(&buffer, &event);
+
+  if (ret == OMX_ErrorNone)
+    post_event ((unsigned)hComp,(unsigned)buffer,event);
+  return ret;
+}
+
+/* ======================================================================
+FUNCTION
+  omx_vdec::validate_etb
+
+DESCRIPTION
+  Checks an input buffer passed to EmptyThisBuffer and prepares it for
+  queueing.
+
+PARAMETERS
+  buffer : client buffer header, replaced by the header to queue
+  event : set to the message to post for the buffer
+
+RETURN VALUE
+  OMX Error None if the buffer can be queued.
+
+========================================================================== */
+OMX_ERRORTYPE omx_vdec::validate_etb(OMX_BUFFERHEADERTYPE **buffer_hdr,
+                                     unsigned *event)
+{
+  OMX_BUFFERHEADERTYPE *buffer = *buffer_hdr;
   unsigned int nBufferIndex = drv_ctx.ip_buf.actualcount;
 
+  if (buffer == NULL)
+  {
+    DEBUG_PRINT_ERROR("\nERROR:ETB Buffer is NULL");
+    return OMX_ErrorBadParameter;
+  }
+
   if (buffer->nFlags & OMX_BUFFERFLAG_CODECCONFIG)
   {
     codec_config_flag = true;
@@ -5905,12 +5989,6 @@ OMX_ERRORTYPE  omx_vdec::empty_this_buffer(OMX_IN OMX_HANDLETYPE         hComp,
       return OMX_ErrorInvalidState;
   }
 
-  if (buffer == NULL)
-  {
-    DEBUG_PRINT_ERROR("\nERROR:ETB Buffer is NULL");
-    return OMX_ErrorBadParameter;
-  }
-
   if (!m_inp_bEnabled)
   {
     DEBUG_PRINT_ERROR("\nERROR:ETB incorrect state operation, input port is disabled.");
@@ -5974,15 +6052,15 @@ OMX_ERRORTYPE  omx_vdec::empty_this_buffer(OMX_IN OMX_HANDLETYPE         hComp,
     buffer, buffer->pBuffer, buffer->nTimeStamp, buffer->nFilledLen);
   if (arbitrary_bytes)
   {
-    post_event ((unsigned)hComp,(unsigned)buffer,
-                OMX_COMPONENT_GENERATE_ETB_ARBITRARY);
+    *event = OMX_COMPONENT_GENERATE_ETB_ARBITRARY;
   }
   else
   {
     if (!(client_extradata & OMX_TIMEINFO_EXTRADATA))
       set_frame_rate(buffer->nTimeStamp);
-    post_event ((unsigned)hComp,(unsigned)buffer,OMX_COMPONENT_GENERATE_ETB);
+    *event = OMX_COMPONENT_GENERATE_ETB;
   }
+  *buffer_hdr = buffer;
   return OMX_ErrorNone;
 }
 
@@ -6086,19 +6164,14 @@ OMX_ERRORTYPE  omx_vdec::empty_this_buffer_proxy(OMX_IN OMX_HANDLETYPE         h
   /*for use buffer we need to memcpy the data*/
   temp_buffer->buffer_len = buffer->nFilledLen;
 
-  if (input_use_buffer)
+  /*In arbitrary bytes mode push_input_buffer has already assembled the
+    frame in the pmem buffer itself, so only non-arbitrary use buffer copies*/
+  if (input_use_buffer && !arbitrary_bytes)
   {
     if (buffer->nFilledLen <= temp_buffer->buffer_len)
     {
-      if(arbitrary_bytes)
-      {
-        memcpy (temp_buffer->bufferaddr, (buffer->pBuffer + buffer->nOffset),buffer->nFilledLen);
-      }
-      else
-      {
-        memcpy (temp_buffer->bufferaddr, (m_inp_heap_ptr[nPortIndex].pBuffer + m_inp_heap_ptr[nPortIndex].nOffset),
-                buffer->nFilledLen);
-      }
+      memcpy (temp_buffer->bufferaddr, (m_inp_heap_ptr[nPortIndex].pBuffer + m_inp_heap_ptr[nPortIndex].nOffset),
+              buffer->nFilledLen);
     }
     else
     {
@@ -6136,6 +6209,12 @@ OMX_ERRORTYPE  omx_vdec::empty_this_buffer_proxy(OMX_IN OMX_HANDLETYPE         h
   if(!arbitrary_bytes)
   {
       frameinfo.flags |= buffer->nFlags;
+      if ((buffer->nFlags & OMX_BUFFERFLAG_DECODEONLY) &&
+          !(buffer->nFlags & OMX_BUFFERFLAG_CODECCONFIG))
+      {
+        DEBUG_PRINT_LOW("Decode only frame TS(%lld)", buffer->nTimeStamp);
+        m_decode_only_ts.insert_ts(buffer->nTimeStamp);
+      }
   }
 
 
@@ -6226,7 +6305,29 @@ RETURN VALUE
 OMX_ERRORTYPE  omx_vdec::fill_this_buffer(OMX_IN OMX_HANDLETYPE  hComp,
                                           OMX_IN OMX_BUFFERHEADERTYPE* buffer)
 {
+  OMX_ERRORTYPE ret = validate_ftb(buffer);
+
+  if (ret == OMX_ErrorNone)
+    post_event((unsigned) hComp, (unsigned)buffer,m_fill_output_msg);
+  return ret;
+}
+
+/* ======================================================================
+FUNCTION
+  omx_vdec::validate_ftb
+
+DESCRIPTION
+  Checks an output buffer passed to FillThisBuffer.
+
+PARAMETERS
+  buffer : client buffer header
 
+RETURN VALUE
+  OMX Error None if the buffer can be queued.
+
+========================================================================== */
+OMX_ERRORTYPE omx_vdec::validate_ftb(OMX_BUFFERHEADERTYPE *buffer)
+{
   if(m_state == OMX_StateInvalid)
   {
       DEBUG_PRINT_ERROR("FTB in Invalid State\n");
@@ -6252,9 +6353,72 @@ OMX_ERRORTYPE  omx_vdec::fill_this_buffer(OMX_IN OMX_HANDLETYPE  hComp,
   }
 
   DEBUG_PRINT_LOW("[FTB] bufhdr = %p, bufhdr->pBuffer = %p", buffer, buffer->pBuffer);
-  post_event((unsigned) hComp, (unsigned)buffer,m_fill_output_msg);
   return OMX_ErrorNone;
 }
+
+/* ======================================================================
+FUNCTION
+  omx_vdec::submit_buffer_batch
+
+DESCRIPTION
+  Handles OMX_QcomIndexConfigVideoBufferBatch: runs the EmptyThisBuffer or
+  FillThisBuffer checks on each buffer of the batch and queues all the
+  accepted ones with a single post_events, so the message thread picks
+  them up in one wakeup. Stops at the first buffer rejected.
+
+PARAMETERS
+  batch : buffers to submit; nSubmitted is updated
+
+RETURN VALUE
+  OMX Error None if every buffer was queued.
+
+========================================================================== */
+OMX_ERRORTYPE omx_vdec::submit_buffer_batch(OMX_HANDLETYPE hComp,
+                                            QOMX_VIDEO_BUFFER_BATCHTYPE *batch)
+{
+  unsigned int p2[QOMX_VIDEO_MAX_BUFFER_BATCH];
+  unsigned int id[QOMX_VIDEO_MAX_BUFFER_BATCH];
+  OMX_ERRORTYPE ret = OMX_ErrorNone;
+  OMX_U32 i;
+
+  if (batch == NULL || batch->ppBufferHdrs == NULL ||
+      batch->nCount > QOMX_VIDEO_MAX_BUFFER_BATCH)
+  {
+    DEBUG_PRINT_ERROR("\nERROR: invalid buffer batch");
+    return OMX_ErrorBadParameter;
+  }
+  if (batch->nPortIndex != OMX_CORE_INPUT_PORT_INDEX &&
+      batch->nPortIndex != OMX_CORE_OUTPUT_PORT_INDEX)
+  {
+    DEBUG_PRINT_ERROR("\nERROR: buffer batch for invalid port %lu",
+                      batch->nPortIndex);
+    return OMX_ErrorBadPortIndex;
+  }
+
+  for (i = 0; i < batch->nCount; i++)
+  {
+    OMX_BUFFERHEADERTYPE *buffer = batch->ppBufferHdrs[i];
+
+    if (batch->nPortIndex == OMX_CORE_INPUT_PORT_INDEX)
+    {
+      ret = validate_etb(&buffer, &id[i]);
+    }
+    else
+    {
+      ret = validate_ftb(buffer);
+      id[i] = m_fill_output_msg;
+    }
+    if (ret != OMX_ErrorNone)
+      break;
+    p2[i] = (unsigned)buffer;
+  }
+
+  DEBUG_PRINT_LOW("Buffer batch on port %lu: %lu of %lu queued",
+                  batch->nPortIndex, i, batch->nCount);
+  batch->nSubmitted = i;
+  post_events((unsigned)hComp, p2, id, i);
+  return ret;
+}
 /* ======================================================================
 FUNCTION
   omx_vdec::fill_this_buffer_proxy
@@ -7060,6 +7224,9 @@ OMX_ERRORTYPE omx_vdec::fill_buffer_done(OMX_HANDLETYPE hComp,
     (drv_ctx.interlace != VDEC_InterlaceFrameProgressive)
      ?true:false);
 
+    if (buffer->nFilledLen && m_decode_only_ts.remove_ts(buffer->nTimeStamp))
+      buffer->nFlags |= OMX_BUFFERFLAG_DECODEONLY;
+
     if (m_debug_timestamp)
     {
       OMX_TICKS expected_ts = 0;
@@ -7079,10 +7246,13 @@ OMX_ERRORTYPE omx_vdec::fill_buffer_done(OMX_HANDLETYPE hComp,
     {
       if (client_extradata)
       {
+        m_extradata_cost.start();
         if(drv_ctx.enable_sec_metadata)
           handle_extradata_secure(buffer);
         else
           handle_extradata(buffer);
+        m_extradata_cost.stop();
+        m_extradata_frames++;
       }
       if (client_extradata & OMX_TIMEINFO_EXTRADATA)
         // Keep min timestamp interval to handle corrupted bit stream scenario
@@ -7556,6 +7726,18 @@ OMX_ERRORTYPE omx_vdec::push_input_sc_codec(OMX_HANDLETYPE hComp)
   OMX_U32 partial_frame = 1;
   OMX_BOOL generate_ebd = OMX_TRUE;
   unsigned address,p2,id;
+  bool fallback = false;
+  OMX_ERRORTYPE ret = OMX_ErrorNone;
+
+  if (m_aligned_input && frame_count && !pdest_frame->nFilledLen &&
+      m_frame_parser.is_frame_aligned(psource_frame))
+  {
+    ret = push_input_aligned_frame(hComp, &fallback);
+    if (ret != OMX_ErrorNone || !fallback)
+    {
+      return ret;
+    }
+  }
 
   DEBUG_PRINT_LOW("Start Parsing the bit stream address %p TimeStamp %d",
         psource_frame,psource_frame->nTimeStamp);
@@ -7653,6 +7835,30 @@ OMX_ERRORTYPE omx_vdec::push_input_sc_codec(OMX_HANDLETYPE hComp)
         generate_ebd = OMX_FALSE;
       }
    }
+    else if (m_aligned_input && frame_count && pdest_frame &&
+             pdest_frame->nFilledLen &&
+             (psource_frame->nFlags & OMX_BUFFERFLAG_ENDOFFRAME) &&
+             m_frame_parser.at_frame_boundary())
+    {
+      /*Source ended on a frame boundary, no need to wait for the next
+        start code before pushing the frame to the Decoder*/
+      DEBUG_PRINT_LOW("End of frame Found start Decoding Size =%d",
+                   pdest_frame->nFilledLen);
+      pdest_frame->nFlags &= ~OMX_BUFFERFLAG_EOS;
+      if (empty_this_buffer_proxy(hComp,pdest_frame) != OMX_ErrorNone)
+      {
+        return OMX_ErrorBadParameter;
+      }
+      frame_count++;
+      pdest_frame = NULL;
+
+      if (m_input_free_q.m_size)
+      {
+        m_input_free_q.pop_entry(&address,&p2,&id);
+        pdest_frame = (OMX_BUFFERHEADERTYPE *) address;
+        pdest_frame->nFilledLen = 0;
+      }
+    }
     if(generate_ebd)
     {
       DEBUG_PRINT_LOW("Buffer Consumed return back to client %p",psource_frame);
@@ -7674,6 +7880,111 @@ OMX_ERRORTYPE omx_vdec::push_input_sc_codec(OMX_HANDLETYPE hComp)
   return OMX_ErrorNone;
 }
 
+/* Pushes a source buffer holding whole frames without parsing it. If the
+ * frame cannot be taken as is, *fallback is set and nothing is consumed,
+ * so that the caller parses the buffer instead. */
+OMX_ERRORTYPE omx_vdec::push_input_aligned_frame (OMX_HANDLETYPE hComp,
+                                                  bool *fallback)
+{
+  unsigned address,p2,id;
+
+  *fallback = false;
+  DEBUG_PRINT_LOW("Aligned source buffer %p size %d TimeStamp %lld",
+        psource_frame,psource_frame->nFilledLen,psource_frame->nTimeStamp);
+  if (codec_type_parse == CODEC_TYPE_H264 && nal_length)
+  {
+    OMX_U8 *psource = psource_frame->pBuffer + psource_frame->nOffset;
+    OMX_U32 source_len = psource_frame->nFilledLen;
+    OMX_U8 *pdest = pdest_frame->pBuffer + pdest_frame->nOffset +
+                    pdest_frame->nFilledLen;
+    OMX_U32 nal_types = 0;
+
+    if (m_frame_parser.convert_nal_length_frame(psource_frame,pdest_frame,
+                                                &nal_types) == -1)
+    {
+      /*Truncated or too large: leave it to the per-NAL parser*/
+      DEBUG_PRINT_HIGH("NAL length frame of %d bytes does not convert, parsing it",
+          psource_frame->nFilledLen);
+      *fallback = true;
+      return OMX_ErrorNone;
+    }
+    if (nal_types & ((1 << NALU_TYPE_SPS) | (1 << NALU_TYPE_PPS)))
+    {
+      update_h264_param_sets(pdest, psource, source_len);
+    }
+    if (nal_types & (1 << NALU_TYPE_EOSEQ))
+    {
+      pdest_frame->nFlags |= QOMX_VIDEO_BUFFERFLAG_EOSEQ;
+    }
+    h264_last_au_ts = LLONG_MAX;
+  }
+  else if (m_frame_parser.copy_aligned_frame(psource_frame,pdest_frame) == -1)
+  {
+    DEBUG_PRINT_HIGH("Aligned frame of %d bytes does not fit, parsing it",
+        psource_frame->nFilledLen);
+    *fallback = true;
+    return OMX_ErrorNone;
+  }
+
+  /*Push the frame to the Decoder*/
+  if (empty_this_buffer_proxy(hComp,pdest_frame) != OMX_ErrorNone)
+  {
+    return OMX_ErrorBadParameter;
+  }
+  frame_count++;
+  pdest_frame = NULL;
+
+  if (m_input_free_q.m_size)
+  {
+    m_input_free_q.pop_entry(&address,&p2,&id);
+    pdest_frame = (OMX_BUFFERHEADERTYPE *) address;
+    pdest_frame->nFilledLen = 0;
+    pdest_frame->nFlags = 0;
+    pdest_frame->nTimeStamp = LLONG_MAX;
+  }
+
+  DEBUG_PRINT_LOW("Buffer Consumed return back to client %p",psource_frame);
+  m_cb.EmptyBufferDone (hComp,m_app_data,psource_frame);
+  psource_frame = NULL;
+
+  if (m_input_pending_q.m_size)
+  {
+    m_input_pending_q.pop_entry(&address,&p2,&id);
+    psource_frame = (OMX_BUFFERHEADERTYPE *) address;
+    DEBUG_PRINT_LOW("Next source Buffer %p time stamp %d",psource_frame,
+            psource_frame->nTimeStamp);
+  }
+  return OMX_ErrorNone;
+}
+
+/* SPS/PPS units of a frame that bypassed the NAL parser still have to
+ * reach H264_Utils and the stream parser. annexb is the converted copy of
+ * the length-prefixed source, which only serves to locate the units. */
+void omx_vdec::update_h264_param_sets (OMX_U8 *annexb, OMX_U8 *source,
+                                       OMX_U32 source_len)
+{
+  OMX_BUFFERHEADERTYPE nal_hdr;
+  OMX_BOOL isNewFrame = OMX_FALSE;
+  OMX_U32 in = 0, out = 0, len = 0, type = 0;
+
+  memset(&nal_hdr, 0, sizeof(nal_hdr));
+  while (source_len - in >= nal_length)
+  {
+    len = h264_nal_length::get(source + in, nal_length);
+    in += nal_length + len;
+    type = len ? (annexb[out + 4] & 0x1F) : NALU_TYPE_UNSPECIFIED;
+    if (type == NALU_TYPE_SPS || type == NALU_TYPE_PPS)
+    {
+      nal_hdr.pBuffer = annexb + out;
+      nal_hdr.nAllocLen = nal_hdr.nFilledLen = len + 4;
+      h264_parser->parse_nal(nal_hdr.pBuffer, nal_hdr.nFilledLen,
+                             NALU_TYPE_SPS);
+      m_frame_parser.mutils->isNewFrame(&nal_hdr, 0, isNewFrame);
+    }
+    out += len + 4;
+  }
+}
+
 OMX_ERRORTYPE omx_vdec::push_input_h264 (OMX_HANDLETYPE hComp)
 {
   OMX_U32 partial_frame = 1;
@@ -7686,6 +7997,21 @@ OMX_ERRORTYPE omx_vdec::push_input_h264 (OMX_HANDLETYPE hComp)
     DEBUG_PRINT_ERROR("\nERROR:H.264 Scratch Buffer not allocated");
     return OMX_ErrorBadParameter;
   }
+  /*Whole access units in NAL length format are converted in one pass, as
+    long as no NAL is pending and SEI/VUI need not be parsed per NAL*/
+  if (m_aligned_input && frame_count && !look_ahead_nal &&
+      !h264_scratch.nFilledLen && !pdest_frame->nFilledLen &&
+      !(psource_frame->nFlags & OMX_BUFFERFLAG_CODECCONFIG) &&
+      !(client_extradata & (OMX_TIMEINFO_EXTRADATA | OMX_FRAMEINFO_EXTRADATA)) &&
+      m_frame_parser.is_nal_length_aligned(psource_frame))
+  {
+    bool fallback = false;
+    OMX_ERRORTYPE ret = push_input_aligned_frame(hComp, &fallback);
+    if (ret != OMX_ErrorNone || !fallback)
+    {
+      return ret;
+    }
+  }
   DEBUG_PRINT_LOW("Pending h264_scratch.nFilledLen %d "
       "look_ahead_nal %d", h264_scratch.nFilledLen, look_ahead_nal);
   DEBUG_PRINT_LOW("Pending pdest_frame->nFilledLen %d",pdest_frame->nFilledLen);
@@ -7956,6 +8282,56 @@ OMX_ERRORTYPE omx_vdec::push_input_h264 (OMX_HANDLETYPE hComp)
         generate_ebd = OMX_FALSE;
       }
     }
+    else if (m_aligned_input && frame_count && pdest_frame &&
+             (pdest_frame->nFilledLen || look_ahead_nal) &&
+             (psource_frame->nFlags & OMX_BUFFERFLAG_ENDOFFRAME) &&
+             !(psource_frame->nFlags & OMX_BUFFERFLAG_CODECCONFIG) &&
+             !(client_extradata & (OMX_TIMEINFO_EXTRADATA | OMX_FRAMEINFO_EXTRADATA)) &&
+             m_frame_parser.at_nal_boundary())
+    {
+      /*Source ended on an access unit boundary, push the frame now rather
+        than on the first NAL of the next one so that the next aligned
+        source takes the one pass conversion*/
+      if (look_ahead_nal)
+      {
+        look_ahead_nal = false;
+        if ((pdest_frame->nAllocLen - pdest_frame->nFilledLen) <
+             h264_scratch.nFilledLen)
+        {
+          DEBUG_PRINT_ERROR("\n Error:5: Destination buffer overflow for H264");
+          return OMX_ErrorBadParameter;
+        }
+        memcpy ((pdest_frame->pBuffer + pdest_frame->nFilledLen),
+                h264_scratch.pBuffer,h264_scratch.nFilledLen);
+        pdest_frame->nFilledLen += h264_scratch.nFilledLen;
+        pdest_frame->nTimeStamp = h264_scratch.nTimeStamp;
+        pdest_frame->nFlags = h264_scratch.nFlags;
+        h264_scratch.nFilledLen = 0;
+      }
+      else if (VALID_TS(h264_last_au_ts) && !VALID_TS(pdest_frame->nTimeStamp))
+      {
+        pdest_frame->nTimeStamp = h264_last_au_ts;
+        pdest_frame->nFlags = h264_last_au_flags;
+      }
+      DEBUG_PRINT_LOW("End of AU Found start Decoding Size =%d",
+                   pdest_frame->nFilledLen);
+      pdest_frame->nFlags &= ~OMX_BUFFERFLAG_EOS;
+      if (empty_this_buffer_proxy(hComp,pdest_frame) != OMX_ErrorNone)
+      {
+        return OMX_ErrorBadParameter;
+      }
+      frame_count++;
+      pdest_frame = NULL;
+      h264_last_au_ts = LLONG_MAX;
+      if (m_input_free_q.m_size)
+      {
+        m_input_free_q.pop_entry(&address,&p2,&id);
+        pdest_frame = (OMX_BUFFERHEADERTYPE *) address;
+        pdest_frame->nFilledLen = 0;
+        pdest_frame->nFlags = 0;
+        pdest_frame->nTimeStamp = LLONG_MAX;
+      }
+    }
   }
   if(generate_ebd && !psource_frame->nFilledLen)
   {
@@ -8114,6 +8490,11 @@ int omx_vdec::alloc_map_ion_memory(OMX_U32 buffer_size,
   } else {
     alloc_data->heap_mask = (ION_HEAP(ION_IOMMU_HEAP_ID));
   }
+  if (!secure_mode && vidc_ion_pool::get()->take(this, fd, alloc_data, fd_data)) {
+    DEBUG_PRINT_HIGH("ion_alloc: pooled buffer, len = %d for %d, fd = %d",
+       alloc_data->len, buffer_size, fd_data->fd);
+    return fd;
+  }
   pthread_mutex_lock(&m_vdec_ionlock);
   rc = ioctl(fd,ION_IOC_ALLOC,alloc_data);
   if (rc || !alloc_data->handle) {
@@ -8155,6 +8536,14 @@ void omx_vdec::free_ion_memory(struct vdec_ion *buf_ion_info) {
        DEBUG_PRINT_ERROR("\n ION: free called with NULL buf_ion_info");
        return;
      }
+     if (!secure_mode && vidc_ion_pool::get()->give(this,
+            buf_ion_info->ion_device_fd, &buf_ion_info->ion_alloc_data,
+            &buf_ion_info->fd_ion_data)) {
+       buf_ion_info->ion_device_fd = -1;
+       buf_ion_info->ion_alloc_data.handle = NULL;
+       buf_ion_info->fd_ion_data.fd = -1;
+       return;
+     }
      pthread_mutex_lock(&m_vdec_ionlock);
      if (close(buf_ion_info->fd_ion_data.fd)) {
        DEBUG_PRINT_ERROR("\n ION: close(%d) failed, errno = %d",
@@ -8310,6 +8699,9 @@ OMX_ERRORTYPE omx_vdec::get_buffer_req(vdec_allocatorproperty *buffer_prop)
        DEBUG_PRINT_HIGH("Smooth streaming enabled extra_data_size=%d",
          extra_data_size);
     }
+    if (m_extradata_index && client_extradata &&
+        buffer_prop->buffer_type == VDEC_BUFFER_TYPE_OUTPUT)
+      extra_data_size += QOMX_EXTRADATA_INDEX_SIZE;
     if (extra_data_size)
     {
       extra_data_size += sizeof(OMX_OTHER_EXTRADATATYPE); //Space for terminator
@@ -8392,6 +8784,9 @@ OMX_ERRORTYPE omx_vdec::start_port_reconfig()
         }
       }
       in_reconfig = true;
+#ifdef USE_ION
+      m_reconfig_start_us = vidc_ion_pool::now_us();
+#endif
       op_buf_rcnfg.buffer_type = VDEC_BUFFER_TYPE_OUTPUT;
       eRet = get_buffer_req(&op_buf_rcnfg);
       if (m_use_smoothstreaming)
@@ -9008,6 +9403,29 @@ void omx_vdec::handle_extradata_secure(OMX_BUFFERHEADERTYPE *p_buf_hdr)
       }
 }
 
+static void add_extradata_index(QOMX_EXTRADATA_INDEXTYPE *index,
+                                OMX_U8 *base, OMX_OTHER_EXTRADATATYPE *extra)
+{
+  QOMX_EXTRADATA_INDEX_ENTRY *entry;
+  if (!index || index->nCount >= QOMX_EXTRADATA_INDEX_MAX)
+    return;
+  entry = &index->entry[index->nCount++];
+  entry->eType = extra->eType;
+  entry->nOffset = (OMX_U8 *)extra - base;
+  entry->nDataSize = extra->nDataSize;
+}
+
+/* Expose a driver MPEG2 extension/user data record in place */
+static void map_extn_user_extradata(QOMX_EXTRADATA_INDEXTYPE *index,
+                                    OMX_U8 *base, OMX_OTHER_EXTRADATATYPE *extra,
+                                    OMX_U32 type)
+{
+  extra->nVersion.nVersion = OMX_SPEC_VERSION;
+  extra->nPortIndex = OMX_CORE_OUTPUT_PORT_INDEX;
+  extra->eType = (OMX_EXTRADATATYPE)type;
+  add_extradata_index(index, base, extra);
+}
+
 void omx_vdec::handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr)
 {
   OMX_OTHER_EXTRADATATYPE *p_extra = NULL, *p_sei = NULL, *p_vui = NULL, *p_extn_user[32];
@@ -9017,14 +9435,27 @@ void omx_vdec::handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr)
   OMX_U32 frame_rate = 0;
   OMX_U32 extn_user_data_cnt = 0;
   OMX_U8 *conceal_mb_data = NULL;
+  OMX_OTHER_EXTRADATATYPE *p_tail = NULL, *p_index_hdr = NULL;
+  QOMX_EXTRADATA_INDEXTYPE *p_index = NULL;
   struct vdec_output_frameinfo *output_respbuf =
      (struct vdec_output_frameinfo *)p_buf_hdr->pOutputPortPrivate;
   OMX_U32 index = p_buf_hdr - m_out_mem_ptr;
   OMX_U8* pBuffer = (OMX_U8 *)drv_ctx.ptr_outputbuffer[index].bufferaddr;
+  OMX_U8* p_end = pBuffer + p_buf_hdr->nAllocLen;
   p_extra = (OMX_OTHER_EXTRADATATYPE *)
            ((unsigned)(pBuffer + p_buf_hdr->nOffset +
             p_buf_hdr->nFilledLen + 3)&(~3));
-  if ((OMX_U8*)p_extra > (pBuffer + p_buf_hdr->nAllocLen))
+  if (m_extradata_index && p_buf_hdr->nAllocLen > QOMX_EXTRADATA_INDEX_SIZE)
+  {
+    // The index sits at a fixed place at the end of the buffer, records
+    // must stay clear of it
+    p_index_hdr = (OMX_OTHER_EXTRADATATYPE *)
+      (pBuffer + QOMX_EXTRADATA_INDEX_OFFSET(p_buf_hdr->nAllocLen));
+    p_index = (QOMX_EXTRADATA_INDEXTYPE *)p_index_hdr->data;
+    p_index->nCount = 0;
+    p_end = (OMX_U8 *)p_index_hdr;
+  }
+  if ((OMX_U8*)p_extra > p_end)
   {
     DEBUG_PRINT_ERROR("ERROR: p_extra(%p), pBuffer(%p), nAllocLen(%d)",
        p_extra, pBuffer, p_buf_hdr->nAllocLen);
@@ -9040,6 +9471,7 @@ void omx_vdec::handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr)
       p_extra = NULL;
     }
     // Process driver extradata
+    p_tail = p_extra;
     while(p_extra && p_extra->eType != VDEC_EXTRADATA_NONE)
     {
       DEBUG_PRINT_LOW("handle_extradata : pBuf(%p) BufTS(%lld) Type(%x) DataSz(%u)",
@@ -9049,7 +9481,7 @@ void omx_vdec::handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr)
         DEBUG_PRINT_ERROR(" \n Corrupt metadata Buffer size %d payload size %d",
                           p_extra->nSize, p_extra->nDataSize);
         p_extra = (OMX_OTHER_EXTRADATATYPE *) (((OMX_U8 *) p_extra) + p_extra->nSize);
-        if ((OMX_U8*)p_extra > (pBuffer + p_buf_hdr->nAllocLen) ||
+        if ((OMX_U8*)p_extra > p_end ||
             p_extra->nDataSize == 0 || p_extra->nSize == 0)
           p_extra = NULL;
           continue;
@@ -9060,17 +9492,28 @@ void omx_vdec::handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr)
           num_conceal_MB = count_MB_in_extradata(p_extra);
         if (client_extradata & VDEC_EXTRADATA_MB_ERROR_MAP)
         {
-          p_concealmb = (OMX_OTHER_EXTRADATATYPE *) \
-            calloc(1, (sizeof(OMX_OTHER_EXTRADATATYPE)));
-          conceal_mb_data = (OMX_U8 *) calloc(p_extra->nDataSize, sizeof(OMX_U8) );
-          if (p_concealmb && conceal_mb_data)
+          if (p_index)
+          {
+            // Handed out where the driver wrote it
+            p_extra->nVersion.nVersion = OMX_SPEC_VERSION;
+            p_extra->nPortIndex = OMX_CORE_OUTPUT_PORT_INDEX;
+          }
+          else
           {
-              memcpy(conceal_mb_data, p_extra->data, p_extra->nDataSize);
-              p_concealmb->nSize = p_extra->nSize;
-              p_concealmb->nDataSize = p_extra->nDataSize;
+            p_concealmb = (OMX_OTHER_EXTRADATATYPE *) \
+              calloc(1, (sizeof(OMX_OTHER_EXTRADATATYPE)));
+            conceal_mb_data = (OMX_U8 *) calloc(p_extra->nDataSize, sizeof(OMX_U8) );
+            if (p_concealmb && conceal_mb_data)
+            {
+                memcpy(conceal_mb_data, p_extra->data, p_extra->nDataSize);
+                p_concealmb->nSize = p_extra->nSize;
+                p_concealmb->nDataSize = p_extra->nDataSize;
+                m_extradata_copied += p_extra->nDataSize;
+            }
           }
           // Map driver extradata to corresponding OMX type
           p_extra->eType = (OMX_EXTRADATATYPE)OMX_ExtraDataConcealMB;
+          add_extradata_index(p_index, pBuffer, p_extra);
         }
         else
           p_extra->eType = OMX_ExtraDataMax; // Invalid type to avoid expose this extradata to OMX client
@@ -9100,8 +9543,11 @@ void omx_vdec::handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr)
       {
         OMX_U8 *data_ptr = (OMX_U8*)p_extra->data;
         OMX_U32 value = 0;
-        p_extn_user[extn_user_data_cnt] = p_extra;
-        extn_user_data_cnt++;
+        if (p_index)
+          map_extn_user_extradata(p_index, pBuffer, p_extra,
+              OMX_ExtraDataMP2ExtnData);
+        else
+          p_extn_user[extn_user_data_cnt++] = p_extra;
         if((*data_ptr & 0xf0) == 0x20)
         {
           value = ((*data_ptr) & 0x01);
@@ -9119,18 +9565,28 @@ void omx_vdec::handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr)
       }
       else if (p_extra->eType == VDEC_EXTRADATA_USER_DATA)
       {
-        p_extn_user[extn_user_data_cnt] = p_extra;
-        extn_user_data_cnt++;
+        if (p_index)
+          map_extn_user_extradata(p_index, pBuffer, p_extra,
+              OMX_ExtraDataMP2UserData);
+        else
+          p_extn_user[extn_user_data_cnt++] = p_extra;
       }
       print_debug_extradata(p_extra);
       p_extra = (OMX_OTHER_EXTRADATATYPE *) (((OMX_U8 *) p_extra) + p_extra->nSize);
-      if ((OMX_U8*)p_extra > (pBuffer + p_buf_hdr->nAllocLen) ||
+      p_tail = p_extra;
+      if ((OMX_U8*)p_extra > p_end ||
           p_extra->nDataSize == 0 || p_extra->nSize == 0)
         p_extra = NULL;
     }
-    p_extra = (OMX_OTHER_EXTRADATATYPE *)
-               ((unsigned)(pBuffer + p_buf_hdr->nOffset +
-                p_buf_hdr->nFilledLen + 3)&(~3));
+    // With the index the driver records stay and OMX records replace the
+    // driver terminator, otherwise OMX records are rewritten from the start
+    if (p_index)
+      p_extra = (p_tail && (OMX_U8*)p_tail < p_end &&
+                 p_tail->eType == VDEC_EXTRADATA_NONE) ? p_tail : NULL;
+    else
+      p_extra = (OMX_OTHER_EXTRADATATYPE *)
+                 ((unsigned)(pBuffer + p_buf_hdr->nOffset +
+                  p_buf_hdr->nFilledLen + 3)&(~3));
   }
 
 #ifdef PROCESS_EXTRADATA_IN_OUTPUT_PORT
@@ -9157,16 +9613,18 @@ void omx_vdec::handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr)
     for(int i = 0; i < extn_user_data_cnt; i++)
     {
       if (((OMX_U8*)p_extra + p_extn_user[i]->nSize) <
-                        (pBuffer + p_buf_hdr->nAllocLen))
+                        p_end)
       {
         if (p_extn_user[i]->eType == VDEC_EXTRADATA_EXT_DATA)
         {
           append_extn_extradata(p_extra, p_extn_user[i]);
+          m_extradata_copied += p_extra->nDataSize;
           p_extra = (OMX_OTHER_EXTRADATATYPE *) (((OMX_U8 *) p_extra) + p_extra->nSize);
         }
         else if (p_extn_user[i]->eType == VDEC_EXTRADATA_USER_DATA)
         {
           append_user_extradata(p_extra, p_extn_user[i]);
+          m_extradata_copied += p_extra->nDataSize;
           p_extra = (OMX_OTHER_EXTRADATATYPE *) (((OMX_U8 *) p_extra) + p_extra->nSize);
         }
       }
@@ -9174,16 +9632,17 @@ void omx_vdec::handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr)
   }
   if ((client_extradata & OMX_INTERLACE_EXTRADATA) && p_extra &&
       ((OMX_U8*)p_extra + OMX_INTERLACE_EXTRADATA_SIZE) <
-       (pBuffer + p_buf_hdr->nAllocLen))
+       p_end)
   {
     p_buf_hdr->nFlags |= OMX_BUFFERFLAG_EXTRADATA;
     append_interlace_extradata(p_extra,
          ((struct vdec_output_frameinfo *)p_buf_hdr->pOutputPortPrivate)->interlaced_format, index);
+    add_extradata_index(p_index, pBuffer, p_extra);
     p_extra = (OMX_OTHER_EXTRADATATYPE *) (((OMX_U8 *) p_extra) + p_extra->nSize);
   }
   if (client_extradata & OMX_FRAMEINFO_EXTRADATA && p_extra &&
       ((OMX_U8*)p_extra + OMX_FRAMEINFO_EXTRADATA_SIZE) <
-       (pBuffer + p_buf_hdr->nAllocLen))
+       p_end)
   {
     p_buf_hdr->nFlags |= OMX_BUFFERFLAG_EXTRADATA;
     /* vui extra data (frame_rate) information */
@@ -9194,32 +9653,35 @@ void omx_vdec::handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr)
         p_buf_hdr->nTimeStamp, frame_rate,
         &((struct vdec_output_frameinfo *)
           p_buf_hdr->pOutputPortPrivate)->aspect_ratio_info);
+    add_extradata_index(p_index, pBuffer, p_extra);
     p_extra = (OMX_OTHER_EXTRADATATYPE *) (((OMX_U8 *) p_extra) + p_extra->nSize);
   }
   if ((client_extradata & VDEC_EXTRADATA_MB_ERROR_MAP) && p_extra &&
     p_concealmb && conceal_mb_data)
   {
-    if (((OMX_U8*)p_extra + p_concealmb->nSize) < (pBuffer + p_buf_hdr->nAllocLen))
+    if (((OMX_U8*)p_extra + p_concealmb->nSize) < p_end)
     {
       p_buf_hdr->nFlags |= OMX_BUFFERFLAG_EXTRADATA;
       append_concealmb_extradata(p_extra, p_concealmb, conceal_mb_data);
+      m_extradata_copied += p_extra->nDataSize;
       p_extra = (OMX_OTHER_EXTRADATATYPE *) (((OMX_U8 *) p_extra) + p_extra->nSize);
     }
   }
   if ((client_extradata & OMX_PORTDEF_EXTRADATA) &&
        p_extra != NULL &&
       ((OMX_U8*)p_extra + OMX_PORTDEF_EXTRADATA_SIZE) <
-       (pBuffer + p_buf_hdr->nAllocLen))
+       p_end)
   {
     p_buf_hdr->nFlags |= OMX_BUFFERFLAG_EXTRADATA;
     append_portdef_extradata(p_extra);
+    add_extradata_index(p_index, pBuffer, p_extra);
     p_extra = (OMX_OTHER_EXTRADATATYPE *) (((OMX_U8 *) p_extra) + p_extra->nSize);
   }
   if (p_buf_hdr->nFlags & OMX_BUFFERFLAG_EXTRADATA)
   {
     if (p_extra &&
       ((OMX_U8*)p_extra + OMX_FRAMEINFO_EXTRADATA_SIZE) <
-        (pBuffer + p_buf_hdr->nAllocLen))
+        p_end)
     {
       append_terminator_extradata(p_extra);
     }
@@ -9229,6 +9691,14 @@ void omx_vdec::handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr)
       p_buf_hdr->nFlags &= ~OMX_BUFFERFLAG_EXTRADATA;
     }
   }
+  if (p_index && (p_buf_hdr->nFlags & OMX_BUFFERFLAG_EXTRADATA))
+  {
+    p_index_hdr->nSize = QOMX_EXTRADATA_INDEX_SIZE;
+    p_index_hdr->nVersion.nVersion = OMX_SPEC_VERSION;
+    p_index_hdr->nPortIndex = OMX_CORE_OUTPUT_PORT_INDEX;
+    p_index_hdr->eType = (OMX_EXTRADATATYPE)OMX_ExtraDataIndex;
+    p_index_hdr->nDataSize = sizeof(QOMX_EXTRADATA_INDEXTYPE);
+  }
   if(p_concealmb)
   {
     free(p_concealmb);
@@ -9309,6 +9779,9 @@ OMX_ERRORTYPE omx_vdec::enable_extradata(OMX_U32 requested_extradata, bool enabl
   }
   else if ((client_extradata & ~DRIVER_EXTRADATA_MASK) != (requested_extradata & ~DRIVER_EXTRADATA_MASK))
   {
+    if (m_extradata_index && !client_extradata != !requested_extradata)
+      extradata_size += requested_extradata ? QOMX_EXTRADATA_INDEX_SIZE :
+                        -(OMX_U32)QOMX_EXTRADATA_INDEX_SIZE;
     client_extradata = requested_extradata;
     drv_ctx.op_buf.buffer_size += extradata_size;
     // align the buffer size
@@ -9323,19 +9796,16 @@ OMX_ERRORTYPE omx_vdec::enable_extradata(OMX_U32 requested_extradata, bool enabl
 
 OMX_U32 omx_vdec::count_MB_in_extradata(OMX_OTHER_EXTRADATATYPE *extra)
 {
-  OMX_U32 num_MB = 0, byte_count = 0, num_MB_in_frame = 0;
-  OMX_U8 *data_ptr = extra->data, data = 0;
-  while (byte_count < extra->nDataSize)
+  OMX_U32 num_MB = 0, byte_count = 0, num_MB_in_frame = 0, word;
+  OMX_U8 *data_ptr = extra->data;
+  // One bit per concealed MB, counted a word at a time
+  for (; byte_count + sizeof(word) <= extra->nDataSize; byte_count += sizeof(word))
   {
-    data = *data_ptr;
-    while (data)
-    {
-      num_MB += (data&0x01);
-      data >>= 1;
-    }
-    data_ptr++;
-    byte_count++;
+    memcpy(&word, data_ptr + byte_count, sizeof(word));
+    num_MB += __builtin_popcount(word);
   }
+  for (; byte_count < extra->nDataSize; byte_count++)
+    num_MB += __builtin_popcount(data_ptr[byte_count]);
   num_MB_in_frame = ((drv_ctx.video_resolution.frame_width + 15) *
                      (drv_ctx.video_resolution.frame_height + 15)) >> 8;
   return ((num_MB_in_frame > 0)?(num_MB * 100 / num_MB_in_frame) : 0);
@@ -10283,6 +10753,9 @@ OMX_BUFFERHEADERTYPE* omx_vdec::allocate_color_convert_buf::get_il_buf_hdr
     bool status;
     if (!omx->in_reconfig && !omx->output_flush_progress && (bufadd->nFilledLen > 0)) {
       pthread_mutex_lock(&omx->c_lock);
+      /* only the displayed area needs converting; C2D ignores this */
+      c2d.set_crop(omx->rectangle.nLeft, omx->rectangle.nTop,
+                   omx->rectangle.nWidth, omx->rectangle.nHeight);
       status = c2d.convert(omx->drv_ctx.ptr_outputbuffer[index].pmem_fd,
                   bufadd->pBuffer,pmem_fd[index],pmem_baseaddress[index]);
       m_out_mem_ptr_client[index].nFilledLen = buffer_size_req;
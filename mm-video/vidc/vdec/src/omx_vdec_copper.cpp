@@ -229,6 +229,7 @@ void* message_thread(void *input)
 
     if (1 == n)
     {
+        omx->m_msg_wakeup.rearm();
         omx->process_event_cb(omx, id);
     }
     if ((n < 0) && (errno != EINTR))
@@ -237,7 +238,8 @@ void* message_thread(void *input)
       break;
     }
   }
-  DEBUG_PRINT_HIGH("omx_vdec: message thread stop\n");
+  DEBUG_PRINT_HIGH("omx_vdec: message thread stop, wakeups %u coalesced %u\n",
+      omx->m_msg_wakeup.get_signalled(), omx->m_msg_wakeup.get_coalesced());
   return 0;
 }
 
@@ -315,107 +317,6 @@ unsigned omx_vdec::omx_cmd_queue::get_q_msg_type()
     return m_q[m_read].id;
 }
 
-#ifdef _ANDROID_
-omx_vdec::ts_arr_list::ts_arr_list()
-{
-  //initialize timestamps array
-  memset(m_ts_arr_list, 0, ( sizeof(ts_entry) * MAX_NUM_INPUT_OUTPUT_BUFFERS) );
-}
-omx_vdec::ts_arr_list::~ts_arr_list()
-{
-  //free m_ts_arr_list?
-}
-
-bool omx_vdec::ts_arr_list::insert_ts(OMX_TICKS ts)
-{
-  bool ret = true;
-  bool duplicate_ts = false;
-  int idx = 0;
-
-  //insert at the first available empty location
-  for ( ; idx < MAX_NUM_INPUT_OUTPUT_BUFFERS; idx++)
-  {
-    if (!m_ts_arr_list[idx].valid)
-    {
-      //found invalid or empty entry, save timestamp
-      m_ts_arr_list[idx].valid = true;
-      m_ts_arr_list[idx].timestamp = ts;
-      DEBUG_PRINT_LOW("Insert_ts(): Inserting TIMESTAMP (%lld) at idx (%d)",
-                       ts, idx);
-      break;
-    }
-  }
-
-  if (idx == MAX_NUM_INPUT_OUTPUT_BUFFERS)
-  {
-    DEBUG_PRINT_LOW("Timestamp array list is FULL. Unsuccessful insert");
-    ret = false;
-  }
-  return ret;
-}
-
-bool omx_vdec::ts_arr_list::pop_min_ts(OMX_TICKS &ts)
-{
-  bool ret = true;
-  int min_idx = -1;
-  OMX_TICKS min_ts = 0;
-  int idx = 0;
-
-  for ( ; idx < MAX_NUM_INPUT_OUTPUT_BUFFERS; idx++)
-  {
-
-    if (m_ts_arr_list[idx].valid)
-    {
-      //found valid entry, save index
-      if (min_idx < 0)
-      {
-        //first valid entry
-        min_ts = m_ts_arr_list[idx].timestamp;
-        min_idx = idx;
-      }
-      else if (m_ts_arr_list[idx].timestamp < min_ts)
-      {
-        min_ts = m_ts_arr_list[idx].timestamp;
-        min_idx = idx;
-      }
-    }
-
-  }
-
-  if (min_idx < 0)
-  {
-    //no valid entries found
-    DEBUG_PRINT_LOW("Timestamp array list is empty. Unsuccessful pop");
-    ts = 0;
-    ret = false;
-  }
-  else
-  {
-    ts = m_ts_arr_list[min_idx].timestamp;
-    m_ts_arr_list[min_idx].valid = false;
-    DEBUG_PRINT_LOW("Pop_min_ts:Timestamp (%lld), index(%d)",
-                     ts, min_idx);
-  }
-
-  return ret;
-
-}
-
-
-bool omx_vdec::ts_arr_list::reset_ts_list()
-{
-  bool ret = true;
-  int idx = 0;
-
-  DEBUG_PRINT_LOW("reset_ts_list(): Resetting timestamp array list");
-  for ( ; idx < MAX_NUM_INPUT_OUTPUT_BUFFERS; idx++)
-  {
-    m_ts_arr_list[idx].valid = false;
-  }
-  return ret;
-}
-#endif
-
 // factory function executed by the core to create instances
 void *get_omx_component_factory_fn(void)
 {
@@ -2434,10 +2335,12 @@ bool omx_vdec::post_event(unsigned int p1,
 
   bRet = true;
   DEBUG_PRINT_LOW("\n Value of this pointer in post_event %p",this);
-  post_message(this, id);
 
   pthread_mutex_unlock(&m_lock);
 
+  if (m_msg_wakeup.signal())
+    post_message(this, id);
+
   return bRet;
 }
 
@@ -34,19 +34,74 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdlib.h>
 
 
+/* Nodes are carved out of slabs and recycled through a freelist, so once
+   the queue has grown to its working depth push/pop do no heap calls */
+#define QUEUE_NODE_SLAB_SIZE 32
+
 typedef struct Node
 {
   void *element;
   struct Node *next;
 } Node;
 
+typedef struct NodeSlab
+{
+  struct NodeSlab *next;
+  Node nodes[QUEUE_NODE_SLAB_SIZE];
+} NodeSlab;
+
 struct Queue
 {
   Node *head;
   Node *tail;
   int  current_size;
+  Node *free_nodes;
+  NodeSlab *slabs;
+  int  alloc_count;
 };
 
+static Node *get_node(Queue *q)
+{
+  Node *node;
+  int idx;
+
+  if (q->free_nodes == NULL)
+  {
+    NodeSlab *slab = (NodeSlab *) malloc(sizeof(NodeSlab));
+    if (slab == NULL)
+      return NULL;
+    q->alloc_count++;
+    slab->next = q->slabs;
+    q->slabs = slab;
+    for (idx = 0; idx < QUEUE_NODE_SLAB_SIZE; idx++)
+    {
+      slab->nodes[idx].next = q->free_nodes;
+      q->free_nodes = &slab->nodes[idx];
+    }
+  }
+
+  node = q->free_nodes;
+  q->free_nodes = node->next;
+  return node;
+}
+
+static void put_node(Queue *q, Node *node)
+{
+  node->next = q->free_nodes;
+  q->free_nodes = node;
+}
+
+static void free_slabs(Queue *q)
+{
+  while (q->slabs)
+  {
+    NodeSlab *slab = q->slabs;
+    q->slabs = slab->next;
+    free(slab);
+  }
+  q->free_nodes = NULL;
+}
+
 Queue *alloc_queue()
 {
   Queue *q = (Queue *) malloc(sizeof(Queue));
@@ -54,6 +109,9 @@ Queue *alloc_queue()
   {
     q->head = q->tail = NULL;
     q->current_size = 0;
+    q->free_nodes = NULL;
+    q->slabs = NULL;
+    q->alloc_count = 0;
   }
   return q;
 }
@@ -64,6 +122,7 @@ void free_queue(Queue *q)
   {
     pop(q);
   }
+  free_slabs(q);
 }
 
 void free_queue_and_qelement(Queue *q)
@@ -74,11 +133,17 @@ void free_queue_and_qelement(Queue *q)
     if (element)
       free(element);
   }
+  free_slabs(q);
+}
+
+int queue_alloc_count(Queue *q)
+{
+  return q->alloc_count;
 }
 
 int push(Queue *q, void * element)
 {
-  Node *new_node = (Node *) malloc(sizeof(Node));
+  Node *new_node = get_node(q);
 
   if (new_node == NULL)
     return -1;
@@ -121,7 +186,7 @@ void *pop(Queue *q)
     q->head = q->head->next;
   }
 
-  free(temp);
+  put_node(q, temp);
   q->current_size--;
   return element;
 }
@@ -41,139 +41,41 @@ void omx_time_stamp_reorder::enable_debug_print(bool flag)
 
 omx_time_stamp_reorder::~omx_time_stamp_reorder()
 {
-	delete_list();
 }
 
 omx_time_stamp_reorder::omx_time_stamp_reorder()
 {
 	reorder_ts = false;
-	phead = pcurrent = NULL;
+	insert_gen = 0;
 	error = false;
         print_debug = false;
 }
 
-void omx_time_stamp_reorder::delete_list()
-{
-	time_stamp_list *ptemp;
-	if (!phead) return;
-	while(phead->next != phead) {
-		ptemp = phead;
-		phead = phead->next;
-		phead->prev = ptemp->prev;
-		ptemp->prev->next = phead;
-		delete ptemp;
-	}
-	delete phead;
-	phead = NULL;
-}
-
-bool omx_time_stamp_reorder::get_current_list()
-{
-	if (!phead) {
-		if(!add_new_list()) {
-			handle_error();
-			return false;
-		}
-	}
-	pcurrent = phead->prev;
-	return true;
-}
-
-bool omx_time_stamp_reorder::update_head()
-{
-	time_stamp_list *ptemp;
-	if(!phead) return false;
-	if (phead->next != phead) {
-		ptemp = phead;
-		phead = ptemp->next;
-		phead->prev = ptemp->prev;
-		ptemp->prev->next = phead;
-		delete ptemp;
-	}
-	return true;
-}
-
-bool omx_time_stamp_reorder::add_new_list()
-{
-	bool status = true;
-	time_stamp_list *ptemp = NULL;
-	if (!phead) {
-		ptemp = phead = new time_stamp_list;
-		if (!phead) {
-			handle_error();
-			status = false;
-			return status;
-		}
-		phead->prev = phead->next = phead;
-	} else {
-		ptemp = new time_stamp_list;
-		if (!ptemp) {
-			handle_error();
-			status = false;
-			return status;
-		}
-		ptemp->prev = phead->prev;
-		ptemp->next = phead;
-		phead->prev->next = ptemp;
-		phead->prev = ptemp;
-	}
-	ptemp->entries_filled = 0;
-	for(int i=0; i < TIME_SZ; i++) {
-		ptemp->input_timestamps[i].in_use = false;
-		ptemp->input_timestamps[i].timestamps = -1;
-	}
-	return status;
-}
-
 bool omx_time_stamp_reorder::insert_timestamp(OMX_BUFFERHEADERTYPE *header)
 {
-	OMX_TICKS *table_entry = NULL;
 	if (!reorder_ts || error || !header) {
 		if (error || !header)
 			DEBUG("\n Invalid condition in insert_timestamp %p", header);
 		return false;
 	}
-	if(!get_current_list()) {
-		handle_error();
-		return false;
-	}
-	if (pcurrent->entries_filled > (TIME_SZ - 1)) {
-		DEBUG("\n Table full return error");
-		handle_error();
-		return false;
-	}
 	if (header->nFlags & OMX_BUFFERFLAG_CODECCONFIG) {
 		return true;
 	}
 	if ((header->nFlags & OMX_BUFFERFLAG_EOS) && !header->nFilledLen)
 	{
 		DEBUG("\n EOS with zero length recieved");
-		if (!add_new_list()) {
-			handle_error();
-			return false;
-		}
+		insert_gen++;
 		return true;
 	}
-	for(int i = 0; i < TIME_SZ && !table_entry; i++) {
-		if (!pcurrent->input_timestamps[i].in_use) {
-			table_entry = &pcurrent->input_timestamps[i].timestamps;
-			pcurrent->input_timestamps[i].in_use = true;
-			pcurrent->entries_filled++;
-		}
-	}
-	if (!table_entry) {
-		DEBUG("\n All entries in use");
+	if (!ts_heap.push(header->nTimeStamp, insert_gen)) {
+		DEBUG("\n Table full return error");
 		handle_error();
 		return false;
 	}
-	*table_entry = header->nTimeStamp;
         if (print_debug)
 	        DEBUG("Time stamp inserted %lld", header->nTimeStamp);
 	if (header->nFlags & OMX_BUFFERFLAG_EOS) {
-		if (!add_new_list()) {
-			handle_error();
-			return false;
-		}
+		insert_gen++;
 	}
 	return true;
 }
@@ -181,94 +83,156 @@ bool omx_time_stamp_reorder::insert_timestamp(OMX_BUFFERHEADERTYPE *header)
 bool omx_time_stamp_reorder::remove_time_stamp(OMX_TICKS ts, bool is_interlaced = false)
 {
 	unsigned int num_ent_remove = (is_interlaced)?2:1;
+	unsigned int head_gen = 0;
+	OMX_TICKS head_ts;
 	if (!reorder_ts || error) {
 		DEBUG("\n not in avi mode");
 		return false;
 	}
-	if (!phead || !phead->entries_filled) return false;
-	for(int i=0; i < TIME_SZ && num_ent_remove; i++) {
-		if (phead->input_timestamps[i].in_use && phead->input_timestamps[i].timestamps == ts) {
-				phead->input_timestamps[i].in_use = false;
-				phead->entries_filled--;
-				num_ent_remove--;
-                                if (print_debug)
-		                       DEBUG("Removed TS %lld", ts);
-		}
-	}
-	if (!phead->entries_filled) {
-		if (!update_head()) {
-			handle_error();
-			return false;
-		}
+	if (!ts_heap.top(&head_ts, &head_gen)) return false;
+	while (num_ent_remove && ts_heap.remove(ts, head_gen)) {
+		num_ent_remove--;
+                if (print_debug)
+		        DEBUG("Removed TS %lld", ts);
 	}
 	return true;
 }
 
 void omx_time_stamp_reorder::flush_timestamp()
 {
-	delete_list();
+	ts_heap.clear();
 }
 
 bool omx_time_stamp_reorder::get_next_timestamp(OMX_BUFFERHEADERTYPE *header, bool is_interlaced)
 {
-	timestamp *element = NULL,*duplicate = NULL;
-	bool status = false;
+	unsigned int gen = 0, next_gen = 0;
+	OMX_TICKS ts, next_ts;
 	if (!reorder_ts || error || !header) {
 		if (error || !header)
 			DEBUG("\n Invalid condition in insert_timestamp %p", header);
 		return false;
 	}
-	if(!phead || !phead->entries_filled) return false;
-	for(int i=0; i < TIME_SZ; i++) {
-		if (phead->input_timestamps[i].in_use) {
-			status = true;
-			if (!element)
-				element = &phead->input_timestamps[i];
-			else {
-				if (element->timestamps > phead->input_timestamps[i].timestamps){
-					element = &phead->input_timestamps[i];
-					duplicate = NULL;
-				} else if(element->timestamps == phead->input_timestamps[i].timestamps)
-					duplicate = &phead->input_timestamps[i];
-			}
-		}
-	}
-	if (element) {
-		phead->entries_filled--;
-		header->nTimeStamp = element->timestamps;
-                if (print_debug)
-		     DEBUG("Getnext Time stamp %lld", header->nTimeStamp);
-		element->in_use = false;
-	}
-	if(is_interlaced && duplicate) {
-		phead->entries_filled--;
-		duplicate->in_use = false;
+	if (!ts_heap.pop(&ts, &gen)) return false;
+	header->nTimeStamp = ts;
+        if (print_debug)
+	     DEBUG("Getnext Time stamp %lld", header->nTimeStamp);
+	/* Both fields of an interlaced frame consume a timestamp of the
+	 * same generation; drop the next smallest one */
+	if (is_interlaced && ts_heap.top(&next_ts, &next_gen) && next_gen == gen) {
+		ts_heap.pop(&next_ts, &next_gen);
+		if (print_debug)
+			DEBUG("Getnext Duplicate Time stamp %lld", next_ts);
 	}
-	else if(is_interlaced && status)
-	{
-		for(int i=0; i < TIME_SZ; i++) {
-			if (phead->input_timestamps[i].in_use) {
-				if (!duplicate)
-					duplicate = &phead->input_timestamps[i];
-				else {
-					if (duplicate->timestamps > phead->input_timestamps[i].timestamps)
-						duplicate = &phead->input_timestamps[i];
-				}
-			}
-		}
-		if (duplicate) {
-			phead->entries_filled--;
-			if (print_debug)
-				DEBUG("Getnext Duplicate Time stamp %lld", header->nTimeStamp);
-			duplicate->in_use = false;
-		}
+	return true;
+}
+
+omx_ts_list::omx_ts_list(unsigned int max)
+{
+	max_entries = (max < TS_HEAP_SZ) ? max : TS_HEAP_SZ;
+}
+
+bool omx_ts_list::insert_ts(OMX_TICKS ts)
+{
+	if (ts_heap.size() >= max_entries)
+		return false;
+	return ts_heap.push(ts, 0);
+}
+
+bool omx_ts_list::pop_min_ts(OMX_TICKS &ts)
+{
+	unsigned int generation;
+
+	if (!ts_heap.pop(&ts, &generation)) {
+		ts = 0;
+		return false;
 	}
+	return true;
+}
 
-	if (!phead->entries_filled) {
-		if (!update_head()) {
-			handle_error();
-			return false;
-		}
+bool omx_ts_list::reset_ts_list()
+{
+	ts_heap.clear();
+	return true;
+}
+
+omx_ts_min_heap::omx_ts_min_heap()
+{
+	entries = 0;
+}
+
+void omx_ts_min_heap::sift_up(unsigned int idx)
+{
+	heap_entry entry = heap[idx];
+	while (idx) {
+		unsigned int parent = (idx - 1) >> 1;
+		if (!less(entry, heap[parent]))
+			break;
+		heap[idx] = heap[parent];
+		idx = parent;
+	}
+	heap[idx] = entry;
+}
+
+void omx_ts_min_heap::sift_down(unsigned int idx)
+{
+	heap_entry entry = heap[idx];
+	while (true) {
+		unsigned int child = (idx << 1) + 1;
+		if (child >= entries)
+			break;
+		if (child + 1 < entries && less(heap[child + 1], heap[child]))
+			child++;
+		if (!less(heap[child], entry))
+			break;
+		heap[idx] = heap[child];
+		idx = child;
+	}
+	heap[idx] = entry;
+}
+
+bool omx_ts_min_heap::push(OMX_TICKS ts, unsigned int generation)
+{
+	if (entries >= TS_HEAP_SZ)
+		return false;
+	heap[entries].timestamp = ts;
+	heap[entries].generation = generation;
+	sift_up(entries++);
+	return true;
+}
+
+bool omx_ts_min_heap::top(OMX_TICKS *ts, unsigned int *generation)
+{
+	if (!entries)
+		return false;
+	*ts = heap[0].timestamp;
+	*generation = heap[0].generation;
+	return true;
+}
+
+bool omx_ts_min_heap::pop(OMX_TICKS *ts, unsigned int *generation)
+{
+	if (!top(ts, generation))
+		return false;
+	heap[0] = heap[--entries];
+	if (entries)
+		sift_down(0);
+	return true;
+}
+
+/* Only used on error paths, so a linear search for the entry is fine */
+bool omx_ts_min_heap::remove(OMX_TICKS ts, unsigned int generation)
+{
+	unsigned int idx;
+	for (idx = 0; idx < entries; idx++) {
+		if (heap[idx].timestamp == ts && heap[idx].generation == generation)
+			break;
 	}
-	return status;
+	if (idx == entries)
+		return false;
+	heap[idx] = heap[--entries];
+	if (idx < entries) {
+		sift_up(idx);
+		sift_down(idx);
+	}
+	return true;
 }
@@ -0,0 +1,271 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+/*
+	Unit test and throughput benchmark for frame_parse::parse_sc_frame.
+
+	mm-vdec-frameparser-test [iterations] [seed]
+	mm-vdec-frameparser-test -b [stream_bytes] [loops]
+
+	The test builds random streams of start codes (00 00 01 xx,
+	00 00 00 01 xx, 00 00 8x) and payloads that mix long runs without
+	zero bytes, isolated zeros and zero runs, and parses them for every
+	codec type in randomly sized source chunks. The frames must be the
+	same as with the stream fed one byte at a time, where the start code
+	prefix scan never has a word or vector to skip over, so every byte
+	goes through the state machine as it did before the scan existed.
+
+	The benchmark parses an H.264 stream of 'stream_bytes' with a slice
+	start code every 4 KB and compares it with a byte at a time model of
+	the state machine in A0/A1/A2, which is what the prefix scan replaces.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include "frameparser.h"
+
+#define MAX_STREAM   (256 * 1024)
+#define MAX_FRAMES   4096
+
+static uint32_t rnd_state;
+
+static uint32_t rnd()
+{
+  rnd_state = rnd_state * 1103515245 + 12345;
+  return rnd_state >> 8;
+}
+
+struct parsed_stream {
+  uint8_t data[MAX_STREAM * 2];
+  uint32_t len;
+  uint32_t ends[MAX_FRAMES];    // end offset of each complete frame
+  uint32_t frames;
+};
+
+static uint32_t build_stream(uint8_t *buf, uint32_t size)
+{
+  static const uint8_t codes[] = { 0xB6, 0xB0, 0xB3, 0x0D, 0x0F, 0x00 };
+  uint32_t len = 0, run, i;
+
+  while (len + 16 < size) {
+    switch (rnd() % 3) {
+    case 0:
+      // MPEG-4 VOP, VC-1 frame, MPEG-2 picture, sequence headers or any
+      buf[len++] = 0; buf[len++] = 0; buf[len++] = 1;
+      buf[len++] = (rnd() % 4) ? codes[rnd() % sizeof(codes)] : (uint8_t)rnd();
+      break;
+    case 1:
+      buf[len++] = 0; buf[len++] = 0; buf[len++] = 0; buf[len++] = 1;
+      buf[len++] = (uint8_t)rnd();
+      break;
+    default:
+      buf[len++] = 0; buf[len++] = 0; buf[len++] = 0x80 | (rnd() & 3);
+      break;
+    }
+    run = rnd() % 2000;
+    for (i = 0; i < run && len < size; i++) {
+      switch (rnd() % 16) {
+      case 0:
+        buf[len++] = 0;
+        break;
+      case 1:
+        // zero run, sometimes a start code lookalike
+        for (uint32_t z = rnd() % 5; z && len < size; z--)
+          buf[len++] = 0;
+        break;
+      default:
+        buf[len++] = (uint8_t)(1 + rnd() % 255);
+        break;
+      }
+    }
+  }
+  return len;
+}
+
+/* Parse like omx_vdec does for arbitrary bytes input: the destination is
+ * handed on whenever a frame is complete. chunk == 0 picks random sizes. */
+static void parse(codec_type codec, const uint8_t *stream, uint32_t len,
+    uint32_t chunk, parsed_stream *out)
+{
+  static uint8_t src[MAX_STREAM];
+  OMX_BUFFERHEADERTYPE source, dest;
+  OMX_U32 partial;
+  frame_parse parser;
+  uint32_t pos = 0, size;
+
+  parser.init_start_codes(codec);
+  memset(&dest, 0, sizeof(dest));
+  out->len = 0;
+  out->frames = 0;
+
+  while (pos < len) {
+    size = chunk ? chunk : 1 + rnd() % (rnd() % 4 ? 64 : 8192);
+    if (size > len - pos)
+      size = len - pos;
+    memcpy(src, stream + pos, size);
+    memset(&source, 0, sizeof(source));
+    source.pBuffer = src;
+    source.nFilledLen = size;
+    source.nAllocLen = size;
+    pos += size;
+
+    while (source.nFilledLen) {
+      dest.pBuffer = out->data + out->len;
+      dest.nAllocLen = sizeof(out->data) - out->len;
+      dest.nOffset = 0;
+      if (parser.parse_sc_frame(&source, &dest, &partial) != 1) {
+        printf("FAIL: parse error at %u\n", pos);
+        exit(1);
+      }
+      out->len += dest.nFilledLen;
+      dest.nFilledLen = 0;
+      if (!partial && out->frames < MAX_FRAMES)
+        out->ends[out->frames++] = out->len;
+    }
+  }
+}
+
+static int test(uint32_t iterations, uint32_t seed)
+{
+  static uint8_t stream[MAX_STREAM];
+  static parsed_stream ref, out;
+  static const codec_type codecs[] = {
+    CODEC_TYPE_MPEG4, CODEC_TYPE_H263, CODEC_TYPE_H264,
+    CODEC_TYPE_VC1, CODEC_TYPE_MPEG2,
+  };
+  uint32_t len;
+
+  rnd_state = seed;
+  for (uint32_t i = 0; i < iterations; i++) {
+    codec_type codec = codecs[i % 5];
+    len = build_stream(stream, 1 + rnd() % MAX_STREAM);
+    parse(codec, stream, len, 1, &ref);
+    parse(codec, stream, len, 0, &out);
+    if (out.len != ref.len || memcmp(out.data, ref.data, ref.len) ||
+        out.frames != ref.frames ||
+        memcmp(out.ends, ref.ends, ref.frames * sizeof(ref.ends[0]))) {
+      printf("FAIL: codec %d stream %u: %u bytes %u frames, expected %u bytes %u frames\n",
+          codec, len, out.len, out.frames, ref.len, ref.frames);
+      printf("test failed at iteration %u, seed %u\n", i, seed);
+      return 1;
+    }
+  }
+  printf("test: %u iterations passed, seed %u\n", iterations, seed);
+  return 0;
+}
+
+static uint64_t now_us()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void report(const char *name, uint32_t bytes, uint32_t loops, uint64_t us)
+{
+  printf("%-22s: %8.1f MB/s\n", name, (double)bytes * loops / (us ? us : 1));
+}
+
+/* A0..A2 of the state machine, one byte per step; returns the number of
+ * 00 00 00 01 codes */
+static uint32_t ref_scan(const uint8_t *p, uint32_t len)
+{
+  uint32_t state = 0, codes = 0;
+
+  for (uint32_t i = 0; i < len; i++) {
+    switch (state) {
+    case 0:
+      state = !p[i];
+      break;
+    case 1:
+      state = p[i] ? 0 : 2;
+      break;
+    default:
+      if (p[i] == 1 && state == 3) {
+        codes++;
+        state = 0;
+      } else {
+        state = p[i] ? 0 : 3;
+      }
+      break;
+    }
+  }
+  return codes;
+}
+
+static int bench(uint32_t bytes, uint32_t loops)
+{
+  static uint8_t stream[MAX_STREAM], src[MAX_STREAM];
+  static parsed_stream out;
+  OMX_BUFFERHEADERTYPE source, dest;
+  OMX_U32 partial;
+  uint32_t i, frames = 0, codes = 0;
+  uint64_t start;
+
+  if (bytes > MAX_STREAM)
+    bytes = MAX_STREAM;
+  // slice data after emulation prevention has no 00 00 pairs
+  for (i = 0; i < bytes; i++)
+    stream[i] = (i % 4096 < 5) ? "\0\0\0\1\x41"[i % 4096] :
+        ((i & 63) ? (uint8_t)(1 + rnd() % 255) : 0);
+
+  start = now_us();
+  for (i = 0; i < loops; i++)
+    codes += ref_scan(stream, bytes);
+  report("byte state machine", bytes, loops, now_us() - start);
+
+  start = now_us();
+  for (i = 0; i < loops; i++) {
+    frame_parse parser;
+    parser.init_start_codes(CODEC_TYPE_H264);
+    memcpy(src, stream, bytes);
+    memset(&source, 0, sizeof(source));
+    source.pBuffer = src;
+    source.nFilledLen = bytes;
+    memset(&dest, 0, sizeof(dest));
+    dest.pBuffer = out.data;
+    dest.nAllocLen = sizeof(out.data);
+    while (source.nFilledLen) {
+      dest.nFilledLen = 0;
+      parser.parse_sc_frame(&source, &dest, &partial);
+      frames += !partial;
+    }
+  }
+  report("parse_sc_frame", bytes, loops, now_us() - start);
+  printf("%u start codes, %u frames\n", codes / loops, frames / loops);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1 && !strcmp(argv[1], "-b"))
+    return bench(argc > 2 ? atoi(argv[2]) : MAX_STREAM, argc > 3 ? atoi(argv[3]) : 2000);
+  return test(argc > 1 ? atoi(argv[1]) : 200, argc > 2 ? atoi(argv[2]) : 1);
+}
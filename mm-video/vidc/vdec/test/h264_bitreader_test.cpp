@@ -0,0 +1,551 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+/*
+	Fuzz test and parse throughput benchmark for h264_bitreader.
+
+	mm-vdec-bitreader-test [iterations] [seed]
+	mm-vdec-bitreader-test -b [sei_messages] [loops]
+
+	The fuzz mode writes random u(n)/ue/se sequences, escapes them with
+	emulation prevention bytes and checks that they read back, and feeds
+	random zero-heavy payloads to the reader, comparing the stripped RBSP
+	and the bits returned against a byte-at-a-time reference reader.
+	Reads of more than 32 bits must return zero without moving.
+
+	The benchmark builds one SEI NAL holding buffering period, picture
+	timing and frame packing messages and times walking every message with
+	the reference reader and with h264_bitreader.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include "h264_bitreader.h"
+
+#define MAX_OPS      256
+#define MAX_NAL      (64 * 1024)
+
+enum op_type { OP_U, OP_UE, OP_SE };
+
+struct bit_op
+{
+  op_type type;
+  uint32_t n;
+  uint32_t value;
+};
+
+/* Straightforward reference: one bit at a time, emulation prevention
+ * handled while reading as the parsers used to do */
+class ref_reader
+{
+public:
+  void init(const uint8_t *src, uint32_t len, bool strip_epb)
+  {
+    data = src;
+    size = len;
+    pos = 0;
+    bit = 0;
+    zeros = 0;
+    consumed = 0;
+    strip = strip_epb;
+    skip_epb();
+  }
+
+  uint32_t u(uint32_t n)
+  {
+    uint32_t value = 0;
+    consumed += n;
+    while (n--) {
+      uint32_t b = 0;
+      if (pos < size) {
+        b = (data[pos] >> (7 - bit)) & 1;
+        if (++bit == 8) {
+          bit = 0;
+          zeros = data[pos] ? 0 : zeros + 1;
+          pos++;
+          skip_epb();
+        }
+      }
+      value = (value << 1) | b;
+    }
+    return value;
+  }
+
+  uint32_t ue()
+  {
+    uint32_t lead_zeros = 0;
+    while (!u(1)) {
+      if (++lead_zeros >= 32) {
+        // not a valid code, give up on the payload like h264_bitreader
+        pos = size;
+        bit = 0;
+        return 0;
+      }
+    }
+    return (uint32_t)(((uint64_t)1 << lead_zeros) - 1 + u(lead_zeros));
+  }
+
+  int32_t se()
+  {
+    uint32_t code = ue();
+    if (code & 1)
+      return (int32_t)((code >> 1) + 1);
+    return -(int32_t)(code >> 1);
+  }
+
+  void skip(uint32_t n)
+  {
+    for (; n > 32; n -= 32)
+      u(32);
+    u(n);
+  }
+
+  uint32_t bit_pos() const
+  {
+    return consumed;
+  }
+
+private:
+  void skip_epb()
+  {
+    if (strip && pos < size && zeros >= 2 && data[pos] == 3) {
+      zeros = 0;
+      pos++;
+    }
+  }
+
+  const uint8_t *data;
+  uint32_t size;
+  uint32_t pos;
+  uint32_t bit;
+  uint32_t zeros;
+  uint32_t consumed;
+  bool strip;
+};
+
+class bit_writer
+{
+public:
+  bit_writer(): len(0), acc(0), acc_bits(0)
+  {
+    memset(buf, 0, sizeof(buf));
+  }
+
+  void u(uint32_t value, uint32_t n)
+  {
+    while (n--) {
+      acc = (acc << 1) | ((value >> n) & 1);
+      if (++acc_bits == 8) {
+        buf[len++] = (uint8_t)acc;
+        acc = 0;
+        acc_bits = 0;
+      }
+    }
+  }
+
+  void ue(uint32_t value)
+  {
+    uint64_t code = (uint64_t)value + 1;
+    uint32_t n = 0;
+    while ((code >> n) > 1)
+      n++;
+    u(0, n);
+    u(1, 1);
+    u((uint32_t)code, n);
+  }
+
+  void se(int32_t value)
+  {
+    ue(value > 0 ? 2 * (uint32_t)value - 1 : 2 * (uint32_t)(-(int64_t)value));
+  }
+
+  void trailing_bits()
+  {
+    u(1, 1);
+    while (acc_bits)
+      u(0, 1);
+  }
+
+  uint8_t buf[MAX_NAL];
+  uint32_t len;
+
+private:
+  uint32_t acc;
+  uint32_t acc_bits;
+};
+
+static uint32_t rnd_state;
+
+static uint32_t rnd()
+{
+  rnd_state = rnd_state * 1103515245 + 12345;
+  return rnd_state >> 8;
+}
+
+static uint32_t rnd32()
+{
+  return (rnd() << 16) ^ rnd();
+}
+
+static uint32_t escape(const uint8_t *src, uint32_t len, uint8_t *dst)
+{
+  uint32_t out = 0, zeros = 0;
+  for (uint32_t i = 0; i < len; i++) {
+    if (zeros >= 2 && src[i] <= 3) {
+      dst[out++] = 3;
+      zeros = 0;
+    }
+    dst[out++] = src[i];
+    zeros = src[i] ? 0 : zeros + 1;
+  }
+  return out;
+}
+
+static void random_ops(bit_op *ops, uint32_t count)
+{
+  for (uint32_t i = 0; i < count; i++) {
+    switch (rnd() % 3) {
+      case 0:
+        ops[i].type = OP_U;
+        ops[i].n = 1 + rnd() % 32;
+        ops[i].value = rnd32() & (ops[i].n == 32 ? 0xFFFFFFFF : (1u << ops[i].n) - 1);
+        // mostly zero bits so that emulation prevention kicks in
+        if (rnd() & 1)
+          ops[i].value = 0;
+        break;
+      case 1:
+        ops[i].type = OP_UE;
+        ops[i].value = rnd32() >> (rnd() % 32);
+        if (ops[i].value == 0xFFFFFFFF)
+          ops[i].value--;
+        break;
+      default:
+        ops[i].type = OP_SE;
+        ops[i].value = rnd32() >> (1 + rnd() % 31);
+        if (rnd() & 1)
+          ops[i].value = (uint32_t)-(int32_t)ops[i].value;
+        if (ops[i].value == 0x80000000)
+          ops[i].value++;
+        break;
+    }
+  }
+}
+
+static bool roundtrip(h264_bitreader &reader)
+{
+  static bit_writer writer;
+  static uint8_t nal[2 * MAX_NAL];
+  bit_op ops[MAX_OPS];
+  uint32_t count = 1 + rnd() % MAX_OPS, nal_len, i;
+
+  writer = bit_writer();
+  random_ops(ops, count);
+  for (i = 0; i < count; i++) {
+    if (ops[i].type == OP_U)
+      writer.u(ops[i].value, ops[i].n);
+    else if (ops[i].type == OP_UE)
+      writer.ue(ops[i].value);
+    else
+      writer.se((int32_t)ops[i].value);
+  }
+  writer.trailing_bits();
+  nal_len = escape(writer.buf, writer.len, nal);
+
+  for (int pass = 0; pass < 2; pass++) {
+    if (pass == 0)
+      reader.init(nal, nal_len);
+    else
+      reader.init(writer.buf, writer.len, false);
+    if (reader.rbsp_size() != writer.len) {
+      printf("FAIL: rbsp size %u expected %u\n", reader.rbsp_size(), writer.len);
+      return false;
+    }
+    if (pass == 0 && reader.epb_count() != nal_len - writer.len) {
+      printf("FAIL: %u emulation prevention bytes expected %u\n",
+          reader.epb_count(), nal_len - writer.len);
+      return false;
+    }
+    for (i = 0; i < count; i++) {
+      uint32_t value;
+      if (ops[i].type == OP_U)
+        value = reader.u(ops[i].n);
+      else if (ops[i].type == OP_UE)
+        value = reader.ue();
+      else
+        value = (uint32_t)reader.se();
+      if (value != ops[i].value) {
+        printf("FAIL: pass %d op %u type %d got %#x expected %#x\n",
+            pass, i, ops[i].type, value, ops[i].value);
+        return false;
+      }
+    }
+    if (reader.u(1) != 1 ||
+        (!reader.byte_aligned() && reader.u(reader.bits_to_align()))) {
+      printf("FAIL: pass %d bad rbsp trailing bits\n", pass);
+      return false;
+    }
+    if (reader.more_bits()) {
+      printf("FAIL: pass %d %u bits left\n", pass, reader.bits_left());
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool random_payload(h264_bitreader &reader)
+{
+  static uint8_t nal[4096];
+  static uint8_t rbsp[4096];
+  static uint8_t stripped[4096];
+  ref_reader ref;
+  uint32_t len = rnd() % sizeof(nal), i, epb;
+  bool strip = (rnd() % 4) != 0;
+
+  for (i = 0; i < len; i++) {
+    uint32_t r = rnd() % 8;
+    nal[i] = r < 4 ? 0 : (r < 6 ? 3 : (uint8_t)rnd());
+  }
+  reader.init(nal, len, strip);
+  ref.init(nal, len, strip);
+
+  if (strip) {
+    uint32_t out = 0, zeros = 0;
+    for (i = 0; i < len; i++) {
+      if (zeros >= 2 && nal[i] == 3) {
+        zeros = 0;
+        continue;
+      }
+      rbsp[out++] = nal[i];
+      zeros = nal[i] ? 0 : zeros + 1;
+    }
+    epb = len - out;
+    if (h264_bitreader::strip(nal, len, stripped, NULL) != out ||
+        memcmp(stripped, rbsp, out)) {
+      printf("FAIL: stripped %u bytes to %u\n", len, out);
+      return false;
+    }
+    if (reader.rbsp_size() != out || reader.epb_count() != epb) {
+      printf("FAIL: rbsp %u/%u epb %u/%u\n", reader.rbsp_size(), out,
+          reader.epb_count(), epb);
+      return false;
+    }
+  }
+
+  while (reader.more_bits()) {
+    uint32_t pos = reader.bit_pos(), n, a, b;
+    switch (rnd() % 4) {
+      case 0:
+        n = rnd() % 33;
+        if (!(rnd() % 8)) {
+          // wider reads return zero and leave the position alone
+          n = (rnd() % 4) ? 33 + rnd() % 64 : 0xFFFFFFFF;
+          a = reader.u(n);
+          b = 0;
+          if (reader.bit_pos() != pos) {
+            printf("FAIL: u(%u) moved from bit %u to %u\n", n, pos,
+                reader.bit_pos());
+            return false;
+          }
+          break;
+        }
+        a = reader.u(n);
+        b = ref.u(n);
+        break;
+      case 1:
+        a = reader.ue();
+        b = ref.ue();
+        break;
+      case 2:
+        a = (uint32_t)reader.se();
+        b = (uint32_t)ref.se();
+        break;
+      default:
+        // reposition both readers on a byte boundary
+        n = rnd() % 64;
+        reader.seek((pos + n + 7) & ~7u);
+        ref.init(strip ? rbsp : nal, reader.rbsp_size(), false);
+        ref.u(reader.bit_pos());
+        a = b = 0;
+        break;
+    }
+    if (a != b) {
+      printf("FAIL: len %u bit %u got %#x expected %#x\n", len, pos, a, b);
+      return false;
+    }
+    if (reader.bit_pos() < pos) {
+      printf("FAIL: reader moved back from %u to %u\n", pos, reader.bit_pos());
+      return false;
+    }
+  }
+  // reading past the end yields zero bits
+  return !reader.u(32) && !reader.ue() && !reader.more_bits();
+}
+
+static int fuzz(uint32_t iterations, uint32_t seed)
+{
+  h264_bitreader reader;
+  rnd_state = seed;
+  for (uint32_t i = 0; i < iterations; i++) {
+    if (!roundtrip(reader) || !random_payload(reader)) {
+      printf("fuzz failed at iteration %u, seed %u\n", i, seed);
+      return 1;
+    }
+  }
+  printf("fuzz: %u iterations passed, seed %u\n", iterations, seed);
+  return 0;
+}
+
+/* Writes 'count' SEI messages of buffering period (0), picture timing (1)
+ * and frame packing arrangement (45) into one escaped SEI NAL */
+static uint32_t build_sei(uint32_t count, uint8_t *nal)
+{
+  static bit_writer writer;
+  bit_writer msg;
+  uint32_t i, len = 0;
+
+  writer = bit_writer();
+  for (i = 0; i < count; i++) {
+    uint32_t type = (i % 3) == 2 ? 45 : i % 3;
+    msg = bit_writer();
+    if (type == 0) {
+      msg.ue(0);                  // seq_parameter_set_id
+      msg.u(rnd() & 0xFFFFFF, 24); // initial_cpb_removal_delay
+      msg.u(0, 24);               // initial_cpb_removal_delay_offset
+    } else if (type == 1) {
+      msg.u(i * 2, 24);           // cpb_removal_delay
+      msg.u(0, 24);               // dpb_output_delay
+    } else {
+      msg.ue(i & 7);              // frame_packing_arrangement_id
+      msg.u(0, 1);                // cancel_flag
+      msg.u(3, 7);                // type: side by side
+      msg.u(0, 1);
+      msg.u(1, 6);
+      msg.u(0, 6);
+      msg.u(0, 16);               // grid positions
+      msg.u(0, 8);                // reserved_byte
+      msg.ue(1);                  // repetition_period
+      msg.u(0, 1);
+    }
+    msg.trailing_bits();
+    writer.u(type, 8);
+    writer.u(msg.len, 8);
+    for (uint32_t j = 0; j < msg.len; j++)
+      writer.u(msg.buf[j], 8);
+  }
+  writer.trailing_bits();
+
+  nal[len++] = 0;
+  nal[len++] = 0;
+  nal[len++] = 0;
+  nal[len++] = 1;
+  nal[len++] = 0x06;
+  return len + escape(writer.buf, writer.len, nal + len);
+}
+
+template <class reader_t>
+static uint32_t walk_sei(reader_t &reader, const uint8_t *nal, uint32_t len,
+    uint32_t count)
+{
+  uint32_t messages = 0, sum = 0;
+  reader.init(nal + 5, len - 5, true);
+  while (messages < count) {
+    uint32_t type = reader.u(8), size = reader.u(8);
+    uint32_t start = reader.bit_pos();
+    if (type == 0) {
+      sum += reader.ue();
+      sum += reader.u(24);
+      sum += reader.u(24);
+    } else if (type == 1) {
+      sum += reader.u(24);
+      sum += reader.u(24);
+    } else {
+      sum += reader.ue();
+      sum += reader.u(1) + reader.u(7) + reader.u(1) + reader.u(6);
+      sum += reader.u(6) + reader.u(16) + reader.u(8);
+      sum += reader.ue();
+      sum += reader.u(1);
+    }
+    reader.skip(start + size * 8 - reader.bit_pos());
+    messages++;
+  }
+  return messages + (sum & 1);
+}
+
+static uint64_t now_us()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static int bench(uint32_t count, uint32_t loops)
+{
+  static uint8_t nal[2 * MAX_NAL];
+  ref_reader ref;
+  h264_bitreader reader;
+  uint32_t len, i, n_ref = 0, n_new = 0;
+  uint64_t start, ref_us, new_us;
+
+  if (count > MAX_NAL / 16)
+    count = MAX_NAL / 16;
+  rnd_state = 1;
+  len = build_sei(count, nal);
+
+  start = now_us();
+  for (i = 0; i < loops; i++)
+    n_ref += walk_sei(ref, nal, len, count);
+  ref_us = now_us() - start;
+
+  start = now_us();
+  for (i = 0; i < loops; i++)
+    n_new += walk_sei(reader, nal, len, count);
+  new_us = now_us() - start;
+
+  if (n_ref != n_new) {
+    printf("FAIL: reference walked %u messages, bitreader %u\n", n_ref, n_new);
+    return 1;
+  }
+  printf("SEI NAL: %u messages, %u bytes, %u emulation prevention bytes\n",
+      count, len, reader.epb_count());
+  printf("reference : %8.1f MB/s %10.0f msgs/s\n",
+      (double)len * loops / (ref_us ? ref_us : 1),
+      (double)n_ref * 1000000 / (ref_us ? ref_us : 1));
+  printf("bitreader : %8.1f MB/s %10.0f msgs/s\n",
+      (double)len * loops / (new_us ? new_us : 1),
+      (double)n_new * 1000000 / (new_us ? new_us : 1));
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1 && !strcmp(argv[1], "-b"))
+    return bench(argc > 2 ? atoi(argv[2]) : 1000, argc > 3 ? atoi(argv[3]) : 2000);
+  return fuzz(argc > 1 ? atoi(argv[1]) : 20000, argc > 2 ? atoi(argv[2]) : 1);
+}
@@ -0,0 +1,498 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+/*
+	Unit test and benchmark for the H264_Utils parameter set tables.
+
+	mm-vdec-h264-utils-test [iterations] [seed]
+	mm-vdec-h264-utils-test -b [frames] [pps_per_idr]
+
+	The test runs random insert/find/erase sequences on H264ParamNaluSet,
+	including out of range ids, against a plain array model. It then
+	builds random NAL length streams where every IDR resends one or more
+	SPS (baseline and high profile, with scaling lists) and PPS, some of
+	them with out of range ids or fields, and checks that isNewFrame
+	reports a new frame exactly at the first NAL of each access unit.
+
+	The benchmark replays a stream that resends 'pps_per_idr' PPS and
+	their SPS on every IDR, with an IDR every 8 frames and 4 slices per
+	frame. Each SPS/PPS replaces its set and each slice looks up its PPS
+	and SPS, once with the linked list Map the tables used to be kept in
+	and once with H264ParamNaluSet. The whole stream is then run through
+	isNewFrame.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include "h264_utils.h"
+
+#define MAX_NAL      512
+#define MAX_NALS     16384
+#define BENCH_GOP    8
+#define BENCH_SLICES 4
+
+static uint32_t rnd_state;
+
+static uint32_t rnd()
+{
+  rnd_state = rnd_state * 1103515245 + 12345;
+  return rnd_state >> 8;
+}
+
+/* RBSP writer; emulation prevention bytes are added when the NAL is closed */
+struct nal_writer {
+  uint8_t rbsp[MAX_NAL];
+  uint32_t bits;
+
+  void start() { memset(rbsp, 0, sizeof(rbsp)); bits = 0; }
+  void u(uint32_t n, uint32_t value)
+  {
+    while (n--) {
+      if ((value >> n) & 1)
+        rbsp[bits >> 3] |= 0x80 >> (bits & 7);
+      bits++;
+    }
+  }
+  void ue(uint32_t value)
+  {
+    uint32_t len = 0;
+    while ((value + 1) >> (len + 1))
+      len++;
+    u(len, 0);
+    u(len + 1, value + 1);
+  }
+  void se(int32_t value)
+  {
+    ue(value > 0 ? 2 * value - 1 : -2 * value);
+  }
+  // appends a 4-byte NAL length, the header and the escaped RBSP
+  uint32_t finish(uint8_t *out, uint32_t header)
+  {
+    uint32_t len = 5, zeros = 0, i;
+
+    u(1, 1);
+    out[4] = (uint8_t)header;
+    for (i = 0; i < (bits + 7) >> 3; i++) {
+      if (zeros == 2 && rbsp[i] <= 3) {
+        out[len++] = 3;
+        zeros = 0;
+      }
+      zeros = rbsp[i] ? 0 : zeros + 1;
+      out[len++] = rbsp[i];
+    }
+    out[0] = out[1] = 0;
+    out[2] = (uint8_t)((len - 4) >> 8);
+    out[3] = (uint8_t)(len - 4);
+    return len;
+  }
+};
+
+struct nal {
+  uint8_t data[MAX_NAL * 2];
+  uint32_t len;
+  uint32_t id;          // set id, or the PPS id of a slice
+  uint32_t sps_id;      // SPS referenced by a PPS
+  bool new_frame;
+};
+
+static nal_writer w;
+static nal nals[MAX_NALS];
+
+static void put_sps(nal *n, uint32_t id, bool high, uint32_t log2_frame_num,
+    uint32_t poc_type)
+{
+  w.start();
+  w.u(8, high ? 100 : 66);
+  w.u(16, 30);
+  w.ue(id);
+  if (high) {
+    w.ue(1); //chroma_format_idc
+    w.ue(0);
+    w.ue(0);
+    w.u(1, 0);
+    w.u(1, 1); //seq_scaling_matrix_present_flag
+    for (uint32_t i = 0; i < 8; i++) {
+      uint32_t present = rnd() & 1;
+      int32_t last_scale = 8, next_scale, delta;
+      w.u(1, present);
+      for (uint32_t j = 0; present && j < (i < 6 ? 16u : 64u); j++) {
+        // a next_scale of 0 ends the list early
+        delta = (rnd() % 16) ? (int32_t)(rnd() % 9) - 4 : -last_scale;
+        next_scale = (last_scale + delta + 256) % 256;
+        w.se(delta);
+        if (!next_scale)
+          break;
+        last_scale = next_scale;
+      }
+    }
+  }
+  w.ue(log2_frame_num);
+  w.ue(poc_type);
+  if (poc_type == 0) {
+    w.ue(rnd() % 13);
+  } else if (poc_type == 1) {
+    w.u(1, 0);
+    w.se(0);
+    w.se(0);
+    w.ue(2);
+    w.se(1);
+    w.se(-1);
+  }
+  w.ue(1 + rnd() % 4); //max_num_ref_frames
+  w.u(1, 0);
+  w.ue(rnd() % 120);
+  w.ue(rnd() % 68);
+  w.u(1, 1);
+  n->id = id;
+  n->len = w.finish(n->data, 0x67);
+}
+
+static void put_pps(nal *n, uint32_t id, uint32_t sps_id)
+{
+  w.start();
+  w.ue(id);
+  w.ue(sps_id);
+  w.u(1, rnd() & 1);
+  w.u(1, 0);
+  w.ue(0);
+  n->id = id;
+  n->sps_id = sps_id;
+  n->len = w.finish(n->data, 0x68);
+}
+
+static void put_slice(nal *n, bool idr, uint32_t ref_idc, uint32_t first_mb,
+    uint32_t pps_id, uint32_t frame_num_bits, uint32_t frame_num)
+{
+  w.start();
+  w.ue(first_mb);
+  w.ue(idr ? 7 : 5);
+  w.ue(pps_id);
+  w.u(frame_num_bits, frame_num);
+  for (uint32_t i = 0; i < 8; i++)
+    w.u(8, rnd());
+  n->id = pps_id;
+  n->len = w.finish(n->data, (ref_idc << 5) | (idr ? 5 : 1));
+}
+
+static void put_sei(nal *n)
+{
+  w.start();
+  w.u(8, 5);
+  w.u(8, 4);
+  w.u(32, rnd());
+  n->len = w.finish(n->data, 0x06);
+}
+
+/* Parameter set store the tables replaced: a linked list Map of heap
+ * allocated sets, with each resent set erased and reinserted */
+struct map_store {
+  Map<uint32, H264ParamNalu *> sets;
+
+  H264ParamNalu *insert(uint32 id)
+  {
+    H264ParamNalu *set = sets.find(id);
+    if (set) {
+      sets.erase(id);
+      delete set;
+    }
+    set = new H264ParamNalu;
+    memset(set, 0, sizeof(*set));
+    sets.insert(id, set);
+    return set;
+  }
+  H264ParamNalu *find(uint32 id) { return sets.find(id); }
+  ~map_store()
+  {
+    for (uint32 id = 0; id < H264_MAX_PPS_COUNT; id++)
+      delete sets.find(id);
+  }
+};
+
+static bool check_table()
+{
+  static H264ParamNaluSet<H264_MAX_SPS_COUNT> table;
+  bool valid[H264_MAX_SPS_COUNT + 8];
+  uint32_t tag[H264_MAX_SPS_COUNT + 8];
+  uint32_t i, id;
+  H264ParamNalu *set;
+
+  table.clear();
+  memset(valid, 0, sizeof(valid));
+  for (i = 0; i < 1000; i++) {
+    id = rnd() % (H264_MAX_SPS_COUNT + 8);
+    switch (rnd() % 4) {
+      case 0:
+      case 1:
+        set = table.insert(id);
+        if (!set != (id >= H264_MAX_SPS_COUNT) ||
+            (set && (set->seqSetID || set->log2MaxFrameNumMinus4))) {
+          printf("FAIL: insert of id %u returned %p\n", id, set);
+          return false;
+        }
+        if (set) {
+          valid[id] = true;
+          tag[id] = set->seqSetID = rnd();
+          set->log2MaxFrameNumMinus4 = 12;
+        }
+        break;
+      case 2:
+        if (table.erase(id) != (id < H264_MAX_SPS_COUNT && valid[id])) {
+          printf("FAIL: erase of id %u\n", id);
+          return false;
+        }
+        valid[id] = false;
+        break;
+      default:
+        set = table.find(id);
+        if (!set != !valid[id] || (set && set->seqSetID != tag[id])) {
+          printf("FAIL: find of id %u returned %p\n", id, set);
+          return false;
+        }
+        break;
+    }
+  }
+  return true;
+}
+
+/* Random stream: IDRs resend SPS and PPS, access units may start with an
+ * SEI, frames have 1..4 slices with the same nal_ref_idc. Returns the
+ * number of NALs; new_frame marks the first NAL of each access unit. */
+static uint32_t build_stream(uint32_t frames)
+{
+  uint32_t count = 0, frame, i, sets, slices, ref_idc, frame_num = 0;
+  uint32_t log2_frame_num = 0, sps_id = 0, pps_id = 0, bad;
+  bool idr;
+
+  for (frame = 0; frame < frames; frame++) {
+    idr = !frame || !(rnd() % 6);
+    ref_idc = idr ? 3 : rnd() % 4;
+    nals[count].new_frame = true;
+    if (rnd() % 4 == 0) {
+      put_sei(&nals[count]);
+      count++;
+      nals[count].new_frame = false;
+    }
+    if (idr) {
+      sets = 1 + rnd() % 4;
+      for (i = 0; i < sets; i++) {
+        sps_id = rnd() % H264_MAX_SPS_COUNT;
+        log2_frame_num = rnd() % 13;
+        put_sps(&nals[count++], sps_id, rnd() & 1, log2_frame_num, rnd() % 3);
+        nals[count].new_frame = false;
+        pps_id = rnd() % H264_MAX_PPS_COUNT;
+        put_pps(&nals[count++], pps_id, sps_id);
+        nals[count].new_frame = false;
+      }
+      // sets that must be rejected, with ids the slices do not use
+      if (rnd() % 2) {
+        bad = (sps_id + 1 + rnd() % 62) % 64;
+        if (bad < H264_MAX_SPS_COUNT)
+          put_sps(&nals[count++], bad, rnd() & 1, 13 + rnd() % 20, rnd() % 3);
+        else
+          put_sps(&nals[count++], bad, rnd() & 1, rnd() % 13, rnd() % 3);
+        nals[count].new_frame = false;
+        bad = (pps_id + 1 + rnd() % 510) % 512;
+        put_pps(&nals[count++], bad,
+            bad < H264_MAX_PPS_COUNT ? H264_MAX_SPS_COUNT + rnd() % 32 : rnd() % 64);
+        nals[count].new_frame = false;
+      }
+      frame_num = 0;
+    }
+    slices = 1 + rnd() % 4;
+    for (i = 0; i < slices; i++) {
+      if (i)
+        nals[count].new_frame = false;
+      put_slice(&nals[count++], idr, ref_idc, i * (1 + rnd() % 100), pps_id,
+          log2_frame_num + 4, frame_num);
+    }
+    if (ref_idc)
+      frame_num = (frame_num + 1) & ((1u << (log2_frame_num + 4)) - 1);
+  }
+  return count;
+}
+
+static bool check_stream(uint32_t frames)
+{
+  H264_Utils utils;
+  OMX_BUFFERHEADERTYPE hdr;
+  OMX_BOOL new_frame;
+  uint32_t count, i;
+
+  memset(&hdr, 0, sizeof(hdr));
+  utils.allocate_rbsp_buffer(MAX_NAL * 2);
+  count = build_stream(frames);
+  for (i = 0; i < count; i++) {
+    hdr.pBuffer = nals[i].data;
+    hdr.nFilledLen = nals[i].len;
+    if (!utils.isNewFrame(&hdr, 4, new_frame)) {
+      printf("FAIL: NAL %u of %u type %u not parsed\n", i, count,
+          nals[i].data[4] & 0x1F);
+      return false;
+    }
+    // the first NAL of the stream has no previous access unit to end
+    if (i && (new_frame == OMX_TRUE) != nals[i].new_frame) {
+      printf("FAIL: NAL %u of %u type %u new frame %d expected %d\n", i,
+          count, nals[i].data[4] & 0x1F, new_frame, nals[i].new_frame);
+      return false;
+    }
+  }
+  utils.deallocate_rbsp_buffer();
+  return true;
+}
+
+static int test(uint32_t iterations, uint32_t seed)
+{
+  rnd_state = seed;
+  for (uint32_t i = 0; i < iterations; i++) {
+    if (!check_table() || !check_stream(1 + rnd() % 64)) {
+      printf("test failed at iteration %u, seed %u\n", i, seed);
+      return 1;
+    }
+  }
+  printf("test: %u iterations passed, seed %u\n", iterations, seed);
+  return 0;
+}
+
+static uint64_t now_us()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void report(const char *name, uint32_t count, uint32_t loops, uint64_t us)
+{
+  printf("%-22s: %8.1f ns/NAL %8.2f M NAL/s\n", name,
+      us * 1000.0 / ((double)count * loops), (double)count * loops / (us ? us : 1));
+}
+
+/* Replays the parameter set traffic of the stream: returns a checksum so
+ * the lookups are not optimized away */
+template <typename pps_store, typename sps_store>
+static uint32_t replay(pps_store &pic, sps_store &seq, uint32_t count)
+{
+  H264ParamNalu *pps, *sps;
+  uint32_t sum = 0, i;
+
+  for (i = 0; i < count; i++) {
+    switch (nals[i].data[4] & 0x1F) {
+      case NALU_TYPE_SPS:
+        seq.insert(nals[i].id)->seqSetID = nals[i].id;
+        break;
+      case NALU_TYPE_PPS:
+        pps = pic.insert(nals[i].id);
+        pps->picSetID = nals[i].id;
+        pps->seqSetID = nals[i].sps_id;
+        break;
+      default:
+        pps = pic.find(nals[i].id);
+        sps = pps ? seq.find(pps->seqSetID) : NULL;
+        sum += sps ? sps->seqSetID : 0;
+        break;
+    }
+  }
+  return sum;
+}
+
+static int bench(uint32_t frames, uint32_t pps_per_idr)
+{
+  uint32_t count = 0, frame, i, loops, sum = 0;
+  uint32_t sps_count;
+  OMX_BUFFERHEADERTYPE hdr;
+  OMX_BOOL new_frame;
+  uint64_t start;
+
+  if (pps_per_idr < 1)
+    pps_per_idr = 1;
+  if (pps_per_idr > H264_MAX_PPS_COUNT)
+    pps_per_idr = H264_MAX_PPS_COUNT;
+  sps_count = pps_per_idr < H264_MAX_SPS_COUNT ? pps_per_idr : H264_MAX_SPS_COUNT;
+  if (frames * (BENCH_SLICES + sps_count + pps_per_idr) > MAX_NALS)
+    frames = MAX_NALS / (BENCH_SLICES + sps_count + pps_per_idr);
+
+  for (frame = 0; frame < frames; frame++) {
+    if (!(frame % BENCH_GOP)) {
+      for (i = 0; i < sps_count; i++) {
+        put_sps(&nals[count++], i, false, 0, 2);
+      }
+      for (i = 0; i < pps_per_idr; i++) {
+        put_pps(&nals[count++], i, i % H264_MAX_SPS_COUNT);
+      }
+    }
+    for (i = 0; i < BENCH_SLICES; i++) {
+      put_slice(&nals[count++], !(frame % BENCH_GOP), 2, i * 10,
+          (frame + i) % pps_per_idr, 4, frame % 16);
+    }
+  }
+  loops = 20000000 / count + 1;
+  printf("%u NALs, %u SPS and %u PPS per IDR, %u loops\n", count, sps_count,
+      pps_per_idr, loops);
+
+  {
+    map_store pic, seq;
+    start = now_us();
+    for (i = 0; i < loops; i++)
+      sum += replay(pic, seq, count);
+    report("Map", count, loops, now_us() - start);
+  }
+  {
+    static H264ParamNaluSet<H264_MAX_PPS_COUNT> pic;
+    static H264ParamNaluSet<H264_MAX_SPS_COUNT> seq;
+    start = now_us();
+    for (i = 0; i < loops; i++)
+      sum += replay(pic, seq, count);
+    report("H264ParamNaluSet", count, loops, now_us() - start);
+  }
+
+  H264_Utils utils;
+  memset(&hdr, 0, sizeof(hdr));
+  utils.allocate_rbsp_buffer(MAX_NAL * 2);
+  loops = loops / 10 + 1;
+  start = now_us();
+  for (i = 0; i < loops; i++) {
+    for (uint32_t n = 0; n < count; n++) {
+      hdr.pBuffer = nals[n].data;
+      hdr.nFilledLen = nals[n].len;
+      utils.isNewFrame(&hdr, 4, new_frame);
+      sum += new_frame;
+    }
+  }
+  report("isNewFrame", count, loops, now_us() - start);
+  utils.deallocate_rbsp_buffer();
+  printf("checksum %u\n", sum);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1 && !strcmp(argv[1], "-b"))
+    return bench(argc > 2 ? atoi(argv[2]) : 240, argc > 3 ? atoi(argv[3]) : 16);
+  return test(argc > 1 ? atoi(argv[1]) : 2000, argc > 2 ? atoi(argv[2]) : 1);
+}
@@ -0,0 +1,345 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+/*
+	Userspace stand-in for the msm video drivers, used to run the OMX
+	components and their test apps without hardware:
+
+	  LD_PRELOAD=libmm-vidc-mock-drv.so mm-vdec-omx-test <clip> ...
+
+	open() of an emulated device node returns a real descriptor (on
+	/dev/null) so fd numbers stay unique, and ioctl()/poll()/close() on it
+	are routed to the in-process device:
+
+	  /dev/msm_vidc_dec*  vidc decoder, mock_vidc_drv.c
+	  /dev/video32,33     V4L2 mem2mem decoder/encoder, mock_v4l2_drv.c
+	  /dev/ion            ION, with ashmem backing so buffers can be mmaped
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <cutils/ashmem.h>
+#include <linux/msm_ion.h>
+#include "mock_drv.h"
+
+#define MOCK_MAX_FDS      1024
+#define MOCK_ION_HANDLES  128
+
+typedef int (*open_fn)(const char *, int, ...);
+typedef int (*close_fn)(int);
+typedef int (*ioctl_fn)(int, ioctl_req_t, ...);
+typedef int (*poll_fn)(struct pollfd *, nfds_t, int);
+
+static int mock_ion_ioctl(void *ctx, ioctl_req_t request, void *arg);
+static void *mock_ion_open(const char *pathname);
+static void mock_ion_close(void *ctx);
+
+static const struct mock_dev_ops mock_ion_dev_ops =
+{
+  "/dev/ion",
+  mock_ion_open,
+  mock_ion_close,
+  mock_ion_ioctl,
+  NULL
+};
+
+static const struct mock_dev_ops *mock_devs[] =
+{
+  &mock_vidc_dev_ops,
+  &mock_v4l2_dec_dev_ops,
+  &mock_v4l2_enc_dev_ops,
+  &mock_ion_dev_ops
+};
+
+struct mock_fd
+{
+  const struct mock_dev_ops *ops;
+  void *ctx;
+};
+
+static pthread_mutex_t mock_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct mock_fd mock_fds[MOCK_MAX_FDS];
+static int mock_ion_fds[MOCK_ION_HANDLES];
+
+static open_fn real_open;
+static close_fn real_close;
+static ioctl_fn real_ioctl;
+static poll_fn real_poll;
+
+static void mock_init_syms(void)
+{
+  if (!real_open)
+  {
+    real_open = (open_fn) dlsym(RTLD_NEXT, "open");
+    real_close = (close_fn) dlsym(RTLD_NEXT, "close");
+    real_ioctl = (ioctl_fn) dlsym(RTLD_NEXT, "ioctl");
+    real_poll = (poll_fn) dlsym(RTLD_NEXT, "poll");
+  }
+}
+
+unsigned long long mock_now_us(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+unsigned mock_env(const char *name, unsigned def)
+{
+  const char *val = getenv(name);
+  return val ? (unsigned) atoi(val) : def;
+}
+
+/* absolute CLOCK_REALTIME deadline for pthread_cond_timedwait */
+void mock_abstime(struct timespec *abstime, unsigned long long wait_us)
+{
+  clock_gettime(CLOCK_REALTIME, abstime);
+  abstime->tv_sec += wait_us / 1000000;
+  abstime->tv_nsec += (wait_us % 1000000) * 1000;
+  abstime->tv_sec += abstime->tv_nsec / 1000000000;
+  abstime->tv_nsec %= 1000000000;
+}
+
+static struct mock_fd *mock_lookup(int fd)
+{
+  if (fd < 0 || fd >= MOCK_MAX_FDS || !mock_fds[fd].ops)
+    return NULL;
+  return &mock_fds[fd];
+}
+
+static void *mock_ion_open(const char *pathname)
+{
+  /* ION state is process wide, the context only has to be non NULL */
+  return (void *) &mock_ion_fds;
+}
+
+static void mock_ion_close(void *ctx)
+{
+}
+
+static int mock_ion_ioctl(void *ctx, ioctl_req_t request, void *arg)
+{
+  int idx;
+
+  switch (request)
+  {
+  case ION_IOC_ALLOC:
+  {
+    struct ion_allocation_data *alloc_data = (struct ion_allocation_data *) arg;
+    int fd = ashmem_create_region("mock_ion", alloc_data->len);
+    if (fd < 0)
+      return -1;
+    pthread_mutex_lock(&mock_lock);
+    for (idx = 0; idx < MOCK_ION_HANDLES && mock_ion_fds[idx]; idx++);
+    if (idx == MOCK_ION_HANDLES)
+    {
+      pthread_mutex_unlock(&mock_lock);
+      real_close(fd);
+      errno = ENOMEM;
+      return -1;
+    }
+    mock_ion_fds[idx] = fd;
+    pthread_mutex_unlock(&mock_lock);
+    /* handles are 1 based so that NULL stays invalid */
+    alloc_data->handle = (struct ion_handle *) (long) (idx + 1);
+    return 0;
+  }
+  case ION_IOC_MAP:
+  case ION_IOC_SHARE:
+  {
+    struct ion_fd_data *fd_data = (struct ion_fd_data *) arg;
+    idx = (int) (long) fd_data->handle - 1;
+    if (idx < 0 || idx >= MOCK_ION_HANDLES || !mock_ion_fds[idx])
+    {
+      errno = EINVAL;
+      return -1;
+    }
+    fd_data->fd = dup(mock_ion_fds[idx]);
+    return fd_data->fd < 0 ? -1 : 0;
+  }
+  case ION_IOC_FREE:
+  {
+    struct ion_handle_data *handle_data = (struct ion_handle_data *) arg;
+    idx = (int) (long) handle_data->handle - 1;
+    if (idx < 0 || idx >= MOCK_ION_HANDLES || !mock_ion_fds[idx])
+    {
+      errno = EINVAL;
+      return -1;
+    }
+    pthread_mutex_lock(&mock_lock);
+    real_close(mock_ion_fds[idx]);
+    mock_ion_fds[idx] = 0;
+    pthread_mutex_unlock(&mock_lock);
+    return 0;
+  }
+  default:
+    /* cache maintenance and the like are no-ops on ashmem */
+    return 0;
+  }
+}
+
+int open(const char *pathname, int flags, ...)
+{
+  const struct mock_dev_ops *ops = NULL;
+  mode_t mode = 0;
+  unsigned idx;
+  void *ctx;
+  int fd;
+
+  mock_init_syms();
+  if (flags & O_CREAT)
+  {
+    va_list args;
+    va_start(args, flags);
+    mode = (mode_t) va_arg(args, int);
+    va_end(args);
+  }
+
+  for (idx = 0; idx < sizeof(mock_devs) / sizeof(mock_devs[0]); idx++)
+  {
+    if (!strncmp(pathname, mock_devs[idx]->path_prefix,
+                 strlen(mock_devs[idx]->path_prefix)))
+    {
+      ops = mock_devs[idx];
+      break;
+    }
+  }
+  if (!ops)
+    return real_open(pathname, flags, mode);
+
+  fd = real_open("/dev/null", O_RDWR);
+  if (fd < 0 || fd >= MOCK_MAX_FDS)
+  {
+    if (fd >= 0)
+      real_close(fd);
+    errno = EMFILE;
+    return -1;
+  }
+  ctx = ops->open(pathname);
+  if (!ctx)
+  {
+    real_close(fd);
+    if (!errno)
+      errno = ENODEV;
+    return -1;
+  }
+  mock_fds[fd].ctx = ctx;
+  mock_fds[fd].ops = ops;
+  return fd;
+}
+
+int close(int fd)
+{
+  struct mock_fd *mfd;
+
+  mock_init_syms();
+  mfd = mock_lookup(fd);
+  if (mfd)
+  {
+    const struct mock_dev_ops *ops = mfd->ops;
+    void *ctx = mfd->ctx;
+    mfd->ops = NULL;
+    mfd->ctx = NULL;
+    ops->close(ctx);
+  }
+  return real_close(fd);
+}
+
+int ioctl(int fd, ioctl_req_t request, ...)
+{
+  struct mock_fd *mfd;
+  va_list args;
+  void *arg;
+
+  mock_init_syms();
+  va_start(args, request);
+  arg = va_arg(args, void *);
+  va_end(args);
+
+  mfd = mock_lookup(fd);
+  if (mfd)
+    return mfd->ops->ioctl(mfd->ctx, request, arg);
+  return real_ioctl(fd, request, arg);
+}
+
+int poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+  unsigned long long deadline;
+  struct mock_fd *mfd;
+  nfds_t idx;
+  int ready;
+
+  mock_init_syms();
+  /* the components poll a single driver fd, which can block in the device */
+  if (nfds == 1 && (mfd = mock_lookup(fds[0].fd)) != NULL)
+  {
+    fds[0].revents = mfd->ops->poll ?
+                     mfd->ops->poll(mfd->ctx, fds[0].events, timeout) :
+                     (fds[0].events & (POLLIN | POLLOUT));
+    return fds[0].revents ? 1 : 0;
+  }
+  for (idx = 0; idx < nfds && !mock_lookup(fds[idx].fd); idx++);
+  if (idx == nfds)
+    return real_poll(fds, nfds, timeout);
+
+  /* mixed sets: check the emulated fds and poll the rest in 1ms slices */
+  deadline = mock_now_us() + (unsigned long long) timeout * 1000;
+  while (1)
+  {
+    ready = 0;
+    for (idx = 0; idx < nfds; idx++)
+    {
+      mfd = mock_lookup(fds[idx].fd);
+      fds[idx].revents = 0;
+      if (mfd)
+        fds[idx].revents = mfd->ops->poll ?
+                           mfd->ops->poll(mfd->ctx, fds[idx].events, 0) :
+                           (fds[idx].events & (POLLIN | POLLOUT));
+      else
+      {
+        struct pollfd pfd = fds[idx];
+        if (real_poll(&pfd, 1, 0) > 0)
+          fds[idx].revents = pfd.revents;
+      }
+      if (fds[idx].revents)
+        ready++;
+    }
+    if (ready || (timeout >= 0 && mock_now_us() >= deadline))
+      return ready;
+    usleep(1000);
+  }
+}
@@ -0,0 +1,60 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+#ifndef MOCK_DRV_H
+#define MOCK_DRV_H
+
+#include <time.h>
+
+#ifdef __BIONIC__
+typedef int ioctl_req_t;
+#else
+typedef unsigned long ioctl_req_t;
+#endif
+
+#define ALIGN(x, to_align) ((((unsigned) x) + (to_align - 1)) & ~(to_align - 1))
+
+/* A device node emulated in-process by the mock driver library */
+struct mock_dev_ops
+{
+  const char *path_prefix;
+  void *(*open)(const char *pathname);
+  void (*close)(void *ctx);
+  int (*ioctl)(void *ctx, ioctl_req_t request, void *arg);
+  /* returns revents; may block up to timeout_ms (-1: forever) */
+  short (*poll)(void *ctx, short events, int timeout_ms);
+};
+
+extern const struct mock_dev_ops mock_vidc_dev_ops;
+extern const struct mock_dev_ops mock_v4l2_dec_dev_ops;
+extern const struct mock_dev_ops mock_v4l2_enc_dev_ops;
+
+unsigned long long mock_now_us(void);
+unsigned mock_env(const char *name, unsigned def);
+void mock_abstime(struct timespec *abstime, unsigned long long wait_us);
+
+#endif
@@ -0,0 +1,538 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+/*
+	Emulation of the V4L2 mem2mem video nodes (/dev/video32 decoder,
+	/dev/video33 encoder) for the mock driver library, see mock_drv.c.
+
+	Buffers queued on the OUTPUT queue are consumed one at a time after
+	MOCK_V4L2_LATENCY_US, like a single hardware core, and returned for
+	VIDIOC_DQBUF. Each consumed buffer yields a result that is written to
+	the next queued CAPTURE buffer with the input timestamp and flags. A
+	decoded frame fills the whole CAPTURE buffer; an encoded one uses
+	1/MOCK_V4L2_ENC_RATIO of the input size.
+
+	MOCK_V4L2_RECONFIG_AFTER=n raises a resolution change event after n
+	input buffers, switching the CAPTURE format to
+	MOCK_V4L2_RECONFIG_WIDTH x MOCK_V4L2_RECONFIG_HEIGHT.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <linux/videodev2.h>
+#include "mock_drv.h"
+
+/* event ids of enum instance_state / vidc_resposes_id in omx_vdec.h */
+#define MOCK_MSM_VIDC_CLOSE_DONE            0x000F
+#define MOCK_MSM_VIDC_DECODER_FLUSH_DONE    0x11
+#define MOCK_MSM_VIDC_DECODER_EVENT_CHANGE  0x12
+
+#define MOCK_V4L2_MAX_BUFS    32
+#define MOCK_V4L2_EVENT_Q     16
+#define MOCK_V4L2_FRAME_Q     64
+
+struct mock_v4l2_buf
+{
+  struct v4l2_buffer buf;
+  struct v4l2_plane plane;
+  unsigned long long ready_us;
+};
+
+struct mock_v4l2_queue
+{
+  struct v4l2_format fmt;
+  unsigned count;
+  int streaming;
+  /* buffers owned by the device, and buffers ready to be dequeued */
+  struct mock_v4l2_buf queued[MOCK_V4L2_MAX_BUFS];
+  unsigned q_rd, q_cnt;
+  struct mock_v4l2_buf done[MOCK_V4L2_MAX_BUFS];
+  unsigned d_rd, d_cnt;
+};
+
+struct mock_v4l2_frame
+{
+  struct timeval timestamp;
+  unsigned flags;
+  unsigned bytesused;
+  unsigned long long ready_us;
+};
+
+struct mock_v4l2
+{
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int encoder;
+  int closing;
+
+  /* OUTPUT carries the client's input, CAPTURE the device's results */
+  struct mock_v4l2_queue out, cap;
+
+  /* results waiting for a CAPTURE buffer */
+  struct mock_v4l2_frame frames[MOCK_V4L2_FRAME_Q];
+  unsigned f_rd, f_cnt;
+
+  unsigned events[MOCK_V4L2_EVENT_Q];
+  unsigned e_rd, e_cnt;
+
+  unsigned latency_us, enc_ratio, min_bufs;
+  unsigned reconfig_after, inputs;
+  unsigned long long busy_until_us;
+};
+
+static unsigned mock_v4l2_sizeimage(struct v4l2_format *fmt)
+{
+  unsigned width = fmt->fmt.pix_mp.width;
+  unsigned height = fmt->fmt.pix_mp.height;
+
+  if (fmt->fmt.pix_mp.pixelformat == V4L2_PIX_FMT_NV12)
+    return ALIGN(ALIGN(width, 128) * ALIGN(height, 32) * 3 / 2, 4096);
+  return ALIGN(width * height * 3 / 4 + 65536, 4096);
+}
+
+static void mock_v4l2_post_event(struct mock_v4l2 *ctx, unsigned id)
+{
+  if (ctx->e_cnt == MOCK_V4L2_EVENT_Q)
+  {
+    fprintf(stderr, "mock_v4l2: event queue full, dropping %u\n", id);
+    return;
+  }
+  ctx->events[(ctx->e_rd + ctx->e_cnt++) % MOCK_V4L2_EVENT_Q] = id;
+  pthread_cond_broadcast(&ctx->cond);
+}
+
+static void mock_v4l2_push_done(struct mock_v4l2_queue *q,
+                                struct mock_v4l2_buf *buf)
+{
+  if (q->d_cnt < MOCK_V4L2_MAX_BUFS)
+    q->done[(q->d_rd + q->d_cnt++) % MOCK_V4L2_MAX_BUFS] = *buf;
+}
+
+/* Caller holds ctx->lock; runs queued input and fills CAPTURE buffers */
+static void mock_v4l2_process(struct mock_v4l2 *ctx)
+{
+  unsigned long long now = mock_now_us();
+
+  while (ctx->out.streaming && ctx->out.q_cnt &&
+         ctx->f_cnt < MOCK_V4L2_FRAME_Q)
+  {
+    struct mock_v4l2_buf *in = &ctx->out.queued[ctx->out.q_rd];
+    struct mock_v4l2_frame *frame =
+      &ctx->frames[(ctx->f_rd + ctx->f_cnt++) % MOCK_V4L2_FRAME_Q];
+
+    if (ctx->busy_until_us < now)
+      ctx->busy_until_us = now;
+    if (in->plane.bytesused)
+      ctx->busy_until_us += ctx->latency_us;
+    in->ready_us = ctx->busy_until_us;
+
+    frame->timestamp = in->buf.timestamp;
+    frame->flags = in->buf.flags;
+    frame->ready_us = in->ready_us;
+    if (!in->plane.bytesused)
+      frame->bytesused = 0;
+    else if (ctx->encoder)
+      frame->bytesused = in->plane.bytesused / ctx->enc_ratio;
+    else
+      frame->bytesused = ctx->cap.fmt.fmt.pix_mp.plane_fmt[0].sizeimage;
+
+    mock_v4l2_push_done(&ctx->out, in);
+    ctx->out.q_rd = (ctx->out.q_rd + 1) % MOCK_V4L2_MAX_BUFS;
+    ctx->out.q_cnt--;
+
+    if (!ctx->encoder && ctx->reconfig_after &&
+        ++ctx->inputs == ctx->reconfig_after)
+    {
+      ctx->cap.fmt.fmt.pix_mp.width =
+        mock_env("MOCK_V4L2_RECONFIG_WIDTH", ctx->cap.fmt.fmt.pix_mp.width);
+      ctx->cap.fmt.fmt.pix_mp.height =
+        mock_env("MOCK_V4L2_RECONFIG_HEIGHT", ctx->cap.fmt.fmt.pix_mp.height);
+      ctx->cap.fmt.fmt.pix_mp.plane_fmt[0].sizeimage =
+        mock_v4l2_sizeimage(&ctx->cap.fmt);
+      mock_v4l2_post_event(ctx, MOCK_MSM_VIDC_DECODER_EVENT_CHANGE);
+    }
+  }
+
+  while (ctx->cap.streaming && ctx->cap.q_cnt && ctx->f_cnt)
+  {
+    struct mock_v4l2_buf *out = &ctx->cap.queued[ctx->cap.q_rd];
+    struct mock_v4l2_frame *frame = &ctx->frames[ctx->f_rd];
+
+    out->buf.timestamp = frame->timestamp;
+    out->buf.flags = frame->flags;
+    out->plane.bytesused = frame->bytesused < out->plane.length ?
+                           frame->bytesused : out->plane.length;
+    out->plane.data_offset = 0;
+    out->ready_us = frame->ready_us;
+    mock_v4l2_push_done(&ctx->cap, out);
+    ctx->cap.q_rd = (ctx->cap.q_rd + 1) % MOCK_V4L2_MAX_BUFS;
+    ctx->cap.q_cnt--;
+    ctx->f_rd = (ctx->f_rd + 1) % MOCK_V4L2_FRAME_Q;
+    ctx->f_cnt--;
+  }
+  pthread_cond_broadcast(&ctx->cond);
+}
+
+static struct mock_v4l2_queue *mock_v4l2_queue_of(struct mock_v4l2 *ctx,
+                                                  unsigned type)
+{
+  if (type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE)
+    return &ctx->out;
+  if (type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE)
+    return &ctx->cap;
+  return NULL;
+}
+
+static void mock_v4l2_reset_queue(struct mock_v4l2_queue *q)
+{
+  q->q_rd = q->q_cnt = 0;
+  q->d_rd = q->d_cnt = 0;
+}
+
+static int mock_v4l2_qbuf(struct mock_v4l2 *ctx, struct v4l2_buffer *buf)
+{
+  struct mock_v4l2_queue *q = mock_v4l2_queue_of(ctx, buf->type);
+  struct mock_v4l2_buf *entry;
+
+  if (!q || !buf->m.planes || buf->index >= q->count ||
+      q->q_cnt == MOCK_V4L2_MAX_BUFS)
+  {
+    errno = EINVAL;
+    return -1;
+  }
+  entry = &q->queued[(q->q_rd + q->q_cnt++) % MOCK_V4L2_MAX_BUFS];
+  entry->buf = *buf;
+  entry->plane = buf->m.planes[0];
+  entry->buf.m.planes = NULL;
+  mock_v4l2_process(ctx);
+  return 0;
+}
+
+static int mock_v4l2_dqbuf(struct mock_v4l2 *ctx, struct v4l2_buffer *buf)
+{
+  struct mock_v4l2_queue *q = mock_v4l2_queue_of(ctx, buf->type);
+  struct v4l2_plane *planes = buf->m.planes;
+  struct mock_v4l2_buf *entry;
+
+  if (!q || !planes)
+  {
+    errno = EINVAL;
+    return -1;
+  }
+  if (!q->d_cnt || q->done[q->d_rd].ready_us > mock_now_us())
+  {
+    errno = EAGAIN;
+    return -1;
+  }
+  entry = &q->done[q->d_rd];
+  *buf = entry->buf;
+  buf->m.planes = planes;
+  buf->length = 1;
+  planes[0] = entry->plane;
+  q->d_rd = (q->d_rd + 1) % MOCK_V4L2_MAX_BUFS;
+  q->d_cnt--;
+  return 0;
+}
+
+/* Caller holds ctx->lock; earliest time something becomes dequeueable */
+static short mock_v4l2_revents(struct mock_v4l2 *ctx, short events,
+                               unsigned long long *next_us)
+{
+  unsigned long long now = mock_now_us();
+  short revents = 0;
+
+  *next_us = 0;
+  if (ctx->e_cnt)
+    revents |= POLLPRI;
+  if (ctx->cap.d_cnt)
+  {
+    if (ctx->cap.done[ctx->cap.d_rd].ready_us <= now)
+      revents |= POLLIN | POLLRDNORM;
+    else
+      *next_us = ctx->cap.done[ctx->cap.d_rd].ready_us;
+  }
+  if (ctx->out.d_cnt)
+  {
+    unsigned long long ready = ctx->out.done[ctx->out.d_rd].ready_us;
+    if (ready <= now)
+      revents |= POLLOUT | POLLWRNORM;
+    else if (!*next_us || ready < *next_us)
+      *next_us = ready;
+  }
+  if (ctx->closing && !ctx->e_cnt)
+    revents |= POLLERR;
+  return revents & (events | POLLERR);
+}
+
+static short mock_v4l2_poll(void *context, short events, int timeout_ms)
+{
+  struct mock_v4l2 *ctx = (struct mock_v4l2 *) context;
+  unsigned long long deadline = mock_now_us() +
+                                (unsigned long long) timeout_ms * 1000;
+  unsigned long long next_us;
+  short revents;
+
+  pthread_mutex_lock(&ctx->lock);
+  while (!(revents = mock_v4l2_revents(ctx, events, &next_us)) &&
+         timeout_ms)
+  {
+    unsigned long long now = mock_now_us();
+    unsigned long long wake = next_us;
+    struct timespec abstime;
+
+    if (timeout_ms > 0)
+    {
+      if (now >= deadline)
+        break;
+      if (!wake || wake > deadline)
+        wake = deadline;
+    }
+    if (wake)
+    {
+      mock_abstime(&abstime, wake > now ? wake - now : 0);
+      pthread_cond_timedwait(&ctx->cond, &ctx->lock, &abstime);
+    }
+    else
+      pthread_cond_wait(&ctx->cond, &ctx->lock);
+  }
+  pthread_mutex_unlock(&ctx->lock);
+  return revents;
+}
+
+static int mock_v4l2_ioctl(void *context, ioctl_req_t request, void *arg)
+{
+  struct mock_v4l2 *ctx = (struct mock_v4l2 *) context;
+  struct mock_v4l2_queue *q;
+  int ret = 0;
+
+  pthread_mutex_lock(&ctx->lock);
+  switch (request)
+  {
+  case VIDIOC_QUERYCAP:
+  {
+    struct v4l2_capability *cap = (struct v4l2_capability *) arg;
+    memset(cap, 0, sizeof(*cap));
+    strlcpy((char *) cap->driver, "mock_v4l2", sizeof(cap->driver));
+    strlcpy((char *) cap->card, ctx->encoder ? "mock encoder" : "mock decoder",
+            sizeof(cap->card));
+    cap->capabilities = V4L2_CAP_VIDEO_CAPTURE_MPLANE |
+                        V4L2_CAP_VIDEO_OUTPUT_MPLANE | V4L2_CAP_STREAMING;
+    break;
+  }
+  case VIDIOC_ENUM_FMT:
+  {
+    struct v4l2_fmtdesc *fdesc = (struct v4l2_fmtdesc *) arg;
+    q = mock_v4l2_queue_of(ctx, fdesc->type);
+    if (!q || fdesc->index)
+    {
+      errno = EINVAL;
+      ret = -1;
+      break;
+    }
+    fdesc->flags = 0;
+    fdesc->pixelformat = q->fmt.fmt.pix_mp.pixelformat;
+    strlcpy((char *) fdesc->description, "mock", sizeof(fdesc->description));
+    break;
+  }
+  case VIDIOC_S_FMT:
+  case VIDIOC_G_FMT:
+  {
+    struct v4l2_format *fmt = (struct v4l2_format *) arg;
+    q = mock_v4l2_queue_of(ctx, fmt->type);
+    if (!q)
+    {
+      errno = EINVAL;
+      ret = -1;
+      break;
+    }
+    if (request == VIDIOC_S_FMT)
+    {
+      q->fmt = *fmt;
+      q->fmt.fmt.pix_mp.num_planes = 1;
+      q->fmt.fmt.pix_mp.plane_fmt[0].sizeimage = mock_v4l2_sizeimage(&q->fmt);
+      /* the decoder's picture size follows its bitstream format */
+      if (!ctx->encoder && q == &ctx->out)
+      {
+        ctx->cap.fmt.fmt.pix_mp.width = fmt->fmt.pix_mp.width;
+        ctx->cap.fmt.fmt.pix_mp.height = fmt->fmt.pix_mp.height;
+        ctx->cap.fmt.fmt.pix_mp.plane_fmt[0].sizeimage =
+          mock_v4l2_sizeimage(&ctx->cap.fmt);
+      }
+    }
+    *fmt = q->fmt;
+    break;
+  }
+  case VIDIOC_REQBUFS:
+  {
+    struct v4l2_requestbuffers *req = (struct v4l2_requestbuffers *) arg;
+    q = mock_v4l2_queue_of(ctx, req->type);
+    if (!q)
+    {
+      errno = EINVAL;
+      ret = -1;
+      break;
+    }
+    if (req->count && req->count < ctx->min_bufs)
+      req->count = ctx->min_bufs;
+    if (req->count > MOCK_V4L2_MAX_BUFS)
+      req->count = MOCK_V4L2_MAX_BUFS;
+    q->count = req->count;
+    mock_v4l2_reset_queue(q);
+    break;
+  }
+  case VIDIOC_QBUF:
+    ret = mock_v4l2_qbuf(ctx, (struct v4l2_buffer *) arg);
+    break;
+  case VIDIOC_DQBUF:
+    ret = mock_v4l2_dqbuf(ctx, (struct v4l2_buffer *) arg);
+    break;
+  case VIDIOC_STREAMON:
+  case VIDIOC_STREAMOFF:
+    q = mock_v4l2_queue_of(ctx, *(unsigned *) arg);
+    if (!q)
+    {
+      errno = EINVAL;
+      ret = -1;
+      break;
+    }
+    q->streaming = (request == VIDIOC_STREAMON);
+    if (!q->streaming)
+    {
+      /* V4L2 returns every buffer to userspace on STREAMOFF */
+      mock_v4l2_reset_queue(q);
+      if (q == &ctx->out)
+        ctx->f_rd = ctx->f_cnt = 0;
+    }
+    mock_v4l2_process(ctx);
+    break;
+  case VIDIOC_DQEVENT:
+  {
+    struct v4l2_event *event = (struct v4l2_event *) arg;
+    if (!ctx->e_cnt)
+    {
+      errno = ENOENT;
+      ret = -1;
+      break;
+    }
+    memset(event, 0, sizeof(*event));
+    event->type = V4L2_EVENT_PRIVATE_START;
+    event->u.data[0] = ctx->events[ctx->e_rd];
+    ctx->e_rd = (ctx->e_rd + 1) % MOCK_V4L2_EVENT_Q;
+    ctx->e_cnt--;
+    event->pending = ctx->e_cnt;
+    break;
+  }
+  case VIDIOC_UNSUBSCRIBE_EVENT:
+    /* last call before close(); lets the poll thread exit. The encoder
+       waits for CLOSE_DONE, the decoder stops on POLLERR. */
+    ctx->closing = 1;
+    if (ctx->encoder)
+      mock_v4l2_post_event(ctx, MOCK_MSM_VIDC_CLOSE_DONE);
+    else
+      pthread_cond_broadcast(&ctx->cond);
+    break;
+  case VIDIOC_DECODER_CMD:
+    /* stop: return every CAPTURE buffer empty, then report the flush */
+    while (ctx->cap.q_cnt)
+    {
+      struct mock_v4l2_buf *out = &ctx->cap.queued[ctx->cap.q_rd];
+      out->plane.bytesused = 0;
+      out->ready_us = 0;
+      mock_v4l2_push_done(&ctx->cap, out);
+      ctx->cap.q_rd = (ctx->cap.q_rd + 1) % MOCK_V4L2_MAX_BUFS;
+      ctx->cap.q_cnt--;
+    }
+    mock_v4l2_post_event(ctx, MOCK_MSM_VIDC_DECODER_FLUSH_DONE);
+    break;
+  default:
+    /* controls, PREPARE_BUF and SUBSCRIBE_EVENT just succeed */
+    break;
+  }
+  pthread_mutex_unlock(&ctx->lock);
+  return ret;
+}
+
+static void *mock_v4l2_open(const char *pathname)
+{
+  struct mock_v4l2 *ctx = (struct mock_v4l2 *) calloc(1, sizeof(*ctx));
+  if (!ctx)
+    return NULL;
+  pthread_mutex_init(&ctx->lock, NULL);
+  pthread_cond_init(&ctx->cond, NULL);
+  ctx->encoder = !strcmp(pathname, "/dev/video33");
+  ctx->latency_us = mock_env("MOCK_V4L2_LATENCY_US", 0);
+  ctx->enc_ratio = mock_env("MOCK_V4L2_ENC_RATIO", 20);
+  if (!ctx->enc_ratio)
+    ctx->enc_ratio = 1;
+  ctx->min_bufs = mock_env("MOCK_V4L2_MIN_BUFS", 4);
+  ctx->reconfig_after = mock_env("MOCK_V4L2_RECONFIG_AFTER", 0);
+
+  ctx->out.fmt.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+  ctx->cap.fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+  ctx->out.fmt.fmt.pix_mp.pixelformat = ctx->encoder ?
+                                        V4L2_PIX_FMT_NV12 : V4L2_PIX_FMT_H264;
+  ctx->cap.fmt.fmt.pix_mp.pixelformat = ctx->encoder ?
+                                        V4L2_PIX_FMT_H264 : V4L2_PIX_FMT_NV12;
+  ctx->out.fmt.fmt.pix_mp.width = ctx->cap.fmt.fmt.pix_mp.width = 1920;
+  ctx->out.fmt.fmt.pix_mp.height = ctx->cap.fmt.fmt.pix_mp.height = 1080;
+  ctx->out.fmt.fmt.pix_mp.num_planes = ctx->cap.fmt.fmt.pix_mp.num_planes = 1;
+  ctx->out.fmt.fmt.pix_mp.plane_fmt[0].sizeimage =
+    mock_v4l2_sizeimage(&ctx->out.fmt);
+  ctx->cap.fmt.fmt.pix_mp.plane_fmt[0].sizeimage =
+    mock_v4l2_sizeimage(&ctx->cap.fmt);
+  return ctx;
+}
+
+static void mock_v4l2_close(void *context)
+{
+  struct mock_v4l2 *ctx = (struct mock_v4l2 *) context;
+  pthread_mutex_destroy(&ctx->lock);
+  pthread_cond_destroy(&ctx->cond);
+  free(ctx);
+}
+
+const struct mock_dev_ops mock_v4l2_dec_dev_ops =
+{
+  "/dev/video32",
+  mock_v4l2_open,
+  mock_v4l2_close,
+  mock_v4l2_ioctl,
+  mock_v4l2_poll
+};
+
+const struct mock_dev_ops mock_v4l2_enc_dev_ops =
+{
+  "/dev/video33",
+  mock_v4l2_open,
+  mock_v4l2_close,
+  mock_v4l2_ioctl,
+  mock_v4l2_poll
+};
@@ -0,0 +1,540 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+/*
+	Emulation of the msm vidc decoder driver (/dev/msm_vidc_dec*) for the
+	mock driver library, see mock_drv.c.
+
+	Every VDEC_IOCTL_DECODE_FRAME "decodes" instantly: the input is
+	returned at once and, as soon as an output buffer is available, a frame
+	carrying the input timestamp and flags is returned with synthetic
+	metadata.
+
+	MOCK_VIDC_DECODE_US  per-frame decode latency in us (default 0)
+	MOCK_VIDC_WIDTH/HEIGHT  initial picture size (default 1920x1080)
+	MOCK_VIDC_SWITCH_FRAMES  change the picture size every n frames,
+	                     like a DASH representation switch (default 0: never)
+	MOCK_VIDC_SWITCH_SIZES  comma separated WxH list the switches cycle
+	                     through (default 1280x720,1920x1080,640x360)
+
+	A switch to a picture that fits the registered output buffers after
+	VDEC_IOCTL_SET_CONT_ON_RECONFIG is reported with
+	VDEC_MSG_EVT_INFO_CONFIG_CHANGED and decoding continues, frames
+	carrying the new crop. Any other switch posts VDEC_MSG_EVT_CONFIG_CHANGED
+	and holds the input until output buffers of the new size are set.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <linux/msm_vidc_dec.h>
+#include "mock_drv.h"
+
+#define MOCK_MSG_Q_SIZE   256
+#define MOCK_FRAME_Q_SIZE 64
+#define MOCK_OUT_Q_SIZE   64
+#define MOCK_HELD_Q_SIZE  32
+#define MOCK_MAX_SWITCH_SIZES 8
+
+struct mock_msg
+{
+  struct vdec_msginfo info;
+  unsigned long long ready_us;
+};
+
+struct mock_frame
+{
+  int64_t time_stamp;
+  uint32_t flags;
+  int empty;
+  unsigned width, height;
+  unsigned long long ready_us;
+};
+
+struct mock_vidc
+{
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int stop_msg;
+
+  struct mock_msg msgs[MOCK_MSG_Q_SIZE];
+  unsigned msg_rd, msg_cnt;
+
+  /* decoded frames waiting for an output buffer */
+  struct mock_frame frames[MOCK_FRAME_Q_SIZE];
+  unsigned frame_rd, frame_cnt;
+
+  /* output buffers queued by the client */
+  struct vdec_fillbuffer_cmd out_bufs[MOCK_OUT_Q_SIZE];
+  unsigned out_rd, out_cnt;
+
+  struct vdec_picsize picsize;
+  struct vdec_allocatorproperty ip_req, op_req;
+  unsigned frame_cnt_total;
+  unsigned long long hw_busy_until_us;
+
+  /* resolution switches */
+  unsigned decoded;
+  unsigned switch_idx;
+  int cont_on_reconfig;
+  unsigned op_set_size;   /* size of the registered output buffers */
+  int reconfig_pending;
+  struct vdec_input_frameinfo held[MOCK_HELD_Q_SIZE];
+  unsigned held_cnt;
+};
+
+static unsigned mock_decode_us;
+static unsigned mock_switch_frames;
+static unsigned mock_switch_cnt;
+static unsigned mock_switch_w[MOCK_MAX_SWITCH_SIZES];
+static unsigned mock_switch_h[MOCK_MAX_SWITCH_SIZES];
+
+static void mock_parse_switch_sizes(void)
+{
+  const char *val = getenv("MOCK_VIDC_SWITCH_SIZES");
+  unsigned w, h;
+  int n;
+
+  if (!val)
+    val = "1280x720,1920x1080,640x360";
+  mock_switch_cnt = 0;
+  while (mock_switch_cnt < MOCK_MAX_SWITCH_SIZES &&
+         sscanf(val, "%ux%u%n", &w, &h, &n) == 2)
+  {
+    mock_switch_w[mock_switch_cnt] = w;
+    mock_switch_h[mock_switch_cnt++] = h;
+    val += n;
+    if (*val != ',')
+      break;
+    val++;
+  }
+}
+
+static void mock_update_buffer_req(struct mock_vidc *ctx)
+{
+  unsigned width = ctx->picsize.frame_width;
+  unsigned height = ctx->picsize.frame_height;
+
+  ctx->picsize.stride = ALIGN(width, 128);
+  ctx->picsize.scan_lines = ALIGN(height, 32);
+
+  ctx->ip_req.buffer_type = VDEC_BUFFER_TYPE_INPUT;
+  ctx->ip_req.buffer_size = ALIGN(width * height * 3 / 4, 8192);
+  ctx->ip_req.alignment = 8192;
+
+  ctx->op_req.buffer_type = VDEC_BUFFER_TYPE_OUTPUT;
+  ctx->op_req.buffer_size = ALIGN(ctx->picsize.stride *
+                                  (ctx->picsize.scan_lines +
+                                   ALIGN(height / 2, 32)), 8192);
+  ctx->op_req.alignment = 8192;
+}
+
+static void *mock_vidc_open(const char *pathname)
+{
+  struct mock_vidc *ctx = (struct mock_vidc *) calloc(1, sizeof(*ctx));
+  if (!ctx)
+    return NULL;
+  pthread_mutex_init(&ctx->lock, NULL);
+  pthread_cond_init(&ctx->cond, NULL);
+  ctx->picsize.frame_width = mock_env("MOCK_VIDC_WIDTH", 1920);
+  ctx->picsize.frame_height = mock_env("MOCK_VIDC_HEIGHT", 1080);
+  ctx->ip_req.mincount = ctx->ip_req.actualcount = 6;
+  ctx->ip_req.maxcount = 32;
+  ctx->op_req.mincount = ctx->op_req.actualcount = 8;
+  ctx->op_req.maxcount = 32;
+  mock_update_buffer_req(ctx);
+  mock_decode_us = mock_env("MOCK_VIDC_DECODE_US", 0);
+  mock_switch_frames = mock_env("MOCK_VIDC_SWITCH_FRAMES", 0);
+  mock_parse_switch_sizes();
+  return ctx;
+}
+
+static void mock_vidc_close(void *context)
+{
+  struct mock_vidc *ctx = (struct mock_vidc *) context;
+  pthread_mutex_destroy(&ctx->lock);
+  pthread_cond_destroy(&ctx->cond);
+  free(ctx);
+}
+
+/* Caller holds ctx->lock */
+static void mock_post_msg(struct mock_vidc *ctx, unsigned msgcode,
+                          unsigned status, unsigned long long ready_us)
+{
+  struct mock_msg *msg;
+
+  if (ctx->msg_cnt == MOCK_MSG_Q_SIZE)
+  {
+    fprintf(stderr, "mock_vidc: message queue full, dropping %u\n", msgcode);
+    return;
+  }
+  msg = &ctx->msgs[(ctx->msg_rd + ctx->msg_cnt++) % MOCK_MSG_Q_SIZE];
+  memset(msg, 0, sizeof(*msg));
+  msg->info.msgcode = msgcode;
+  msg->info.status_code = status;
+  msg->ready_us = ready_us;
+  pthread_cond_broadcast(&ctx->cond);
+}
+
+/* Caller holds ctx->lock; pairs decoded frames with free output buffers */
+static void mock_deliver_frames(struct mock_vidc *ctx)
+{
+  while (ctx->frame_cnt && ctx->out_cnt &&
+         ctx->msg_cnt < MOCK_MSG_Q_SIZE)
+  {
+    struct mock_frame *frame = &ctx->frames[ctx->frame_rd];
+    struct vdec_fillbuffer_cmd *out = &ctx->out_bufs[ctx->out_rd];
+    struct vdec_output_frameinfo *info;
+    struct mock_msg *msg;
+
+    mock_post_msg(ctx, VDEC_MSG_RESP_OUTPUT_BUFFER_DONE, VDEC_S_SUCCESS,
+                  frame->ready_us);
+    msg = &ctx->msgs[(ctx->msg_rd + ctx->msg_cnt - 1) % MOCK_MSG_Q_SIZE];
+    info = &msg->info.msgdata.output_frame;
+    info->bufferaddr = out->buffer.bufferaddr;
+    info->offset = 0;
+    info->client_data = out->client_data;
+    info->time_stamp = frame->time_stamp;
+    info->flags = frame->flags;
+    info->interlaced_format = VDEC_InterlaceFrameProgressive;
+    info->framesize.left = 0;
+    info->framesize.top = 0;
+    info->framesize.right = frame->width;
+    info->framesize.bottom = frame->height;
+    if (frame->empty)
+    {
+      info->len = 0;
+    }
+    else
+    {
+      info->len = out->buffer.buffer_len;
+      info->pic_type = (ctx->frame_cnt_total++ % 30) ?
+                       PICTURE_TYPE_P : PICTURE_TYPE_IDR;
+    }
+    msg->info.msgdatasize = sizeof(*info);
+
+    ctx->frame_rd = (ctx->frame_rd + 1) % MOCK_FRAME_Q_SIZE;
+    ctx->frame_cnt--;
+    ctx->out_rd = (ctx->out_rd + 1) % MOCK_OUT_Q_SIZE;
+    ctx->out_cnt--;
+  }
+}
+
+/* Caller holds ctx->lock. Moves to the next size of the switch list;
+   returns 0 if the new picture fits the registered output buffers and
+   decoding continues, 1 if the output port has to be reconfigured. */
+static int mock_switch_resolution(struct mock_vidc *ctx)
+{
+  struct vdec_allocatorproperty ip_req = ctx->ip_req, op_req = ctx->op_req;
+  unsigned idx = ctx->switch_idx++ % mock_switch_cnt;
+
+  ctx->picsize.frame_width = mock_switch_w[idx];
+  ctx->picsize.frame_height = mock_switch_h[idx];
+  mock_update_buffer_req(ctx);
+  ctx->ip_req = ip_req;
+  if (ctx->cont_on_reconfig && ctx->op_req.buffer_size <= ctx->op_set_size)
+  {
+    /* buffer requirements stay those of the largest picture */
+    ctx->op_req = op_req;
+    mock_post_msg(ctx, VDEC_MSG_EVT_INFO_CONFIG_CHANGED, VDEC_S_SUCCESS,
+                  ctx->hw_busy_until_us);
+    return 0;
+  }
+  ctx->op_req.actualcount = op_req.actualcount;
+  ctx->reconfig_pending = 1;
+  mock_post_msg(ctx, VDEC_MSG_EVT_CONFIG_CHANGED, VDEC_S_SUCCESS,
+                ctx->hw_busy_until_us);
+  return 1;
+}
+
+static int mock_hold_input(struct mock_vidc *ctx,
+                           struct vdec_input_frameinfo *frameinfo)
+{
+  if (ctx->held_cnt == MOCK_HELD_Q_SIZE)
+  {
+    errno = EBUSY;
+    return -1;
+  }
+  ctx->held[ctx->held_cnt++] = *frameinfo;
+  return 0;
+}
+
+static int mock_decode_frame(struct mock_vidc *ctx,
+                             struct vdec_input_frameinfo *frameinfo)
+{
+  unsigned long long now = mock_now_us();
+  struct mock_frame *frame;
+  struct mock_msg *msg;
+
+  if (ctx->reconfig_pending)
+    return mock_hold_input(ctx, frameinfo);
+  if (ctx->frame_cnt == MOCK_FRAME_Q_SIZE)
+  {
+    errno = EBUSY;
+    return -1;
+  }
+  if (mock_switch_frames && mock_switch_cnt && frameinfo->datalen &&
+      ctx->decoded && !(ctx->decoded % mock_switch_frames) &&
+      ctx->switch_idx * mock_switch_frames < ctx->decoded &&
+      mock_switch_resolution(ctx))
+    return mock_hold_input(ctx, frameinfo);
+  mock_post_msg(ctx, VDEC_MSG_RESP_INPUT_BUFFER_DONE, VDEC_S_SUCCESS, now);
+  msg = &ctx->msgs[(ctx->msg_rd + ctx->msg_cnt - 1) % MOCK_MSG_Q_SIZE];
+  msg->info.msgdata.input_frame_clientdata = frameinfo->client_data;
+
+  if (!frameinfo->datalen && !(frameinfo->flags & VDEC_BUFFERFLAG_EOS))
+    return 0;
+
+  /* Frames are decoded back to back, like a single hardware core */
+  frame = &ctx->frames[(ctx->frame_rd + ctx->frame_cnt++) % MOCK_FRAME_Q_SIZE];
+  frame->time_stamp = frameinfo->timestamp;
+  frame->flags = frameinfo->flags;
+  frame->empty = !frameinfo->datalen;
+  frame->width = ctx->picsize.frame_width;
+  frame->height = ctx->picsize.frame_height;
+  if (!frame->empty)
+    ctx->decoded++;
+  if (ctx->hw_busy_until_us < now)
+    ctx->hw_busy_until_us = now;
+  if (!frame->empty)
+    ctx->hw_busy_until_us += mock_decode_us;
+  frame->ready_us = ctx->hw_busy_until_us;
+  mock_deliver_frames(ctx);
+  return 0;
+}
+
+static void mock_flush(struct mock_vidc *ctx, enum vdec_bufferflush flush_dir)
+{
+  unsigned long long now = mock_now_us();
+
+  if (flush_dir == VDEC_FLUSH_TYPE_INPUT || flush_dir == VDEC_FLUSH_TYPE_ALL)
+  {
+    unsigned i;
+    for (i = 0; i < ctx->held_cnt; i++)
+    {
+      struct mock_msg *msg;
+      mock_post_msg(ctx, VDEC_MSG_RESP_INPUT_FLUSHED, VDEC_S_SUCCESS, now);
+      msg = &ctx->msgs[(ctx->msg_rd + ctx->msg_cnt - 1) % MOCK_MSG_Q_SIZE];
+      msg->info.msgdata.input_frame_clientdata = ctx->held[i].client_data;
+    }
+    ctx->held_cnt = 0;
+    ctx->frame_cnt = 0;
+    mock_post_msg(ctx, VDEC_MSG_RESP_FLUSH_INPUT_DONE, VDEC_S_SUCCESS, now);
+  }
+  if (flush_dir == VDEC_FLUSH_TYPE_OUTPUT || flush_dir == VDEC_FLUSH_TYPE_ALL)
+  {
+    /* frames of the old size are dropped with the port reconfiguration */
+    if (ctx->reconfig_pending)
+      ctx->frame_cnt = 0;
+    while (ctx->out_cnt && ctx->msg_cnt < MOCK_MSG_Q_SIZE)
+    {
+      struct vdec_fillbuffer_cmd *out = &ctx->out_bufs[ctx->out_rd];
+      struct mock_msg *msg;
+      mock_post_msg(ctx, VDEC_MSG_RESP_OUTPUT_FLUSHED, VDEC_S_SUCCESS, now);
+      msg = &ctx->msgs[(ctx->msg_rd + ctx->msg_cnt - 1) % MOCK_MSG_Q_SIZE];
+      msg->info.msgdata.output_frame.bufferaddr = out->buffer.bufferaddr;
+      msg->info.msgdata.output_frame.client_data = out->client_data;
+      ctx->out_rd = (ctx->out_rd + 1) % MOCK_OUT_Q_SIZE;
+      ctx->out_cnt--;
+    }
+    mock_post_msg(ctx, VDEC_MSG_RESP_FLUSH_OUTPUT_DONE, VDEC_S_SUCCESS, now);
+  }
+}
+
+static int mock_get_next_msg(struct mock_vidc *ctx, struct vdec_msginfo *out)
+{
+  while (!ctx->stop_msg)
+  {
+    if (ctx->msg_cnt)
+    {
+      struct mock_msg *msg = &ctx->msgs[ctx->msg_rd];
+      unsigned long long now = mock_now_us();
+      if (msg->ready_us <= now)
+      {
+        memcpy(out, &msg->info, sizeof(*out));
+        ctx->msg_rd = (ctx->msg_rd + 1) % MOCK_MSG_Q_SIZE;
+        ctx->msg_cnt--;
+        return 0;
+      }
+      else
+      {
+        struct timespec abstime;
+        mock_abstime(&abstime, msg->ready_us - now);
+        pthread_cond_timedwait(&ctx->cond, &ctx->lock, &abstime);
+      }
+    }
+    else
+      pthread_cond_wait(&ctx->cond, &ctx->lock);
+  }
+  errno = EINTR;
+  return -1;
+}
+
+static int mock_vidc_ioctl(void *context, ioctl_req_t request, void *arg)
+{
+  struct mock_vidc *ctx = (struct mock_vidc *) context;
+  struct vdec_ioctl_msg *ioctl_msg = (struct vdec_ioctl_msg *) arg;
+  unsigned long long now;
+  int ret = 0;
+
+  if (request == VDEC_IOCTL_GET_NEXT_MSG)
+  {
+    pthread_mutex_lock(&ctx->lock);
+    ret = mock_get_next_msg(ctx, (struct vdec_msginfo *) ioctl_msg->out);
+    pthread_mutex_unlock(&ctx->lock);
+    return ret;
+  }
+
+  pthread_mutex_lock(&ctx->lock);
+  now = mock_now_us();
+  switch (request)
+  {
+  case VDEC_IOCTL_STOP_NEXT_MSG:
+    ctx->stop_msg = 1;
+    pthread_cond_broadcast(&ctx->cond);
+    break;
+  case VDEC_IOCTL_CMD_START:
+    ctx->stop_msg = 0;
+    mock_post_msg(ctx, VDEC_MSG_RESP_START_DONE, VDEC_S_SUCCESS, now);
+    break;
+  case VDEC_IOCTL_CMD_STOP:
+    mock_post_msg(ctx, VDEC_MSG_RESP_STOP_DONE, VDEC_S_SUCCESS, now);
+    break;
+  case VDEC_IOCTL_CMD_PAUSE:
+    mock_post_msg(ctx, VDEC_MSG_RESP_PAUSE_DONE, VDEC_S_SUCCESS, now);
+    break;
+  case VDEC_IOCTL_CMD_RESUME:
+    mock_post_msg(ctx, VDEC_MSG_RESP_RESUME_DONE, VDEC_S_SUCCESS, now);
+    break;
+  case VDEC_IOCTL_CMD_FLUSH:
+    mock_flush(ctx, *(enum vdec_bufferflush *) ioctl_msg->in);
+    break;
+  case VDEC_IOCTL_DECODE_FRAME:
+    ret = mock_decode_frame(ctx, (struct vdec_input_frameinfo *) ioctl_msg->in);
+    break;
+  case VDEC_IOCTL_FILL_OUTPUT_BUFFER:
+    if (ctx->out_cnt == MOCK_OUT_Q_SIZE)
+    {
+      errno = EBUSY;
+      ret = -1;
+      break;
+    }
+    memcpy(&ctx->out_bufs[(ctx->out_rd + ctx->out_cnt++) % MOCK_OUT_Q_SIZE],
+           ioctl_msg->in, sizeof(struct vdec_fillbuffer_cmd));
+    mock_deliver_frames(ctx);
+    break;
+  case VDEC_IOCTL_GET_BUFFER_REQ:
+  {
+    struct vdec_allocatorproperty *prop =
+      (struct vdec_allocatorproperty *) ioctl_msg->out;
+    if (prop->buffer_type == VDEC_BUFFER_TYPE_INPUT)
+      *prop = ctx->ip_req;
+    else
+      *prop = ctx->op_req;
+    break;
+  }
+  case VDEC_IOCTL_SET_BUFFER_REQ:
+  {
+    struct vdec_allocatorproperty *prop =
+      (struct vdec_allocatorproperty *) ioctl_msg->in;
+    struct vdec_allocatorproperty *req =
+      (prop->buffer_type == VDEC_BUFFER_TYPE_INPUT) ?
+      &ctx->ip_req : &ctx->op_req;
+    if (prop->actualcount < req->mincount ||
+        prop->actualcount > req->maxcount)
+    {
+      errno = EINVAL;
+      ret = -1;
+    }
+    else
+      req->actualcount = prop->actualcount;
+    break;
+  }
+  case VDEC_IOCTL_SET_CONT_ON_RECONFIG:
+    ctx->cont_on_reconfig = 1;
+    break;
+  case VDEC_IOCTL_SET_BUFFER:
+  {
+    struct vdec_setbuffer_cmd *cmd = (struct vdec_setbuffer_cmd *) ioctl_msg->in;
+    unsigned i, held_cnt;
+    if (cmd->buffer_type != VDEC_BUFFER_TYPE_OUTPUT)
+      break;
+    ctx->op_set_size = cmd->buffer.buffer_len;
+    if (!ctx->reconfig_pending || ctx->op_set_size < ctx->op_req.buffer_size)
+      break;
+    /* output port reconfigured: decode the input held since the switch */
+    ctx->reconfig_pending = 0;
+    held_cnt = ctx->held_cnt;
+    ctx->held_cnt = 0;
+    for (i = 0; i < held_cnt; i++)
+      mock_decode_frame(ctx, &ctx->held[i]);
+    break;
+  }
+  case VDEC_IOCTL_SET_PICRES:
+    ctx->picsize = *(struct vdec_picsize *) ioctl_msg->in;
+    mock_update_buffer_req(ctx);
+    break;
+  case VDEC_IOCTL_GET_PICRES:
+    *(struct vdec_picsize *) ioctl_msg->out = ctx->picsize;
+    break;
+  case VDEC_IOCTL_GET_INTERLACE_FORMAT:
+    *(enum vdec_interlaced_format *) ioctl_msg->out =
+      VDEC_InterlaceFrameProgressive;
+    break;
+  case VDEC_IOCTL_GET_MV_BUFFER_SIZE:
+  {
+    struct vdec_mv_buff_size *mv = (struct vdec_mv_buff_size *) ioctl_msg->out;
+    mv->size = ALIGN(ctx->picsize.frame_width / 16 *
+                     ctx->picsize.frame_height / 16 * 64, 8192);
+    mv->alignment = 8192;
+    break;
+  }
+  case VDEC_IOCTL_GET_NUMBER_INSTANCES:
+  case VDEC_IOCTL_GET_DISABLE_DMX_SUPPORT:
+  case VDEC_IOCTL_GET_ENABLE_SEC_METADATA:
+  case VDEC_IOCTL_GET_PERF_LEVEL:
+    if (ioctl_msg->out)
+      *(unsigned *) ioctl_msg->out = (request == VDEC_IOCTL_GET_NUMBER_INSTANCES);
+    break;
+  default:
+    /* configuration ioctls (SET_CODEC, SET_BUFFER, ...) just succeed */
+    break;
+  }
+  pthread_mutex_unlock(&ctx->lock);
+  return ret;
+}
+
+const struct mock_dev_ops mock_vidc_dev_ops =
+{
+  "/dev/msm_vidc_dec",
+  mock_vidc_open,
+  mock_vidc_close,
+  mock_vidc_ioctl,
+  NULL
+};
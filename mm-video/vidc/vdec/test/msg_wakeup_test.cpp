@@ -0,0 +1,243 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+/*
+	Wakeup test and contention benchmark for vidc_msg_wakeup.
+
+	mm-vdec-msg-wakeup-test [events] [producers] [seed]
+	mm-vdec-msg-wakeup-test -b [events] [max_producers]
+
+	Both modes model post_event and the message thread: producers queue
+	an event under a shared mutex, as the ETB/FTB/command queues are, and
+	write one byte to a pipe; the consumer reads the pipe and drains every
+	queued event under the mutex, as process_event_cb does.
+
+	The test posts 'events' events from each producer with random yields
+	between them, using vidc_msg_wakeup to decide which posts write to the
+	pipe. Every event must reach the consumer: if the pipe stays empty for
+	two seconds while events are queued, a wakeup was lost.
+
+	The benchmark posts 'events' events per producer for 1..max_producers
+	producers, once writing the pipe for every event while holding the
+	mutex, as post_event did, and once with vidc_msg_wakeup and the write
+	after the unlock. It reports events per second, pipe writes and
+	consumer wakeups per event. Producers stop posting while 256 pipe
+	bytes are unread, standing in for the bounded buffer count.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "vidc_msg_wakeup.h"
+
+#define MAX_PRODUCERS 16
+#define MAX_UNREAD    256     // pipe bytes in flight, well below the pipe size
+
+struct msg_queue {
+  pthread_mutex_t lock;
+  int pipe_in;
+  int pipe_out;
+  bool coalesce;
+  uint32_t events;
+  uint32_t producers;
+  uint32_t queued;        // under lock: events not yet drained
+  uint32_t received;      // consumer only
+  volatile uint32_t wakeups;
+  volatile uint32_t writes;
+  uint32_t seeds[MAX_PRODUCERS];
+  vidc_msg_wakeup wakeup;
+};
+
+static void *producer(void *arg)
+{
+  msg_queue *q = (msg_queue *)arg;
+  uint32_t index = __sync_fetch_and_add(&q->seeds[MAX_PRODUCERS - 1], 1);
+  uint32_t rnd_state = q->seeds[index], i;
+  unsigned char id = 1;
+
+  for (i = 0; i < q->events; i++) {
+    /* the component never has more events outstanding than it has
+     * buffers, and a producer blocked on a full pipe while holding the
+     * mutex would deadlock the locked mode */
+    while (q->writes - q->wakeups >= MAX_UNREAD)
+      sched_yield();
+    pthread_mutex_lock(&q->lock);
+    q->queued++;
+    if (!q->coalesce) {
+      write(q->pipe_out, &id, 1);
+      __sync_fetch_and_add(&q->writes, 1);
+    }
+    pthread_mutex_unlock(&q->lock);
+    if (q->coalesce && q->wakeup.signal()) {
+      write(q->pipe_out, &id, 1);
+      __sync_fetch_and_add(&q->writes, 1);
+    }
+    if (rnd_state) {
+      rnd_state = rnd_state * 1103515245 + 12345;
+      if (!((rnd_state >> 8) % 4))
+        sched_yield();
+    }
+  }
+  return NULL;
+}
+
+/* Returns false when events stay queued with nothing in the pipe */
+static bool consume(msg_queue *q)
+{
+  uint32_t total = q->events * q->producers, count;
+  struct pollfd pfd;
+  unsigned char id;
+
+  pfd.fd = q->pipe_in;
+  pfd.events = POLLIN;
+  while (q->received < total) {
+    if (poll(&pfd, 1, 2000) <= 0)
+      return false;
+    if (read(q->pipe_in, &id, 1) != 1)
+      return false;
+    __sync_fetch_and_add(&q->wakeups, 1);
+    if (q->coalesce)
+      q->wakeup.rearm();
+    pthread_mutex_lock(&q->lock);
+    count = q->queued;
+    q->queued = 0;
+    pthread_mutex_unlock(&q->lock);
+    q->received += count;
+  }
+  return true;
+}
+
+/* Runs one producer/consumer round; returns the elapsed time in us, or
+ * 0 if a wakeup was lost */
+static uint64_t run(msg_queue *q, uint32_t events, uint32_t producers,
+    bool coalesce, uint32_t seed)
+{
+  pthread_t threads[MAX_PRODUCERS];
+  struct timeval start, end;
+  int fds[2];
+  bool ok;
+  uint32_t i;
+
+  if (pipe(fds))
+    return 0;
+  pthread_mutex_init(&q->lock, NULL);
+  q->pipe_in = fds[0];
+  q->pipe_out = fds[1];
+  q->coalesce = coalesce;
+  q->events = events;
+  q->producers = producers;
+  q->queued = q->received = q->wakeups = q->writes = 0;
+  q->wakeup.reset();
+  for (i = 0; i < producers; i++)
+    q->seeds[i] = seed ? seed + i : 0;
+  q->seeds[MAX_PRODUCERS - 1] = 0;
+
+  gettimeofday(&start, NULL);
+  for (i = 0; i < producers; i++)
+    pthread_create(&threads[i], NULL, producer, q);
+  ok = consume(q);
+  // a lost wakeup leaves producers blocked on a full pipe at most
+  if (!ok) {
+    close(fds[0]);
+    fds[0] = -1;
+  }
+  for (i = 0; i < producers; i++)
+    pthread_join(threads[i], NULL);
+  gettimeofday(&end, NULL);
+
+  if (fds[0] >= 0)
+    close(fds[0]);
+  close(fds[1]);
+  pthread_mutex_destroy(&q->lock);
+  if (!ok)
+    return 0;
+  return (end.tv_sec - start.tv_sec) * 1000000ull + end.tv_usec - start.tv_usec + 1;
+}
+
+static int test(uint32_t events, uint32_t producers, uint32_t seed)
+{
+  static msg_queue q;
+
+  if (producers < 1 || producers >= MAX_PRODUCERS)
+    producers = 4;
+  for (uint32_t round = 0; round < 20; round++) {
+    if (!run(&q, events, producers, true, seed + round * MAX_PRODUCERS)) {
+      printf("FAIL: round %u lost a wakeup, %u of %u events received\n",
+          round, q.received, events * producers);
+      return 1;
+    }
+    if (q.wakeup.get_signalled() != q.writes ||
+        q.writes + q.wakeup.get_coalesced() != events * producers) {
+      printf("FAIL: round %u %u writes, %u signalled, %u coalesced\n", round,
+          q.writes, q.wakeup.get_signalled(), q.wakeup.get_coalesced());
+      return 1;
+    }
+  }
+  printf("test: 20 rounds of %u events from %u producers passed, seed %u\n",
+      events, producers, seed);
+  return 0;
+}
+
+static int bench(uint32_t events, uint32_t max_producers)
+{
+  static msg_queue q;
+  uint32_t producers, mode;
+  uint64_t us;
+
+  if (max_producers < 1 || max_producers >= MAX_PRODUCERS)
+    max_producers = 4;
+  for (producers = 1; producers <= max_producers; producers *= 2) {
+    for (mode = 0; mode < 2; mode++) {
+      us = run(&q, events, producers, mode, 0);
+      if (!us) {
+        printf("lost wakeup\n");
+        return 1;
+      }
+      printf("%u producer%s, %-23s: %8.2f M events/s %5.3f writes/event "
+          "%5.3f wakeups/event\n", producers, producers > 1 ? "s" : " ",
+          mode ? "coalesced, unlocked" : "write per event, locked",
+          (double)events * producers / us,
+          (double)q.writes / (events * producers),
+          (double)q.wakeups / (events * producers));
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1 && !strcmp(argv[1], "-b"))
+    return bench(argc > 2 ? atoi(argv[2]) : 200000, argc > 3 ? atoi(argv[3]) : 4);
+  return test(argc > 1 ? atoi(argv[1]) : 20000, argc > 2 ? atoi(argv[2]) : 4,
+      argc > 3 ? atoi(argv[3]) : 1);
+}
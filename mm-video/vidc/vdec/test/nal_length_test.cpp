@@ -0,0 +1,276 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+/*
+	Unit test and throughput benchmark for h264_nal_length.
+
+	mm-vdec-nal-length-test [iterations] [seed]
+	mm-vdec-nal-length-test -b [au_bytes] [loops]
+
+	The test builds random access units with 1, 2, 3 and 4-byte NAL length
+	fields, including zero length units, and compares to_annexb() with a
+	reference that accumulates each length a byte at a time and stages every
+	NAL in a scratch buffer, as the NAL length parser does. 4-byte units are
+	also converted in place. Truncated units and short destinations must be
+	rejected. avcC records with several SPS and PPS are rewritten with
+	from_avcc() and checked the same way.
+
+	The benchmark converts one access unit of 'au_bytes' spread over eight
+	slices with the reference and with to_annexb() for each field size.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include "h264_nal_length.h"
+
+#define MAX_NALS     16
+#define MAX_AU       (512 * 1024)
+
+static uint32_t rnd_state;
+
+static uint32_t rnd()
+{
+  rnd_state = rnd_state * 1103515245 + 12345;
+  return rnd_state >> 8;
+}
+
+/* NAL length parser model: length bytes accumulated one at a time, each NAL
+ * staged in scratch behind a start code and then appended to dst */
+static int ref_convert(uint8_t *dst, uint32_t dst_len, const uint8_t *src,
+    uint32_t src_len, uint32_t nal_length, uint8_t *scratch, uint32_t *types)
+{
+  uint32_t in = 0, out = 0, len, acc, scratch_len;
+
+  *types = 0;
+  while (in < src_len) {
+    len = 0;
+    for (acc = 0; acc < nal_length; acc++) {
+      if (in >= src_len)
+        return -1;
+      len |= (uint32_t)src[in++] << ((nal_length - acc - 1) << 3);
+    }
+    if (len > src_len - in)
+      return -1;
+    scratch[0] = scratch[1] = scratch[2] = 0;
+    scratch[3] = 1;
+    memcpy(scratch + 4, src + in, len);
+    scratch_len = len + 4;
+    if (len)
+      *types |= 1u << (src[in] & 0x1F);
+    in += len;
+    if (scratch_len > dst_len - out)
+      return -1;
+    memcpy(dst + out, scratch, scratch_len);
+    out += scratch_len;
+  }
+  return (int)out;
+}
+
+static uint32_t max_len(uint32_t nal_length)
+{
+  return nal_length == 1 ? 255 : 4000;
+}
+
+/* Random access unit of 1..MAX_NALS units; payloads start with a NAL header */
+static uint32_t build_au(uint8_t *au, uint32_t nal_length)
+{
+  uint32_t count = 1 + rnd() % MAX_NALS, len = 0, i, j, size;
+
+  for (i = 0; i < count; i++) {
+    size = (rnd() % 8) ? rnd() % (max_len(nal_length) + 1) : 0;
+    h264_nal_length::put(au + len, size, nal_length);
+    len += nal_length;
+    for (j = 0; j < size; j++)
+      au[len + j] = (uint8_t)(j ? rnd() : (0x60 | (rnd() % 13)));
+    len += size;
+  }
+  return len;
+}
+
+static bool check_au(uint32_t nal_length)
+{
+  static uint8_t au[MAX_AU], out[MAX_AU], ref[MAX_AU], scratch[MAX_AU];
+  uint32_t len, types = 0, ref_types = 0, cut;
+  int ret, ref_ret;
+
+  len = build_au(au, nal_length);
+  ref_ret = ref_convert(ref, sizeof(ref), au, len, nal_length, scratch, &ref_types);
+  ret = h264_nal_length::to_annexb(out, sizeof(out), au, len, nal_length, &types);
+  if (ret < 0 || ret != ref_ret || memcmp(out, ref, ret) || types != ref_types) {
+    printf("FAIL: nal_length %u au %u got %d expected %d types %#x/%#x\n",
+        nal_length, len, ret, ref_ret, types, ref_types);
+    return false;
+  }
+
+  // a destination one byte short is rejected
+  if (h264_nal_length::to_annexb(out, ret - 1, au, len, nal_length, NULL) != -1) {
+    printf("FAIL: nal_length %u overran a %d byte destination\n", nal_length, ret - 1);
+    return false;
+  }
+
+  // so is a unit cut inside a length field or payload
+  cut = rnd() % len;
+  ret = h264_nal_length::to_annexb(out, sizeof(out), au, cut, nal_length, NULL);
+  ref_ret = ref_convert(ref, sizeof(ref), au, cut, nal_length, scratch, &ref_types);
+  if (ret != ref_ret || (ret > 0 && memcmp(out, ref, ret))) {
+    printf("FAIL: nal_length %u au cut at %u of %u got %d expected %d\n",
+        nal_length, cut, len, ret, ref_ret);
+    return false;
+  }
+
+  if (nal_length == 4) {
+    ref_ret = ref_convert(ref, sizeof(ref), au, len, nal_length, scratch, &ref_types);
+    ret = h264_nal_length::to_annexb(au, len, au, len, nal_length, &types);
+    if (ret != ref_ret || memcmp(au, ref, ret) || types != ref_types) {
+      printf("FAIL: in place conversion of %u bytes got %d\n", len, ret);
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool check_avcc()
+{
+  static uint8_t avcc[MAX_AU], out[MAX_AU], ref[MAX_AU];
+  uint32_t sps = 1 + rnd() % 3, pps = 1 + rnd() % 4, nal_length = 1 + rnd() % 4;
+  uint32_t len = 0, ref_len = 0, set, n, size, j;
+  int ret;
+
+  avcc[len++] = 1;
+  avcc[len++] = 66;
+  avcc[len++] = 0;
+  avcc[len++] = 30;
+  avcc[len++] = 0xFC | (nal_length - 1);
+  for (set = 0; set < 2; set++) {
+    avcc[len++] = set ? pps : (0xE0 | sps);
+    for (n = 0; n < (set ? pps : sps); n++) {
+      size = 1 + rnd() % (nal_length == 1 ? 255 : 300);
+      avcc[len++] = (uint8_t)(size >> 8);
+      avcc[len++] = (uint8_t)size;
+      h264_nal_length::put(ref + ref_len, size, nal_length);
+      ref_len += nal_length;
+      for (j = 0; j < size; j++)
+        avcc[len + j] = ref[ref_len + j] = (uint8_t)(j ? rnd() : (set ? 0x68 : 0x67));
+      len += size;
+      ref_len += size;
+    }
+  }
+
+  ret = h264_nal_length::from_avcc(NULL, avcc, len, nal_length);
+  if (ret != (int)ref_len ||
+      h264_nal_length::from_avcc(out, avcc, len, nal_length) != ret ||
+      memcmp(out, ref, ref_len)) {
+    printf("FAIL: avcC %u SPS %u PPS nal_length %u got %d expected %u\n",
+        sps, pps, nal_length, ret, ref_len);
+    return false;
+  }
+  if (h264_nal_length::from_avcc(NULL, avcc, 6 + rnd() % (len - 6), nal_length) != -1) {
+    printf("FAIL: truncated avcC accepted\n");
+    return false;
+  }
+  return true;
+}
+
+static int test(uint32_t iterations, uint32_t seed)
+{
+  rnd_state = seed;
+  for (uint32_t i = 0; i < iterations; i++) {
+    if (!check_au(1 + i % 4) || !check_avcc()) {
+      printf("test failed at iteration %u, seed %u\n", i, seed);
+      return 1;
+    }
+  }
+  printf("test: %u iterations passed, seed %u\n", iterations, seed);
+  return 0;
+}
+
+static uint64_t now_us()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void report(const char *name, uint32_t bytes, uint32_t loops, uint64_t us)
+{
+  printf("%-22s: %8.1f MB/s %8.2f us/AU\n", name,
+      (double)bytes * loops / (us ? us : 1), (double)us / loops);
+}
+
+static int bench(uint32_t au_bytes, uint32_t loops)
+{
+  static uint8_t au[MAX_AU], out[MAX_AU + 64], scratch[MAX_AU];
+  uint32_t nal_length, len, slice, i, types;
+  uint64_t start;
+  char name[32];
+
+  if (au_bytes > MAX_AU - 64)
+    au_bytes = MAX_AU - 64;
+  for (nal_length = 2; nal_length <= 4; nal_length += 2) {
+    // eight slices, lengths kept within a 2-byte field
+    slice = au_bytes / 8 < 0xFFFF ? au_bytes / 8 : 0xFFFF;
+    len = 0;
+    for (i = 0; i < 8; i++) {
+      h264_nal_length::put(au + len, slice, nal_length);
+      memset(au + len + nal_length, 0x41, slice);
+      len += nal_length + slice;
+    }
+
+    start = now_us();
+    for (i = 0; i < loops; i++)
+      ref_convert(out, sizeof(out), au, len, nal_length, scratch, &types);
+    snprintf(name, sizeof(name), "reference, %u-byte", nal_length);
+    report(name, len, loops, now_us() - start);
+
+    start = now_us();
+    for (i = 0; i < loops; i++)
+      h264_nal_length::to_annexb(out, sizeof(out), au, len, nal_length, &types);
+    snprintf(name, sizeof(name), "to_annexb, %u-byte", nal_length);
+    report(name, len, loops, now_us() - start);
+  }
+
+  // in place: the first pass leaves start codes, which read back as
+  // length 1, so restore the length fields between loops
+  start = now_us();
+  for (i = 0; i < loops; i++) {
+    for (uint32_t pos = 0; pos < len; pos += 4 + slice)
+      h264_nal_length::put(au + pos, slice, 4);
+    h264_nal_length::to_annexb(au, len, au, len, 4, &types);
+  }
+  report("to_annexb, in place", len, loops, now_us() - start);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1 && !strcmp(argv[1], "-b"))
+    return bench(argc > 2 ? atoi(argv[2]) : 128 * 1024, argc > 3 ? atoi(argv[3]) : 5000);
+  return test(argc > 1 ? atoi(argv[1]) : 20000, argc > 2 ? atoi(argv[2]) : 1);
+}
@@ -43,7 +43,12 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <semaphore.h>
 #include "OMX_QCOMExtns.h"
 #include <sys/time.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 #include <cutils/properties.h>
+#if defined (_ANDROID_HONEYCOMB_) || defined (_ANDROID_ICS_)
+#include <media/hardware/HardwareAPI.h>
+#endif
 
 #include <linux/android_pmem.h>
 
@@ -283,6 +288,48 @@ int waitForPortSettingsChanged = 1;
 test_status currentStatus = GOOD_STATE;
 struct timeval t_start = {0, 0}, t_end = {0, 0};
 
+/* ETB->EBD latency per input buffer, ETB->FBD latency per timestamp and
+   CPU cost per decoded frame. Only measured with VDEC_TEST_BENCH=1, or
+   when VDEC_TEST_BATCH or VDEC_TEST_ADAPTIVE asks for a measurement.
+   Past BENCH_MAX_SAMPLES a sample replaces a random earlier one, so the
+   percentiles still cover the whole run */
+#define BENCH_MAX_INPUT_BUFS 64
+#define BENCH_TS_SLOTS 64
+#define BENCH_MAX_SAMPLES 65536
+struct bench_samples
+{
+  unsigned *us;
+  unsigned cnt, size;
+  unsigned seen, max;
+};
+static bool bench_enabled = false;
+struct bench_ts_slot
+{
+  OMX_TICKS timestamp;
+  struct timespec time;
+  bool valid;
+};
+static struct timespec bench_etb_time[BENCH_MAX_INPUT_BUFS];
+static struct bench_ts_slot bench_ts[BENCH_TS_SLOTS];
+static unsigned bench_ts_next = 0;
+static struct bench_samples bench_ebd_latency, bench_fbd_latency;
+static pthread_mutex_t bench_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct timespec bench_cpu_start;
+static int bench_cycles_fd = -1;
+/* Client side cost of queueing the initial buffers; VDEC_TEST_BATCH=<n>
+   queues them through the BufferBatch extension, n buffers per call */
+static unsigned bench_batch_size = 0;
+static double bench_submit_ns = 0;
+static unsigned bench_submit_cnt = 0;
+/* Output gap across a resolution switch, from the last frame before
+   OMX_EventPortSettingsChanged to the first frame after it, split by
+   whether the port had to be reconfigured. VDEC_TEST_ADAPTIVE=<w>x<h>
+   enables adaptive playback up to that size */
+static unsigned bench_adaptive_width = 0, bench_adaptive_height = 0;
+static struct bench_samples bench_switch_crop, bench_switch_reconfig;
+static struct bench_samples *bench_switch_kind = NULL;
+static struct timespec bench_last_fbd, bench_switch_from;
+
 //* OMX Spec Version supported by the wrappers. Version = 1.1 */
 const OMX_U32 CURRENT_OMX_SPEC_VERSION = 0x00000101;
 OMX_COMPONENTTYPE* dec_handle = 0;
@@ -331,6 +378,16 @@ static int Read_Buffer_From_RCV_File(OMX_BUFFERHEADERTYPE  *pBufHdr);
 static int Read_Buffer_From_VC1_File(OMX_BUFFERHEADERTYPE  *pBufHdr);
 static int Read_Buffer_From_DivX_4_5_6_File(OMX_BUFFERHEADERTYPE  *pBufHdr);
 static int Read_Buffer_From_DivX_311_File(OMX_BUFFERHEADERTYPE  *pBufHdr);
+static void bench_start();
+static void bench_etb(OMX_BUFFERHEADERTYPE *pBuffer);
+static void bench_ebd(OMX_BUFFERHEADERTYPE *pBuffer);
+static void bench_fbd(OMX_BUFFERHEADERTYPE *pBuffer);
+static void bench_switch(bool crop_only);
+static void bench_report(int frames);
+static void bench_submit_begin(struct timespec *start);
+static void bench_submit_end(struct timespec *start, unsigned count);
+static OMX_U32 bench_submit_batch(OMX_U32 port, OMX_BUFFERHEADERTYPE **hdrs,
+                                  OMX_U32 count);
 
 static OMX_ERRORTYPE Allocate_Buffer ( OMX_COMPONENTTYPE *dec_handle,
                                        OMX_BUFFERHEADERTYPE  ***pBufHdrs,
@@ -595,6 +652,7 @@ void* ebd_thread(void* pArg)
     if((readBytes = Read_Buffer(pBuffer)) > 0) {
         pBuffer->nFilledLen = readBytes;
         DEBUG_PRINT("%s: Timestamp sent(%lld)", __FUNCTION__, pBuffer->nTimeStamp);
+        bench_etb(pBuffer);
         OMX_EmptyThisBuffer(dec_handle,pBuffer);
         etb_count++;
     }
@@ -604,6 +662,7 @@ void* ebd_thread(void* pArg)
         bInputEosReached = true;
         pBuffer->nFilledLen = readBytes;
         DEBUG_PRINT("%s: Timestamp sent(%lld)", __FUNCTION__, pBuffer->nTimeStamp);
+        bench_etb(pBuffer);
         OMX_EmptyThisBuffer(dec_handle,pBuffer);
         DEBUG_PRINT("EBD::Either EOS or Some Error while reading file\n");
         etb_count++;
@@ -884,6 +943,12 @@ void* fbd_thread(void* pArg)
       //total frames is fbd_cnt - 1 since the start time is
       //recorded after the first frame is decoded.
       printf("\nAvg decoding frame rate=%f\n", (fbd_cnt - 1)/total_time);
+      if (fbd_cnt)
+        printf("Queue node allocations=%d (%f per frame)\n",
+               queue_alloc_count(etb_queue) + queue_alloc_count(fbd_queue),
+               (float)(queue_alloc_count(etb_queue) +
+                       queue_alloc_count(fbd_queue)) / fbd_cnt);
+      bench_report(fbd_cnt);
 
       DEBUG_PRINT("***************************************************\n");
       DEBUG_PRINT("FillBufferDone: End Of Stream Reached\n");
@@ -1023,6 +1088,7 @@ OMX_ERRORTYPE EventHandler(OMX_IN OMX_HANDLETYPE hComponent,
             break;
         case OMX_EventPortSettingsChanged:
             DEBUG_PRINT("OMX_EventPortSettingsChanged port[%d]\n", nData1);
+            bench_switch(nData2 == OMX_IndexConfigCommonOutputCrop);
             if (nData2 == OMX_IndexConfigCommonOutputCrop)
             {
                 DEBUG_PRINT("Received OMX_IndexConfigCommonOutputCrop\n");
@@ -1080,6 +1146,7 @@ OMX_ERRORTYPE EmptyBufferDone(OMX_IN OMX_HANDLETYPE hComponent,
 
     DEBUG_PRINT("Function %s cnt[%d]\n", __FUNCTION__, ebd_cnt);
     ebd_cnt++;
+    bench_ebd(pBuffer);
 
 
     if(bInputEosReached) {
@@ -1104,6 +1171,7 @@ OMX_ERRORTYPE FillBufferDone(OMX_OUT OMX_HANDLETYPE hComponent,
                              OMX_OUT OMX_BUFFERHEADERTYPE* pBuffer)
 {
     DEBUG_PRINT("Inside %s callback_count[%d] \n", __FUNCTION__, fbd_cnt);
+    bench_fbd(pBuffer);
 
     /* Test app will assume there is a dynamic port setting
      * In case that there is no dynamic port setting, OMX will not call event cb,
@@ -1494,6 +1562,7 @@ int main(int argc, char **argv)
       }
     }
 
+    bench_start();
     run_tests();
     pthread_cond_destroy(&cond);
     pthread_mutex_destroy(&lock);
@@ -1819,6 +1888,8 @@ int Play_Decoder()
     int frameSize=0;
     OMX_ERRORTYPE ret = OMX_ErrorNone;
     OMX_BUFFERHEADERTYPE* pBuffer = NULL;
+    struct timespec submit_start;
+    OMX_U32 batch_first = 0, batch_cnt = 0;
     DEBUG_PRINT("Inside %s \n", __FUNCTION__);
 
     /* open the i/p and o/p files based on the video file format passed */
@@ -2015,6 +2086,30 @@ int Play_Decoder()
         printf("\n ERROR: Setting picture order!");
         return -1;
     }
+#if defined (_ANDROID_HONEYCOMB_) || defined (_ANDROID_ICS_)
+    if (bench_adaptive_width && bench_adaptive_height)
+    {
+        android::PrepareForAdaptivePlaybackParams adaptive;
+        OMX_INDEXTYPE index;
+
+        memset(&adaptive, 0, sizeof(adaptive));
+        adaptive.nSize = sizeof(adaptive);
+        adaptive.nVersion.nVersion = CURRENT_OMX_SPEC_VERSION;
+        adaptive.nPortIndex = 1;
+        adaptive.bEnable = OMX_TRUE;
+        adaptive.nMaxFrameWidth = bench_adaptive_width;
+        adaptive.nMaxFrameHeight = bench_adaptive_height;
+        if (OMX_GetExtensionIndex(dec_handle,
+              (OMX_STRING)"OMX.google.android.index.prepareForAdaptivePlayback",
+              &index) != OMX_ErrorNone ||
+            OMX_SetParameter(dec_handle, index, (OMX_PTR)&adaptive) != OMX_ErrorNone)
+            printf("\n Adaptive playback for %ux%u not supported\n",
+                   bench_adaptive_width, bench_adaptive_height);
+        else
+            DEBUG_PRINT("\n Adaptive playback up to %ux%u\n",
+                        bench_adaptive_width, bench_adaptive_height);
+    }
+#endif
     DEBUG_PRINT("\nVideo format: W x H (%d x %d)",
       portFmt.format.video.nFrameWidth,
       portFmt.format.video.nFrameHeight);
@@ -2159,7 +2254,11 @@ int Play_Decoder()
         }
         pOutYUVBufHdrs[bufCnt]->nOutputPortIndex = 1;
         pOutYUVBufHdrs[bufCnt]->nFlags &= ~OMX_BUFFERFLAG_EOS;
+        if (bench_batch_size)
+            continue;
+        bench_submit_begin(&submit_start);
         ret = OMX_FillThisBuffer(dec_handle, pOutYUVBufHdrs[bufCnt]);
+        bench_submit_end(&submit_start, 1);
         if (OMX_ErrorNone != ret)
             DEBUG_PRINT_ERROR("Error - OMX_FillThisBuffer failed with result %d\n", ret);
         else
@@ -2168,6 +2267,9 @@ int Play_Decoder()
             free_op_buf_cnt--;
         }
     }
+    if (bench_batch_size)
+        free_op_buf_cnt -= bench_submit_batch(1, pOutYUVBufHdrs,
+                                              portFmt.nBufferCountActual);
 
     used_ip_buf_cnt = input_buf_cnt;
 
@@ -2203,6 +2305,7 @@ int Play_Decoder()
       pInputBufHdrs[0]->nOffset = 0;
       pInputBufHdrs[0]->nFlags = 0;
 
+      bench_etb(pInputBufHdrs[0]);
       ret = OMX_EmptyThisBuffer(dec_handle, pInputBufHdrs[0]);
       if (ret != OMX_ErrorNone)
       {
@@ -2222,6 +2325,7 @@ int Play_Decoder()
       i = 0;
     }
 
+    batch_first = i;
     for (i; i < used_ip_buf_cnt;i++) {
       pInputBufHdrs[i]->nInputPortIndex = 0;
       pInputBufHdrs[i]->nOffset = 0;
@@ -2232,7 +2336,11 @@ int Play_Decoder()
         pInputBufHdrs[i]->nFlags |= OMX_BUFFERFLAG_EOS;;
         bInputEosReached = true;
 
-        OMX_EmptyThisBuffer(dec_handle, pInputBufHdrs[i]);
+        bench_etb(pInputBufHdrs[i]);
+        if (bench_batch_size)
+          batch_cnt++;
+        else
+          OMX_EmptyThisBuffer(dec_handle, pInputBufHdrs[i]);
         etb_count++;
         DEBUG_PRINT("File is small::Either EOS or Some Error while reading file\n");
         break;
@@ -2242,7 +2350,15 @@ int Play_Decoder()
       pInputBufHdrs[i]->nFlags = 0;
 //pBufHdr[bufCnt]->pAppPrivate = this;
       DEBUG_PRINT("%s: Timestamp sent(%lld)", __FUNCTION__, pInputBufHdrs[i]->nTimeStamp);
+      bench_etb(pInputBufHdrs[i]);
+      if (bench_batch_size) {
+          batch_cnt++;
+          etb_count++;
+          continue;
+      }
+      bench_submit_begin(&submit_start);
       ret = OMX_EmptyThisBuffer(dec_handle, pInputBufHdrs[i]);
+      bench_submit_end(&submit_start, 1);
       if (OMX_ErrorNone != ret) {
           DEBUG_PRINT_ERROR("ERROR - OMX_EmptyThisBuffer failed with result %d\n", ret);
           do_freeHandle_and_clean_up(true);
@@ -2253,6 +2369,13 @@ int Play_Decoder()
           etb_count++;
       }
     }
+    if (batch_cnt &&
+        bench_submit_batch(0, &pInputBufHdrs[batch_first], batch_cnt) != batch_cnt)
+    {
+        DEBUG_PRINT_ERROR("ERROR - input buffer batch failed\n");
+        do_freeHandle_and_clean_up(true);
+        return -1;
+    }
 
     if(0 != pthread_create(&ebd_thread_id, NULL, ebd_thread, NULL))
     {
@@ -3985,3 +4108,276 @@ freespace_query_failed:
    close(pmem_fd);
 #endif
 }
+
+static void bench_start()
+{
+  struct perf_event_attr attr;
+  const char *bench = getenv("VDEC_TEST_BENCH");
+  const char *batch = getenv("VDEC_TEST_BATCH");
+  const char *adaptive = getenv("VDEC_TEST_ADAPTIVE");
+
+  if (batch)
+  {
+    bench_batch_size = atoi(batch);
+    if (bench_batch_size > QOMX_VIDEO_MAX_BUFFER_BATCH)
+      bench_batch_size = QOMX_VIDEO_MAX_BUFFER_BATCH;
+  }
+  if (adaptive &&
+      sscanf(adaptive, "%ux%u", &bench_adaptive_width, &bench_adaptive_height) != 2)
+    bench_adaptive_width = bench_adaptive_height = 0;
+  bench_enabled = (bench && atoi(bench)) || bench_batch_size ||
+                  (bench_adaptive_width && bench_adaptive_height);
+  if (!bench_enabled)
+    return;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &bench_cpu_start);
+  /* Count cycles of every thread the component spawns from here on */
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = PERF_COUNT_HW_CPU_CYCLES;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  bench_cycles_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  if (bench_cycles_fd < 0)
+    DEBUG_PRINT("perf cycle counter unavailable, reporting CPU time only\n");
+}
+
+static unsigned bench_elapsed_us(struct timespec *from)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - from->tv_sec) * 1000000 +
+         (now.tv_nsec - from->tv_nsec) / 1000;
+}
+
+/* Caller holds bench_lock */
+static void bench_add_sample(struct bench_samples *samples, unsigned us)
+{
+  samples->seen++;
+  if (us > samples->max)
+    samples->max = us;
+  if (samples->cnt == BENCH_MAX_SAMPLES)
+  {
+    unsigned idx = (unsigned)rand() % samples->seen;
+    if (idx < samples->cnt)
+      samples->us[idx] = us;
+    return;
+  }
+  if (samples->cnt == samples->size)
+  {
+    unsigned new_size = samples->size ? samples->size * 2 : 1024;
+    if (new_size > BENCH_MAX_SAMPLES)
+      new_size = BENCH_MAX_SAMPLES;
+    unsigned *new_arr = (unsigned *)realloc(samples->us,
+                                            new_size * sizeof(unsigned));
+    if (!new_arr)
+      return;
+    samples->us = new_arr;
+    samples->size = new_size;
+  }
+  samples->us[samples->cnt++] = us;
+}
+
+static void bench_etb(OMX_BUFFERHEADERTYPE *pBuffer)
+{
+  int idx;
+
+  if (!bench_enabled)
+    return;
+  pthread_mutex_lock(&bench_lock);
+  for (idx = 0; idx < used_ip_buf_cnt && idx < BENCH_MAX_INPUT_BUFS; idx++)
+  {
+    if (pInputBufHdrs[idx] == pBuffer)
+    {
+      clock_gettime(CLOCK_MONOTONIC, &bench_etb_time[idx]);
+      break;
+    }
+  }
+  if (pBuffer->nFilledLen)
+  {
+    struct bench_ts_slot *slot = &bench_ts[bench_ts_next++ % BENCH_TS_SLOTS];
+    slot->timestamp = pBuffer->nTimeStamp;
+    clock_gettime(CLOCK_MONOTONIC, &slot->time);
+    slot->valid = true;
+  }
+  pthread_mutex_unlock(&bench_lock);
+}
+
+static void bench_ebd(OMX_BUFFERHEADERTYPE *pBuffer)
+{
+  int idx;
+
+  if (!bench_enabled)
+    return;
+  pthread_mutex_lock(&bench_lock);
+  for (idx = 0; idx < used_ip_buf_cnt && idx < BENCH_MAX_INPUT_BUFS; idx++)
+  {
+    if (pInputBufHdrs[idx] == pBuffer)
+    {
+      if (bench_etb_time[idx].tv_sec)
+        bench_add_sample(&bench_ebd_latency,
+                         bench_elapsed_us(&bench_etb_time[idx]));
+      bench_etb_time[idx].tv_sec = 0;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&bench_lock);
+}
+
+static void bench_fbd(OMX_BUFFERHEADERTYPE *pBuffer)
+{
+  int idx;
+
+  if (!bench_enabled || !pBuffer->nFilledLen)
+    return;
+  pthread_mutex_lock(&bench_lock);
+  for (idx = 0; idx < BENCH_TS_SLOTS; idx++)
+  {
+    if (bench_ts[idx].valid && bench_ts[idx].timestamp == pBuffer->nTimeStamp)
+    {
+      bench_add_sample(&bench_fbd_latency,
+                       bench_elapsed_us(&bench_ts[idx].time));
+      bench_ts[idx].valid = false;
+      break;
+    }
+  }
+  if (bench_switch_kind)
+  {
+    bench_add_sample(bench_switch_kind, bench_elapsed_us(&bench_switch_from));
+    bench_switch_kind = NULL;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &bench_last_fbd);
+  pthread_mutex_unlock(&bench_lock);
+}
+
+/* A reconfiguration that follows a crop change of the same switch
+   reclassifies it; the initial port settings change is not a switch */
+static void bench_switch(bool crop_only)
+{
+  if (!bench_enabled)
+    return;
+  pthread_mutex_lock(&bench_lock);
+  if (bench_last_fbd.tv_sec &&
+      (!bench_switch_kind || bench_switch_kind == &bench_switch_crop))
+  {
+    if (!bench_switch_kind)
+      bench_switch_from = bench_last_fbd;
+    bench_switch_kind = crop_only ? &bench_switch_crop : &bench_switch_reconfig;
+  }
+  pthread_mutex_unlock(&bench_lock);
+}
+
+static int bench_cmp_uint(const void *a, const void *b)
+{
+  unsigned x = *(const unsigned *)a, y = *(const unsigned *)b;
+  return (x > y) - (x < y);
+}
+
+static void bench_print_samples(const char *name, struct bench_samples *samples)
+{
+  if (!samples->cnt)
+    return;
+  qsort(samples->us, samples->cnt, sizeof(unsigned), bench_cmp_uint);
+  printf("%s latency (us): p50=%u p90=%u p99=%u max=%u (%u buffers)\n", name,
+         samples->us[samples->cnt / 2],
+         samples->us[samples->cnt * 9 / 10],
+         samples->us[samples->cnt * 99 / 100],
+         samples->max,
+         samples->seen);
+}
+
+static void bench_report(int frames)
+{
+  struct timespec cpu_end;
+  long long cycles = 0;
+  double cpu_us;
+
+  if (!bench_enabled || frames <= 0)
+    return;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_end);
+  cpu_us = (cpu_end.tv_sec - bench_cpu_start.tv_sec) * 1e6 +
+           (cpu_end.tv_nsec - bench_cpu_start.tv_nsec) / 1e3;
+  printf("CPU time per frame=%.1f us\n", cpu_us / frames);
+  if (bench_cycles_fd >= 0 &&
+      read(bench_cycles_fd, &cycles, sizeof(cycles)) == sizeof(cycles))
+    printf("CPU cycles per frame=%lld\n", cycles / frames);
+
+  pthread_mutex_lock(&bench_lock);
+  bench_print_samples("ETB->EBD", &bench_ebd_latency);
+  bench_print_samples("ETB->FBD", &bench_fbd_latency);
+  bench_print_samples("Switch (crop only)", &bench_switch_crop);
+  bench_print_samples("Switch (port reconfig)", &bench_switch_reconfig);
+  pthread_mutex_unlock(&bench_lock);
+  if (bench_submit_cnt)
+    printf("Submit overhead per buffer=%.2f us (%u buffers, batch %u)\n",
+           bench_submit_ns / bench_submit_cnt / 1000, bench_submit_cnt,
+           bench_batch_size ? bench_batch_size : 1);
+}
+
+static void bench_submit_begin(struct timespec *start)
+{
+  clock_gettime(CLOCK_MONOTONIC, start);
+}
+
+static void bench_submit_end(struct timespec *start, unsigned count)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  bench_submit_ns += (now.tv_sec - start->tv_sec) * 1e9 +
+                     (now.tv_nsec - start->tv_nsec);
+  bench_submit_cnt += count;
+}
+
+/* Queue count buffers on port through the BufferBatch extension,
+   bench_batch_size buffers per call. Falls back to one call per buffer
+   if the component does not support it. Returns the buffers queued. */
+static OMX_U32 bench_submit_batch(OMX_U32 port, OMX_BUFFERHEADERTYPE **hdrs,
+                                  OMX_U32 count)
+{
+  QOMX_VIDEO_BUFFER_BATCHTYPE batch;
+  OMX_INDEXTYPE index;
+  struct timespec start;
+  OMX_ERRORTYPE ret;
+  OMX_U32 queued = 0;
+
+  if (OMX_GetExtensionIndex(dec_handle,
+        (OMX_STRING)OMX_QCOM_INDEX_CONFIG_VIDEO_BUFFERBATCH, &index) != OMX_ErrorNone)
+  {
+    printf("Buffer batch extension not supported, queueing one by one\n");
+    bench_batch_size = 0;
+    for (; queued < count; queued++)
+    {
+      bench_submit_begin(&start);
+      ret = (port == 0) ? OMX_EmptyThisBuffer(dec_handle, hdrs[queued]) :
+                          OMX_FillThisBuffer(dec_handle, hdrs[queued]);
+      bench_submit_end(&start, 1);
+      if (ret != OMX_ErrorNone)
+        break;
+    }
+    return queued;
+  }
+
+  while (queued < count)
+  {
+    memset(&batch, 0, sizeof(batch));
+    batch.nSize = sizeof(batch);
+    batch.nVersion.nVersion = CURRENT_OMX_SPEC_VERSION;
+    batch.nPortIndex = port;
+    batch.nCount = count - queued;
+    if (batch.nCount > bench_batch_size)
+      batch.nCount = bench_batch_size;
+    batch.ppBufferHdrs = hdrs + queued;
+    bench_submit_begin(&start);
+    ret = OMX_SetConfig(dec_handle, index, &batch);
+    bench_submit_end(&start, batch.nSubmitted);
+    queued += batch.nSubmitted;
+    if (ret != OMX_ErrorNone)
+    {
+      DEBUG_PRINT_ERROR("Error - buffer batch on port %lu failed with result %d\n",
+                        port, ret);
+      break;
+    }
+  }
+  return queued;
+}
@@ -0,0 +1,325 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+/*
+	B-frame timestamp reorder test for omx_ts_min_heap, omx_ts_list
+	(omx_vdec::m_timestamp_list) and omx_time_stamp_reorder.
+
+	mm-vdec-ts-parser-test [iterations] [seed]
+
+	Each iteration builds GOPs with IPBB and hierarchical B-frame
+	patterns, queues the timestamps in decode order and pops one whenever
+	the next frame in presentation order has been decoded, as the decoder
+	outputs it. The popped timestamps must come out in presentation order.
+	Timestamps repeat at random, as with 0 or duplicated container times.
+
+	The reorder class is also checked across EOS (the timestamps queued
+	before an EOS all come out before any queued after it, including a
+	zero-length EOS on an empty list), interlaced output, removal on
+	error, overflow and flush. The heap is checked with generations that
+	wrap around 2^32, and both lists must be empty and reusable after a
+	flush or reset mid-stream.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "ts_parser.h"
+
+#define MAX_FRAMES   512
+#define FRAME_US     33367
+#define LIST_SZ      32
+
+static uint32_t rnd_state;
+
+static uint32_t rnd()
+{
+  rnd_state = rnd_state * 1103515245 + 12345;
+  return rnd_state >> 8;
+}
+
+/* Fills pts[] in presentation order and order[] with presentation
+ * indices in decode order: an I/P anchor, then the B-frames before it,
+ * either in display order (IPBB) or as a binary hierarchy. */
+static uint32_t build_gops(OMX_TICKS *pts, uint32_t *order, uint32_t frames)
+{
+  uint32_t count = 0, anchor = 0, gap, i;
+  OMX_TICKS base = (OMX_TICKS)(rnd() % 1000) * FRAME_US;
+
+  for (i = 0; i < frames; i++) {
+    // some containers repeat a timestamp, or have none at all
+    if (i && !(rnd() % 8))
+      pts[i] = pts[i - 1];
+    else
+      pts[i] = base + (OMX_TICKS)i * FRAME_US;
+  }
+  order[count++] = 0;
+  while (anchor + 1 < frames) {
+    gap = 1 + rnd() % 8;
+    if (anchor + gap >= frames)
+      gap = frames - 1 - anchor;
+    order[count++] = anchor + gap;
+    if (rnd() % 2) {
+      for (i = 1; i < gap; i++)
+        order[count++] = anchor + i;
+    } else {
+      // hierarchical: each level halves the remaining intervals
+      uint32_t step, pos;
+      bool done[9];
+      memset(done, 0, sizeof(done));
+      done[0] = done[gap] = true;
+      for (step = 8; step; step >>= 1)
+        for (pos = step; pos < gap; pos += step)
+          if (!done[pos]) {
+            order[count++] = anchor + pos;
+            done[pos] = true;
+          }
+    }
+    anchor += gap;
+  }
+  return count;
+}
+
+/* Decoder model: output the next frame in presentation order as soon as
+ * it and every frame before it have been decoded */
+template <typename insert_fn, typename pop_fn>
+static bool reorder(uint32_t frames, insert_fn insert, pop_fn pop)
+{
+  static OMX_TICKS pts[MAX_FRAMES];
+  static uint32_t order[MAX_FRAMES];
+  bool decoded[MAX_FRAMES];
+  uint32_t count, next = 0, i;
+  OMX_TICKS ts;
+
+  count = build_gops(pts, order, frames);
+  if (count != frames) {
+    printf("FAIL: %u frames in decode order, expected %u\n", count, frames);
+    return false;
+  }
+  memset(decoded, 0, sizeof(decoded));
+  for (i = 0; i < count; i++) {
+    if (!insert(pts[order[i]])) {
+      printf("FAIL: insert of frame %u rejected\n", order[i]);
+      return false;
+    }
+    decoded[order[i]] = true;
+    while (next < frames && decoded[next]) {
+      if (!pop(&ts) || ts != pts[next]) {
+        printf("FAIL: frame %u got %lld expected %lld\n", next,
+            (long long)ts, (long long)pts[next]);
+        return false;
+      }
+      next++;
+    }
+  }
+  return !pop(&ts);
+}
+
+static omx_ts_list *ts_list;
+static omx_time_stamp_reorder *ts_reorder;
+
+static bool list_insert(OMX_TICKS ts) { return ts_list->insert_ts(ts); }
+static bool list_pop(OMX_TICKS *ts) { return ts_list->pop_min_ts(*ts); }
+
+static bool reorder_insert(OMX_TICKS ts)
+{
+  OMX_BUFFERHEADERTYPE hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.nTimeStamp = ts;
+  hdr.nFilledLen = 100;
+  return ts_reorder->insert_timestamp(&hdr);
+}
+
+static bool reorder_pop(OMX_TICKS *ts)
+{
+  OMX_BUFFERHEADERTYPE hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  if (!ts_reorder->get_next_timestamp(&hdr, false))
+    return false;
+  *ts = hdr.nTimeStamp;
+  return true;
+}
+
+static bool queue(OMX_TICKS ts, OMX_U32 flags, OMX_U32 len)
+{
+  OMX_BUFFERHEADERTYPE hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.nTimeStamp = ts;
+  hdr.nFlags = flags;
+  hdr.nFilledLen = len;
+  return ts_reorder->insert_timestamp(&hdr);
+}
+
+static bool next_is(OMX_TICKS expected, bool interlaced)
+{
+  OMX_BUFFERHEADERTYPE hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  if (!ts_reorder->get_next_timestamp(&hdr, interlaced) ||
+      hdr.nTimeStamp != expected) {
+    printf("FAIL: got %lld expected %lld\n", (long long)hdr.nTimeStamp,
+        (long long)expected);
+    return false;
+  }
+  return true;
+}
+
+static bool check_list()
+{
+  omx_ts_list list(LIST_SZ);
+  OMX_TICKS ts;
+  uint32_t i;
+
+  ts_list = &list;
+  if (!reorder(LIST_SZ, list_insert, list_pop))
+    return false;
+  // bounded by the buffer count
+  for (i = 0; i < LIST_SZ; i++)
+    list.insert_ts(rnd());
+  if (list.insert_ts(0)) {
+    printf("FAIL: list took more than %u timestamps\n", LIST_SZ);
+    return false;
+  }
+  // reset mid-stream, then a seek back to earlier timestamps
+  list.reset_ts_list();
+  if (list.pop_min_ts(ts) || ts)
+    return false;
+  return reorder(LIST_SZ, list_insert, list_pop);
+}
+
+static bool check_reorder(uint32_t frames)
+{
+  omx_time_stamp_reorder r;
+  OMX_TICKS ts;
+  uint32_t i;
+
+  ts_reorder = &r;
+  if (reorder_insert(1)) {
+    printf("FAIL: insert accepted with reorder mode off\n");
+    return false;
+  }
+  r.set_timestamp_reorder_mode(true);
+  if (!reorder(frames, reorder_insert, reorder_pop))
+    return false;
+
+  /* EOS: a later stream restarting at 0 must not overtake the end of
+   * the first one, with or without data in the EOS buffer */
+  queue(900, 0, 10);
+  queue(800, OMX_BUFFERFLAG_EOS, 10);
+  queue(200, 0, 10);
+  queue(300, OMX_BUFFERFLAG_EOS, 0);
+  queue(100, OMX_BUFFERFLAG_CODECCONFIG, 10);
+  queue(0, 0, 10);
+  if (!next_is(800, false) || !next_is(900, false) || !next_is(200, false) ||
+      !next_is(0, false) || reorder_pop(&ts))
+    return false;
+  // a zero-length EOS on an empty list does not block later timestamps
+  queue(0, OMX_BUFFERFLAG_EOS, 0);
+  queue(50, 0, 10);
+  if (!next_is(50, false))
+    return false;
+
+  // interlaced: both fields are queued, one frame consumes both
+  queue(2000, 0, 10);
+  queue(1000, 0, 10);
+  queue(1500, 0, 10);
+  queue(500, 0, 10);
+  if (!next_is(500, true) || !next_is(1500, true) || reorder_pop(&ts))
+    return false;
+  // but never the first timestamp after an EOS
+  queue(100, OMX_BUFFERFLAG_EOS, 10);
+  queue(50, 0, 10);
+  if (!next_is(100, true) || !next_is(50, true))
+    return false;
+
+  // removal only touches the oldest generation
+  queue(10, 0, 10);
+  queue(20, OMX_BUFFERFLAG_EOS, 10);
+  queue(10, 0, 10);
+  r.remove_time_stamp(10, false);
+  if (!next_is(20, false) || !next_is(10, false) || reorder_pop(&ts))
+    return false;
+
+  // flush mid-stream, then a stream that starts over
+  for (i = 0; i < 10; i++)
+    queue(rnd(), 0, 10);
+  r.flush_timestamp();
+  if (reorder_pop(&ts) || !reorder(frames, reorder_insert, reorder_pop))
+    return false;
+
+  // overflow is an error that disables the reorder until it is recreated
+  for (i = 0; i < TS_HEAP_SZ; i++)
+    queue(i, 0, 10);
+  if (queue(i, 0, 10) || reorder_pop(&ts) || reorder_insert(0)) {
+    printf("FAIL: timestamp table overflow not reported\n");
+    return false;
+  }
+  return true;
+}
+
+static bool check_heap_wrap()
+{
+  omx_ts_min_heap heap;
+  unsigned int base = 0xFFFFFFFF - rnd() % 4, gen, expected_gen;
+  OMX_TICKS ts, last = 0;
+  uint32_t i, n = 0;
+
+  for (i = 0; i < 64; i++)
+    heap.push(rnd() % 16, base + rnd() % 8);
+  expected_gen = base;
+  while (heap.pop(&ts, &gen)) {
+    if ((int)(gen - expected_gen) < 0 ||
+        (gen == expected_gen && n && ts < last)) {
+      printf("FAIL: generation %#x ts %lld after %#x ts %lld\n", gen,
+          (long long)ts, expected_gen, (long long)last);
+      return false;
+    }
+    expected_gen = gen;
+    last = ts;
+    n++;
+  }
+  return n == 64 && !heap.size();
+}
+
+static int test(uint32_t iterations, uint32_t seed)
+{
+  rnd_state = seed;
+  for (uint32_t i = 0; i < iterations; i++) {
+    if (!check_list() || !check_reorder(1 + rnd() % (TS_HEAP_SZ / 2)) ||
+        !check_heap_wrap()) {
+      printf("test failed at iteration %u, seed %u\n", i, seed);
+      return 1;
+    }
+  }
+  printf("test: %u iterations passed, seed %u\n", iterations, seed);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  return test(argc > 1 ? atoi(argv[1]) : 2000, argc > 2 ? atoi(argv[2]) : 1);
+}
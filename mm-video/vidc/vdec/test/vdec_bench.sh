@@ -0,0 +1,41 @@
+#!/system/bin/sh
+#
+# Offline decode benchmark: runs mm-vdec-omx-test against the mock vidc
+# driver once per input type and prints the throughput/latency summary.
+#
+#   vdec_bench.sh <clip> <codec_type> <input_type> [<input_type> ...]
+#
+# codec_type and input_type take the same values as mm-vdec-omx-test.
+# VDEC_TEST_BENCH=1 is set for the test to collect and print the
+# latency and CPU figures.
+# MOCK_VIDC_DECODE_US, MOCK_VIDC_WIDTH and MOCK_VIDC_HEIGHT are passed
+# through to the mock driver.
+# VDEC_TEST_BATCH=<n> makes the test queue its initial buffers n at a
+# time through the BufferBatch extension.
+# MOCK_VIDC_SWITCH_FRAMES=<n> makes the mock driver switch resolution
+# every n frames, cycling through MOCK_VIDC_SWITCH_SIZES; with
+# VDEC_TEST_ADAPTIVE=<w>x<h> the test enables adaptive playback up to
+# that size so switches within it only update the crop.
+
+MOCK_LIB=${MOCK_LIB:-/system/lib/libmm-vidc-mock-drv.so}
+
+if [ $# -lt 3 ]; then
+  echo "usage: $0 <clip> <codec_type> <input_type> [<input_type> ...]"
+  exit 1
+fi
+
+clip=$1
+codec=$2
+shift 2
+
+for input_type in "$@"; do
+  nal_size=""
+  # H.264 NAL length size clips need the length field size
+  if [ "$codec" = "1" ] && [ "$input_type" = "3" ]; then
+    nal_size=4
+  fi
+  echo "=== codec $codec input_type $input_type: $clip"
+  # output_type 0: no display/dump, test_case 1: plain playback
+  VDEC_TEST_BENCH=1 LD_PRELOAD=$MOCK_LIB mm-vdec-omx-test $clip $codec $input_type \
+    $nal_size 0 1 | grep -E "frame rate|per frame|latency|per buffer"
+done
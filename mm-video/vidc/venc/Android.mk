@@ -78,6 +78,7 @@ endif
 
 
 LOCAL_SRC_FILES   += ../common/src/extra_data_handler.cpp
+LOCAL_SRC_FILES   += ../common/src/vidc_ion_pool.cpp
 
 include $(BUILD_SHARED_LIBRARY)
 
@@ -58,6 +58,10 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "qc_omx_component.h"
 #include "omx_video_common.h"
 #include "extra_data_handler.h"
+#include "vidc_msg_wakeup.h"
+#ifdef USE_ION
+#include "vidc_ion_pool.h"
+#endif
 #include <linux/videodev2.h>
 #include <dlfcn.h>
 #include "C2DColorConverter.h"
@@ -127,6 +131,7 @@ static const char* MEM_DEVICE = "/dev/pmem_smipool";
 #ifdef _ANDROID_ICS_
 #define MAX_NUM_INPUT_BUFFERS 32
 #define MAX_NUM_OUTPUT_BUFFERS 32
+#define OMX_VIDEO_MAP_CACHE_SIZE 16
 #endif
 void* message_thread(void *);
 // OMX video class
@@ -164,6 +169,34 @@ protected:
     destroyC2DColorConverter_t *mConvertClose;
   };
   omx_c2d_conv c2d_conv;
+  /* Keeps client gralloc buffers mapped across ETBs so the RGBA->NV12
+     path does not mmap/munmap every frame. Keyed by (gralloc handle, fd,
+     size): every dma-buf fd shares one anon inode, so only the handle
+     tells a recycled fd apart. LRU replacement, cleared on input
+     free_buffer and port disable. */
+  class omx_map_cache {
+  public:
+    omx_map_cache();
+    ~omx_map_cache();
+    void *map(const void *handle, int fd, unsigned int size);
+    void clear();
+    unsigned int get_hits() { return hits; }
+    unsigned int get_misses() { return misses; }
+  private:
+    struct map_entry {
+      const void *handle;
+      int fd;
+      unsigned int size;
+      void *addr;
+      unsigned int last_use;
+    };
+    map_entry entries[OMX_VIDEO_MAP_CACHE_SIZE];
+    unsigned int use_count;
+    unsigned int hits;
+    unsigned int misses;
+    pthread_mutex_t lock;
+  };
+  omx_map_cache m_map_cache;
 #endif
 public:
   omx_video();  // constructor
@@ -307,6 +340,8 @@ public:
 
   int  m_pipe_in;
   int  m_pipe_out;
+  // Batches message thread wakeups across queued events
+  vidc_msg_wakeup m_msg_wakeup;
 
   pthread_t msg_thread_id;
   pthread_t async_thread_id;
@@ -120,6 +120,7 @@ void* message_thread(void *input)
 
     if(1 == n)
     {
+      omx->m_msg_wakeup.rearm();
       omx->process_event_cb(omx, id);
     }
 #ifdef QLE_BUILD
@@ -128,7 +129,8 @@ void* message_thread(void *input)
     if((n < 0) && (errno != EINTR)) break;
 #endif
   }
-  DEBUG_PRINT_LOW("omx_venc: message thread stop\n");
+  DEBUG_PRINT_LOW("omx_venc: message thread stop, wakeups %u coalesced %u\n",
+      omx->m_msg_wakeup.get_signalled(), omx->m_msg_wakeup.get_coalesced());
   return 0;
 }
 
@@ -310,11 +312,17 @@ omx_video::~omx_video()
   pthread_mutex_destroy(&m_lock);
   sem_destroy(&m_cmd_lock);
 
+#ifdef USE_ION
+  vidc_ion_pool::get()->drain(this);
+#endif
   m_venc_num_instances--;
   if (!m_venc_num_instances)
   {
     DEBUG_PRINT_HIGH("Calling close() on venc ion device fd = %d",
        m_venc_ion_devicefd);
+#ifdef USE_ION
+    vidc_ion_pool::get()->log_stats("omx_video");
+#endif
     close(m_venc_ion_devicefd);
     m_venc_ion_devicefd = 0;
     pthread_mutex_destroy(&m_venc_ionlock);
@@ -1270,6 +1278,9 @@ OMX_ERRORTYPE  omx_video::send_command_proxy(OMX_IN OMX_HANDLETYPE hComp,
     if(param1 == PORT_INDEX_IN || param1 == OMX_ALL)
     {
       m_sInPortDef.bEnabled = OMX_FALSE;
+#ifdef _ANDROID_ICS_
+      m_map_cache.clear();
+#endif
       if((m_state == OMX_StateLoaded || m_state == OMX_StateIdle)
          && release_input_done())
       {
@@ -1514,9 +1525,11 @@ bool omx_video::post_event(unsigned int p1,
 
   bRet = true;
   DEBUG_PRINT_LOW("\n Value of this pointer in post_event %p",this);
-  post_message(this, id);
   pthread_mutex_unlock(&m_lock);
 
+  if (m_msg_wakeup.signal())
+    post_message(this, id);
+
   return bRet;
 }
 
@@ -2624,6 +2637,7 @@ OMX_ERRORTYPE omx_video::free_input_buffer(OMX_BUFFERHEADERTYPE *bufferHdr)
       return OMX_ErrorNone;
     else {
       c2d_conv.close();
+      m_map_cache.clear();
       opaque_buffer_hdr[index] = NULL;
     }
   }
@@ -4478,6 +4492,12 @@ int omx_video::alloc_map_ion_memory(int size,struct ion_allocation_data *alloc_d
            alloc_data->heap_mask = (ION_HEAP(MEM_HEAP_ID) |
                 ION_HEAP(ION_IOMMU_HEAP_ID));
 
+        if (!secure_session &&
+            vidc_ion_pool::get()->take(this, ion_device_fd, alloc_data, fd_data)) {
+           DEBUG_PRINT_HIGH("ion_alloc: pooled buffer, len = %d for %d, fd = %d",
+              alloc_data->len, size, fd_data->fd);
+           return ion_device_fd;
+        }
         pthread_mutex_lock(&m_venc_ionlock);
         rc = ioctl(ion_device_fd,ION_IOC_ALLOC,alloc_data);
         if(rc || !alloc_data->handle) {
@@ -4518,6 +4538,14 @@ void omx_video::free_ion_memory(struct venc_ion *buf_ion_info)
         DEBUG_PRINT_ERROR("\n Invalid input to free_ion_memory");
         return;
      }
+     if (!secure_session && vidc_ion_pool::get()->give(this,
+            buf_ion_info->ion_device_fd, &buf_ion_info->ion_alloc_data,
+            &buf_ion_info->fd_ion_data)) {
+        buf_ion_info->ion_alloc_data.handle = NULL;
+        buf_ion_info->ion_device_fd = -1;
+        buf_ion_info->fd_ion_data.fd = -1;
+        return;
+     }
      pthread_mutex_lock(&m_venc_ionlock);
      if (close(buf_ion_info->fd_ion_data.fd)) {
        DEBUG_PRINT_ERROR("\n ION: close(%d) failed, errno = %d",
@@ -4527,6 +4555,7 @@ void omx_video::free_ion_memory(struct venc_ion *buf_ion_info)
               &buf_ion_info->ion_alloc_data.handle)) {
          DEBUG_PRINT_ERROR("\n ION: free failed, dev_fd = %d, handle = 0x%p",
             buf_ion_info->ion_device_fd, buf_ion_info->ion_alloc_data.handle);
+         pthread_mutex_unlock(&m_venc_ionlock);
          return;
      }
      buf_ion_info->ion_alloc_data.handle = NULL;
@@ -4698,6 +4727,90 @@ bool omx_video::omx_c2d_conv::get_buffer_size(int port,unsigned int &buf_size)
   }
   return ret;
 }
+omx_video::omx_map_cache::omx_map_cache()
+{
+  memset(entries,0,sizeof(entries));
+  for (int i = 0; i < OMX_VIDEO_MAP_CACHE_SIZE; i++)
+    entries[i].fd = -1;
+  use_count = 0;
+  hits = 0;
+  misses = 0;
+  pthread_mutex_init(&lock, NULL);
+}
+omx_video::omx_map_cache::~omx_map_cache()
+{
+  clear();
+  pthread_mutex_destroy(&lock);
+}
+/* Returns a mapping of the whole buffer behind gralloc 'handle', NULL on
+   failure. The mapping stays valid until clear() or until it is evicted
+   by a newer buffer. */
+void *omx_video::omx_map_cache::map(const void *handle, int fd, unsigned int size)
+{
+  map_entry *victim = NULL;
+  void *addr = NULL;
+
+  if (!handle || fd < 0 || !size)
+    return NULL;
+
+  pthread_mutex_lock(&lock);
+  use_count++;
+  for (int i = 0; i < OMX_VIDEO_MAP_CACHE_SIZE; i++) {
+    map_entry *e = &entries[i];
+    if (e->addr && e->handle == handle && e->fd == fd && e->size == size) {
+      e->last_use = use_count;
+      hits++;
+      addr = e->addr;
+      break;
+    }
+    /* Two live handles never share an fd, and a live handle keeps its
+       fd: either match means the old buffer is gone, drop its mapping. */
+    if (e->addr && (e->handle == handle || e->fd == fd)) {
+      munmap(e->addr, e->size);
+      e->addr = NULL;
+      e->handle = NULL;
+      e->fd = -1;
+    }
+    if (!victim || !e->addr ||
+        (victim->addr && e->last_use < victim->last_use))
+      victim = e;
+  }
+  if (!addr) {
+    misses++;
+    addr = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+      DEBUG_PRINT_ERROR("\n map cache: mmap failed fd %d size %u", fd, size);
+      addr = NULL;
+    } else {
+      if (victim->addr)
+        munmap(victim->addr, victim->size);
+      victim->handle = handle;
+      victim->fd = fd;
+      victim->size = size;
+      victim->addr = addr;
+      victim->last_use = use_count;
+    }
+  }
+  pthread_mutex_unlock(&lock);
+  return addr;
+}
+void omx_video::omx_map_cache::clear()
+{
+  bool mapped = false;
+  pthread_mutex_lock(&lock);
+  for (int i = 0; i < OMX_VIDEO_MAP_CACHE_SIZE; i++) {
+    if (entries[i].addr) {
+      munmap(entries[i].addr, entries[i].size);
+      mapped = true;
+    }
+    entries[i].addr = NULL;
+    entries[i].handle = NULL;
+    entries[i].fd = -1;
+  }
+  if (mapped)
+    DEBUG_PRINT_HIGH("\n map cache: %u hits %u misses", hits, misses);
+  pthread_mutex_unlock(&lock);
+}
 OMX_ERRORTYPE  omx_video::empty_this_buffer_opaque(OMX_IN OMX_HANDLETYPE hComp,
                                                   OMX_IN OMX_BUFFERHEADERTYPE* buffer)
 {
@@ -4828,10 +4941,12 @@ OMX_ERRORTYPE omx_video::convert_queue_buffer(OMX_HANDLETYPE hComp,
            pdest_frame,pdest_frame->nFilledLen);
     }
   } else {
-     uva = (unsigned char *)mmap(NULL, Input_pmem_info.size,
-                           PROT_READ|PROT_WRITE,
-                           MAP_SHARED,Input_pmem_info.fd,0);
-     if(uva == MAP_FAILED) {
+     encoder_media_buffer_type *media_buffer =
+       (encoder_media_buffer_type *)Input_pmem_info.buffer;
+     uva = (unsigned char *)m_map_cache.map(
+             media_buffer ? media_buffer->meta_handle : NULL,
+             Input_pmem_info.fd, Input_pmem_info.size);
+     if(!uva) {
        ret = OMX_ErrorBadParameter;
      } else {
        if(!c2d_conv.convert(Input_pmem_info.fd,uva,
@@ -4858,7 +4973,6 @@ OMX_ERRORTYPE omx_video::convert_queue_buffer(OMX_HANDLETYPE hComp,
                pdest_frame,pdest_frame->nFilledLen);
            }
          }
-         munmap(uva,Input_pmem_info.size);
       }
     }
     if((ret == OMX_ErrorNone) &&
@@ -4906,6 +5020,8 @@ OMX_ERRORTYPE omx_video::push_input_buffer(OMX_HANDLETYPE hComp)
         ret == OMX_ErrorNone) {
     struct pmem Input_pmem_info;
     encoder_media_buffer_type *media_buffer;
+    memset(&Input_pmem_info, 0, sizeof(Input_pmem_info));
+    Input_pmem_info.fd = -1;
     index = pdest_frame - m_inp_mem_ptr;
     if(index >= m_sInPortDef.nBufferCountActual){
        DEBUG_PRINT_ERROR("\n Output buffer index is wrong %d act count %d",
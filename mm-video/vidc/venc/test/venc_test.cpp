@@ -335,6 +335,21 @@ static struct DynamicConfig dynamic_config;
 static long long tot_bufsize = 0;
 int ebd_cnt=0, fbd_cnt=0;
 
+/* ETB->FBD latency, matched on timestamp, and wall clock throughput */
+static const int LATENCY_TS_SLOTS = 64;
+struct LatencySlot
+{
+   long long nTimeStamp;
+   long long nEtbTime;
+   bool bValid;
+};
+static LatencySlot m_sLatencySlots[LATENCY_TS_SLOTS];
+static int m_nLatencyNext = 0;
+static long long* m_pLatency = NULL;
+static int m_nLatencyCnt = 0, m_nLatencySize = 0;
+static long long m_nFirstEtbTime = 0, m_nLastFbdTime = 0;
+static pthread_mutex_t m_latencyMutex = PTHREAD_MUTEX_INITIALIZER;
+
 #ifdef USE_ION
 static const char* PMEM_DEVICE = "/dev/ion";
 #elif MAX_RES_720P
@@ -1067,6 +1082,79 @@ OMX_ERRORTYPE EVT_CB(OMX_IN OMX_HANDLETYPE hComponent,
    return OMX_ErrorNone;
 }
 ////////////////////////////////////////////////////////////////////////////////
+void Latency_MarkEtb(long long nTimeStamp)
+{
+   pthread_mutex_lock(&m_latencyMutex);
+   LatencySlot* pSlot = &m_sLatencySlots[m_nLatencyNext++ % LATENCY_TS_SLOTS];
+   pSlot->nTimeStamp = nTimeStamp;
+   pSlot->nEtbTime = GetTimeStamp();
+   pSlot->bValid = true;
+   if (m_nFirstEtbTime == 0)
+      m_nFirstEtbTime = pSlot->nEtbTime;
+   pthread_mutex_unlock(&m_latencyMutex);
+}
+////////////////////////////////////////////////////////////////////////////////
+void Latency_MarkFbd(OMX_BUFFERHEADERTYPE* pBuffer)
+{
+   if (pBuffer->nFilledLen == 0 ||
+       (pBuffer->nFlags & OMX_BUFFERFLAG_CODECCONFIG))
+      return;
+
+   pthread_mutex_lock(&m_latencyMutex);
+   m_nLastFbdTime = GetTimeStamp();
+   for (int i = 0; i < LATENCY_TS_SLOTS; i++)
+   {
+      if (m_sLatencySlots[i].bValid &&
+          m_sLatencySlots[i].nTimeStamp == pBuffer->nTimeStamp)
+      {
+         if (m_nLatencyCnt == m_nLatencySize)
+         {
+            int nSize = m_nLatencySize ? m_nLatencySize * 2 : 1024;
+            long long* pNew = (long long*) realloc(m_pLatency,
+                                                   nSize * sizeof(long long));
+            if (pNew == NULL)
+               break;
+            m_pLatency = pNew;
+            m_nLatencySize = nSize;
+         }
+         m_pLatency[m_nLatencyCnt++] =
+            m_nLastFbdTime - m_sLatencySlots[i].nEtbTime;
+         m_sLatencySlots[i].bValid = false;
+         break;
+      }
+   }
+   pthread_mutex_unlock(&m_latencyMutex);
+}
+////////////////////////////////////////////////////////////////////////////////
+static int Latency_Compare(const void* a, const void* b)
+{
+   long long x = *(const long long*) a, y = *(const long long*) b;
+   return (x > y) - (x < y);
+}
+////////////////////////////////////////////////////////////////////////////////
+void Latency_Report()
+{
+   pthread_mutex_lock(&m_latencyMutex);
+   if (m_nLastFbdTime > m_nFirstEtbTime && fbd_cnt)
+   {
+      printf("\nSustained throughput: %f buffers/sec",
+             fbd_cnt * 1e6 / (m_nLastFbdTime - m_nFirstEtbTime));
+   }
+   if (m_nLatencyCnt)
+   {
+      qsort(m_pLatency, m_nLatencyCnt, sizeof(long long), Latency_Compare);
+      printf("\nETB->FBD latency (us): p50=%lld p90=%lld p99=%lld max=%lld",
+             m_pLatency[m_nLatencyCnt / 2],
+             m_pLatency[m_nLatencyCnt * 9 / 10],
+             m_pLatency[m_nLatencyCnt * 99 / 100],
+             m_pLatency[m_nLatencyCnt - 1]);
+   }
+   free(m_pLatency);
+   m_pLatency = NULL;
+   m_nLatencyCnt = m_nLatencySize = 0;
+   pthread_mutex_unlock(&m_latencyMutex);
+}
+////////////////////////////////////////////////////////////////////////////////
 OMX_ERRORTYPE EBD_CB(OMX_IN OMX_HANDLETYPE hComponent,
                      OMX_IN OMX_PTR pAppData,
                      OMX_IN OMX_BUFFERHEADERTYPE* pBuffer)
@@ -1112,6 +1200,7 @@ OMX_ERRORTYPE FBD_CB(OMX_OUT OMX_HANDLETYPE hComponent,
    long long currTime = GetTimeStamp();
 
    m_bWatchDogKicked = true;
+   Latency_MarkFbd(pBuffer);
 
    /* Empty Buffers should not be counted */
    if(pBuffer->nFilledLen !=0)
@@ -1241,6 +1330,7 @@ OMX_ERRORTYPE VencTest_EncodeFrame(void* pYUVBuff,
       {
          m_pInBuffers[i]->nTimeStamp = nTimeStamp;
     D("Sending Buffer - %x", m_pInBuffers[i]->pBuffer);
+         Latency_MarkEtb(nTimeStamp);
          result = OMX_EmptyThisBuffer(m_hHandle,
                                       m_pInBuffers[i]);
          /* Counting Buffers supplied to OpenMax Encoder */
@@ -2326,7 +2416,9 @@ int main(int argc, char** argv)
       printf("\n\n Encode Time is zero");
    }
    printf("\nTotal Number of Frames :%d",ebd_cnt);
-   printf("\nNumber of dropped frames during encoding:%d\n",ebd_cnt-fbd_cnt);
+   printf("\nNumber of dropped frames during encoding:%d",ebd_cnt-fbd_cnt);
+   Latency_Report();
+   printf("\n");
    /* End of Time Statistics Logging */
 
    D("main has exited");